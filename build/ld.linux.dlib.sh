@@ -153,7 +153,7 @@ then
                 if [ $STATICSYSLIBS -eq 1 ]
                 then
                     case "$LIBNAME" in
-                    z|bz2)
+                    z|bz2|zstd)
                         # set load to static
                         load-static
                         load-all-symbols
@@ -210,7 +210,7 @@ then
                 else
 
                     case "$LIBNAME" in
-                    z|bz2)
+                    z|bz2|zstd)
                         # set load to dynamic
                         load-ref-symbols
                         load-dynamic
@@ -198,7 +198,7 @@ then
                 if [ $STATICSYSLIBS -eq 1 ]
                 then
                     case "$LIBNAME" in
-                    z|bz2)
+                    z|bz2|zstd)
                         # set load to static
                         load-static
                         load-all-symbols
@@ -276,7 +276,7 @@ then
                 else
 
                     case "$LIBNAME" in
-                    z|bz2)
+                    z|bz2|zstd)
                         # set load to dynamic
                         load-ref-symbols
                         load-dynamic
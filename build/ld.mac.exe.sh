@@ -173,7 +173,7 @@ then
                 if [ $STATICSYSLIBS -eq 1 ]
                 then
                     case "$LIBNAME" in
-                    z|bz2)
+                    z|bz2|zstd)
                         # set load to static
                         load-static
                         ;;
@@ -252,7 +252,7 @@ then
                     # special case for libs we have in "ext"
                     # that are sometimes requested as static
                     case "$LIBNAME" in
-                    z|bz2)
+                    z|bz2|zstd)
                         # set load to dynamic
                         load-dynamic
                         ;;
@@ -62,6 +62,8 @@ HAVE_GZIP=0
 NEED_GZIP=1
 HAVE_BZIP=0
 NEED_BZIP=1
+HAVE_ZSTD=0
+NEED_ZSTD=0
 HAVE_DL=0
 NEED_DL=1
 HAVE_M=0
@@ -256,6 +258,10 @@ do
         LIBS="$LIBS $1"
         HAVE_BZIP=1
         ;;
+    -[lds]zstd)
+        LIBS="$LIBS $1"
+        HAVE_ZSTD=1
+        ;;
     -[lds]dl)
         LIBS="$LIBS $1"
         HAVE_DL=1
@@ -299,6 +305,7 @@ do
         KPROC=4
         HAVE_GZIP=1
         HAVE_BZIP=1
+        HAVE_ZSTD=1
         HAVE_KFC=1
         NEED_M=1
         NEED_XML=1
@@ -309,6 +316,7 @@ do
         KPROC=4
         HAVE_GZIP=1
         HAVE_BZIP=1
+        HAVE_ZSTD=1
         HAVE_KFC=1
         NEED_M=1
         NEED_XML=1
@@ -319,6 +327,7 @@ do
         KPROC=4
         HAVE_GZIP=1
         HAVE_BZIP=1
+        HAVE_ZSTD=1
         HAVE_KFC=1
         NEED_M=16
         NEED_XML=1
@@ -349,6 +358,16 @@ do
         DYLD=2
         ;;
 
+    -[ls]vxf|-[ls]wvxf)
+        LIBS="$LIBS $1"
+        NEED_ZSTD=1
+        ;;
+    -dvxf|-dwvxf)
+        LIBS="$LIBS $1"
+        NEED_ZSTD=1
+        DYLD=2
+        ;;
+
     -[ls]vfs)
         LIBS="$LIBS $1"
         ;;
@@ -512,6 +531,7 @@ fi
 # supply missing libraries
 [ $HAVE_GZIP -eq 0 ] && [ $NEED_GZIP -ne 0 ] && LIBS="$LIBS -lz"
 [ $HAVE_BZIP -eq 0 ] && [ $NEED_BZIP -ne 0 ] && LIBS="$LIBS -lbz2"
+[ $HAVE_ZSTD -eq 0 ] && [ $NEED_ZSTD -ne 0 ] && LIBS="$LIBS -lzstd"
 [ $HAVE_DL -eq 0 ] && [ $NEED_DL -ne 0 ] && LIBS="$LIBS -ldl"
 [ $HAVE_M -eq 0 ] && [ $NEED_M -ne 0 ] && HAVE_M=16
 [ $HAVE_XML -eq 0 ] && [ $NEED_XML -ne 0 ] && HAVE_XML=32
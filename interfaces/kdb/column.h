@@ -184,6 +184,20 @@ KDB_EXTERN rc_t CC KColumnByteOrder ( const KColumn *self, bool *reversed );
 KDB_EXTERN rc_t CC KColumnIdRange ( const KColumn *self, int64_t *first, uint64_t *count );
 
 
+/* LocateBlobs
+ *  find the blobs holding a set of row ids in a single call.
+ *  ids are visited in sorted order, so that ids sharing a blob
+ *  or an index block are resolved together
+ *
+ *  "ids" [ IN ] and "count" [ IN ] - row ids to locate, in any order
+ *
+ *  "first" [ OUT ] and "span" [ OUT ] - for each id, the first row id
+ *  and number of rows of its blob, or 0 and 0 when the id is absent
+ */
+KDB_EXTERN rc_t CC KColumnLocateBlobs ( const KColumn *self,
+    const int64_t *ids, uint32_t count, int64_t *first, uint32_t *span );
+
+
 /* Reindex
  *  optimize indices
  */
@@ -99,6 +99,26 @@ KDB_EXTERN rc_t CC KDBManagerMakeUpdate ( KDBManager **mgr, struct KDirectory *w
 KDB_EXTERN rc_t CC KDBManagerVersion ( const KDBManager *self, uint32_t *version );
 
 
+/* SetIndexCacheLimit
+ *  set the memory each column opened for read from now on may use
+ *  to keep decoded blocks of its blob index between lookups
+ *
+ *  "bytes" [ IN ] - budget per column; 0 disables caching
+ */
+KDB_EXTERN rc_t CC KDBManagerSetIndexCacheLimit ( const KDBManager *self, size_t bytes );
+
+
+/* SetColumnDataMapping
+ *  have columns opened for read from now on map their data fork
+ *  into memory when it is a local file or lies uncompressed within
+ *  an archive, so that blobs are copied out of the mapping instead
+ *  of being read through the file
+ *
+ *  "enabled" [ IN ] - off by default
+ */
+KDB_EXTERN rc_t CC KDBManagerSetColumnDataMapping ( const KDBManager *self, bool enabled );
+
+
 /* Exists
  *  returns true if requested object exists
  *
@@ -63,6 +63,24 @@ KFS_EXTERN rc_t CC KBufFileMakeRead ( struct KFile const ** buf,
     struct KFile const * original, size_t bsize );
 
 
+/* MakeReadAhead
+ *  make a read-only file buffer that detects sequential reads
+ *  and fetches upcoming pages on a background thread
+ *
+ *  "buf" [ OUT ] - return parameter for new buffered file
+ *
+ *  "original" [ IN ] - source file to be buffered. must have read access,
+ *  and must tolerate reads from more than one thread at a time
+ *
+ *  "bsize" [ IN ] - buffer size
+ *
+ *  "read_ahead" [ IN ] - largest number of bytes to fetch ahead of
+ *  sequential reads. limited to half of "bsize". 0 disables read-ahead
+ */
+KFS_EXTERN rc_t CC KBufFileMakeReadAhead ( struct KFile const ** buf,
+    struct KFile const * original, size_t bsize, size_t read_ahead );
+
+
 /* MakeBufferedWrite
  *  make a writable file buffer
  *
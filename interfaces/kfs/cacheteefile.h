@@ -107,6 +107,43 @@ KFS_EXTERN rc_t CC KDirectoryVMakeCacheTee ( struct KDirectory *self,
     struct KFile const **tee, struct KFile const *remote,
     uint32_t blocksize, const char *path, va_list args );
 
+/* -----
+ * TrimCacheDir
+ *  evicts files from a cache directory, least recently used first,
+ *  until the files in it take no more than "budget" bytes on disk
+ *
+ *  the date of a file tells when it was last used, CacheTee-files
+ *  refresh the date of their local file whenever they are made.
+ *  a cache file another CacheTee-file is filling right now is locked
+ *  and left alone, its size still counts against the budget.
+ *
+ *  "budget" [ IN ] - bytes the directory may hold
+ *
+ *  "evicted" [ OUT, NULL OKAY ] - return parameter for bytes removed
+ *
+ *  "path" [ IN ] - NUL terminated string in directory-native
+ *  character set denoting the cache directory, sub-directories
+ *  are not visited
+ */
+KFS_EXTERN rc_t CC KDirectoryTrimCacheDir ( struct KDirectory *self,
+    uint64_t budget, uint64_t *evicted, const char *path, ... );
+KFS_EXTERN rc_t CC KDirectoryVTrimCacheDir ( struct KDirectory *self,
+    uint64_t budget, uint64_t *evicted, const char *path, va_list args );
+
+/* -----
+ * starts a background thread on a CacheTee-file, which fetches the blocks
+ * not yet in the cache while readers proceed
+ *
+ * blocks following the most recent read come first, then the file wraps around
+ * the thread ends when every block is cached, or the file is released,
+ * at which point a complete cache will be promoted
+ *
+ * does nothing if "self" is not a writable CacheTee-file, e.g. because
+ * the cache was already complete and KDirectoryMakeCacheTee returned it directly
+ */
+KFS_EXTERN rc_t CC StartCacheFill( const struct KFile * self );
+
+
 /* -----
  * checks if a given file ( has to be a local file )
  *
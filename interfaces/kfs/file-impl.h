@@ -51,6 +51,7 @@ struct timeout_t;
 struct KSysFile_v1;
 struct KSysFile_v2;
 struct KDirectory_v1;
+struct KFileReadVec;
 typedef union KFile_vt KFile_vt;
 extern KItfTok KFile_tok_v2;
 
@@ -118,6 +119,11 @@ struct KFile_vt_v1
         const void *buffer, size_t size, size_t *num_writ, struct timeout_t *tm );
     /* end minor version == 2 */
 
+    /* start minor version == 3 */
+    /* short counts are completed by the caller, as by ReadAll */
+    rc_t ( CC * read_v ) ( const KFILE_IMPL *self, struct KFileReadVec *vec, uint32_t count );
+    /* end minor version == 3 */
+
     /* ANY NEW ENTRIES MUST BE REFLECTED IN libs/kfs/file.c
        BY BOTH THE CORRESPONDING MESSAGE DISPATCH FUNCTION(s) AND
        VTABLE VALIDITY CHECKS IN KFileInit_v1 */
@@ -150,6 +150,30 @@ KFS_EXTERN rc_t CC KFileReadAll_v1 ( const KFile_v1 *self, uint64_t pos,
 KFS_EXTERN rc_t CC KFileTimedReadAll_v1 ( const KFile_v1 *self, uint64_t pos,
     void *buffer, size_t bsize, size_t *num_read, struct timeout_t *tm );
 
+/* ReadV
+ *  read several ranges of a file with a single message,
+ *  allowing implementations to combine or overlap the transfers
+ *
+ *  "vec" [ IN/OUT ] and "count" [ IN ] - ranges to read. each
+ *  range is read as by ReadAll, and receives in "num_read" the
+ *  number of bytes read, which is less than "bsize" only at
+ *  end of file.
+ *
+ *  ranges given in ascending order, without overlap, are read
+ *  most efficiently.
+ */
+typedef struct KFileReadVec KFileReadVec;
+struct KFileReadVec
+{
+    uint64_t pos;
+    void *buffer;
+    size_t bsize;
+    size_t num_read;
+};
+
+KFS_EXTERN rc_t CC KFileReadV_v1 ( const KFile_v1 *self,
+    KFileReadVec *vec, uint32_t count );
+
 /* ReadExactly
  * TimedReadExactly
  *  read from file until "bytes" have been retrieved
@@ -79,6 +79,7 @@ enum KFileDesc
 #define KFileTimedRead NAME_VERS ( KFileTimedRead, KFILE_VERS )
 #define KFileReadAll NAME_VERS ( KFileReadAll, KFILE_VERS )
 #define KFileTimedReadAll NAME_VERS ( KFileTimedReadAll, KFILE_VERS )
+#define KFileReadV NAME_VERS ( KFileReadV, KFILE_VERS )
 #define KFileReadExactly NAME_VERS ( KFileReadExactly, KFILE_VERS )
 #define KFileTimedReadExactly NAME_VERS ( KFileTimedReadExactly, KFILE_VERS )
 #define KFileWrite NAME_VERS ( KFileWrite, KFILE_VERS )
@@ -0,0 +1,171 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_kfs_ioqueue_
+#define _h_kfs_ioqueue_
+
+#ifndef _h_kfs_extern_
+#include <kfs/extern.h>
+#endif
+
+#ifndef _h_klib_defs_
+#include <klib/defs.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+/*--------------------------------------------------------------------------
+ * forwards
+ */
+struct KFile;
+struct KFileReadVec;
+
+
+/*--------------------------------------------------------------------------
+ * KFileIOQueue
+ *  a queue of asynchronous reads
+ *
+ *  on Linux, reads from system files are handed to the kernel through
+ *  io_uring, so that many of them may be outstanding at once. files
+ *  without a system file underneath, or kernels without io_uring,
+ *  fall back to performing each read as it is queued.
+ *
+ *  a queue is not thread safe - give each thread its own.
+ */
+typedef struct KFileIOQueue KFileIOQueue;
+
+
+/* Make
+ *  create a queue allowing up to "depth" outstanding reads
+ */
+KFS_EXTERN rc_t CC KFileIOQueueMake ( KFileIOQueue **q, uint32_t depth );
+
+
+/* AddRef
+ * Release
+ */
+KFS_EXTERN rc_t CC KFileIOQueueAddRef ( const KFileIOQueue *self );
+KFS_EXTERN rc_t CC KFileIOQueueRelease ( const KFileIOQueue *self );
+
+
+/* Asynchronous
+ *  returns true if reads are performed by the kernel
+ *  in the background, false if they happen as queued
+ */
+KFS_EXTERN bool CC KFileIOQueueAsynchronous ( const KFileIOQueue *self );
+
+
+/* RegisterBuffers
+ *  pin a set of buffers for use by subsequent reads
+ *  the kernel maps them once, rather than on every read
+ *
+ *  "buffers" [ IN ] and "sizes" [ IN ] - "count" buffers and their sizes
+ *
+ *  registration replaces any previous set. buffers must remain valid
+ *  until the queue is released or registers another set. when pinning
+ *  is not possible, the buffers are still accepted and used normally.
+ */
+KFS_EXTERN rc_t CC KFileIOQueueRegisterBuffers ( KFileIOQueue *self,
+    void * const *buffers, const size_t *sizes, uint32_t count );
+
+
+/* Read
+ *  queue a read
+ *
+ *  "f" [ IN ] - file to read, attached until the read completes
+ *
+ *  "pos" [ IN ] - starting position within file
+ *
+ *  "buffer" [ OUT ] and "bsize" [ IN ] - return buffer for read.
+ *  it must remain valid until the read completes.
+ *
+ *  "buf_idx" [ IN ] - index of the registered buffer containing
+ *  "buffer", or -1 if it is not registered
+ *
+ *  "data" [ IN, NULL OKAY ] - returned with the completion
+ *
+ *  queued reads are handed to the kernel by Submit or Complete.
+ *  returns rcExhausted when "depth" reads are outstanding,
+ *  in which case some must be completed first.
+ */
+KFS_EXTERN rc_t CC KFileIOQueueRead ( KFileIOQueue *self, struct KFile const *f,
+    uint64_t pos, void *buffer, size_t bsize, int32_t buf_idx, void *data );
+
+
+/* Submit
+ *  hand queued reads to the kernel without waiting for any to complete
+ */
+KFS_EXTERN rc_t CC KFileIOQueueSubmit ( KFileIOQueue *self );
+
+
+/* Complete
+ *  retrieve a completed read
+ *
+ *  "c" [ OUT ] - the completed read. "num_read" is less than requested
+ *  only at end of file, "rc" gives its individual outcome.
+ *
+ *  "wait" [ IN ] - when true, block until a read completes
+ *
+ *  returns rcDone when no reads are outstanding,
+ *  and rcIncomplete when none have completed and "wait" is false.
+ */
+typedef struct KFileIOCompletion KFileIOCompletion;
+struct KFileIOCompletion
+{
+    uint64_t pos;
+    void *buffer;
+    void *data;
+    size_t num_read;
+    rc_t rc;
+};
+
+KFS_EXTERN rc_t CC KFileIOQueueComplete ( KFileIOQueue *self,
+    KFileIOCompletion *c, bool wait );
+
+
+/* Outstanding
+ *  the number of reads queued but not yet retrieved by Complete
+ */
+KFS_EXTERN uint32_t CC KFileIOQueueOutstanding ( const KFileIOQueue *self );
+
+
+/* ReadV
+ *  read several ranges of a file, keeping up to "depth" in flight
+ *  same contract as KFileReadV - each range is filled unless it
+ *  reaches end of file. the queue must have no reads outstanding.
+ */
+KFS_EXTERN rc_t CC KFileIOQueueReadV ( KFileIOQueue *self, struct KFile const *f,
+    struct KFileReadVec *vec, uint32_t count );
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _h_kfs_ioqueue_ */
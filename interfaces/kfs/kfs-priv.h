@@ -61,6 +61,31 @@ KFS_EXTERN rc_t CC KFileMakeFDFileWrite ( struct KFile **f, bool update, int fd
 KFS_EXTERN struct KFile_v2 const * CC KFileMakeFDFileRead_v2 ( ctx_t ctx, int fd );
 KFS_EXTERN struct KFile_v2 * CC KFileMakeFDFileWrite_v2 ( ctx_t ctx, bool update, int fd );
 
+/* LockRange
+ * UnlockRange
+ *  advisory lock on "size" bytes at "pos" of a file with a system file
+ *  underneath, a "size" of 0 extends to any end of file. ranges may lie
+ *  beyond end of file.
+ *
+ *  where the system has open file description locks ( Linux 3.15 and
+ *  later ), a lock belongs to the file object: it conflicts with locks
+ *  taken through other file objects, in this process or another, and
+ *  lasts until unlocked or the object is closed. elsewhere locks belong
+ *  to the process, do not exclude its threads, and are dropped when any
+ *  of its handles to the file is closed.
+ *
+ *  "exclusive" [ IN ] - write lock when true, read lock when false
+ *
+ *  "wait" [ IN ] - when false, return rcBusy instead of blocking
+ *  while a conflicting lock is held
+ *
+ *  not supported under Windows
+ */
+KFS_EXTERN rc_t CC KFileLockRange ( struct KFile const *self,
+    uint64_t pos, uint64_t size, bool exclusive, bool wait );
+KFS_EXTERN rc_t CC KFileUnlockRange ( struct KFile const *self,
+    uint64_t pos, uint64_t size );
+
 /* GetMeta
  *  extracts metadata into a string-vector
  *
@@ -92,6 +92,29 @@ KFS_EXTERN rc_t CC KMMapReposition ( const KMMap *self, uint64_t pos, size_t *si
 KFS_EXTERN rc_t CC KMMapAddrRead ( const KMMap *self, const void **addr );
 KFS_EXTERN rc_t CC KMMapAddrUpdate ( KMMap *self, void **addr );
 
+/* Advise
+ *  tell the system how a part of the region is going to be used
+ *
+ *  "pos" [ IN ] and "size" [ IN ] - range of the mapped file,
+ *  cropped to the region
+ *
+ *  "advice" [ IN ] - expected use of the range
+ *
+ *  returns rcUnsupported if the region is not backed by a system mapping
+ */
+typedef uint32_t KMMapAdvice;
+enum
+{
+    kmmaNormal,
+    kmmaRandom,
+    kmmaSequential,
+    kmmaWillNeed,
+    kmmaDontNeed
+};
+
+KFS_EXTERN rc_t CC KMMapAdvise ( const KMMap *self,
+    uint64_t pos, size_t size, KMMapAdvice advice );
+
 /* Make
  *  maps entire file
  *
@@ -176,6 +176,28 @@ KFS_EXTERN rc_t CC KPageFileGet ( KPageFile *self, KPage **page, uint32_t page_i
 KFS_EXTERN rc_t CC KPageFilePosGet ( KPageFile *self, KPage **page, uint64_t offset );
 
 
+/* Has
+ *  answers whether a page is currently cached,
+ *  without affecting its position in the cache
+ *
+ *  "page_id" [ IN ] - id of page to look for
+ */
+KFS_EXTERN bool CC KPageFileHas ( const KPageFile *self, uint32_t page_id );
+
+
+/* Insert
+ *  caches a page whose contents were read from the backing file by
+ *  other means, e.g. ahead of use. does nothing if already cached
+ *
+ *  "page_id" [ IN ] - id of page to cache
+ *
+ *  "data" [ IN ] and "bytes" [ IN ] - page contents. a partial
+ *  page, e.g. at end of file, is zero-padded
+ */
+KFS_EXTERN rc_t CC KPageFileInsert ( KPageFile *self, uint32_t page_id,
+    const void *data, size_t bytes );
+
+
 /* DropBacking
  *  used immediately prior to releasing
  *  prevents modified pages from being flushed to disk
@@ -52,6 +52,13 @@ extern "C" {
 KLIB_EXTERN KTime_t CC KTimeStamp ( void );
 
 
+/* NsStamp
+ *  monotonic timestamp in nanoseconds
+ *  meaningful only as a difference between two stamps
+ */
+KLIB_EXTERN uint64_t CC KTimeNsStamp ( void );
+
+
 /*--------------------------------------------------------------------------
  * KTime
  *  simple time structure
@@ -66,6 +66,39 @@ KNS_EXTERN rc_t CC KNSManagerSetHTTPTimeouts ( struct KNSManager *self,
     int32_t readMillis, int32_t writeMillis );
 
 
+/* SetHTTPParallelRead
+ *  sets how HTTP files made afterwards split large reads:
+ *  a read spanning at least two chunks is issued as concurrent
+ *  range requests, one chunk at a time per connection, and
+ *  reassembled in order into the caller's buffer
+ *
+ *  "connections" [ IN ] - number of connections a file may read over
+ *  at once, up to 16. 0 or 1 keeps to a single connection ( default )
+ *
+ *  "chunk_size" [ IN ] - size in bytes of each range request,
+ *  at least 1K. 0 selects the default of 1M
+ */
+KNS_EXTERN rc_t CC KNSManagerSetHTTPParallelRead ( struct KNSManager *self,
+    uint32_t connections, size_t chunk_size );
+
+
+/* SetHTTPConnectionPool
+ *  sets limits on the keep-alive connections a manager keeps for reuse.
+ *  an HTTP client of the manager hands its connection back when released,
+ *  and a new client to the same host and port takes the most recent one
+ *  that is still open and idle instead of connecting again
+ *
+ *  "max_idle" [ IN ] - connections kept over all hosts ( default 32 )
+ *
+ *  "max_per_host" [ IN ] - connections kept per host and port ( default 4 ).
+ *  0 for either disables reuse
+ *
+ *  "idle_secs" [ IN ] - connections idle for longer are closed ( default 30 )
+ */
+KNS_EXTERN rc_t CC KNSManagerSetHTTPConnectionPool ( struct KNSManager *self,
+    uint32_t max_idle, uint32_t max_per_host, uint32_t idle_secs );
+
+
 
 /*------------------------------------------------------------------------------
  * KFile
@@ -51,6 +51,7 @@ extern "C" {
  */
 struct VBlob;
 struct VTable;
+struct KNamelist;
 struct VTypedesc;
 struct VTypedecl;
 
@@ -118,6 +119,25 @@ VDB_EXTERN rc_t CC VTableCreateCachedCursorRead ( struct VTable const *self,
     const VCursor **curs, size_t capacity );
 
 
+/* CreateProjectedCursorRead
+ *  creates a cached read cursor that declares up front which
+ *  columns it is going to read. only physical columns reached by
+ *  these are opened, and columns missing from schema are only made
+ *  up for declared names, so that columns outside the projection
+ *  cost neither time nor file handles.
+ *
+ *  "curs" [ OUT ] - return parameter for newly created cursor
+ *
+ *  "capacity" [ IN ] - as for CreateCachedCursorRead
+ *
+ *  "columns" [ IN ] and "count" [ IN ] - simple names of the columns,
+ *  without type casts. columns that exist only as physical columns
+ *  of the table cannot be added unless declared here
+ */
+VDB_EXTERN rc_t CC VTableCreateProjectedCursorRead ( struct VTable const *self,
+    const VCursor **curs, size_t capacity, const char * const *columns, uint32_t count );
+
+
 /* AddColumn
  *  add a column to an unopened cursor
  *
@@ -252,6 +272,17 @@ VDB_EXTERN rc_t CC VCursorCloseRow ( const VCursor *self );
  */
 VDB_EXTERN rc_t CC VCursorFlushPage ( VCursor *self );
 
+/* SetFlushThreads
+ *  sets the number of threads used to encode the columns of
+ *  a flushed page. columns are compressed concurrently, but
+ *  written in the same order and with the same results as
+ *  when encoded serially. the threads are started here and
+ *  kept until the count changes or the cursor is released.
+ *
+ *  "count" [ IN ] - 0 or 1 to encode on the flushing thread alone
+ */
+VDB_EXTERN rc_t CC VCursorSetFlushThreads ( VCursor *self, uint32_t count );
+
 
 /* GetBlob
  *  retrieve a blob of data containing the current row id
@@ -362,6 +393,62 @@ VDB_EXTERN rc_t CC VCursorCellDataDirect ( const VCursor *self, int64_t row_id,
     uint32_t *boff, uint32_t *row_len );
 
 
+/* CellDataPinned
+ *  access a single cell like "CellDataDirect", but keep the decoded
+ *  blob holding it alive until the reference is released.
+ *  any number of references may be held at once, to cells of the
+ *  same or different blobs, independently of further reads on
+ *  the cursor and of its cache
+ *
+ *  "row_id" [ IN ] - row to be accessed
+ *
+ *  "col_idx" [ IN ] - index of column to be read, returned by "AddColumn"
+ *
+ *  "ref" [ OUT ] - cell description holding a blob reference.
+ *  must be released via "VCellRefRelease" on success.
+ *  "base", "boff" and "row_len" have the same meaning as
+ *  in "CellDataDirect"
+ */
+typedef struct VCellRef VCellRef;
+struct VCellRef
+{
+    struct VBlob const *blob;
+    const void *base;
+    uint32_t elem_bits;
+    uint32_t boff;
+    uint32_t row_len;
+};
+
+VDB_EXTERN rc_t CC VCursorCellDataPinned ( const VCursor *self, int64_t row_id,
+    uint32_t col_idx, VCellRef *ref );
+
+/* Release
+ *  drop the blob reference of a pinned cell and clear it
+ */
+VDB_EXTERN rc_t CC VCellRefRelease ( VCellRef *ref );
+
+
+/* ReadBatch
+ *  access cells of a contiguous range of rows in one pass
+ *  each blob is resolved once, and the locations of all of
+ *  its cells within the range are walked without a search per row
+ *
+ *  "col_idx" [ IN ] - index of column to be read, returned by "AddColumn"
+ *
+ *  "first_row" [ IN ] and "count" [ IN ] - range of rows to be read
+ *
+ *  "f" [ IN ] and "data" [ IN, OPAQUE ] - callback invoked for each row
+ *  in ascending order, receiving the same cell description as
+ *  "CellDataDirect". "base" remains valid only during the call.
+ *  returning non-zero stops the batch and is returned to caller.
+ */
+typedef rc_t ( CC * VCursorBatchFunc ) ( int64_t row_id, uint32_t elem_bits,
+    const void *base, uint32_t boff, uint32_t row_len, void *data );
+
+VDB_EXTERN rc_t CC VCursorReadBatch ( const VCursor *self, uint32_t col_idx,
+    int64_t first_row, uint64_t count, VCursorBatchFunc f, void *data );
+
+
 /* VCursorDataPrefetch
  * -- will prefecth rows into CursorCache (if it exists)
  * -- no OUT parameters - just primes the cache 
@@ -385,6 +472,51 @@ LIB_EXPORT rc_t CC VCursorDataPrefetch ( const VCursor * self,
     int64_t min_valid_row_id, int64_t max_valid_row_id, bool continue_on_error );
 
 
+/* VCursorPrefetch
+ *  completion handle for an asynchronous prefetch
+ */
+typedef struct VCursorPrefetch VCursorPrefetch;
+
+
+/* VCursorDataPrefetchAsync
+ * -- same contract as VCursorDataPrefetch, but returns immediately
+ * -- the sorted rows are grouped by the blob holding them, and each
+ *    group is handed to one of a pool of worker threads, decoding
+ *    blobs through its own read cursor onto the same table
+ * -- every decoded blob is published into the CursorCache as soon
+ *    as it is ready, so reads may proceed while prefetch is running
+ * -- only one asynchronous prefetch is outstanding per cursor;
+ *    starting a new one waits for the previous one to complete
+ * -- releasing the cursor cancels rows not yet handed to a worker
+ * -- the underlying files must tolerate concurrent reads
+ *
+ * "num_threads" [ IN ] - size of worker pool, 0 for default
+ *
+ * "handle" [ OUT, NULL OKAY ] - optional completion handle;
+ *  must be released with VCursorPrefetchRelease. when NULL,
+ *  the prefetch runs detached and is collected by the cursor.
+ */
+VDB_EXTERN rc_t CC VCursorDataPrefetchAsync ( const VCursor * self,
+    const int64_t * row_ids, uint32_t col_idx, uint32_t num_rows,
+    int64_t min_valid_row_id, int64_t max_valid_row_id, bool continue_on_error,
+    uint32_t num_threads, VCursorPrefetch ** handle );
+
+/* VCursorPrefetchWait
+ *  wait for all workers to finish
+ *  returns a "canceled" rc if the cursor was released
+ *  before all rows were prefetched
+ *
+ *  "status" [ OUT, NULL OKAY ] - the first error encountered
+ *  by the workers, or 0
+ */
+VDB_EXTERN rc_t CC VCursorPrefetchWait ( VCursorPrefetch * self, rc_t * status );
+
+/* VCursorPrefetchRelease
+ *  release handle; does not cancel or wait for the prefetch
+ */
+VDB_EXTERN rc_t CC VCursorPrefetchRelease ( const VCursorPrefetch * self );
+
+
 /* Default
  *  give a default row value for cell
  *  TBD - document full cell data, not append
@@ -459,6 +591,65 @@ VDB_EXTERN uint64_t CC VCursorSetCacheCapacity(VCursor *self,uint64_t capacity);
 VDB_EXTERN uint64_t CC VCursorGetCacheCapacity(const VCursor *self);
 
 
+/* ListPhysicalColumns
+ *  lists the physical columns of the table that the cursor has opened
+ *  to produce its columns, e.g. to see what a projection reaches
+ *
+ *  "names" [ OUT ] - simple names of physical columns, without
+ *  leading '.'; includes static columns kept in metadata
+ */
+VDB_EXTERN rc_t CC VCursorListPhysicalColumns ( const VCursor *self, struct KNamelist **names );
+
+/* SetCacheDepth
+ *  sets how many recently used blobs of each column a cached read
+ *  cursor checks before searching its cache. the default of 2 suits
+ *  sequential reads; interleaved access to several parts of a column
+ *  benefits from more. must be called before "Open"
+ *
+ *  "depth" [ IN ] - 1 .. 64
+ */
+VDB_EXTERN rc_t CC VCursorSetCacheDepth ( const VCursor *self, uint32_t depth );
+
+/* GetCacheStats
+ *  report how well the blob cache of a read cursor serves its reads
+ *
+ *  "col_idx" [ IN ] - index of column returned by "AddColumn",
+ *  or 0 for totals over the cursor
+ *
+ *  "stats" [ OUT ] - counters accumulated since the cursor was opened.
+ *  "raises" counts the times a single blob larger than the capacity
+ *  forced the capacity up, and is only kept in totals.
+ *  returns rcNotAvailable if the cursor was opened without a cache
+ */
+typedef struct VCursorCacheStats VCursorCacheStats;
+struct VCursorCacheStats
+{
+    uint64_t hits;          /* reads served from a cached blob */
+    uint64_t misses;        /* reads that had to decode a blob */
+    uint64_t evictions;     /* blobs dropped to stay within capacity */
+    uint64_t bytes_decoded; /* size of blobs decoded on misses */
+    uint64_t decode_ns;     /* time spent decoding on misses */
+    uint64_t capacity;      /* current capacity in bytes */
+    uint64_t raises;
+};
+
+VDB_EXTERN rc_t CC VCursorGetCacheStats ( const VCursor *self,
+    uint32_t col_idx, VCursorCacheStats *stats );
+
+/* SetCacheAdaptive
+ *  let the cache capacity follow the observed re-reference distance:
+ *  a blob decoded again shortly after being evicted grows the
+ *  capacity by the amount that would have kept it, while a stretch
+ *  of reads without such blobs gives memory back, never below the
+ *  capacity the cursor had when adaptation was enabled.
+ *  growth is drawn from the budget set by "VDBManagerSetCacheBudget"
+ *
+ *  "enable" [ IN ] - false returns borrowed memory and fixes
+ *  the capacity at its base again
+ */
+VDB_EXTERN rc_t CC VCursorSetCacheAdaptive ( const VCursor *self, bool enable );
+
+
 
 #ifdef __cplusplus
 }
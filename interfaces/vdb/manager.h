@@ -181,6 +181,30 @@ VDB_EXTERN rc_t CC VDBManagerGetObjModDate ( const VDBManager *self,
     KTime_t * ts, const char *path );
 
 
+/* EnableSharedBlobCache
+ *  share decoded blobs among all read cursors subsequently created
+ *  on this manager, including cursors used from different threads.
+ *  a blob is decoded only once even when several cursors ask for it
+ *  at the same time.
+ *
+ *  "capacity" [ IN ] - memory budget in bytes for all tables and columns.
+ *  calling again only changes the budget; the cache stays enabled
+ *  for the lifetime of the manager
+ */
+VDB_EXTERN rc_t CC VDBManagerEnableSharedBlobCache ( const VDBManager *self, size_t capacity );
+
+
+/* SetCacheBudget
+ *  limits how much memory cursors with an adaptive cache
+ *  ( see "VCursorSetCacheAdaptive" ) may together add to
+ *  their capacities. the default is 256MB.
+ *
+ *  "bytes" [ IN ] - new budget. lowering it below what is in use
+ *  does not shrink caches, but stops them from growing
+ */
+VDB_EXTERN rc_t CC VDBManagerSetCacheBudget ( const VDBManager *self, size_t bytes );
+
+
 /* PathType
  *  check the path type of an object/directory path.
  *
@@ -52,10 +52,22 @@
 #define SUB_DEBUG(msg)
 #endif
 
+/* bases of reference read ahead on sequential access */
+#define WINDOW_BASES ( 1024 * 1024 )
+
 typedef struct RestoreRead RestoreRead;
 struct RestoreRead
 {
     const RefSeqMgr* rmgr;
+    int64_t last_row_id;
+
+    /* window of the reference last read ahead,
+       covering [ win_start, win_start + win_len ) */
+    const RefSeq* seq;
+    KDataBuffer seqid;
+    KDataBuffer window;
+    INSDC_coord_zero win_start;
+    INSDC_coord_len win_len;
 };
 
 
@@ -66,6 +78,8 @@ void CC RestoreReadWhack ( void *obj )
     if ( self != NULL )
     {
         rc_t rc;
+        KDataBufferWhack( &self->seqid );
+        KDataBufferWhack( &self->window );
         rc = RefSeqMgr_Release( self->rmgr );
         assert( rc == 0 );
         free( self );
@@ -91,6 +105,9 @@ rc_t RestoreReadMake ( RestoreRead **objp, const VDBManager *mgr )
     {
         SUB_DEBUG( ( "SUB.Make in 'ref_restore_read.c'\n" ) );
 
+        obj->seqid.elem_bits = 8;
+        obj->window.elem_bits = 8;
+
         rc = RefSeqMgr_Make( &obj->rmgr, mgr, errefseq_4NA, 8 * 1024 * 1024, 30 );
         if ( rc == 0 )
         {
@@ -106,6 +123,61 @@ rc_t RestoreReadMake ( RestoreRead **objp, const VDBManager *mgr )
 }
 
 
+/* RestoreReadWindow
+ *  read ahead the reference from "offset" into the window,
+ *  so that the following rows of a sequential pass are
+ *  copied from memory rather than read one at a time
+ */
+static
+rc_t RestoreReadWindow ( RestoreRead* self, const char* seqid, uint32_t seqid_len,
+                         INSDC_coord_zero offset, INSDC_coord_len seq_len )
+{
+    rc_t rc = 0;
+    INSDC_coord_len length, win_len;
+
+    if ( self->seq == NULL || self->seqid.elem_count != seqid_len ||
+         memcmp( self->seqid.base, seqid, seqid_len ) != 0 )
+    {
+        self->seq = NULL;
+        self->win_len = 0;
+        rc = KDataBufferResize( &self->seqid, seqid_len );
+        if ( rc == 0 )
+        {
+            memcpy( self->seqid.base, seqid, seqid_len );
+            rc = RefSeqMgr_GetSeq( self->rmgr, &self->seq, seqid, seqid_len );
+        }
+        if ( rc != 0 )
+        {
+            self->seq = NULL;
+            return rc;
+        }
+    }
+
+    rc = RefSeq_SeqLength( self->seq, &length );
+    if ( rc == 0 )
+    {
+        /* rows wrapping around a circular reference are read directly */
+        if ( offset < 0 || ( uint64_t )offset + seq_len > length )
+            return RC( rcXF, rcFunction, rcExecuting, rcRange, rcExcessive );
+
+        win_len = length - offset;
+        if ( win_len > WINDOW_BASES )
+            win_len = seq_len > WINDOW_BASES ? seq_len : WINDOW_BASES;
+
+        self->win_len = 0;
+        rc = KDataBufferResize( &self->window, win_len );
+        if ( rc == 0 )
+        {
+            rc = RefSeq_Read( self->seq, offset, win_len, self->window.base, &self->win_len );
+            if ( rc == 0 )
+                self->win_start = offset;
+            else
+                self->win_len = 0;
+        }
+    }
+    return rc;
+}
+
 static
 rc_t CC ref_restore_read_impl ( void *data, const VXformInfo *info, int64_t row_id,
                                 VRowResult *rslt, uint32_t argc, const VRowData argv [] )
@@ -119,6 +191,7 @@ rc_t CC ref_restore_read_impl ( void *data, const VXformInfo *info, int64_t row_
     const char* seqid     = argv[ 1 ].u.data.base;
     INSDC_coord_one   seq_start;
     INSDC_coord_len   seq_len;
+    int64_t           last_row_id;
 
     assert( argv[ 0 ].u.data.elem_bits == 8 );
     assert( argv[ 1 ].u.data.elem_bits == 8 );
@@ -132,6 +205,9 @@ rc_t CC ref_restore_read_impl ( void *data, const VXformInfo *info, int64_t row_
     seq_start = ( ( INSDC_coord_one* )argv[ 2 ].u.data.base )[ argv[ 2 ].u.data.first_elem ];
     seq_len   = ( ( INSDC_coord_len* )argv[ 3 ].u.data.base )[ argv[ 3 ].u.data.first_elem ];
 
+    last_row_id = self->last_row_id;
+    self->last_row_id = row_id;
+
     if ( seq_len < read_len )
     {
         rc = RC( rcXF, rcFunction, rcExecuting, rcData, rcInvalid );
@@ -160,6 +236,21 @@ rc_t CC ref_restore_read_impl ( void *data, const VXformInfo *info, int64_t row_
                 {
                     memset( dst, 15, seq_len ); /* fill with 'N' */
                 }
+                else if ( self->seq != NULL &&
+                          self->seqid.elem_count == seqid_len &&
+                          memcmp( self->seqid.base, seqid, seqid_len ) == 0 &&
+                          seq_start - 1 >= self->win_start &&
+                          ( uint64_t )( seq_start - 1 - self->win_start ) + seq_len <= self->win_len )
+                {
+                    /* row is within the window read ahead */
+                    memcpy( dst, ( const uint8_t* )self->window.base + ( seq_start - 1 - self->win_start ), seq_len );
+                }
+                else if ( row_id == last_row_id + 1 &&
+                          RestoreReadWindow( self, seqid, seqid_len, seq_start - 1, seq_len ) == 0 &&
+                          self->win_len >= seq_len )
+                {
+                    memcpy( dst, self->window.base, seq_len );
+                }
                 else
                 {
                     INSDC_coord_len read = 0;
@@ -36,6 +36,7 @@
 #include <klib/debug.h>
 #include <kdb/meta.h>
 #include <klib/data-buffer.h>
+#include <klib/sort.h>
 #include <insdc/insdc.h>
 #include <align/refseq-mgr.h>
 #include <bitstr.h>
@@ -53,15 +54,23 @@
 #define SUB_DEBUG(msg)
 #endif
 
+/* limits on a single batch of alignments */
+#define BATCH_MAX_IDS   ( 16 * 1024 )
+#define BATCH_MAX_BASES ( 32 * 1024 * 1024 )
+
 typedef struct RestoreRead RestoreRead;
 struct RestoreRead
 {
     const VCursor *curs;
     uint32_t read_idx;
     int64_t  last_row_id;
-    int64_t  last_sequentual_row_id;
-	int64_t  prefetch_start_id;
-	int64_t  prefetch_stop_id;
+
+    /* reads of the last batch of alignments, sorted by id;
+       read i occupies bases [ offset [ i ], offset [ i + 1 ] ) */
+    KDataBuffer ids;
+    KDataBuffer offset;
+    KDataBuffer bases;
+    uint32_t num_ids;
 };
 
 static
@@ -71,6 +80,9 @@ void CC RestoreReadWhack ( void *obj )
     if ( self != NULL )
     {
         VCursorRelease ( self -> curs );
+        KDataBufferWhack ( & self -> ids );
+        KDataBufferWhack ( & self -> offset );
+        KDataBufferWhack ( & self -> bases );
         free ( self );
     }
 }
@@ -82,8 +94,7 @@ rc_t RestoreReadMake ( RestoreRead **objp, const VTable *tbl, const VCursor* nat
     char name[]="PRIMARY_ALIGNMENT";
 
     /* create the object */
-    RestoreRead *obj = malloc ( sizeof * obj );
-    memset(obj,0,sizeof * obj);
+    RestoreRead *obj = calloc ( 1, sizeof * obj );
     if ( obj == NULL )
     {
 		*objp=0;
@@ -91,6 +102,10 @@ rc_t RestoreReadMake ( RestoreRead **objp, const VTable *tbl, const VCursor* nat
     }
     else
 	{
+		obj -> ids . elem_bits = 64;
+		obj -> offset . elem_bits = 64;
+		obj -> bases . elem_bits = 8;
+
 		rc = VCursorLinkedCursorGet(native_curs,name,&obj->curs);
 		if(rc == 0){
 			VCursorAddRef(obj->curs);
@@ -153,6 +168,107 @@ static INSDC_4na_bin  map[]={
 /*15  1111 - 1111*/ 15
 };
 
+/* RestoreReadFind
+ *  locate an alignment within the current batch
+ */
+static
+bool RestoreReadFind ( const RestoreRead *self, int64_t id,
+                       const INSDC_4na_bin **r_src, uint32_t *r_src_len )
+{
+    const int64_t *ids = self -> ids . base;
+    uint32_t lower = 0, upper = self -> num_ids;
+
+    while ( lower < upper )
+    {
+        uint32_t mid = lower + ( upper - lower ) / 2;
+        if ( ids [ mid ] < id )
+            lower = mid + 1;
+        else
+            upper = mid;
+    }
+
+    if ( lower < self -> num_ids && ids [ lower ] == id )
+    {
+        const uint64_t *offset = self -> offset . base;
+        * r_src = ( const INSDC_4na_bin* ) self -> bases . base + offset [ lower ];
+        * r_src_len = ( uint32_t ) ( offset [ lower + 1 ] - offset [ lower ] );
+        return true;
+    }
+
+    return false;
+}
+
+/* RestoreReadBatch
+ *  replace the current batch with the alignments referenced by "align_id",
+ *  fetched in a single pass in ascending id order so that every blob of
+ *  the alignment table is visited once rather than once per row.
+ *  on failure the batch keeps whatever was fetched; rows fall back to
+ *  reading missing alignments directly.
+ */
+static
+void RestoreReadBatch ( RestoreRead *self, const int64_t *align_id, uint32_t count )
+{
+    rc_t rc;
+    uint32_t i, num_ids;
+    int64_t *ids;
+    uint64_t *offset;
+
+    self -> num_ids = 0;
+
+    rc = KDataBufferResize ( & self -> ids, count );
+    if ( rc != 0 )
+        return;
+
+    /* sort-unique the alignment ids */
+    ids = self -> ids . base;
+    for ( i = num_ids = 0; i < count; ++ i )
+    {
+        if ( align_id [ i ] > 0 )
+            ids [ num_ids ++ ] = align_id [ i ];
+    }
+    if ( num_ids == 0 )
+        return;
+    ksort_int64_t ( ids, num_ids );
+    for ( i = 1, count = num_ids, num_ids = 1; i < count; ++ i )
+    {
+        if ( ids [ i ] != ids [ num_ids - 1 ] )
+            ids [ num_ids ++ ] = ids [ i ];
+    }
+
+    rc = KDataBufferResize ( & self -> offset, num_ids + 1 );
+    if ( rc != 0 )
+        return;
+    offset = self -> offset . base;
+    offset [ 0 ] = 0;
+
+    for ( i = 0; i < num_ids; ++ i )
+    {
+        const INSDC_4na_bin *r_src;
+        uint32_t             r_src_len;
+        uint64_t             end;
+
+        SUB_DEBUG( ( "SUB.Rd in 'seq-restore-read.c' at #%lu\n", ids[ i ] ) );
+
+        rc = VCursorCellDataDirect( self -> curs, ids[ i ], self -> read_idx,
+                                    NULL, ( const void** ) &r_src, NULL, &r_src_len );
+        if ( rc != 0 )
+            break;
+
+        /* bases buffer grows geometrically; its elem_count is capacity */
+        end = offset [ i ] + r_src_len;
+        if ( end > self -> bases . elem_count )
+        {
+            rc = KDataBufferResize ( & self -> bases, end * 2 );
+            if ( rc != 0 )
+                break;
+        }
+        memcpy( ( INSDC_4na_bin* ) self -> bases . base + offset [ i ], r_src, r_src_len );
+        offset [ i + 1 ] = end;
+    }
+
+    self -> num_ids = i;
+}
+
 static
 rc_t CC seq_restore_read_impl ( void *data, const VXformInfo *info, int64_t row_id,
                                 VRowResult *rslt, uint32_t argc, const VRowData argv [] )
@@ -168,7 +284,9 @@ rc_t CC seq_restore_read_impl ( void *data, const VXformInfo *info, int64_t row_
     const int64_t	*align_id	= argv[ 1 ].u.data.base;
     const INSDC_coord_len *read_len = argv[ 2 ].u.data.base;
     const uint8_t	*read_type	= argv[ 3 ].u.data.base;
-	bool	is_sequential=false;
+    INSDC_coord_len	max_len = 0;
+    bool	is_sequential;
+    bool	batched = false;
     
     assert( argv[ 0 ].u.data.elem_bits == 8 );
     assert( argv[ 1 ].u.data.elem_bits == 64 );
@@ -182,12 +300,7 @@ rc_t CC seq_restore_read_impl ( void *data, const VXformInfo *info, int64_t row_
     read_len  += argv [ 2 ] . u . data . first_elem;
     read_type += argv [ 3 ] . u . data . first_elem;
 
-    if(row_id != self->last_row_id  && row_id != self->last_row_id + 1){
-		self->last_sequentual_row_id = row_id;
-		is_sequential = false;
-    } else if(row_id > self->last_sequentual_row_id + 100){
-		is_sequential = true;
-	}
+    is_sequential = ( row_id == self->last_row_id + 1 );
     self->last_row_id = row_id;
 
     
@@ -195,6 +308,8 @@ rc_t CC seq_restore_read_impl ( void *data, const VXformInfo *info, int64_t row_
     for ( i = 0, len = 0; i < (int)num_reads; i++ )
     {
         len += read_len[ i ];
+        if ( max_len < read_len[ i ] )
+            max_len = read_len[ i ];
     }
 
     /* resize output row */    
@@ -208,11 +323,6 @@ rc_t CC seq_restore_read_impl ( void *data, const VXformInfo *info, int64_t row_
         {
             memcpy( dst, src, len );
         } else {
-			if( is_sequential && (row_id < self->prefetch_start_id || row_id > self->prefetch_stop_id )){ /* do prefetch */
-				VCursorDataPrefetch(self->curs,align_id,self->read_idx,argv[1].u.data.base_elem_count-argv[1].u.data.first_elem,1,INT64_MAX,true);
-				self->prefetch_start_id=row_id;
-				self->prefetch_stop_id =argv[1].blob_stop_id;
-			}
 			for( i = 0; i < (int)num_reads && rc == 0; i++ ) /*** checking read by read ***/
 			{
 				if ( align_id[ i ] > 0 )
@@ -220,10 +330,33 @@ rc_t CC seq_restore_read_impl ( void *data, const VXformInfo *info, int64_t row_
 					const INSDC_4na_bin *r_src;
 					uint32_t             r_src_len;
 
-					SUB_DEBUG( ( "SUB.Rd in 'seq-restore-read.c' at #%lu\n", align_id[ i ] ) );
+					if ( ! RestoreReadFind( self, align_id[ i ], &r_src, &r_src_len ) )
+					{
+						if ( is_sequential && ! batched )
+						{
+							/* batch this row and the rest of the input blob,
+							   bounded by count and an estimate of its bases */
+							uint64_t count = argv[ 1 ].u.data.base_elem_count - argv[ 1 ].u.data.first_elem;
+							uint64_t limit = BATCH_MAX_BASES / ( max_len + 1 );
+							if ( limit > BATCH_MAX_IDS )
+								limit = BATCH_MAX_IDS;
+							if ( limit < num_reads )
+								limit = num_reads;
+							if ( count > limit )
+								count = limit;
 
-					rc = VCursorCellDataDirect( self -> curs, align_id[ i ], self -> read_idx,
-												NULL, ( const void** ) &r_src, NULL, &r_src_len );
+							RestoreReadBatch( self, align_id, (uint32_t)count );
+							batched = true;
+						}
+
+						if ( ! RestoreReadFind( self, align_id[ i ], &r_src, &r_src_len ) )
+						{
+							SUB_DEBUG( ( "SUB.Rd in 'seq-restore-read.c' at #%lu\n", align_id[ i ] ) );
+
+							rc = VCursorCellDataDirect( self -> curs, align_id[ i ], self -> read_idx,
+														NULL, ( const void** ) &r_src, NULL, &r_src_len );
+						}
+					}
 					if ( rc == 0 )
 					{
 						if ( r_src_len == read_len[ i ] )
@@ -38,6 +38,8 @@ extern "C" {
 /*--------------------------------------------------------------------------
  * forwards
  */
+struct KMMap;
+struct KLock;
 typedef union KColumnPageMap KColumnPageMap;
 
 
@@ -58,6 +60,17 @@ struct KColumnData
     /* data fork itself */
     struct KFile const *f;
 
+    /* optional mapping of the data fork up to "eof" */
+    struct KMMap const *mm;
+    const uint8_t *maddr;
+
+    /* end of the last read from the mapping,
+       and how far ahead of it the system was told to fetch,
+       shared by the readers of the column under "advise_lock" */
+    struct KLock *advise_lock;
+    uint64_t last_end;
+    uint64_t advised;
+
     /* page size */
     size_t pgsize;
 };
@@ -73,6 +86,13 @@ struct KColumnData
 rc_t KColumnDataOpenRead ( KColumnData *self,
     const KDirectory *dir, uint64_t eof, size_t pgsize );
 
+/* MapRead
+ *  map the data fork into memory for reading
+ *  only done for system files, whether local or within
+ *  an uncompressed archive; on failure the file is read as before
+ */
+rc_t KColumnDataMapRead ( KColumnData *self, const KDirectory *dir );
+
 /* Whack
  */
 rc_t KColumnDataWhack ( KColumnData *self );
@@ -28,7 +28,9 @@
 #include "coldata-priv.h"
 #include <kfs/file.h>
 #include <kfs/buffile.h>
+#include <kfs/mmap.h>
 #include <kfs/impl.h>
+#include <kproc/lock.h>
 #include <klib/rc.h>
 #include <sysalloc.h>
 
@@ -41,6 +43,12 @@
 
 #define DATA_READ_FILE_BUFFER 256 * 1024
 
+/* with a mapped data fork, sequential reads have the system
+   fetch this far beyond the blob being read; isolated blobs
+   smaller than DATA_MMAP_ADVISE_MIN are left to page faults */
+#define DATA_MMAP_READ_AHEAD ( 1024 * 1024 )
+#define DATA_MMAP_ADVISE_MIN ( 16 * 1024 )
+
 
 /*--------------------------------------------------------------------------
  * KColumnData
@@ -98,16 +106,130 @@ rc_t KColumnDataOpenRead ( KColumnData *self,
     return rc;
 }
 
+/* MapRead
+ *  map the data fork into memory for reading
+ */
+rc_t KColumnDataMapRead ( KColumnData *self, const KDirectory *dir )
+{
+    rc_t rc;
+    const KFile * f;
+
+    assert ( self != NULL );
+
+    if ( self -> mm != NULL || self -> eof == 0 )
+        return 0;
+    if ( ( uint64_t ) ( size_t ) self -> eof != self -> eof )
+        return RC ( rcDB, rcColumn, rcOpening, rcData, rcExcessive );
+
+    /* the buffered file hides the system file */
+    rc = KDirectoryOpenFileRead ( dir, & f, "data" );
+    if ( rc == 0 )
+    {
+        uint64_t offset;
+
+        /* refuse anything that KMMap would read into memory */
+        if ( KFileGetSysFile ( f, & offset ) == NULL )
+            rc = RC ( rcDB, rcColumn, rcOpening, rcFile, rcIncorrect );
+        else
+        {
+            rc = KMMapMakeRgnRead ( & self -> mm, f, 0, ( size_t ) self -> eof );
+            if ( rc == 0 )
+            {
+                const void * addr;
+
+                /* blobs are located through the index, so the system
+                   is not to guess at what follows a fault, but told;
+                   this also confirms that the region is a system mapping */
+                rc = KMMapAdvise ( self -> mm, 0, ( size_t ) self -> eof, kmmaRandom );
+                if ( rc == 0 )
+                    rc = KMMapAddrRead ( self -> mm, & addr );
+                if ( rc == 0 )
+                    rc = KLockMake ( & self -> advise_lock );
+                if ( rc == 0 )
+                {
+                    /* the buffer is of no further use */
+                    KFileRelease ( self -> f );
+                    self -> f = f;
+
+                    self -> maddr = addr;
+                    self -> last_end = self -> advised = 0;
+                    return 0;
+                }
+
+                KMMapRelease ( self -> mm );
+                self -> mm = NULL;
+            }
+        }
+
+        KFileRelease ( f );
+    }
+
+    return rc;
+}
+
 /* Whack
  */
 rc_t KColumnDataWhack ( KColumnData *self )
 {
-    rc_t rc = KFileRelease ( self -> f );
+    rc_t rc = KMMapRelease ( self -> mm );
     if ( rc == 0 )
-        self -> f = NULL;
+    {
+        KLockRelease ( self -> advise_lock );
+        self -> advise_lock = NULL;
+        self -> mm = NULL;
+        self -> maddr = NULL;
+        rc = KFileRelease ( self -> f );
+        if ( rc == 0 )
+            self -> f = NULL;
+    }
     return rc;
 }
 
+/* AdviseMapped
+ *  ask the system to fetch the blob being read from the mapping
+ *  and, when blobs are read in order, the data following it
+ *
+ *  the access history is shared by all readers of the column,
+ *  and only the advice itself is given outside of the lock
+ */
+static
+void KColumnDataAdviseMapped ( KColumnData *self, uint64_t pos, size_t size )
+{
+    uint64_t start = 0, ahead = 0;
+    uint64_t end = pos + size;
+
+    if ( KLockAcquire ( self -> advise_lock ) != 0 )
+        return;
+
+    if ( pos == self -> last_end )
+    {
+        if ( end > self -> advised )
+        {
+            start = self -> advised > pos ? self -> advised : pos;
+            ahead = end + DATA_MMAP_READ_AHEAD;
+            if ( ahead > self -> eof )
+                ahead = self -> eof;
+
+            self -> advised = ahead;
+        }
+    }
+    else
+    {
+        if ( size >= DATA_MMAP_ADVISE_MIN )
+        {
+            start = pos;
+            ahead = end;
+        }
+        self -> advised = end;
+    }
+
+    self -> last_end = end;
+    KLockUnlock ( self -> advise_lock );
+
+    if ( ahead > start )
+        KMMapAdvise ( self -> mm, start, ( size_t ) ( ahead - start ), kmmaWillNeed );
+}
+
 /* Read
  *  reads from the data fork using a blob map
  */
@@ -126,8 +248,26 @@ rc_t KColumnDataRead ( const KColumnData *self, const KColumnPageMap *pm,
         return 0;
     }
 
-    pos = pm -> pg * self -> pgsize;
-    return KFileRead ( self -> f, pos + offset, buffer, bsize, num_read );
+    pos = pm -> pg * self -> pgsize + offset;
+
+    if ( self -> maddr != NULL )
+    {
+        if ( pos >= self -> eof )
+            bsize = 0;
+        else
+        {
+            if ( bsize > self -> eof - pos )
+                bsize = ( size_t ) ( self -> eof - pos );
+
+            KColumnDataAdviseMapped ( ( KColumnData* ) self, pos, bsize );
+            memmove ( buffer, & self -> maddr [ pos ], bsize );
+        }
+
+        * num_read = bsize;
+        return 0;
+    }
+
+    return KFileRead ( self -> f, pos, buffer, bsize, num_read );
 }
 
 
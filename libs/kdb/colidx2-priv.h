@@ -42,6 +42,8 @@
 #include <klib/data-buffer.h>
 #include "idxblk-priv.h"
 
+struct KLock;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -54,11 +56,19 @@ extern "C" {
 
 typedef struct KColumnIdx2BlockCache
 {
-    /* single page cache */
+    /* node in cache by start_id, and in LRU order */
+    BSTNode n;
+    DLNode ln;
+
+    /* single decoded block */
     void *block;
     int64_t start_id;
     size_t count;
     KColIdxBlock iblk;
+    KColBlockLoc bloc;
+
+    /* bytes charged against the budget */
+    size_t size;
 } KColumnIdx2BlockCache;
 
 typedef struct KColumnIdx2 KColumnIdx2;
@@ -70,9 +80,17 @@ struct KColumnIdx2
     /* idx2 itself */
     struct KFile const *f;
 
-    /* full caching mechanism */
-    KDataBuffer cstorage;
-    uint32_t	last;
+    /* full caching mechanism:
+       decoded blocks by start_id, most recently used first in "lru".
+       the column is shared by cursors and their prefetch threads,
+       so the cache and reads of the file are serialized by "lock" */
+    BSTree cache;
+    DLList lru;
+    struct KLock *lock;
+
+    /* bytes cached and budget */
+    size_t cache_size;
+    size_t cache_limit;
 };
 
 /* Open
@@ -91,6 +109,12 @@ rc_t KColumnIdx2LocateBlob ( const KColumnIdx2 *self,
     KColBlobLoc *loc, const KColBlockLoc *bloc,
     int64_t first, int64_t upper, bool bswap );
 
+/* SetCacheLimit
+ *  set the budget for decoded blocks kept between lookups;
+ *  0 disables caching
+ */
+void KColumnIdx2SetCacheLimit ( KColumnIdx2 *self, size_t bytes );
+
 
 #ifdef __cplusplus
 }
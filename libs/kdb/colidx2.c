@@ -30,9 +30,11 @@
 #include <kfs/file.h>
 #include <kfs/buffile.h>
 #include <klib/rc.h>
+#include <kproc/lock.h>
 #include <sysalloc.h>
 
 #include <limits.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
@@ -54,11 +56,6 @@ rc_t KColumnIdx2Init ( KColumnIdx2 *self, uint64_t idx2_eof )
 {
     rc_t rc;
 
-#if 0
-    memset(&self->cstorage,0,sizeof(self->cstorage));
-    self->cstorage.elem_bits = sizeof(KColumnIdx2BlockCache)*8;
-    self->last = 0;
-#endif
     rc = KFileSize ( self -> f, & self -> eof );
     if ( rc == 0 )
     {
@@ -84,21 +81,20 @@ rc_t KColumnIdx2OpenRead ( KColumnIdx2 *self,
 {
     rc_t rc;
 
-    rc = KDataBufferMake ( & self -> cstorage, sizeof ( KColumnIdx2BlockCache ) * 8, 0 );
+    BSTreeInit ( & self -> cache );
+    DLListInit ( & self -> lru );
+    self -> cache_size = 0;
+    self -> cache_limit = 0;
+
+    rc = KLockMake ( & self -> lock );
     if ( rc != 0 )
     {
         memset ( self, 0, sizeof * self );
         return rc;
     }
 
-    self -> last = 0;
-
     if ( eof == 0 )
     {
-#if 0
-        KDataBufferResize(&self->cstorage,0);
-        self -> last = 0;
-#endif
         self -> eof = 0;
         self -> f = NULL;
         return 0;
@@ -125,27 +121,95 @@ rc_t KColumnIdx2OpenRead ( KColumnIdx2 *self,
 #endif
     if ( rc == 0 )
         rc = KColumnIdx2Init ( self, eof );
+
+    /* a missing idx2 leaves the index usable */
+    if ( rc != 0 && GetRCState ( rc ) != rcNotFound )
+    {
+        KLockRelease ( self -> lock );
+        self -> lock = NULL;
+    }
     return rc;
 }
 
 /* Whack
  */
+static
+void CC KColumnIdx2BlockCacheWhack ( BSTNode *n, void *ignore )
+{
+    KColumnIdx2BlockCache *entry = ( KColumnIdx2BlockCache* ) n;
+    free ( entry -> block );
+    free ( entry );
+}
+
 rc_t KColumnIdx2Whack ( KColumnIdx2 *self )
 {
     rc_t rc = KFileRelease ( self -> f );
     if ( rc == 0 )
     {
-        int i;
-        KColumnIdx2BlockCache * cache=(KColumnIdx2BlockCache *)self -> cstorage.base;
         self -> f = NULL;
-        for(i=0;i<self->cstorage.elem_count;i++){
-            free(cache[i].block);
-        }
-        KDataBufferWhack(&self->cstorage);
+        BSTreeWhack ( & self -> cache, KColumnIdx2BlockCacheWhack, NULL );
+        DLListInit ( & self -> lru );
+        self -> cache_size = 0;
+        KLockRelease ( self -> lock );
+        self -> lock = NULL;
     }
     return rc;
 }
 
+/* SetCacheLimit
+ *  set the budget for decoded blocks
+ */
+static
+int CC KColumnIdx2BlockCacheCmp ( const void *item, const BSTNode *n )
+{
+    const int64_t *start_id = item;
+    const KColumnIdx2BlockCache *entry = ( const KColumnIdx2BlockCache* ) n;
+    if ( * start_id != entry -> start_id )
+        return * start_id < entry -> start_id ? -1 : 1;
+    return 0;
+}
+
+static
+int CC KColumnIdx2BlockCacheSort ( const BSTNode *item, const BSTNode *n )
+{
+    return KColumnIdx2BlockCacheCmp ( & ( ( const KColumnIdx2BlockCache* ) item ) -> start_id, n );
+}
+
+static
+void KColumnIdx2CacheRemove ( KColumnIdx2 *self, KColumnIdx2BlockCache *entry )
+{
+    BSTreeUnlink ( & self -> cache, & entry -> n );
+    DLListUnlink ( & self -> lru, & entry -> ln );
+    self -> cache_size -= entry -> size;
+    free ( entry -> block );
+    free ( entry );
+}
+
+static
+void KColumnIdx2CacheTrim ( KColumnIdx2 *self, size_t limit )
+{
+    while ( self -> cache_size > limit )
+    {
+        /* evict least recently used */
+        DLNode *ln = DLListTail ( & self -> lru );
+        if ( ln == NULL )
+            break;
+        KColumnIdx2CacheRemove ( self, ( KColumnIdx2BlockCache* )
+            ( ( char* ) ln - offsetof ( KColumnIdx2BlockCache, ln ) ) );
+    }
+}
+
+void KColumnIdx2SetCacheLimit ( KColumnIdx2 *self, size_t bytes )
+{
+    assert ( self != NULL );
+    if ( self -> lock != NULL && KLockAcquire ( self -> lock ) == 0 )
+    {
+        self -> cache_limit = bytes;
+        KColumnIdx2CacheTrim ( self, bytes );
+        KLockUnlock ( self -> lock );
+    }
+}
+
 /* LocateBlob
  *  locate an existing blob
  */
@@ -159,9 +223,9 @@ rc_t KColIdxBlockLocateBlob ( const KColIdxBlock *iblk,
     int slot = KColIdxBlockFind ( iblk,
         bloc, count, first, & start_id, & span );
     if ( slot < 0 )
-        return RC ( rcDB, rcColumn, rcSelecting, rcBlob, rcNotFound );
+        return RC ( rcDB, rcIndex, rcSelecting, rcRange, rcNotFound );
     if ( upper > ( start_id + span ) )
-        return RC ( rcDB, rcColumn, rcSelecting, rcRange, rcInvalid );
+        return RC ( rcDB, rcIndex, rcSelecting, rcRange, rcInvalid );
 
     loc -> start_id = start_id;
     loc -> id_range = span;
@@ -172,74 +236,128 @@ rc_t KColIdxBlockLocateBlob ( const KColIdxBlock *iblk,
     return 0;
 }
 
+/* ReadBlock
+ *  read and decode the block described by "bloc"
+ */
+static
+rc_t KColumnIdx2ReadBlock ( const KColumnIdx2 *self,
+    KColumnIdx2BlockCache *entry, const KColBlockLoc *bloc, bool bswap )
+{
+    rc_t rc;
+
+    /* determine the number of entries in block */
+    size_t orig = bloc -> u . blk . size;
+    uint32_t count = KColBlockLocEntryCount ( bloc, & orig );
+
+    /* determine the size to allocate */
+    size_t block_size = KColBlockLocAllocSize ( bloc, orig, count );
+
+    /* allocate a block */
+    void *block = malloc ( block_size );
+    if ( block == NULL )
+        rc = RC ( rcDB, rcIndex, rcSelecting, rcMemory, rcExhausted );
+    else
+    {
+        size_t num_read;
+        rc = KFileReadAll ( self -> f, bloc -> pg, block, orig, & num_read );
+        if ( rc == 0 )
+        {
+            if ( num_read != orig )
+                rc = RC ( rcDB, rcIndex, rcSelecting, rcTransfer, rcIncomplete );
+            else
+            {
+                rc = KColIdxBlockInit ( & entry -> iblk, bloc, orig, block, block_size, bswap );
+                if ( rc == 0 )
+                {
+                    entry -> block = block;
+                    entry -> start_id = bloc -> start_id;
+                    entry -> count = count;
+                    entry -> bloc = * bloc;
+                    entry -> size = sizeof * entry + block_size;
+                    return 0;
+                }
+            }
+        }
+
+        free ( block );
+    }
+
+    return rc;
+}
+
 /* LocateBlob
  *  locate an existing blob
  */
-rc_t KColumnIdx2LocateBlob ( const KColumnIdx2 *self,
+static
+rc_t KColumnIdx2LocateBlobInt ( KColumnIdx2 *self,
     KColBlobLoc *loc, const KColBlockLoc *bloc,
     int64_t first, int64_t upper, bool bswap )
 {
     rc_t rc;
+    KColumnIdx2BlockCache *entry = ( KColumnIdx2BlockCache* )
+        BSTreeFind ( & self -> cache, & bloc -> start_id, KColumnIdx2BlockCacheCmp );
 
-    /* compression not supported */
-    if ( bloc -> u . blk . compressed )
-        rc = RC ( rcDB, rcIndex, rcSelecting, rcNoObj, rcUnsupported );
-    else
+    /* a stale entry for the same id was superseded */
+    if ( entry != NULL && entry -> bloc . pg != bloc -> pg )
     {
-        uint64_t buffer [ 1024 / 8 ]; /* make sure is uint64_t aligned */
-        void *block = buffer;
-
-        /* determine the number of entries in block */
-        size_t orig = bloc -> u . blk . size;
-        uint32_t count = KColBlockLocEntryCount ( bloc, & orig );
+        KColumnIdx2CacheRemove ( self, entry );
+        entry = NULL;
+    }
 
-        /* determine the size to allocate */
-        size_t block_size = KColBlockLocAllocSize ( bloc, orig, count );
+    if ( entry == NULL )
+    {
+        entry = malloc ( sizeof * entry );
+        if ( entry == NULL )
+            return RC ( rcDB, rcIndex, rcSelecting, rcMemory, rcExhausted );
 
-        /* allocate a block */
-        if ( block_size > sizeof buffer )
-            block = malloc ( block_size );
-        if ( block == NULL )
-            rc = RC ( rcDB, rcIndex, rcSelecting, rcMemory, rcExhausted );
-        else
+        rc = KColumnIdx2ReadBlock ( self, entry, bloc, bswap );
+        if ( rc != 0 )
         {
-            size_t num_read;
-            rc = KFileReadAll ( self -> f, bloc -> pg, block, orig, & num_read );
-            if ( rc == 0 )
-            {
-                if ( num_read != orig )
-                    rc = RC ( rcDB, rcIndex, rcSelecting, rcTransfer, rcIncomplete );
-                else
-                {
-                    KColIdxBlock iblk;
-                    rc = KColIdxBlockInit ( & iblk, bloc, orig, block, block_size, bswap );
-                    if ( rc == 0 )
-                    {
-                        uint32_t span;
-                        int64_t start_id;
-                        int slot = KColIdxBlockFind ( & iblk,
-                            bloc, count, first, & start_id, & span );
-                        if ( slot < 0 )
-                            rc = RC ( rcDB, rcIndex, rcSelecting, rcRange, rcNotFound );
-                        else if ( upper > ( start_id + span ) )
-                            rc = RC ( rcDB, rcIndex, rcSelecting, rcRange, rcInvalid );
-                        else
-                        {
-                            loc -> start_id = start_id;
-                            loc -> id_range = span;
-
-                            KColIdxBlockGet ( & iblk,
-                                bloc, count, slot, & loc -> pg, & span );
-                            loc -> u . blob . size = span;
-                        }
-                    }
-                }
-            }
+            free ( entry );
+            return rc;
+        }
 
-            if ( block != buffer )
-                free ( block );
+        if ( entry -> size > self -> cache_limit )
+        {
+            /* too big to keep, or caching disabled */
+            rc = KColIdxBlockLocateBlob ( & entry -> iblk, loc, & entry -> bloc,
+                ( uint32_t ) entry -> count, first, upper );
+            free ( entry -> block );
+            free ( entry );
+            return rc;
         }
+
+        KColumnIdx2CacheTrim ( self, self -> cache_limit - entry -> size );
+        BSTreeInsert ( & self -> cache, & entry -> n, KColumnIdx2BlockCacheSort );
+        DLListPushHead ( & self -> lru, & entry -> ln );
+        self -> cache_size += entry -> size;
+    }
+    else if ( DLListHead ( & self -> lru ) != & entry -> ln )
+    {
+        DLListUnlink ( & self -> lru, & entry -> ln );
+        DLListPushHead ( & self -> lru, & entry -> ln );
     }
 
+    return KColIdxBlockLocateBlob ( & entry -> iblk, loc, & entry -> bloc,
+        ( uint32_t ) entry -> count, first, upper );
+}
+
+rc_t KColumnIdx2LocateBlob ( const KColumnIdx2 *cself,
+    KColBlobLoc *loc, const KColBlockLoc *bloc,
+    int64_t first, int64_t upper, bool bswap )
+{
+    rc_t rc;
+    KColumnIdx2 *self = ( KColumnIdx2* ) cself;
+
+    /* compression not supported */
+    if ( bloc -> u . blk . compressed )
+        return RC ( rcDB, rcIndex, rcSelecting, rcNoObj, rcUnsupported );
+
+    rc = KLockAcquire ( self -> lock );
+    if ( rc == 0 )
+    {
+        rc = KColumnIdx2LocateBlobInt ( self, loc, bloc, first, upper, bswap );
+        KLockUnlock ( self -> lock );
+    }
     return rc;
 }
@@ -33,6 +33,7 @@
 #include <kdb/kdb-priv.h>
 #include <klib/checksum.h>
 #include <klib/rc.h>
+#include <klib/sort.h>
 #include <klib/printf.h>
 #include <klib/debug.h>
 #include <atomic32.h>
@@ -263,6 +264,12 @@ rc_t KDBManagerVOpenColumnReadInt ( const KDBManager *self,
             rc = KColumnMakeRead ( & col, dir, colpath );
             if ( rc == 0 )
             {
+                KColumnIdx2SetCacheLimit ( & col -> idx . idx2, self -> idx2_cache_limit );
+
+                /* without a mapping, reads simply go through the file */
+                if ( self -> map_column_data )
+                    KColumnDataMapRead ( & col -> df, dir );
+
                 col -> mgr = KDBManagerAttach ( self );
                 * colp = col;
                 return 0;
@@ -437,6 +444,71 @@ LIB_EXPORT rc_t CC KColumnIdRange ( const KColumn *self, int64_t *first, uint64_
 }
 
 
+/* LocateBlobs
+ *  find the blobs holding a set of row ids
+ */
+static
+int CC KColumnLocateBlobsCmp ( const void *a, const void *b, void *data )
+{
+    const int64_t *ids = data;
+    int64_t ia = ids [ * ( const uint32_t* ) a ];
+    int64_t ib = ids [ * ( const uint32_t* ) b ];
+    return ia < ib ? -1 : ia > ib;
+}
+
+LIB_EXPORT rc_t CC KColumnLocateBlobs ( const KColumn *self,
+    const int64_t *ids, uint32_t count, int64_t *first, uint32_t *span )
+{
+    rc_t rc = 0;
+    uint32_t i, *order;
+    KColBlobLoc loc;
+    bool have_loc = false;
+
+    if ( self == NULL )
+        return RC ( rcDB, rcColumn, rcSelecting, rcSelf, rcNull );
+    if ( count == 0 )
+        return 0;
+    if ( ids == NULL || first == NULL || span == NULL )
+        return RC ( rcDB, rcColumn, rcSelecting, rcParam, rcNull );
+
+    order = malloc ( count * sizeof * order );
+    if ( order == NULL )
+        return RC ( rcDB, rcColumn, rcSelecting, rcMemory, rcExhausted );
+
+    for ( i = 0; i < count; ++ i )
+        order [ i ] = i;
+    ksort ( order, count, sizeof * order, KColumnLocateBlobsCmp, ( void* ) ids );
+
+    for ( i = 0; i < count; ++ i )
+    {
+        uint32_t j = order [ i ];
+        int64_t id = ids [ j ];
+
+        /* neighbors usually share the previous blob */
+        if ( ! have_loc || id < loc . start_id || id >= loc . start_id + loc . id_range )
+        {
+            rc = KColumnIdxLocateBlob ( & self -> idx, & loc, id, id );
+            have_loc = ( rc == 0 );
+            if ( rc != 0 )
+            {
+                if ( GetRCState ( rc ) != rcNotFound )
+                    break;
+                first [ j ] = 0;
+                span [ j ] = 0;
+                rc = 0;
+                continue;
+            }
+        }
+
+        first [ j ] = loc . start_id;
+        span [ j ] = loc . id_range;
+    }
+
+    free ( order );
+    return rc;
+}
+
+
 /* OpenManager
  *  duplicate reference to manager
  *  NB - returned reference must be released
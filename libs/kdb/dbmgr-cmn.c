@@ -170,6 +170,7 @@ rc_t KDBManagerMake ( KDBManager **mgrp, const KDirectory *wd, const char *op,
         {
             memset ( mgr, 0, sizeof * mgr );
             mgr -> wd = wd;
+            mgr -> idx2_cache_limit = KDB_IDX2_CACHE_LIMIT;
             if ( wd != NULL )
                 rc = KDirectoryAddRef ( wd );
             else
@@ -256,6 +257,32 @@ LIB_EXPORT rc_t CC KDBManagerVersion ( const KDBManager *self, uint32_t *version
 }
 
 
+/* SetIndexCacheLimit
+ *  budget for decoded index blocks of columns opened from now on
+ */
+LIB_EXPORT rc_t CC KDBManagerSetIndexCacheLimit ( const KDBManager *self, size_t bytes )
+{
+    if ( self == NULL )
+        return RC ( rcDB, rcMgr, rcUpdating, rcSelf, rcNull );
+
+    ( ( KDBManager* ) self ) -> idx2_cache_limit = bytes;
+    return 0;
+}
+
+
+/* SetColumnDataMapping
+ *  map data forks of columns opened for read from now on
+ */
+LIB_EXPORT rc_t CC KDBManagerSetColumnDataMapping ( const KDBManager *self, bool enabled )
+{
+    if ( self == NULL )
+        return RC ( rcDB, rcMgr, rcUpdating, rcSelf, rcNull );
+
+    ( ( KDBManager* ) self ) -> map_column_data = enabled;
+    return 0;
+}
+
+
 /* Exists
  *  returns true if requested object exists
  *
@@ -74,8 +74,17 @@ struct KDBManager
 
     /* other managers needed by the KDB manager */
     struct VFSManager * vfsmgr;
+
+    /* budget per read column for decoded level 2 index blocks */
+    size_t idx2_cache_limit;
+
+    /* map data forks of read columns */
+    bool map_column_data;
 };
 
+/* default idx2_cache_limit */
+#define KDB_IDX2_CACHE_LIMIT ( 256 * 1024 )
+
 
 /* Make - PRIVATE
  */
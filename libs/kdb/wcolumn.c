@@ -38,6 +38,7 @@
 #include <kfs/impl.h>
 #include <klib/checksum.h>
 #include <klib/printf.h>
+#include <klib/sort.h>
 #include <klib/log.h>
 #include <sysalloc.h>
 
@@ -760,6 +761,51 @@ LIB_EXPORT rc_t CC KTableVCreateColumn ( KTable *self, KColumn **colp,
 }
 
 
+/* AttachColumnRead
+ *  attach a new reference to an already open column
+ *  refuses a column open for update or an object of another type
+ */
+static
+rc_t KDBManagerAttachColumnRead ( const KSymbol *sym, const KColumn **colp )
+{
+    const KColumn *ccol;
+    rc_t rc, obj;
+
+    switch (sym->type)
+    {
+    case kptColumn:
+        ccol = (const KColumn*)sym->u.obj;
+        /* if open for update, refuse */
+        if ( ccol -> read_only )
+        {
+            /* attach a new reference and we're gone */
+            rc = KColumnAddRef ( ccol );
+            if ( rc == 0 )
+                * colp = ccol;
+            return rc;
+        }
+        obj = rcColumn;
+        break;
+    default:
+        obj = rcPath;
+        break;
+    case kptTable:
+        obj = rcTable;
+        break;
+    case kptDatabase:
+        obj = rcDatabase;
+        break;
+    case kptIndex:
+        obj = rcIndex;
+        break;
+    case kptMetadata:
+        obj = rcMetadata;
+        break;
+    }
+    return RC (rcDB, rcMgr, rcOpening, obj, rcBusy);
+}
+
+
 /* OpenColumnRead
  * VOpenColumnRead
  *  open a column for read
@@ -786,43 +832,8 @@ rc_t KDBManagerVOpenColumnReadInt ( const KDBManager *cself,
         sym = KDBManagerOpenObjectFind (cself, colpath);
         if (sym != NULL)
         {
-            const KColumn *ccol;
-            rc_t obj;
-
             if(cached != NULL ) *cached = true;
-
-            switch (sym->type)
-            {
-            case kptColumn:
-                ccol = (const KColumn*)sym->u.obj;
-                /* if open for update, refuse */
-                if ( ccol -> read_only )
-                {
-                    /* attach a new reference and we're gone */
-                    rc = KColumnAddRef ( ccol );
-                    if ( rc == 0 )
-                        * colp = ccol;
-                    return rc;
-                }
-                obj = rcColumn;
-                break;
-            default:
-                obj = rcPath;
-                break;
-            case kptTable:
-                obj = rcTable;
-                break;
-            case kptDatabase:
-                obj = rcDatabase;
-                break;
-            case kptIndex:
-                obj = rcIndex;
-                break;
-            case kptMetadata:
-                obj = rcMetadata;
-                break;
-            }
-            rc = RC (rcDB, rcMgr, rcOpening, obj, rcBusy);
+            return KDBManagerAttachColumnRead ( sym, colp );
         }
         else
         {
@@ -860,7 +871,24 @@ rc_t KDBManagerVOpenColumnReadInt ( const KDBManager *cself,
                         return 0;
                     }
 
-                    KColumnRelease ( col );
+                    /* never registered with the manager: tear down
+                       without going through KColumnWhack */
+                    KColumnIdxWhack ( & col -> idx,
+                        col -> df . eof, col -> df . pgsize, col -> checksum );
+                    KColumnDataWhack ( & col -> df );
+                    free ( col );
+
+                    /* another thread opened the same column meanwhile */
+                    if ( GetRCState ( rc ) == rcBusy )
+                    {
+                        sym = KDBManagerOpenObjectFind (cself, colpath);
+                        if ( sym != NULL )
+                        {
+                            if ( cached != NULL )
+                                * cached = true;
+                            rc = KDBManagerAttachColumnRead ( sym, colp );
+                        }
+                    }
                 }
 
                 KDirectoryRelease ( dir );
@@ -1394,6 +1422,71 @@ LIB_EXPORT rc_t CC KColumnIdRange ( const KColumn *self, int64_t *first, uint64_
 }
 
 
+/* LocateBlobs
+ *  find the blobs holding a set of row ids
+ */
+static
+int CC KColumnLocateBlobsCmp ( const void *a, const void *b, void *data )
+{
+    const int64_t *ids = data;
+    int64_t ia = ids [ * ( const uint32_t* ) a ];
+    int64_t ib = ids [ * ( const uint32_t* ) b ];
+    return ia < ib ? -1 : ia > ib;
+}
+
+LIB_EXPORT rc_t CC KColumnLocateBlobs ( const KColumn *self,
+    const int64_t *ids, uint32_t count, int64_t *first, uint32_t *span )
+{
+    rc_t rc = 0;
+    uint32_t i, *order;
+    KColBlobLoc loc;
+    bool have_loc = false;
+
+    if ( self == NULL )
+        return RC ( rcDB, rcColumn, rcSelecting, rcSelf, rcNull );
+    if ( count == 0 )
+        return 0;
+    if ( ids == NULL || first == NULL || span == NULL )
+        return RC ( rcDB, rcColumn, rcSelecting, rcParam, rcNull );
+
+    order = malloc ( count * sizeof * order );
+    if ( order == NULL )
+        return RC ( rcDB, rcColumn, rcSelecting, rcMemory, rcExhausted );
+
+    for ( i = 0; i < count; ++ i )
+        order [ i ] = i;
+    ksort ( order, count, sizeof * order, KColumnLocateBlobsCmp, ( void* ) ids );
+
+    for ( i = 0; i < count; ++ i )
+    {
+        uint32_t j = order [ i ];
+        int64_t id = ids [ j ];
+
+        /* neighbors usually share the previous blob */
+        if ( ! have_loc || id < loc . start_id || id >= loc . start_id + loc . id_range )
+        {
+            rc = KColumnIdxLocateBlob ( & self -> idx, & loc, id, id );
+            have_loc = ( rc == 0 );
+            if ( rc != 0 )
+            {
+                if ( GetRCState ( rc ) != rcNotFound )
+                    break;
+                first [ j ] = 0;
+                span [ j ] = 0;
+                rc = 0;
+                continue;
+            }
+        }
+
+        first [ j ] = loc . start_id;
+        span [ j ] = loc . id_range;
+    }
+
+    free ( order );
+    return rc;
+}
+
+
 /* Reindex
  *  optimize indices
  */
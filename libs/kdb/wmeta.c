@@ -2682,6 +2682,52 @@ rc_t KMetadataMakeRead ( KMetadata **meta,
 #endif
 
 
+/* AttachMetadataRead
+ *  attach a new reference to already open metadata
+ *  refuses metadata open for update or an object of another type
+ */
+static
+rc_t KDBManagerAttachMetadataRead ( const KSymbol *sym, const KMetadata **metap )
+{
+    const KMetadata * cmeta;
+    rc_t rc, obj;
+
+    switch (sym->type)
+    {
+    case kptMetadata:
+        cmeta = (KMetadata*)sym->u.obj;
+        /* if open for update, refuse */
+        if ( cmeta -> read_only )
+        {
+            /* attach a new reference and we're gone */
+            rc = KMetadataAddRef ( cmeta );
+            if ( rc == 0 )
+                * metap = cmeta;
+            return rc;
+        }
+        obj = rcMetadata;
+        break;
+
+    default:
+        obj = rcPath;
+        break;
+    case kptTable:
+        obj = rcTable;
+        break;
+    case kptColumn:
+        obj = rcColumn;
+        break;
+    case kptIndex:
+        obj = rcIndex;
+        break;
+    case kptDatabase:
+        obj = rcDatabase;
+        break;
+    }
+    return RC (rcDB, rcMgr, rcOpening, obj, rcBusy);
+}
+
+
 /* OpenMetadataRead
  *  opens metadata for read
  *
@@ -2707,43 +2753,8 @@ rc_t KDBManagerOpenMetadataReadInt ( KDBManager *self,
         sym = KDBManagerOpenObjectFind (self, metapath);
         if (sym != NULL)
         {
-            const KMetadata * cmeta;
-            rc_t obj;
-
 	    if(cached != NULL ) *cached = true;
-            switch (sym->type)
-            {
-            case kptMetadata:
-                cmeta = (KMetadata*)sym->u.obj;
-                /* if open for update, refuse */
-                if ( cmeta -> read_only )
-                {
-                    /* attach a new reference and we're gone */
-                    rc = KMetadataAddRef ( cmeta );
-                    if ( rc == 0 )
-                        * metap = cmeta;
-                    return rc;
-                }
-                obj = rcMetadata;
-                break;
-
-            default:
-                obj = rcPath;
-                break;
-            case kptTable:
-                obj = rcTable;
-                break;
-            case kptColumn:
-                obj = rcColumn;
-                break;
-            case kptIndex:
-                obj = rcIndex;
-                break;
-            case kptDatabase:
-                obj = rcDatabase;
-                break;
-            }
-            return  RC (rcDB, rcMgr, rcOpening, obj, rcBusy);
+            return KDBManagerAttachMetadataRead ( sym, metap );
 	}
 
 
@@ -2776,7 +2787,24 @@ rc_t KDBManagerOpenMetadataReadInt ( KDBManager *self,
                     return 0;
                 }
 
-                KMetadataRelease ( meta );
+                /* never registered with the manager: tear down
+                   without going through KMetadataWhack */
+                KDirectoryRelease ( meta -> dir );
+                atomic32_set ( & meta -> refcount, 0 );
+                KMDataNodeWhack ( & meta -> root -> n, NULL );
+                free ( meta );
+
+                /* another thread opened the same metadata meanwhile */
+                if ( GetRCState ( rc ) == rcBusy )
+                {
+                    sym = KDBManagerOpenObjectFind (self, metapath);
+                    if ( sym != NULL )
+                    {
+                        if ( cached != NULL )
+                            * cached = true;
+                        rc = KDBManagerAttachMetadataRead ( sym, metap );
+                    }
+                }
             }
 
 /*             rc = RC ( rcDB, rcMgr, rcOpening, rcMetadata, rcExists ); */
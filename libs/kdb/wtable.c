@@ -565,6 +565,51 @@ LIB_EXPORT rc_t CC KDatabaseVCreateTable ( KDatabase *self,
 }
 
 
+/* AttachTableRead
+ *  attach a new reference to an already open table
+ *  refuses a table open for update or an object of another type
+ */
+static
+rc_t KDBManagerAttachTableRead ( const KSymbol *sym, const KTable **tblp )
+{
+    const KTable * ctbl;
+    rc_t rc, obj;
+
+    switch (sym->type)
+    {
+    case kptTable:
+        ctbl = (KTable*)sym->u.obj;
+        /* if open for update, refuse */
+        if ( ctbl -> read_only )
+        {
+            /* attach a new reference and we're gone */
+            rc = KTableAddRef ( ctbl );
+            if ( rc == 0 )
+                * tblp = ctbl;
+            return rc;
+        }
+        obj = rcTable;
+        break;
+
+    default:
+        obj = rcPath;
+        break;
+    case kptDatabase:
+        obj = rcDatabase;
+        break;
+    case kptColumn:
+        obj = rcColumn;
+        break;
+    case kptIndex:
+        obj = rcIndex;
+        break;
+    case kptMetadata:
+        obj = rcMetadata;
+        break;
+    }
+    return RC (rcDB, rcMgr, rcOpening, obj, rcBusy);
+}
+
 /* OpenTableRead
  * VOpenTableRead
  *  open a table for read
@@ -593,44 +638,7 @@ rc_t KDBManagerVOpenTableReadInt ( const KDBManager *cself,
         /* if already open */
         sym = KDBManagerOpenObjectFind (cself, tblpath);
         if (sym != NULL)
-        {
-            const KTable * ctbl;
-            rc_t obj;
-
-            switch (sym->type)
-            {
-            case kptTable:
-                ctbl = (KTable*)sym->u.obj;
-                /* if open for update, refuse */
-                if ( ctbl -> read_only )
-                {
-                    /* attach a new reference and we're gone */
-                    rc = KTableAddRef ( ctbl );
-                    if ( rc == 0 )
-                        * tblp = ctbl;
-                    return rc;
-                }
-                obj = rcTable;
-                break;
-                
-            default:
-                obj = rcPath;
-                break;
-            case kptDatabase:
-                obj = rcDatabase;
-                break;
-            case kptColumn:
-                obj = rcColumn;
-                break;
-            case kptIndex:
-                obj = rcIndex;
-                break;
-            case kptMetadata:
-                obj = rcMetadata;
-                break;
-            }
-            rc = RC (rcDB, rcMgr, rcOpening, obj, rcBusy);
-        }
+            return KDBManagerAttachTableRead ( sym, tblp );
         else
         {
             KTable * tbl;
@@ -659,6 +667,14 @@ rc_t KDBManagerVOpenTableReadInt ( const KDBManager *cself,
                         return 0;
                     }
                     free ( tbl );
+
+                    /* another thread opened the same table meanwhile */
+                    if ( GetRCState ( rc ) == rcBusy )
+                    {
+                        sym = KDBManagerOpenObjectFind (cself, tblpath);
+                        if ( sym != NULL )
+                            rc = KDBManagerAttachTableRead ( sym, tblp );
+                    }
                 }
                 KDirectoryRelease ( dir );
             }
@@ -32,6 +32,9 @@ struct KBufFile;
 #include <kfs/file.h>
 #include <kfs/impl.h>
 #include <kfs/pagefile.h>
+#include <kproc/lock.h>
+#include <kproc/cond.h>
+#include <kproc/thread.h>
 #include <klib/debug.h>
 #include <klib/log.h>
 #include <klib/rc.h>
@@ -58,9 +61,28 @@ struct KBufFile
     KFile *f;
     KPageFile *pf;
 
+    /* serializes access to the page cache and current page,
+       since the same buffered file may be shared among readers */
+    KLock *lock;
+
     KPage *pg;
     size_t pgsize;
     uint32_t pgid;
+
+    /* optional read-ahead stage, also guarded by "lock".
+       pages [ ra_next, ra_end ) are fetched in the background
+       into the page cache while reads remain sequential */
+    KThread *ra_thread;
+    KCondition *ra_work;
+    KCondition *ra_done;
+    uint32_t ra_limit;
+    uint32_t ra_window;
+    uint32_t ra_pages;
+    uint32_t ra_last;
+    uint32_t ra_next;
+    uint32_t ra_end;
+    uint32_t ra_busy;
+    bool ra_quit;
 };
 
 
@@ -71,10 +93,36 @@ struct KBufFile
     ( self ) -> dad . align [ 0 ] = ( val )
     
 
+static
+void KBufFileStopReadAhead ( KBufFile *self )
+{
+    if ( self -> ra_thread != NULL )
+    {
+        if ( KLockAcquire ( self -> lock ) == 0 )
+        {
+            self -> ra_quit = true;
+            KConditionSignal ( self -> ra_work );
+            KLockUnlock ( self -> lock );
+        }
+
+        KThreadWait ( self -> ra_thread, NULL );
+        KThreadRelease ( self -> ra_thread );
+        self -> ra_thread = NULL;
+    }
+
+    KConditionRelease ( self -> ra_done );
+    KConditionRelease ( self -> ra_work );
+    self -> ra_done = self -> ra_work = NULL;
+}
+
 static
 rc_t CC KBufFileDestroy ( KBufFile *self )
 {
-    rc_t rc = KPageRelease ( self -> pg );
+    rc_t rc;
+
+    KBufFileStopReadAhead ( self );
+
+    rc = KPageRelease ( self -> pg );
     if ( rc == 0 )
     {
         self -> pg = NULL;
@@ -83,6 +131,7 @@ rc_t CC KBufFileDestroy ( KBufFile *self )
         rc = KPageFileRelease ( self -> pf );
         if ( rc == 0 )
         {
+            KLockRelease ( self -> lock );
             KFileRelease ( self -> f );
             free ( self );
         }
@@ -157,11 +206,18 @@ rc_t CC KBufFileSize ( const KBufFile *self, uint64_t *size )
 static
 rc_t CC KBufFileSetSize ( KBufFile *self, uint64_t size )
 {
-    KPageRelease ( self -> pg );
-    self -> pg = NULL;
-    self -> pgid = 0;
+    rc_t rc = KLockAcquire ( self -> lock );
+    if ( rc == 0 )
+    {
+        KPageRelease ( self -> pg );
+        self -> pg = NULL;
+        self -> pgid = 0;
+
+        rc = KPageFileSetSize ( self -> pf, size );
 
-    return KPageFileSetSize ( self -> pf, size );
+        KLockUnlock ( self -> lock );
+    }
+    return rc;
 }
 
 static
@@ -170,16 +226,137 @@ rc_t CC KBufFileNoSetSize ( KBufFile *self, uint64_t size )
     return RC ( rcFS, rcFile, rcResizing, rcFunction, rcUnsupported );
 }
 
+/* ReadAheadNote
+ *  track the pages touched by each read
+ *  the window doubles with every read that continues
+ *  where the previous one stopped, and collapses upon a seek
+ */
 static
-rc_t CC KBufFileRead ( const KBufFile *cself, uint64_t pos,
-    void *buffer, size_t bsize, size_t *num_read )
+void KBufFileReadAheadNote ( KBufFile *self, uint64_t pos, size_t bsize )
 {
-    KBufFile *self = ( KBufFile* ) cself;
+    uint32_t first, last;
+
+    if ( self -> ra_thread == NULL || bsize == 0 )
+        return;
+
+    first = ( uint32_t ) ( pos / self -> pgsize ) + 1;
+    last = ( uint32_t ) ( ( pos + bsize - 1 ) / self -> pgsize ) + 1;
+    if ( first > self -> ra_pages )
+        return;
+    if ( last > self -> ra_pages )
+        last = self -> ra_pages;
 
+    if ( first == self -> ra_last || first == self -> ra_last + 1 )
+    {
+        /* sequential: grow window once per page advanced */
+        if ( last > self -> ra_last )
+        {
+            uint32_t end;
+
+            if ( self -> ra_window == 0 )
+                self -> ra_window = 1;
+            else if ( self -> ra_window < self -> ra_limit )
+                self -> ra_window *= 2;
+            if ( self -> ra_window > self -> ra_limit )
+                self -> ra_window = self -> ra_limit;
+
+            end = last + 1 + self -> ra_window;
+            if ( end > self -> ra_pages + 1 )
+                end = self -> ra_pages + 1;
+
+            if ( self -> ra_next <= last )
+                self -> ra_next = last + 1;
+            if ( self -> ra_end < end )
+                self -> ra_end = end;
+
+            if ( self -> ra_next < self -> ra_end )
+                KConditionSignal ( self -> ra_work );
+        }
+    }
+    else
+    {
+        /* random: abandon outstanding pages */
+        self -> ra_window = 0;
+        self -> ra_next = self -> ra_end = 0;
+    }
+
+    self -> ra_last = last;
+}
+
+/* ReadAheadThread
+ *  fetches pages noted for read-ahead without holding the lock,
+ *  and inserts them into the page cache if they are still wanted
+ */
+static
+rc_t CC KBufFileReadAheadThread ( const KThread *t, void *data )
+{
+    rc_t rc;
+    KBufFile *self = data;
+
+    void *page = malloc ( self -> pgsize );
+    if ( page == NULL )
+        return RC ( rcFS, rcFile, rcReading, rcMemory, rcExhausted );
+
+    rc = KLockAcquire ( self -> lock );
+    while ( rc == 0 && ! self -> ra_quit )
+    {
+        rc_t rc2;
+        size_t num_read;
+        uint32_t pgid;
+
+        if ( self -> ra_next >= self -> ra_end )
+        {
+            rc = KConditionWait ( self -> ra_work, self -> lock );
+            continue;
+        }
+
+        pgid = self -> ra_next ++;
+        if ( KPageFileHas ( self -> pf, pgid ) )
+            continue;
+
+        /* readers wanting this page will wait rather than fetch it again */
+        self -> ra_busy = pgid;
+        KLockUnlock ( self -> lock );
+
+        rc2 = KFileReadAll ( self -> f, ( uint64_t ) ( pgid - 1 ) * self -> pgsize,
+            page, self -> pgsize, & num_read );
+
+        rc = KLockAcquire ( self -> lock );
+        if ( rc == 0 )
+        {
+            if ( rc2 != 0 )
+            {
+                /* leave it to the reader to see the error */
+                self -> ra_window = 0;
+                self -> ra_next = self -> ra_end = 0;
+            }
+            else if ( num_read != 0 && pgid < self -> ra_end )
+            {
+                KPageFileInsert ( self -> pf, pgid, page, num_read );
+            }
+
+            self -> ra_busy = 0;
+            KConditionBroadcast ( self -> ra_done );
+        }
+    }
+
+    if ( rc == 0 )
+        KLockUnlock ( self -> lock );
+
+    free ( page );
+    return rc;
+}
+
+static
+rc_t KBufFileReadLocked ( KBufFile *self, uint64_t pos,
+    void *buffer, size_t bsize, size_t *num_read )
+{
     rc_t rc;
     uint8_t *dst = buffer;
     size_t total, partial;
 
+    KBufFileReadAheadNote ( self, pos, bsize );
+
     for ( rc = 0, total = 0; total < bsize; pos += partial, total += partial )
     {
         const uint8_t *src;
@@ -196,9 +373,20 @@ rc_t CC KBufFileRead ( const KBufFile *cself, uint64_t pos,
         {
             /* release previous page */
             KPageRelease ( self -> pg );
+            self -> pg = NULL;
+            self -> pgid = 0;
+
+            /* let an outstanding read-ahead of this page complete */
+            while ( self -> ra_busy == pgid )
+            {
+                rc = KConditionWait ( self -> ra_done, self -> lock );
+                if ( rc != 0 )
+                    break;
+            }
 
             /* get requested page */
-            rc = KPageFilePosGet ( self -> pf, & self -> pg, pos );
+            if ( rc == 0 )
+                rc = KPageFilePosGet ( self -> pf, & self -> pg, pos );
             if ( rc != 0 )
             {
                 if ( GetRCState ( rc ) == rcNotFound )
@@ -265,7 +453,26 @@ rc_t CC KBufFileRead ( const KBufFile *cself, uint64_t pos,
 }
 
 static
-rc_t CC KBufFileWrite ( KBufFile *self, uint64_t pos,
+rc_t CC KBufFileRead ( const KBufFile *cself, uint64_t pos,
+    void *buffer, size_t bsize, size_t *num_read )
+{
+    KBufFile *self = ( KBufFile* ) cself;
+
+    rc_t rc = KLockAcquire ( self -> lock );
+    if ( rc == 0 )
+    {
+        rc = KBufFileReadLocked ( self, pos, buffer, bsize, num_read );
+        KLockUnlock ( self -> lock );
+    }
+    else
+    {
+        * num_read = 0;
+    }
+    return rc;
+}
+
+static
+rc_t KBufFileWriteLocked ( KBufFile *self, uint64_t pos,
     const void *buffer, size_t size, size_t *num_writ )
 {
     rc_t rc;
@@ -334,6 +541,24 @@ rc_t CC KBufFileWrite ( KBufFile *self, uint64_t pos,
 }
 
 
+static
+rc_t CC KBufFileWrite ( KBufFile *self, uint64_t pos,
+    const void *buffer, size_t size, size_t *num_writ )
+{
+    rc_t rc = KLockAcquire ( self -> lock );
+    if ( rc == 0 )
+    {
+        rc = KBufFileWriteLocked ( self, pos, buffer, size, num_writ );
+        KLockUnlock ( self -> lock );
+    }
+    else
+    {
+        * num_writ = 0;
+    }
+    return rc;
+}
+
+
 static
 rc_t CC KBufFileNoWrite ( KBufFile *self, uint64_t pos,
     const void *buffer, size_t size, size_t *num_writ )
@@ -398,10 +623,14 @@ rc_t KBufFileMake ( KBufFile ** bp, const KFile_vt *vt,
     else
     {
         rc = KFileInit ( & buf -> dad, vt, "KBufFile", "no-name", read_enabled, write_enabled );
+        if ( rc == 0 )
+            rc = KLockMake ( & buf -> lock );
         if ( rc == 0 )
         {
             rc = KFileAddRef ( f );
-            if ( rc == 0 )
+            if ( rc != 0 )
+                KLockRelease ( buf -> lock );
+            else
             {
                 buf -> max_write = serial ? 0 : eof;
 
@@ -412,6 +641,13 @@ rc_t KBufFileMake ( KBufFile ** bp, const KFile_vt *vt,
                 buf -> pgsize = KPageConstSize ();
                 buf -> pgid = 0;
 
+                buf -> ra_thread = NULL;
+                buf -> ra_work = buf -> ra_done = NULL;
+                buf -> ra_limit = buf -> ra_window = buf -> ra_pages = 0;
+                buf -> ra_last = buf -> ra_next = buf -> ra_end = 0;
+                buf -> ra_busy = 0;
+                buf -> ra_quit = false;
+
                 KBufFileSetSerialAccess ( buf, serial );
 
                 * bp = buf;
@@ -425,17 +661,36 @@ rc_t KBufFileMake ( KBufFile ** bp, const KFile_vt *vt,
     return rc;
 }
 
-/* MakeBufferedRead
- *  make a read-only file buffer
- *
- *  "buf" [ OUT ] - return parameter for new buffered file
- *
- *  "original" [ IN ] - source file to be buffered. must have read access
- *
- *  "bsize" [ IN ] - buffer size
- */
-LIB_EXPORT rc_t CC KBufFileMakeRead ( const KFile ** bp,
-    const KFile * original, size_t bsize )
+static
+rc_t KBufFileStartReadAhead ( KBufFile *self, size_t bsize, size_t read_ahead )
+{
+    rc_t rc;
+
+    /* never look ahead by more than half the cache,
+       or pages fetched ahead would evict each other */
+    uint64_t limit = read_ahead / self -> pgsize;
+    if ( limit > bsize / self -> pgsize / 2 )
+        limit = bsize / self -> pgsize / 2;
+    if ( limit == 0 || KBufFileSerialAccess ( self ) )
+        return 0;
+
+    self -> ra_limit = ( uint32_t ) limit;
+    self -> ra_pages = ( uint32_t ) ( ( self -> max_write + self -> pgsize - 1 ) / self -> pgsize );
+
+    rc = KConditionMake ( & self -> ra_work );
+    if ( rc == 0 )
+        rc = KConditionMake ( & self -> ra_done );
+    if ( rc == 0 )
+        rc = KThreadMake ( & self -> ra_thread, KBufFileReadAheadThread, self );
+    if ( rc != 0 )
+        KBufFileStopReadAhead ( self );
+
+    return rc;
+}
+
+static
+rc_t KBufFileMakeReadInt ( const KFile ** bp,
+    const KFile * original, size_t bsize, size_t read_ahead )
 {
     rc_t rc;
 
@@ -475,8 +730,16 @@ LIB_EXPORT rc_t CC KBufFileMakeRead ( const KFile ** bp,
                     original, eof, pf, true, false, serial );
                 if ( rc == 0 )
                 {
-                    * bp = & buf -> dad;
-                    return 0;
+                    rc = KBufFileStartReadAhead ( buf, bsize, read_ahead );
+                    if ( rc == 0 )
+                    {
+                        * bp = & buf -> dad;
+                        return 0;
+                    }
+
+                    KBufFileDestroy ( buf );
+                    * bp = NULL;
+                    return rc;
                 }
 
                 KPageFileRelease ( pf );
@@ -489,6 +752,40 @@ LIB_EXPORT rc_t CC KBufFileMakeRead ( const KFile ** bp,
     return rc;
 }
 
+/* MakeBufferedRead
+ *  make a read-only file buffer
+ *
+ *  "buf" [ OUT ] - return parameter for new buffered file
+ *
+ *  "original" [ IN ] - source file to be buffered. must have read access
+ *
+ *  "bsize" [ IN ] - buffer size
+ */
+LIB_EXPORT rc_t CC KBufFileMakeRead ( const KFile ** bp,
+    const KFile * original, size_t bsize )
+{
+    return KBufFileMakeReadInt ( bp, original, bsize, 0 );
+}
+
+/* MakeReadAhead
+ *  make a read-only file buffer with read-ahead
+ *
+ *  "buf" [ OUT ] - return parameter for new buffered file
+ *
+ *  "original" [ IN ] - source file to be buffered. must have read access,
+ *  and must tolerate reads from more than one thread at a time
+ *
+ *  "bsize" [ IN ] - buffer size
+ *
+ *  "read_ahead" [ IN ] - largest number of bytes to fetch ahead of
+ *  sequential reads. limited to half of "bsize". 0 disables read-ahead
+ */
+LIB_EXPORT rc_t CC KBufFileMakeReadAhead ( const KFile ** bp,
+    const KFile * original, size_t bsize, size_t read_ahead )
+{
+    return KBufFileMakeReadInt ( bp, original, bsize, read_ahead );
+}
+
 
 /* MakeBufferedWrite
  *  make a writable file buffer
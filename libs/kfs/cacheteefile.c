@@ -37,10 +37,16 @@ struct KCacheTeeFile;
 #include <klib/printf.h>
 #include <klib/checksum.h>
 #include <klib/time.h>
+#include <klib/sort.h>
 
 #include <kfs/cacheteefile.h>
+#include <kfs/kfs-priv.h>
 #include <kfs/defs.h>
 
+#include <kproc/lock.h>
+#include <kproc/cond.h>
+#include <kproc/thread.h>
+
 #include <sysalloc.h>
 #include <stdlib.h>
 #include <string.h>
@@ -58,6 +64,13 @@ struct KCacheTeeFile;
  M ... bitmap of blocks bytes = ( ( ( content-size / block-size ) + 1 ) / 8 ) + 1 )
  S ... size of content ( uint64_t ) 8 bytes
  B ... used blocksize  ( uint32_t ) 4 bytes
+
+ several processes may share a local file:
+ a process fetching blocks write-locks their content-range, others wait for it
+ and then find the blocks in the bitmap on disk instead of fetching them again.
+ bits are merged into the bitmap on disk under a lock on the bytes written.
+ every process read-locks the byte past the end of the file while it has the
+ file open, the file is promoted by the last one.
  */
 
 
@@ -66,7 +79,6 @@ struct KCacheTeeFile;
  */
 
 #define CACHE_TEE_DEFAULT_BLOCKSIZE ( 32 * 1024 * 4 )
-#define CACHE_TEE_LOCKING 0
 
 #define CACHE_STAT 0
 
@@ -166,6 +178,9 @@ static void report_cache_stat( CacheStatistic * stat )
 #endif
 
 
+/* how many block-buffers a file keeps for its readers */
+#define CACHE_TEE_SPARE_BUFFERS 4
+
 typedef struct KCacheTeeFile
 {
     KFile dad;
@@ -180,18 +195,25 @@ typedef struct KCacheTeeFile
     uint8_t * bitmap;						/* the bitmap of cached blocks */
     uint64_t bitmap_bytes;					/* how many bytes do we need to store the bitmap */
 
-	uint8_t * scratch_buffer;
-    uint64_t first_block_in_scratch;		/* what is the block-id of the first block in the scratch-buffer */
-    uint64_t scratch_size;					/* how many bytes are allocated for the scratch-buffer */
-    uint64_t valid_scratch_bytes;			/* how many bytes store valid data in the scratch-buffer */
+    KLock * lock;							/* guards bitmap, pending and the fill-state, not held during I/O */
+    KCondition * fetched;					/* broadcast whenever a pending block is done */
+    uint8_t * pending;						/* bitmap of blocks currently fetched by a reader or the fill-thread */
+
+    KThread * filler;						/* optional background thread filling the cache */
+    uint64_t fill_next;						/* the next block the fill-thread looks at */
+    bool fill_quit;
 
     uint32_t block_size;					/* how big is a block ( aka 1 bit in the bitmap )*/
 
+    uint8_t * spare_buffers [ CACHE_TEE_SPARE_BUFFERS ];	/* block-buffers returned by readers, guarded by lock */
+    uint32_t spare_count;
+
 #if( CACHE_STAT > 0 )
 	CacheStatistic stat;					/* optional cache statistic */
 #endif
 
 	bool local_read_only;
+    bool shared;							/* other processes coordinate through byte-range locks on the local file */
     char local_path [ 1 ];					/* stores the path to the local cache, for eventual promoting at close */
 } KCacheTeeFile;
 
@@ -613,6 +635,18 @@ static bool file_exist( KDirectory * dir, const char * filename )
 }
 
 
+/*	the byte past the end of the local file, read-locked by every cache-tee file using it,
+	in this process or another where the system has open file description locks */
+#define IN_USE_MARKER( CacheFile ) ( ( CacheFile )->local_size )
+
+static bool used_by_other_process( const KCacheTeeFile *self )
+{
+    /* a write-lock is refused while anybody else holds a read-lock, our own is converted */
+    rc_t rc = KFileLockRange( self->local, IN_USE_MARKER( self ), 1, true, false );
+    return ( GetRCState( rc ) == rcBusy );
+}
+
+
 static rc_t promote_cache( KCacheTeeFile * self )
 {
     char cache_file_name [ 4096 ];
@@ -660,6 +694,8 @@ static rc_t promote_cache( KCacheTeeFile * self )
 }
 
 
+static void stop_fill_thread( KCacheTeeFile *self );
+
 /* Destroy
  */
 static rc_t CC KCacheTeeFileDestroy( KCacheTeeFile * self )
@@ -669,8 +705,10 @@ static rc_t CC KCacheTeeFileDestroy( KCacheTeeFile * self )
 #if( CACHE_STAT > 0 )
 	report_cache_stat( & self -> stat );
 #endif
-	
-    if ( !self -> local_read_only && !already_promoted_by_other_instance )
+
+    stop_fill_thread( self );
+
+    if ( !self -> local_read_only && !already_promoted_by_other_instance && !used_by_other_process( self ) )
     {
 		bool fully_in_cache;
         rc_t rc = IsCacheFileComplete ( self -> local, &fully_in_cache );
@@ -682,8 +720,12 @@ static rc_t CC KCacheTeeFileDestroy( KCacheTeeFile * self )
 
     if ( self->bitmap != NULL )
         free( self->bitmap );
-    if ( self->scratch_buffer != NULL )
-        free( self->scratch_buffer );
+    if ( self->pending != NULL )
+        free( self->pending );
+    while ( self->spare_count > 0 )
+        free( self->spare_buffers[ --self->spare_count ] );
+    KConditionRelease ( self -> fetched );
+    KLockRelease ( self -> lock );
 
     KFileRelease ( self -> remote );
     KFileRelease ( self -> local );
@@ -710,47 +752,52 @@ static void set_bitmap( const KCacheTeeFile *cself, uint64_t start_block, uint64
 }
 
 
-static rc_t write_bitmap( const KCacheTeeFile *cself, uint64_t start_block, uint64_t block_count )
+/*	OR the bitmap-bytes on disk into the bitmap in memory,
+	picking up the blocks other processes have fetched
+*/
+static void merge_bitmap( const KCacheTeeFile *cself, uint32_t first_byte, size_t bytes )
 {
-    size_t written;
-    uint32_t start_block_byte = ( uint32_t ) ( start_block >> 3 );
-    uint32_t end_block_byte = ( uint32_t ) ( ( start_block + block_count - 1 ) >> 3 );
-    uint64_t pos = cself->remote_size + start_block_byte;
-    size_t to_write = ( end_block_byte - start_block_byte ) + 1;
-    rc_t rc = KFileWriteAll( cself->local, pos, &cself->bitmap[ start_block_byte ], to_write, &written );
-    if ( rc != 0 )
+    uint8_t disk[ 256 ];
+    while ( bytes > 0 )
     {
-        PLOGERR( klogErr, ( klogErr, rc, "cannot write local-file-bitmap block $(sb).$(cn)", 
-                           "sb=%lu,cn=%lu", start_block, block_count ) );
+        size_t i, nread;
+        size_t chunk = ( bytes < sizeof disk ) ? bytes : sizeof disk;
+        if ( KFileReadAll( cself->local, cself->remote_size + first_byte, disk, chunk, &nread ) != 0 )
+            return;
+        for ( i = 0; i < nread; ++i )
+            cself->bitmap[ first_byte + i ] |= disk[ i ];
+        if ( nread < chunk )
+            return;
+        first_byte += chunk;
+        bytes -= chunk;
     }
-    return rc;
 }
 
 
-static rc_t resize_scratch_buffer( const KCacheTeeFile *cself, uint64_t new_size )
+static rc_t write_bitmap( const KCacheTeeFile *cself, uint64_t start_block, uint64_t block_count )
 {
-    rc_t rc = 0;
-    KCacheTeeFile *self = ( KCacheTeeFile * )cself;
+    size_t written;
+    uint32_t start_block_byte = ( uint32_t ) ( start_block >> 3 );
+    uint32_t end_block_byte = ( uint32_t ) ( ( start_block + block_count - 1 ) >> 3 );
+    uint64_t pos = cself->remote_size + start_block_byte;
+    size_t to_write = ( end_block_byte - start_block_byte ) + 1;
+    bool locked = false;
+    rc_t rc;
 
-    /* create scratch-buffer or resize it if needed */
-    if ( self->scratch_size == 0 )
+    if ( cself->shared )
     {
-        self->scratch_buffer = malloc( new_size );
-        if ( self->scratch_buffer == NULL )
-            rc = RC ( rcFS, rcFile, rcConstructing, rcMemory, rcExhausted );
-        else
-            self->scratch_size = new_size;
+        /* other processes set bits in the same bytes, do not overwrite theirs */
+        locked = ( KFileLockRange( cself->local, pos, to_write, true, true ) == 0 );
+        merge_bitmap( cself, start_block_byte, to_write );
     }
-    else if ( self->scratch_size < new_size )
+
+    rc = KFileWriteAll( cself->local, pos, &cself->bitmap[ start_block_byte ], to_write, &written );
+    if ( locked )
+        KFileUnlockRange( cself->local, pos, to_write );
+    if ( rc != 0 )
     {
-        uint8_t * tmp = realloc( self->scratch_buffer, new_size );
-        if ( tmp == NULL )
-            rc = RC ( rcFS, rcFile, rcConstructing, rcMemory, rcExhausted );
-        else
-        {
-            self->scratch_buffer = tmp;
-            self->scratch_size = new_size;
-        }
+        PLOGERR( klogErr, ( klogErr, rc, "cannot write local-file-bitmap block $(sb).$(cn)", 
+                           "sb=%lu,cn=%lu", start_block, block_count ) );
     }
     return rc;
 }
@@ -771,6 +818,53 @@ size_t check_rd_len( const KCacheTeeFile *cself, uint64_t pos, size_t bsize )
     return res;
 }
 
+/*	keep other processes from fetching these blocks until unlock_blocks(), waiting
+	for those fetching any of them right now. failing to lock only risks fetching
+	a block twice, so errors are ignored.
+*/
+static void lock_blocks( const KCacheTeeFile *self, uint64_t first, uint64_t count )
+{
+    if ( self->shared )
+    {
+        uint64_t pos = first * self->block_size;
+        KFileLockRange( self->local, pos, check_rd_len( self, pos, ( size_t )( count * self->block_size ) ), true, true );
+    }
+}
+
+
+static void unlock_blocks( const KCacheTeeFile *self, uint64_t first, uint64_t count )
+{
+    if ( self->shared )
+    {
+        uint64_t pos = first * self->block_size;
+        KFileUnlockRange( self->local, pos, check_rd_len( self, pos, ( size_t )( count * self->block_size ) ) );
+    }
+}
+
+
+/*	true if the bitmap on disk has all of these blocks,
+	i.e. another process has fetched them since we looked at our bitmap
+*/
+static bool disk_has_blocks( const KCacheTeeFile *self, uint64_t first, uint64_t count )
+{
+    uint8_t disk[ 256 ];
+    uint64_t block, first_byte = first >> 3;
+    size_t nread, bytes = ( size_t )( ( ( first + count - 1 ) >> 3 ) - first_byte + 1 );
+
+    if ( bytes > sizeof disk ||
+         KFileReadAll( self->local, self->remote_size + first_byte, disk, bytes, &nread ) != 0 ||
+         nread != bytes )
+        return false;
+
+    for ( block = first; block < first + count; ++block )
+    {
+        if ( ( disk[ ( block >> 3 ) - first_byte ] & BitNr2Mask[ block & 7 ] ) == 0 )
+            return false;
+    }
+    return true;
+}
+
+
 static rc_t rd_remote_wr_local( const KCacheTeeFile *cself, uint64_t pos,
                                 void *buffer, size_t bsize, size_t *num_read )
 {
@@ -800,263 +894,377 @@ static rc_t rd_remote_wr_local( const KCacheTeeFile *cself, uint64_t pos,
 }
 
 
-static rc_t KCacheTeeFileRead_simple2( const KCacheTeeFile *cself, uint64_t pos,
-                                       void *buffer, size_t bsize, size_t *num_read )
+static bool is_zero_buffer( const uint8_t * buffer, size_t bytes )
 {
-    rc_t rc=0;
-    uint64_t block = pos / cself->block_size;
-    size_t   offset = pos % cself->block_size;
-    size_t   to_read_total = bsize;
-	int64_t salvage_block = -1;
-		
+    size_t i;
+    for ( i = 0; i < bytes; ++i )
+    {
+        if ( buffer[ i ] != 0 )
+            return false;
+    }
+    return bytes > 0;
+}
+
+
+/*	fetch a block the caller has marked as pending, called and returning with the lock held
+	the lock is dropped while talking to the remote file, readers of the same block wait
+	for the "fetched" - condition instead of fetching it again
+	unless "trust_disk" is false, a block another process has fetched is read from disk
+*/
+static rc_t fetch_pending_block( KCacheTeeFile *self, uint64_t block, uint8_t * buffer, size_t * nread,
+                                 bool trust_disk )
+{
+    uint64_t fpos = block * self->block_size;
+    size_t fbsize = check_rd_len( self, fpos, self->block_size );
+    bool from_disk;
+    rc_t rc;
+
+    KLockUnlock( self->lock );
+    lock_blocks( self, block, 1 );
+
+    from_disk = ( trust_disk && disk_has_blocks( self, block, 1 ) );
+    if ( from_disk )
+        rc = KFileReadAll( self->local, fpos, buffer, fbsize, nread );
+    else
+        rc = rd_remote_wr_local( self, fpos, buffer, fbsize, nread );
+
+    /* the lock lives as long as the file, re-acquiring it does not fail */
+    KLockAcquire( self->lock );
+
+    if ( rc == 0 && !IS_CACHE_BIT( self, block ) )
+    {
+        if ( from_disk )
+            set_bitmap( self, block, 1 );
+        else if ( !self->local_read_only )
+        {
+            set_bitmap( self, block, 1 );
+            rc = write_bitmap( self, block, 1 );
+        }
+    }
+    unlock_blocks( self, block, 1 );
+
+    self->pending[ block >> 3 ] &= ~( BitNr2Mask[ block & 0x07 ] );
+    KConditionBroadcast( self->fetched );
+    return rc;
+}
+
+
+/*	copies "to_read" bytes at "offset" of the given block into "dst", reading from the
+	local file if the block is cached, otherwise from the remote file, into "buffer" ( one block )
+	unless the whole block was requested
+*/
+static rc_t read_block( KCacheTeeFile *self, uint64_t block, size_t offset,
+                        uint8_t * dst, size_t to_read, uint8_t * buffer, size_t * num_read )
+{
+    uint64_t fpos = block * self->block_size;
+    bool refetch = false;
+    rc_t rc = KLockAcquire( self->lock );
+
+    *num_read = 0;
+    while ( rc == 0 )
+    {
+        if ( IS_BITMAP_BIT( self->pending, block ) )
+        {
+            /* somebody else is fetching this block, wait for him */
+            rc = KConditionWait( self->fetched, self->lock );
+        }
+        else if ( IS_CACHE_BIT( self, block ) && !refetch )
+        {
+            size_t nread;
+            KLockUnlock( self->lock );
+            rc = KFileReadAll( self->local, fpos + offset, dst, to_read, num_read );
+            if ( rc != 0 || !is_zero_buffer( dst, *num_read ) )
+                return rc;
+
+            /* check for fully zero'd block, which is a sign of a broken cache-file */
+            nread = check_rd_len( self, fpos, self->block_size );
+            rc = KFileReadAll( self->local, fpos, buffer, nread, &nread );
+            if ( rc != 0 || !is_zero_buffer( buffer, nread ) )
+                return rc;
+
+            refetch = true;
+            rc = KLockAcquire( self->lock );
+        }
+        else
+        {
+            size_t nread;
+            bool whole_block = ( offset == 0 && to_read >= self->block_size );
+            uint8_t * fetch_to = whole_block ? dst : buffer;
+
+            /* this thread fetches the block, others asking for it will wait */
+            self->pending[ block >> 3 ] |= BitNr2Mask[ block & 0x07 ];
+            self->fill_next = block + 1;
+
+            rc = fetch_pending_block( self, block, fetch_to, &nread, !refetch );
+            KLockUnlock( self->lock );
+            if ( rc == 0 && nread > offset )
+            {
+                if ( to_read > nread - offset )
+                    to_read = nread - offset;
+                if ( !whole_block )
+                    memmove( dst, buffer + offset, to_read );
+                *num_read = to_read;
+            }
+            return rc;
+        }
+    }
+    return rc;
+}
+
+
+/* each reader needs a block-buffer of its own, so that readers can proceed in parallel.
+   they are kept with the file between reads instead of being allocated for each one */
+static uint8_t * take_block_buffer( KCacheTeeFile *self )
+{
+    uint8_t * buffer = NULL;
+    if ( KLockAcquire( self->lock ) == 0 )
+    {
+        if ( self->spare_count > 0 )
+            buffer = self->spare_buffers[ --self->spare_count ];
+        KLockUnlock( self->lock );
+    }
+    if ( buffer == NULL )
+        buffer = malloc( self->block_size );
+    return buffer;
+}
+
+
+static void give_block_buffer( KCacheTeeFile *self, uint8_t * buffer )
+{
+    if ( KLockAcquire( self->lock ) == 0 )
+    {
+        if ( self->spare_count < CACHE_TEE_SPARE_BUFFERS )
+        {
+            self->spare_buffers[ self->spare_count++ ] = buffer;
+            buffer = NULL;
+        }
+        KLockUnlock( self->lock );
+    }
+    free( buffer );
+}
+
+
+static rc_t KCacheTeeFileRead_concurrent( const KCacheTeeFile *cself, uint64_t pos,
+                                          void *buffer, size_t bsize, size_t *num_read )
+{
+    KCacheTeeFile *self = ( KCacheTeeFile * )cself;
+    uint8_t * dst = buffer;
+    uint8_t * block_buffer;
+    size_t to_read_total = check_rd_len( cself, pos, bsize );
+    rc_t rc = 0;
+
     *num_read = 0;
-    rc = resize_scratch_buffer( cself, cself->block_size );
+    if ( to_read_total == 0 )
+        return 0;
+
+    block_buffer = take_block_buffer( self );
+    if ( block_buffer == NULL )
+        return RC ( rcFS, rcFile, rcReading, rcMemory, rcExhausted );
 
     while ( rc == 0 && to_read_total > 0 )
-	{
-        size_t to_read = cself->block_size - offset;
-		
-        if ( to_read > to_read_total ) to_read = to_read_total;
+    {
+        uint64_t block = pos / self->block_size;
+        size_t offset = pos % self->block_size;
+        size_t to_read = self->block_size - offset;
+        size_t nread;
 
-        if ( cself -> first_block_in_scratch == block )
-		{
-            if ( cself -> valid_scratch_bytes <= offset )
-			{ /** EOF in remote file and nothing to read **/
-                to_read_total = to_read = 0; 
-			}
-			else
-			{ 
-                if ( to_read > cself -> valid_scratch_bytes - offset )
-				{ /** EOF in remote file something left**/
-				   to_read_total = to_read = cself -> valid_scratch_bytes - offset;
-                }
-                memcpy( buffer, cself -> scratch_buffer + offset, to_read );
-			}
+        if ( to_read > to_read_total ) to_read = to_read_total;
 
-            /*** move source counters **/
-            offset += to_read;
-            block  += offset / cself->block_size;
-            offset %= cself->block_size;
+        rc = read_block( self, block, offset, dst, to_read, block_buffer, &nread );
+        if ( rc == 0 )
+        {
+            if ( nread == 0 )
+                break;
 
-            /*** move output counters **/       
-            to_read_total -= to_read;
-            *num_read += to_read;
-            buffer = ((char*)buffer) + to_read;
+            pos += nread;
+            dst += nread;
+            to_read_total -= nread;
+            *num_read += nread;
         }
-		else if ( IS_CACHE_BIT( cself, block ) )
-		{
-            uint64_t fpos = block * cself->block_size;
-            int64_t fbsize = cself -> remote_size - fpos;
-            size_t nread = 0;
+    }
 
-            if( fbsize > cself->block_size ) fbsize = cself -> block_size;
+    give_block_buffer( self, block_buffer );
+    return rc;
+}
 
-            rc = KFileReadAll( cself->local, fpos, cself->scratch_buffer, fbsize, &nread );
-            if ( rc == 0 )
-			{
-                int i;
-                uint64_t *b = ( uint64_t* )cself->scratch_buffer;
-                ( ( KCacheTeeFile * )cself ) -> first_block_in_scratch = block;
-                ( ( KCacheTeeFile * )cself ) -> valid_scratch_bytes = nread;
-				
-                if ( block != salvage_block )
-				{ /** check for fully space page, but don't do it in infinite loop **/
-                    for ( i = 0; i < ( nread/ sizeof( *b ) ) && b [ i]==0; i++ ) { } 
-                    if ( i == ( nread / sizeof( *b ) ) )
-					{
-                        rc = rd_remote_wr_local( cself, block*cself->block_size, cself->scratch_buffer, fbsize, &nread );
-                        if ( rc == 0 ) salvage_block = block;
-                    }
-					else
-					{
-                        salvage_block = -1;
+
+/* the most blocks a vectored read claims to fetch up front */
+#define CACHE_TEE_READV_BLOCKS 1024
+
+static int CC cmp_block_ids( const void * a, const void * b )
+{
+    uint64_t left = *( const uint64_t * )a;
+    uint64_t right = *( const uint64_t * )b;
+    return ( left < right ) ? -1 : ( left > right );
+}
+
+
+/*	fetch a run of claimed, consecutive blocks with a single remote read
+	called and returning with the lock held, like fetch_pending_block()
+*/
+static rc_t fetch_pending_run( KCacheTeeFile *self, uint64_t first, uint64_t count )
+{
+    uint64_t fpos = first * self->block_size;
+    size_t fbsize = check_rd_len( self, fpos, ( size_t )( count * self->block_size ) );
+    size_t nread = 0;
+    uint64_t block;
+    bool from_disk;
+    rc_t rc = 0;
+
+    KLockUnlock( self->lock );
+    lock_blocks( self, first, count );
+
+    /* another process may have fetched the whole run in the meantime */
+    from_disk = disk_has_blocks( self, first, count );
+    if ( from_disk )
+        nread = fbsize;
+    else
+    {
+        uint8_t * buffer = malloc( fbsize );
+        if ( buffer == NULL )
+            rc = RC ( rcFS, rcFile, rcReading, rcMemory, rcExhausted );
+        else
+            rc = rd_remote_wr_local( self, fpos, buffer, fbsize, &nread );
+        free( buffer );
+    }
+    KLockAcquire( self->lock );
+
+    for ( block = first; block < first + count; ++block )
+    {
+        /* only blocks that arrived completely count as cached */
+        uint64_t block_end = ( block + 1 ) * self->block_size;
+        if ( rc == 0 && ( block_end <= fpos + nread || fpos + nread == self->remote_size ) )
+            set_bitmap( self, block, 1 );
+        self->pending[ block >> 3 ] &= ~( BitNr2Mask[ block & 0x07 ] );
+    }
+    if ( rc == 0 && nread > 0 && !from_disk )
+        rc = write_bitmap( self, first, count );
+    unlock_blocks( self, first, count );
+
+    KConditionBroadcast( self->fetched );
+    return rc;
+}
+
+
+/*	claim the blocks of all ranges that are neither cached nor pending,
+	and fetch each run of consecutive claimed blocks with a single remote read
+	errors are left to the reads that follow
+*/
+static void fetch_missing_blocks( KCacheTeeFile *self, const KFileReadVec * vec, uint32_t count )
+{
+    uint64_t * claimed = malloc( CACHE_TEE_READV_BLOCKS * sizeof * claimed );
+    if ( claimed != NULL )
+    {
+        uint32_t i, n = 0;
+        if ( KLockAcquire( self->lock ) == 0 )
+        {
+            for ( i = 0; i < count && n < CACHE_TEE_READV_BLOCKS; ++i )
+            {
+                size_t bytes = check_rd_len( self, vec[ i ].pos, vec[ i ].bsize );
+                if ( bytes > 0 )
+                {
+                    uint64_t block = vec[ i ].pos / self->block_size;
+                    uint64_t last = ( vec[ i ].pos + bytes - 1 ) / self->block_size;
+                    for ( ; block <= last && n < CACHE_TEE_READV_BLOCKS; ++block )
+                    {
+                        if ( !IS_CACHE_BIT( self, block ) && !IS_BITMAP_BIT( self->pending, block ) )
+                        {
+                            self->pending[ block >> 3 ] |= BitNr2Mask[ block & 0x07 ];
+                            claimed[ n++ ] = block;
+                        }
                     }
                 }
             }
-        }
-		else
-		{
-            uint64_t fpos = block * cself->block_size;
-            int64_t  fbsize = cself->remote_size - fpos;
-            size_t   nread = 0;
 
-            if ( fbsize > cself->block_size ) fbsize = cself->block_size;
-            rc = rd_remote_wr_local( cself, fpos, cself->scratch_buffer, fbsize, &nread );
-            if ( rc == 0 )
-			{
-                ( ( KCacheTeeFile * )cself ) -> first_block_in_scratch = block;
-                ( ( KCacheTeeFile * )cself ) -> valid_scratch_bytes = nread;
-                if ( !cself->local_read_only )
-				{
-                    set_bitmap( cself, block, 1 );
-                    rc = write_bitmap( cself, block, 1 );
-                }
+            qsort( claimed, n, sizeof * claimed, cmp_block_ids );
+            for ( i = 0; i < n; )
+            {
+                uint32_t j = i + 1;
+                while ( j < n && claimed[ j ] == claimed[ j - 1 ] + 1 )
+                    ++j;
+                fetch_pending_run( self, claimed[ i ], j - i );
+                i = j;
             }
+            KLockUnlock( self->lock );
         }
-
+        free( claimed );
     }
+}
 
-    return rc;
+
+/*	find the next block neither cached nor pending, starting at "fill_next"
+	readers move "fill_next" behind the block they requested last, so the
+	blocks after the current read-position are filled first
+*/
+static bool next_block_to_fill( KCacheTeeFile *self, uint64_t * block )
+{
+    uint64_t i, b = self->fill_next;
+    for ( i = 0; i < self->block_count; ++i, ++b )
+    {
+        if ( b >= self->block_count )
+            b = 0;
+        if ( ( b & 7 ) == 0 && self->bitmap[ b >> 3 ] == 0xFF )
+        {
+            /* skip 8 cached blocks at once */
+            i += 7;
+            b += 7;
+        }
+        else if ( !IS_CACHE_BIT( self, b ) && !IS_BITMAP_BIT( self->pending, b ) )
+        {
+            *block = b;
+            return true;
+        }
+    }
+    return false;
 }
 
-#if 0
-/**********************************************************************************************
-    try #3
-**********************************************************************************************/
-static rc_t KCacheTeeFileRead_3( const KCacheTeeFile *cself, uint64_t pos,
-                                 void * buffer, size_t bsize, size_t *num_read )
+
+static rc_t CC KCacheTeeFileFillThread( const KThread *t, void *data )
 {
-	rc_t rc = 0;
-	uint64_t i_pos = pos;
-	uint8_t * i_buffer = buffer;
-	size_t still_to_read = bsize;
-	size_t total_read = 0;
-	size_t bytes_read;
-
-	/* we have to exclude that we are requesting beyond EOF, we can do that because we know the size
-	   of the file, the 'constructor' of the KCacheTeeFile has requested it and rejects construction
-	   if it cannot get this size */
-	if ( ( i_pos + still_to_read ) > cself -> remote_size )
-	{
-		still_to_read = ( cself -> remote_size - i_pos );
-	}
-	
-	while ( rc == 0 && still_to_read > 0 )
-	{
-		uint64_t block = ( i_pos / cself->block_size );
-		if ( IS_CACHE_BIT( cself, block ) )
-		{
-			/* i_pos is in a cached block... */
-			size_t to_read = ( ( ( block + 1 ) * cself->block_size ) - i_pos );
-			if ( to_read > still_to_read ) to_read = still_to_read;
-			rc = KFileReadAll( cself->local, i_pos, i_buffer, to_read, &bytes_read );
-			if ( rc == 0 )
-			{
-				/* check what we read from the local file is completely empty */
-				size_t i = 0;
-				while ( i_buffer[ i ] == 0 && i < bytes_read ) { i++; }
-				if ( i == ( bytes_read + 1 ) )
-				{
-					/* we have to read from remote because this segment is zero!
-					   this is a fix for broken cache-files */
-					cself->bitmap[ block >> 3 ] &= ~( BitNr2Mask[ block & 0x07 ] );
-					rc = write_bitmap( cself, block, 1 );
-					/* do not advance the buffer, because in the loop this will be read remotely now */
-				}
-				else
-				{
-					i_buffer += bytes_read;
-					total_read += bytes_read;
-					i_pos += bytes_read;
-					still_to_read -= bytes_read;
-				}
-			}
+    KCacheTeeFile *self = data;
+    rc_t rc;
+
+    uint8_t * buffer = malloc( self->block_size );
+    if ( buffer == NULL )
+        return RC ( rcFS, rcFile, rcReading, rcMemory, rcExhausted );
+
+    rc = KLockAcquire( self->lock );
+    if ( rc == 0 )
+    {
+        uint64_t block;
+        while ( !self->fill_quit && next_block_to_fill( self, &block ) )
+        {
+            size_t nread;
+            self->pending[ block >> 3 ] |= BitNr2Mask[ block & 0x07 ];
+            self->fill_next = block + 1;
+
+            /* on error leave the remaining blocks to the readers */
+            rc = fetch_pending_block( self, block, buffer, &nread, true );
+            if ( rc != 0 )
+                break;
         }
-		else
-		{
-			/* i_pos is not in a cached block... */
-			uint64_t block_pos = ( block * cself->block_size );
-			uint64_t ofs = ( i_pos - block_pos );
-			if ( ofs == 0 && still_to_read >= cself->block_size )
-			{
-				/* read the whole block remotely, this can return less than requested if last block...
-				   and it can return 0 bytes if the http-connection times out... */
-				rc = KFileReadAll( cself->remote, i_pos, i_buffer, cself->block_size, &bytes_read );
-				if ( rc == 0 )
-				{
-					if ( bytes_read == 0 )
-					{
-						still_to_read = 0;	/* terminate the loop, return as much as read so far, return rc ==0 */
-					}
-					else
-					{
-						/* write it to the local file */
-						size_t bytes_written;
-						rc = KFileWriteAll( cself->local, i_pos, i_buffer, bytes_read, &bytes_written );
-						if ( rc == 0 )
-						{
-							if ( bytes_written != bytes_read )
-							{
-								rc = RC ( rcFS, rcFile, rcWriting, rcTransfer, rcTooShort );
-							}
-							else
-							{
-								/* write the bitmap */
-								set_bitmap( cself, block, 1 );
-								rc = write_bitmap( cself, block, 1 );
-								if ( rc == 0 )
-								{
-									i_buffer += bytes_read;
-									total_read += bytes_read;
-									i_pos += bytes_read;
-									still_to_read -= bytes_read;
-								}
-							}
-						}
-					}
-				}
-			}
-			else
-			{
-				/* use the scratch-buffer to read the whole block, copy the smaller part that was requested */
-				if ( cself->scratch_size < cself->block_size )
-				{
-					rc = resize_scratch_buffer( cself, cself->block_size );
-				}
-				if ( rc == 0 )
-				{
-					/* read the whole block remotely, this can return less than requested if last block...
-				       and it can return 0 bytes if the http-connection times out... */
-					rc = KFileReadAll( cself->remote, block_pos, cself->scratch_buffer, cself->block_size, &bytes_read );
-					if ( rc == 0 )
-					{
-						if ( bytes_read == 0 )
-						{
-							still_to_read = 0;	/* terminate the loop, return as much as read so far, return rc ==0 */
-						}
-						else
-						{
-							/* write it to the local file */
-							size_t bytes_written;
-							rc = KFileWriteAll( cself->local, block_pos, cself -> scratch_buffer, bytes_read, &bytes_written );
-							if ( rc == 0 )
-							{
-								if ( bytes_written != bytes_read )
-								{
-									rc = RC ( rcFS, rcFile, rcWriting, rcTransfer, rcTooShort );
-								}
-								else
-								{
-									/* write the bitmap */
-									set_bitmap( cself, block, 1 );
-									rc = write_bitmap( cself, block, 1 );
-									if ( rc == 0 )
-									{
-										/* here comes the difference: copy the bytes from the offset */
-										size_t to_copy = ( cself->block_size - ofs );
-										if ( to_copy > still_to_read ) to_copy = still_to_read;
-										memmove ( i_buffer, &( cself->scratch_buffer[ ofs ] ), to_copy );
-										
-										i_buffer += to_copy;
-										total_read += to_copy;
-										i_pos += to_copy;
-										still_to_read -= to_copy;
-									}
-								}
-							}
-						}
-					}
-				}
-			}
-		}
-	}
+        KLockUnlock( self->lock );
+    }
 
-	if ( rc == 0 )
-		*num_read = total_read;
+    free( buffer );
+    return rc;
+}
 
-	return rc;
+
+static void stop_fill_thread( KCacheTeeFile *self )
+{
+    if ( self->filler != NULL )
+    {
+        if ( KLockAcquire( self->lock ) == 0 )
+        {
+            self->fill_quit = true;
+            KLockUnlock( self->lock );
+        }
+        KThreadWait( self->filler, NULL );
+        KThreadRelease( self->filler );
+        self->filler = NULL;
+    }
 }
-#endif
 
 /**********************************************************************************************
     START vt-functions
@@ -1091,10 +1299,10 @@ static rc_t KCacheTeeFileRead( const KCacheTeeFile *cself, uint64_t pos,
                                void *buffer, size_t bsize, size_t *num_read )
 {
 
-	/* rc_t rc = KCacheTeeFileRead_3( cself, pos, buffer, bsize, num_read ); */
-    rc_t rc = KCacheTeeFileRead_simple2( cself, pos, buffer, bsize, num_read );
+    rc_t rc = KCacheTeeFileRead_concurrent( cself, pos, buffer, bsize, num_read );
 
 #if( CACHE_STAT > 0 )
+	/* the statistic is not guarded, it is meant for single readers */
 	write_cache_stat( & ( ( ( KCacheTeeFile * )cself ) -> stat ), pos, bsize, *num_read );
 #endif
 	
@@ -1102,12 +1310,50 @@ static rc_t KCacheTeeFileRead( const KCacheTeeFile *cself, uint64_t pos,
 }
 
 
+static rc_t KCacheTeeFileReadV( const KCacheTeeFile *cself, KFileReadVec *vec, uint32_t count )
+{
+    uint32_t i;
+    rc_t rc = 0;
+
+    /* one remote request per run of missing blocks, instead of one per block */
+    if ( !cself->local_read_only )
+        fetch_missing_blocks( ( KCacheTeeFile * )cself, vec, count );
+
+    for ( i = 0; rc == 0 && i < count; ++i )
+    {
+        if ( vec[ i ].bsize > 0 )
+            rc = KCacheTeeFileRead( cself, vec[ i ].pos, vec[ i ].buffer, vec[ i ].bsize, &vec[ i ].num_read );
+    }
+    return rc;
+}
+
+
 static rc_t KCacheTeeFileWrite( KCacheTeeFile *self, uint64_t pos,
                                 const void *buffer, size_t size, size_t *num_writ )
 {
     return RC ( rcFS, rcFile, rcUpdating, rcInterface, rcUnsupported );
 }
 
+static uint32_t KCacheTeeFileType( const KCacheTeeFile *self )
+{
+    /* what a version 1.0 file used to report */
+    return kfdInvalid;
+}
+
+
+static rc_t KCacheTeeFileTimedRead( const KCacheTeeFile *self, uint64_t pos,
+                                    void *buffer, size_t bsize, size_t *num_read, struct timeout_t *tm )
+{
+    return KCacheTeeFileRead( self, pos, buffer, bsize, num_read );
+}
+
+
+static rc_t KCacheTeeFileTimedWrite( KCacheTeeFile *self, uint64_t pos,
+                                     const void *buffer, size_t size, size_t *num_writ, struct timeout_t *tm )
+{
+    return KCacheTeeFileWrite( self, pos, buffer, size, num_writ );
+}
+
 /**********************************************************************************************
     END vt-functions
 **********************************************************************************************/
@@ -1115,8 +1361,8 @@ static rc_t KCacheTeeFileWrite( KCacheTeeFile *self, uint64_t pos,
 
 static KFile_vt_v1 vtKCacheTeeFile =
 {
-    /* version 1.0 */
-    1, 0,
+    /* version 1.3 */
+    1, 3,
 
     /* start minor version 0 methods */
     KCacheTeeFileDestroy,
@@ -1125,8 +1371,21 @@ static KFile_vt_v1 vtKCacheTeeFile =
     KCacheTeeFileSize,
     KCacheTeeFileSetSize,
     KCacheTeeFileRead,
-    KCacheTeeFileWrite
+    KCacheTeeFileWrite,
     /* end minor version 0 methods */
+
+    /* start minor version 1 methods */
+    KCacheTeeFileType,
+    /* end minor version 1 methods */
+
+    /* start minor version 2 methods */
+    KCacheTeeFileTimedRead,
+    KCacheTeeFileTimedWrite,
+    /* end minor version 2 methods */
+
+    /* start minor version 3 methods */
+    KCacheTeeFileReadV
+    /* end minor version 3 methods */
 };
 
 
@@ -1136,6 +1395,11 @@ static rc_t make_cache_tee( struct KDirectory *self, struct KFile const **tee,
     rc_t rc;
     size_t path_size = string_size ( path );
     KCacheTeeFile * cf = malloc ( sizeof * cf + path_size + 1 );
+
+    /* the date orders the files of a cache directory by last use for KDirectoryTrimCacheDir */
+    if ( ! read_only )
+        KDirectorySetDate ( self, false, KTimeStamp (), "%s.cache", path );
+
     if ( cf == NULL )
         rc = RC ( rcFS, rcFile, rcConstructing, rcMemory, rcExhausted );
     else
@@ -1146,11 +1410,15 @@ static rc_t make_cache_tee( struct KDirectory *self, struct KFile const **tee,
         cf -> local  = local;
         cf -> block_size = ( blocksize > 0 ) ? blocksize : CACHE_TEE_DEFAULT_BLOCKSIZE;
         cf -> bitmap = NULL;
-        cf -> scratch_buffer = NULL;
-        cf -> scratch_size = 0;
-        cf -> first_block_in_scratch = -1;
-        cf -> valid_scratch_bytes = 0;
+        cf -> lock = NULL;
+        cf -> fetched = NULL;
+        cf -> pending = NULL;
+        cf -> filler = NULL;
+        cf -> fill_next = 0;
+        cf -> fill_quit = false;
+        cf -> spare_count = 0;
 		cf -> local_read_only = read_only;
+        cf -> shared = false;
 
 #if( CACHE_STAT > 0 )
 		init_cache_stat( & cf -> stat );
@@ -1201,7 +1469,7 @@ static rc_t make_cache_tee( struct KDirectory *self, struct KFile const **tee,
                     rc = verify_existing_local_file( cf, &fully_in_cache );
             }
 
-			if ( rc == 0 && fully_in_cache && ! cf -> local_read_only )
+			if ( rc == 0 && fully_in_cache && ! cf -> local_read_only && ! used_by_other_process( cf ) )
             {
                 /* here is the up-front-test: the cache is complete and we have write access! */
                 rc = promote_cache( cf );
@@ -1219,6 +1487,11 @@ static rc_t make_cache_tee( struct KDirectory *self, struct KFile const **tee,
 				{
                     cf -> remote_size = cf -> local_size;
 				}
+
+                /* announce the use of the local file to other processes,
+                   and coordinate with them where byte-range locks are supported */
+                if ( ! cf -> local_read_only )
+                    cf -> shared = ( KFileLockRange( cf -> local, IN_USE_MARKER( cf ), 1, false, true ) == 0 );
 				
                 /* now we have to AddRef() everything we hang on until the final release! */
                 rc = KDirectoryAddRef ( cf -> dir );
@@ -1227,6 +1500,12 @@ static rc_t make_cache_tee( struct KDirectory *self, struct KFile const **tee,
                     rc = KFileAddRef( cf -> remote );
                     if ( rc == 0 )
                     {
+                        /* what concurrent readers need to coordinate fetching blocks */
+                        rc = KLockMake ( & cf -> lock );
+                        if ( rc == 0 )
+                            rc = KConditionMake ( & cf -> fetched );
+                        if ( rc == 0 )
+                            rc = create_bitmap_buffer( & cf -> pending, cf -> bitmap_bytes );
                         if ( rc == 0 )
                         {
 							rc = KFileInit( &cf -> dad, (const union KFile_vt *)&vtKCacheTeeFile, "KCacheTeeFile", path, true, false );
@@ -1255,6 +1534,9 @@ static rc_t make_cache_tee( struct KDirectory *self, struct KFile const **tee,
                 }
             }
         }
+        free ( cf -> pending );
+        KConditionRelease ( cf -> fetched );
+        KLockRelease ( cf -> lock );
         free ( cf );
     }
     return rc;
@@ -1366,6 +1648,179 @@ LIB_EXPORT rc_t CC KDirectoryMakeCacheTee ( struct KDirectory *self,
 }
 
 
+typedef struct cache_dir_entry
+{
+    const char * name;
+    KTime_t date;
+    uint64_t size;
+} cache_dir_entry;
+
+
+static int CC cache_dir_entry_cmp( const void * a, const void * b, void * data )
+{
+    const cache_dir_entry * ea = a;
+    const cache_dir_entry * eb = b;
+    if ( ea -> date != eb -> date )
+        return ( ea -> date < eb -> date ) ? -1 : 1;
+    return strcmp( ea -> name, eb -> name );
+}
+
+
+/*	remove a file nobody fills right now: a CacheTee-file holds byte-range locks on its
+	local file, our write-lock over all of it is refused then. locks being unsupported
+	only leaves the removal to fail on systems that refuse to remove open files.
+*/
+static bool evict_cache_file( KDirectory * self, const char * dir, const char * name )
+{
+    bool removed = false;
+    struct KFile * f;
+    rc_t rc = KDirectoryOpenFileWrite( self, &f, true, "%s/%s", dir, name );
+    if ( rc == 0 )
+    {
+        rc = KFileLockRange( f, 0, 0, true, false );
+        if ( GetRCState( rc ) != rcBusy )
+            removed = ( KDirectoryRemove( self, false, "%s/%s", dir, name ) == 0 );
+        KFileRelease( f );
+    }
+    return removed;
+}
+
+
+/*	bytes a file takes on disk, directories not reporting it give the size of the file,
+	which overcounts a partial cache file with holes in it
+*/
+static rc_t cache_file_size( const KDirectory * self, const char * dir, const char * name, uint64_t * size )
+{
+    rc_t rc = KDirectoryFilePhysicalSize( self, size, "%s/%s", dir, name );
+    if ( rc != 0 )
+        rc = KDirectoryFileSize( self, size, "%s/%s", dir, name );
+    return rc;
+}
+
+
+static rc_t trim_cache_dir( KDirectory * self, uint64_t budget, uint64_t * evicted,
+                            const char * dir, const KNamelist * names )
+{
+    uint32_t i, count;
+    rc_t rc = KNamelistCount( names, &count );
+    if ( rc == 0 && count > 0 )
+    {
+        cache_dir_entry * entries = malloc( count * sizeof * entries );
+        if ( entries == NULL )
+            rc = RC ( rcFS, rcDirectory, rcUpdating, rcMemory, rcExhausted );
+        else
+        {
+            uint32_t used = 0;
+            uint64_t total = 0;
+
+            for ( i = 0; rc == 0 && i < count; ++i )
+            {
+                cache_dir_entry * e = &entries[ used ];
+                rc = KNamelistGet( names, i, &e -> name );
+                if ( rc == 0 &&
+                     KDirectoryPathType( self, "%s/%s", dir, e -> name ) == kptFile &&
+                     cache_file_size( self, dir, e -> name, &e -> size ) == 0 &&
+                     KDirectoryDate( self, &e -> date, "%s/%s", dir, e -> name ) == 0 )
+                {
+                    total += e -> size;
+                    ++used;
+                }
+            }
+
+            if ( rc == 0 && total > budget )
+            {
+                ksort( entries, used, sizeof * entries, cache_dir_entry_cmp, NULL );
+                for ( i = 0; i < used && total > budget; ++i )
+                {
+                    if ( evict_cache_file( self, dir, entries[ i ].name ) )
+                    {
+                        total -= entries[ i ].size;
+                        *evicted += entries[ i ].size;
+                    }
+                }
+            }
+            free( entries );
+        }
+    }
+    return rc;
+}
+
+
+LIB_EXPORT rc_t CC KDirectoryVTrimCacheDir ( struct KDirectory *self,
+    uint64_t budget, uint64_t *evicted, const char *path, va_list args )
+{
+    rc_t rc;
+    uint64_t dummy;
+
+    if ( evicted == NULL )
+        evicted = &dummy;
+    *evicted = 0;
+
+    if ( self == NULL )
+        rc = RC ( rcFS, rcDirectory, rcUpdating, rcSelf, rcNull );
+    else if ( path == NULL )
+        rc = RC ( rcFS, rcDirectory, rcUpdating, rcPath, rcNull );
+    else if ( path [ 0 ] == 0 )
+        rc = RC ( rcFS, rcDirectory, rcUpdating, rcPath, rcEmpty );
+    else
+    {
+        char full [ 4096 ];
+        rc = KDirectoryVResolvePath ( self, false, full, sizeof full, path, args );
+        if ( rc == 0 )
+        {
+            KNamelist * names;
+            rc = KDirectoryList( self, &names, NULL, NULL, "%s", full );
+            if ( rc == 0 )
+            {
+                rc = trim_cache_dir( self, budget, evicted, full, names );
+                KNamelistRelease( names );
+            }
+        }
+    }
+    return rc;
+}
+
+
+LIB_EXPORT rc_t CC KDirectoryTrimCacheDir ( struct KDirectory *self,
+    uint64_t budget, uint64_t *evicted, const char *path, ... )
+{
+    rc_t rc;
+    va_list args;
+    va_start ( args, path );
+
+    rc = KDirectoryVTrimCacheDir ( self, budget, evicted, path, args );
+
+    va_end ( args );
+
+    return rc;
+}
+
+
+LIB_EXPORT rc_t CC StartCacheFill( const struct KFile * self )
+{
+    rc_t rc = 0;
+    KCacheTeeFile * cf;
+
+    if ( self == NULL )
+        return RC ( rcFS, rcFile, rcValidating, rcSelf, rcNull );
+    if ( self -> vt != ( const KFile_vt * ) &vtKCacheTeeFile )
+        return 0;
+
+    cf = ( KCacheTeeFile * ) self;
+    if ( cf -> local_read_only )
+        return 0;
+
+    rc = KLockAcquire( cf -> lock );
+    if ( rc == 0 )
+    {
+        if ( cf -> filler == NULL && ! cf -> fill_quit )
+            rc = KThreadMake( &cf -> filler, KCacheTeeFileFillThread, cf );
+        KLockUnlock( cf -> lock );
+    }
+    return rc;
+}
+
+
 LIB_EXPORT rc_t CC GetCacheCompleteness( const struct KFile * self, float * percent, uint64_t * bytes_in_cache )
 {
     rc_t rc;
@@ -443,6 +443,66 @@ LIB_EXPORT rc_t CC KFileTimedReadAll_v1 ( const KFile_v1 *self, uint64_t pos,
     return rc;
 }
 
+/* ReadV
+ *  read several ranges of a file with a single message
+ *
+ *  "vec" [ IN/OUT ] and "count" [ IN ] - ranges to read. each
+ *  range is read as by ReadAll, and receives in "num_read" the
+ *  number of bytes read, which is less than "bsize" only at
+ *  end of file.
+ */
+LIB_EXPORT rc_t CC KFileReadV_v1 ( const KFile_v1 *self,
+    KFileReadVec *vec, uint32_t count )
+{
+    rc_t rc;
+    uint32_t i;
+
+    if ( vec == NULL )
+    {
+        if ( count == 0 )
+            return 0;
+        return RC ( rcFS, rcFile, rcReading, rcParam, rcNull );
+    }
+
+    for ( i = 0; i < count; ++ i )
+    {
+        vec [ i ] . num_read = 0;
+        if ( vec [ i ] . buffer == NULL && vec [ i ] . bsize != 0 )
+            return RC ( rcFS, rcFile, rcReading, rcBuffer, rcNull );
+    }
+
+    if ( self == NULL )
+        return RC ( rcFS, rcFile, rcReading, rcSelf, rcNull );
+
+    if ( ! self -> read_enabled )
+        return RC ( rcFS, rcFile, rcReading, rcFile, rcNoPerm );
+
+    switch ( self -> vt -> v1 . maj )
+    {
+    case 1:
+        rc = 0;
+        if ( self -> vt -> v1 . min >= 3 )
+            rc = ( * self -> vt -> v1 . read_v ) ( self, vec, count );
+
+        /* read what the implementation left over, if anything */
+        for ( i = 0; rc == 0 && i < count; ++ i )
+        {
+            KFileReadVec *v = & vec [ i ];
+            if ( v -> num_read < v -> bsize )
+            {
+                size_t num_read;
+                rc = KFileReadAll_v1 ( self, v -> pos + v -> num_read,
+                    ( uint8_t* ) v -> buffer + v -> num_read, v -> bsize - v -> num_read, & num_read );
+                if ( rc == 0 )
+                    v -> num_read += num_read;
+            }
+        }
+        return rc;
+    }
+
+    return RC ( rcFS, rcFile, rcReading, rcInterface, rcBadVersion );
+}
+
 /* ReadExactly
  * TimedReadExactly
  *  read from file until "bytes" have been retrieved
@@ -819,6 +879,11 @@ LIB_EXPORT rc_t CC KFileInit ( KFile_v1 *self, const KFile_vt *vt,
         switch ( vt -> v1 . min )
         {
             /* ADD NEW MINOR VERSION CASES HERE */
+        case 3:
+#if _DEBUGGING
+            if ( vt -> v1 . read_v == NULL )
+                return RC ( rcFS, rcFile, rcConstructing, rcInterface, rcNull );
+#endif
         case 2:
 #if _DEBUGGING
             if ( vt -> v1 . timed_write == NULL ||
@@ -0,0 +1,462 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include <kfs/extern.h>
+#include <kfs/ioqueue.h>
+#include <kfs/file.h>
+#include <kfs/impl.h>
+#include <klib/refcount.h>
+#include <klib/rc.h>
+#include <sysalloc.h>
+
+#include "sysuring-priv.h"
+
+#include <stdlib.h>
+#include <errno.h>
+#include <assert.h>
+
+
+/*--------------------------------------------------------------------------
+ * KFileIORequest
+ *  one slot of the queue
+ */
+typedef struct KFileIORequest KFileIORequest;
+struct KFileIORequest
+{
+    const KFile *f;
+    const struct KSysFile_v1 *sys;
+    uint64_t offset;
+    uint64_t pos;
+    void *buffer;
+    void *data;
+    size_t bsize;
+    size_t num_read;
+    int32_t buf_idx;
+    rc_t rc;
+};
+
+
+/*--------------------------------------------------------------------------
+ * KFileIOQueue
+ */
+struct KFileIOQueue
+{
+    KSysURing *ring;
+    KFileIORequest *req;
+
+    /* stack of free slots */
+    uint32_t *free;
+    uint32_t num_free;
+
+    /* circular list of slots completed without the ring */
+    uint32_t *ready;
+    uint32_t ready_head;
+    uint32_t num_ready;
+
+    uint32_t depth;
+    KRefcount refcount;
+};
+
+static
+rc_t KFileIOQueueComplete_int ( KFileIOQueue *self, KFileIOCompletion *c, bool wait );
+
+/* Whack
+ */
+static
+rc_t KFileIOQueueWhack ( KFileIOQueue *self )
+{
+    /* the kernel may still be writing into caller buffers */
+    while ( self -> num_free < self -> depth )
+    {
+        KFileIOCompletion c;
+        if ( KFileIOQueueComplete_int ( self, & c, true ) != 0 )
+            break;
+    }
+
+    KSysURingWhack ( self -> ring );
+    free ( self -> req );
+    free ( self -> free );
+    free ( self -> ready );
+    free ( self );
+    return 0;
+}
+
+/* Make
+ */
+LIB_EXPORT rc_t CC KFileIOQueueMake ( KFileIOQueue **qp, uint32_t depth )
+{
+    rc_t rc;
+    KFileIOQueue *q;
+
+    if ( qp == NULL )
+        return RC ( rcFS, rcQueue, rcConstructing, rcParam, rcNull );
+    * qp = NULL;
+
+    if ( depth == 0 )
+        return RC ( rcFS, rcQueue, rcConstructing, rcParam, rcInvalid );
+
+    q = calloc ( 1, sizeof * q );
+    if ( q == NULL )
+        return RC ( rcFS, rcQueue, rcConstructing, rcMemory, rcExhausted );
+
+    q -> req = calloc ( depth, sizeof q -> req [ 0 ] );
+    q -> free = malloc ( depth * sizeof q -> free [ 0 ] );
+    q -> ready = malloc ( depth * sizeof q -> ready [ 0 ] );
+    if ( q -> req == NULL || q -> free == NULL || q -> ready == NULL )
+        rc = RC ( rcFS, rcQueue, rcConstructing, rcMemory, rcExhausted );
+    else
+    {
+        uint32_t i;
+        for ( i = 0; i < depth; ++ i )
+            q -> free [ i ] = depth - 1 - i;
+        q -> num_free = q -> depth = depth;
+
+        /* without a ring every read is performed as it is queued */
+        if ( KSysURingMake ( & q -> ring, depth ) != 0 )
+            q -> ring = NULL;
+
+        KRefcountInit ( & q -> refcount, 1, "KFileIOQueue", "make", "ioqueue" );
+        * qp = q;
+        return 0;
+    }
+
+    free ( q -> req );
+    free ( q -> free );
+    free ( q -> ready );
+    free ( q );
+    return rc;
+}
+
+/* AddRef
+ * Release
+ */
+LIB_EXPORT rc_t CC KFileIOQueueAddRef ( const KFileIOQueue *self )
+{
+    if ( self != NULL ) switch ( KRefcountAdd ( & self -> refcount, "KFileIOQueue" ) )
+    {
+    case krefOkay:
+        break;
+    default:
+        return RC ( rcFS, rcQueue, rcAttaching, rcConstraint, rcViolated );
+    }
+    return 0;
+}
+
+LIB_EXPORT rc_t CC KFileIOQueueRelease ( const KFileIOQueue *self )
+{
+    if ( self != NULL ) switch ( KRefcountDrop ( & self -> refcount, "KFileIOQueue" ) )
+    {
+    case krefOkay:
+        break;
+    case krefWhack:
+        return KFileIOQueueWhack ( ( KFileIOQueue* ) self );
+    default:
+        return RC ( rcFS, rcQueue, rcReleasing, rcConstraint, rcViolated );
+    }
+    return 0;
+}
+
+/* Asynchronous
+ */
+LIB_EXPORT bool CC KFileIOQueueAsynchronous ( const KFileIOQueue *self )
+{
+    return self != NULL && self -> ring != NULL;
+}
+
+/* Outstanding
+ */
+LIB_EXPORT uint32_t CC KFileIOQueueOutstanding ( const KFileIOQueue *self )
+{
+    if ( self == NULL )
+        return 0;
+    return self -> depth - self -> num_free;
+}
+
+/* RegisterBuffers
+ */
+LIB_EXPORT rc_t CC KFileIOQueueRegisterBuffers ( KFileIOQueue *self,
+    void * const *buffers, const size_t *sizes, uint32_t count )
+{
+    if ( self == NULL )
+        return RC ( rcFS, rcQueue, rcRegistering, rcSelf, rcNull );
+    if ( count != 0 && ( buffers == NULL || sizes == NULL ) )
+        return RC ( rcFS, rcQueue, rcRegistering, rcParam, rcNull );
+    if ( self -> num_free != self -> depth )
+        return RC ( rcFS, rcQueue, rcRegistering, rcQueue, rcBusy );
+
+    /* failure to pin leaves the buffers usable as ordinary memory */
+    if ( self -> ring != NULL )
+        KSysURingRegisterBuffers ( self -> ring, buffers, sizes, count );
+
+    return 0;
+}
+
+/* read an error code from the ring
+ */
+static
+rc_t KFileIOQueueReadError ( int err )
+{
+    switch ( err )
+    {
+    case EBADF:
+        return RC ( rcFS, rcFile, rcReading, rcFileDesc, rcInvalid );
+    case EFAULT:
+        return RC ( rcFS, rcFile, rcReading, rcBuffer, rcInvalid );
+    case EINVAL:
+        return RC ( rcFS, rcFile, rcReading, rcParam, rcInvalid );
+    case EISDIR:
+        return RC ( rcFS, rcFile, rcReading, rcFile, rcWrongType );
+    case ENOMEM:
+        return RC ( rcFS, rcFile, rcReading, rcMemory, rcExhausted );
+    case EIO:
+        return RC ( rcFS, rcFile, rcReading, rcTransfer, rcUnknown );
+    }
+    return RC ( rcFS, rcFile, rcReading, rcNoObj, rcUnknown );
+}
+
+/* hand the unread remainder of a slot to the ring
+ */
+static
+rc_t KFileIOQueuePrepare ( KFileIOQueue *self, uint32_t idx )
+{
+    KFileIORequest *req = & self -> req [ idx ];
+    return KSysURingPrepare ( self -> ring, req -> sys,
+        req -> offset + req -> pos + req -> num_read,
+        ( char* ) req -> buffer + req -> num_read,
+        req -> bsize - req -> num_read, req -> buf_idx, idx );
+}
+
+/* Read
+ */
+LIB_EXPORT rc_t CC KFileIOQueueRead ( KFileIOQueue *self, const KFile *f,
+    uint64_t pos, void *buffer, size_t bsize, int32_t buf_idx, void *data )
+{
+    rc_t rc;
+    uint32_t idx;
+    KFileIORequest *req;
+
+    if ( self == NULL )
+        return RC ( rcFS, rcQueue, rcInserting, rcSelf, rcNull );
+    if ( f == NULL )
+        return RC ( rcFS, rcQueue, rcInserting, rcFile, rcNull );
+    if ( buffer == NULL && bsize != 0 )
+        return RC ( rcFS, rcQueue, rcInserting, rcBuffer, rcNull );
+    if ( self -> num_free == 0 )
+        return RC ( rcFS, rcQueue, rcInserting, rcQueue, rcExhausted );
+
+    rc = KFileAddRef ( f );
+    if ( rc != 0 )
+        return rc;
+
+    idx = self -> free [ -- self -> num_free ];
+    req = & self -> req [ idx ];
+
+    req -> f = f;
+    req -> sys = NULL;
+    req -> offset = 0;
+    req -> pos = pos;
+    req -> buffer = buffer;
+    req -> data = data;
+    req -> bsize = bsize;
+    req -> num_read = 0;
+    req -> buf_idx = buf_idx;
+    req -> rc = 0;
+
+    if ( self -> ring != NULL && bsize != 0 )
+    {
+        /* files that map directly onto a system file go to the kernel */
+        req -> sys = KFileGetSysFile ( f, & req -> offset );
+        if ( req -> sys != NULL && KFileIOQueuePrepare ( self, idx ) == 0 )
+            return 0;
+        req -> sys = NULL;
+    }
+
+    /* everything else is read now and reported by Complete */
+    req -> rc = KFileReadAll ( f, pos, buffer, bsize, & req -> num_read );
+    self -> ready [ ( self -> ready_head + self -> num_ready ) % self -> depth ] = idx;
+    ++ self -> num_ready;
+
+    return 0;
+}
+
+/* Submit
+ */
+LIB_EXPORT rc_t CC KFileIOQueueSubmit ( KFileIOQueue *self )
+{
+    if ( self == NULL )
+        return RC ( rcFS, rcQueue, rcWriting, rcSelf, rcNull );
+    if ( self -> ring == NULL )
+        return 0;
+    return KSysURingSubmit ( self -> ring );
+}
+
+/* Complete
+ */
+static
+void KFileIOQueueRetire ( KFileIOQueue *self, uint32_t idx, KFileIOCompletion *c )
+{
+    KFileIORequest *req = & self -> req [ idx ];
+
+    c -> pos = req -> pos;
+    c -> buffer = req -> buffer;
+    c -> data = req -> data;
+    c -> num_read = req -> num_read;
+    c -> rc = req -> rc;
+
+    KFileRelease ( req -> f );
+    req -> f = NULL;
+    req -> sys = NULL;
+
+    self -> free [ self -> num_free ++ ] = idx;
+}
+
+static
+rc_t KFileIOQueueComplete_int ( KFileIOQueue *self, KFileIOCompletion *c, bool wait )
+{
+    if ( self -> num_free == self -> depth )
+        return RC ( rcFS, rcQueue, rcReading, rcQueue, rcDone );
+
+    if ( self -> num_ready != 0 )
+    {
+        uint32_t idx = self -> ready [ self -> ready_head ];
+        self -> ready_head = ( self -> ready_head + 1 ) % self -> depth;
+        -- self -> num_ready;
+        KFileIOQueueRetire ( self, idx, c );
+        return 0;
+    }
+
+    while ( 1 )
+    {
+        uint64_t tag;
+        int32_t res;
+        KFileIORequest *req;
+
+        rc_t rc = KSysURingReap ( self -> ring, & tag, & res, wait );
+        if ( rc != 0 )
+            return rc;
+
+        assert ( tag < self -> depth );
+        req = & self -> req [ tag ];
+
+        if ( res < 0 )
+        {
+            if ( res != -EINTR && res != -EAGAIN )
+                req -> rc = KFileIOQueueReadError ( - res );
+        }
+        else
+        {
+            req -> num_read += ( size_t ) res;
+
+            /* end of file or done */
+            if ( res == 0 || req -> num_read == req -> bsize )
+            {
+                KFileIOQueueRetire ( self, ( uint32_t ) tag, c );
+                return 0;
+            }
+        }
+
+        if ( req -> rc == 0 )
+        {
+            /* short or interrupted, continue with the remainder */
+            req -> rc = KFileIOQueuePrepare ( self, ( uint32_t ) tag );
+        }
+
+        if ( req -> rc != 0 )
+        {
+            KFileIOQueueRetire ( self, ( uint32_t ) tag, c );
+            return 0;
+        }
+    }
+}
+
+LIB_EXPORT rc_t CC KFileIOQueueComplete ( KFileIOQueue *self,
+    KFileIOCompletion *c, bool wait )
+{
+    if ( self == NULL )
+        return RC ( rcFS, rcQueue, rcReading, rcSelf, rcNull );
+    if ( c == NULL )
+        return RC ( rcFS, rcQueue, rcReading, rcParam, rcNull );
+
+    return KFileIOQueueComplete_int ( self, c, wait );
+}
+
+/* ReadV
+ */
+LIB_EXPORT rc_t CC KFileIOQueueReadV ( KFileIOQueue *self, const KFile *f,
+    KFileReadVec *vec, uint32_t count )
+{
+    rc_t rc = 0;
+    uint32_t i;
+    KFileIOCompletion c;
+
+    if ( self == NULL )
+        return RC ( rcFS, rcQueue, rcReading, rcSelf, rcNull );
+    if ( f == NULL )
+        return RC ( rcFS, rcQueue, rcReading, rcFile, rcNull );
+    if ( vec == NULL && count != 0 )
+        return RC ( rcFS, rcQueue, rcReading, rcParam, rcNull );
+    if ( self -> num_free != self -> depth )
+        return RC ( rcFS, rcQueue, rcReading, rcQueue, rcBusy );
+
+    for ( i = 0; i < count; ++ i )
+        vec [ i ] . num_read = 0;
+
+    for ( i = 0; i < count && rc == 0; )
+    {
+        if ( self -> num_free != 0 )
+        {
+            rc = KFileIOQueueRead ( self, f, vec [ i ] . pos,
+                vec [ i ] . buffer, vec [ i ] . bsize, -1, & vec [ i ] );
+            ++ i;
+        }
+        else
+        {
+            rc = KFileIOQueueComplete_int ( self, & c, true );
+            if ( rc == 0 )
+            {
+                ( ( KFileReadVec* ) c . data ) -> num_read = c . num_read;
+                rc = c . rc;
+            }
+        }
+    }
+
+    /* collect everything in flight, even after an error */
+    while ( self -> num_free != self -> depth )
+    {
+        rc_t rc2 = KFileIOQueueComplete_int ( self, & c, true );
+        if ( rc2 != 0 )
+        {
+            if ( rc == 0 )
+                rc = rc2;
+            break;
+        }
+        ( ( KFileReadVec* ) c . data ) -> num_read = c . num_read;
+        if ( rc == 0 )
+            rc = c . rc;
+    }
+
+    return rc;
+}
@@ -0,0 +1,419 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include <kfs/extern.h>
+#include "sysfile-priv.h"
+#include "../sysuring-priv.h"
+#include <klib/rc.h>
+#include <sysalloc.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <assert.h>
+
+#if defined __has_include
+#if __has_include ( <linux/io_uring.h> )
+#define HAVE_IO_URING 1
+#endif
+#endif
+
+#if HAVE_IO_URING
+
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/* reads of more than this are issued in pieces by the caller */
+#define URING_MAX_READ ( 1U << 30 )
+
+/*--------------------------------------------------------------------------
+ * KSysURing
+ *  io_uring driven directly through its system calls
+ */
+struct KSysURing
+{
+    /* submission ring */
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+
+    /* completion ring */
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+
+    /* mappings */
+    void *sq_ring;
+    void *cq_ring;
+    size_t sq_ring_size;
+    size_t cq_ring_size;
+    size_t sqes_size;
+
+    uint32_t entries;
+    uint32_t staged;
+    uint32_t bufs;
+
+    int fd;
+};
+
+static
+int uring_setup ( uint32_t entries, struct io_uring_params *p )
+{
+    return ( int ) syscall ( __NR_io_uring_setup, entries, p );
+}
+
+static
+int uring_enter ( int fd, uint32_t to_submit, uint32_t min_complete, uint32_t flags )
+{
+    return ( int ) syscall ( __NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0 );
+}
+
+static
+int uring_register ( int fd, uint32_t opcode, const void *arg, uint32_t nr_args )
+{
+    return ( int ) syscall ( __NR_io_uring_register, fd, opcode, arg, nr_args );
+}
+
+static
+rc_t uring_error ( int err, enum RCContext ctx )
+{
+    switch ( err )
+    {
+    case ENOSYS:
+    case EPERM:
+    case EINVAL:
+        return RC ( rcFS, rcQueue, ctx, rcInterface, rcUnsupported );
+    case ENOMEM:
+    case EAGAIN:
+        return RC ( rcFS, rcQueue, ctx, rcMemory, rcExhausted );
+    case EMFILE:
+    case ENFILE:
+        return RC ( rcFS, rcQueue, ctx, rcFileDesc, rcExhausted );
+    }
+    return RC ( rcFS, rcQueue, ctx, rcNoObj, rcUnknown );
+}
+
+/* Whack
+ */
+void KSysURingWhack ( KSysURing *self )
+{
+    if ( self != NULL )
+    {
+        if ( self -> sqes != NULL )
+            munmap ( self -> sqes, self -> sqes_size );
+        if ( self -> cq_ring != NULL && self -> cq_ring != self -> sq_ring )
+            munmap ( self -> cq_ring, self -> cq_ring_size );
+        if ( self -> sq_ring != NULL )
+            munmap ( self -> sq_ring, self -> sq_ring_size );
+        close ( self -> fd );
+        free ( self );
+    }
+}
+
+/* Make
+ */
+rc_t KSysURingMake ( KSysURing **ringp, uint32_t depth )
+{
+    int fd;
+    KSysURing *ring;
+    struct io_uring_params p;
+
+    assert ( ringp != NULL );
+    * ringp = NULL;
+
+    if ( depth == 0 )
+        return RC ( rcFS, rcQueue, rcConstructing, rcParam, rcInvalid );
+
+    memset ( & p, 0, sizeof p );
+    fd = uring_setup ( depth, & p );
+    if ( fd < 0 )
+        return uring_error ( errno, rcConstructing );
+
+    /* plain IORING_OP_READ arrived with 5.6, use FAST_POLL (5.7) to recognize it */
+    if ( ( p . features & IORING_FEAT_FAST_POLL ) == 0 )
+    {
+        close ( fd );
+        return RC ( rcFS, rcQueue, rcConstructing, rcInterface, rcUnsupported );
+    }
+
+    ring = calloc ( 1, sizeof * ring );
+    if ( ring == NULL )
+    {
+        close ( fd );
+        return RC ( rcFS, rcQueue, rcConstructing, rcMemory, rcExhausted );
+    }
+
+    ring -> fd = fd;
+    ring -> entries = p . sq_entries;
+    ring -> sq_ring_size = p . sq_off . array + p . sq_entries * sizeof ( unsigned );
+    ring -> cq_ring_size = p . cq_off . cqes + p . cq_entries * sizeof ( struct io_uring_cqe );
+    ring -> sqes_size = p . sq_entries * sizeof ( struct io_uring_sqe );
+
+    /* both rings usually share one mapping */
+    if ( ( p . features & IORING_FEAT_SINGLE_MMAP ) != 0 )
+    {
+        if ( ring -> cq_ring_size > ring -> sq_ring_size )
+            ring -> sq_ring_size = ring -> cq_ring_size;
+        ring -> cq_ring_size = ring -> sq_ring_size;
+    }
+
+    ring -> sq_ring = mmap ( NULL, ring -> sq_ring_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING );
+    if ( ring -> sq_ring == MAP_FAILED )
+        ring -> sq_ring = NULL;
+    else if ( ( p . features & IORING_FEAT_SINGLE_MMAP ) != 0 )
+        ring -> cq_ring = ring -> sq_ring;
+    else
+    {
+        ring -> cq_ring = mmap ( NULL, ring -> cq_ring_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING );
+        if ( ring -> cq_ring == MAP_FAILED )
+            ring -> cq_ring = NULL;
+    }
+
+    if ( ring -> cq_ring != NULL )
+    {
+        ring -> sqes = mmap ( NULL, ring -> sqes_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES );
+        if ( ring -> sqes == MAP_FAILED )
+            ring -> sqes = NULL;
+    }
+
+    if ( ring -> sqes == NULL )
+    {
+        rc_t rc = uring_error ( errno, rcConstructing );
+        KSysURingWhack ( ring );
+        return rc;
+    }
+
+    ring -> sq_head = ( unsigned* ) ( ( char* ) ring -> sq_ring + p . sq_off . head );
+    ring -> sq_tail = ( unsigned* ) ( ( char* ) ring -> sq_ring + p . sq_off . tail );
+    ring -> sq_mask = ( unsigned* ) ( ( char* ) ring -> sq_ring + p . sq_off . ring_mask );
+    ring -> sq_array = ( unsigned* ) ( ( char* ) ring -> sq_ring + p . sq_off . array );
+
+    ring -> cq_head = ( unsigned* ) ( ( char* ) ring -> cq_ring + p . cq_off . head );
+    ring -> cq_tail = ( unsigned* ) ( ( char* ) ring -> cq_ring + p . cq_off . tail );
+    ring -> cq_mask = ( unsigned* ) ( ( char* ) ring -> cq_ring + p . cq_off . ring_mask );
+    ring -> cqes = ( struct io_uring_cqe* ) ( ( char* ) ring -> cq_ring + p . cq_off . cqes );
+
+    * ringp = ring;
+    return 0;
+}
+
+/* RegisterBuffers
+ */
+rc_t KSysURingRegisterBuffers ( KSysURing *self,
+    void * const *buffers, const size_t *sizes, uint32_t count )
+{
+    uint32_t i;
+    struct iovec *iov;
+
+    assert ( self != NULL );
+
+    if ( self -> bufs != 0 )
+    {
+        uring_register ( self -> fd, IORING_UNREGISTER_BUFFERS, NULL, 0 );
+        self -> bufs = 0;
+    }
+
+    if ( count == 0 )
+        return 0;
+
+    iov = malloc ( count * sizeof * iov );
+    if ( iov == NULL )
+        return RC ( rcFS, rcQueue, rcRegistering, rcMemory, rcExhausted );
+
+    for ( i = 0; i < count; ++ i )
+    {
+        iov [ i ] . iov_base = buffers [ i ];
+        iov [ i ] . iov_len = sizes [ i ];
+    }
+
+    /* pinning counts against RLIMIT_MEMLOCK on older kernels */
+    if ( uring_register ( self -> fd, IORING_REGISTER_BUFFERS, iov, count ) < 0 )
+    {
+        rc_t rc = uring_error ( errno, rcRegistering );
+        free ( iov );
+        return rc;
+    }
+
+    free ( iov );
+    self -> bufs = count;
+    return 0;
+}
+
+/* Prepare
+ */
+rc_t KSysURingPrepare ( KSysURing *self, const KSysFile_v1 *f,
+    uint64_t pos, void *buffer, size_t bsize, int32_t buf_idx, uint64_t tag )
+{
+    unsigned tail, idx;
+    struct io_uring_sqe *sqe;
+
+    assert ( self != NULL );
+    assert ( f != NULL );
+
+    /* only this thread advances the tail, the kernel advances the head */
+    tail = * self -> sq_tail;
+    if ( tail - __atomic_load_n ( self -> sq_head, __ATOMIC_ACQUIRE ) >= self -> entries )
+        return RC ( rcFS, rcQueue, rcInserting, rcQueue, rcExhausted );
+
+    idx = tail & * self -> sq_mask;
+    sqe = & self -> sqes [ idx ];
+    memset ( sqe, 0, sizeof * sqe );
+
+    if ( buf_idx >= 0 && ( uint32_t ) buf_idx < self -> bufs )
+    {
+        sqe -> opcode = IORING_OP_READ_FIXED;
+        sqe -> buf_index = ( uint16_t ) buf_idx;
+    }
+    else
+    {
+        sqe -> opcode = IORING_OP_READ;
+    }
+    sqe -> fd = f -> fd;
+    sqe -> off = pos;
+    sqe -> addr = ( uint64_t ) ( size_t ) buffer;
+    sqe -> len = bsize > URING_MAX_READ ? URING_MAX_READ : ( uint32_t ) bsize;
+    sqe -> user_data = tag;
+
+    self -> sq_array [ idx ] = idx;
+    __atomic_store_n ( self -> sq_tail, tail + 1, __ATOMIC_RELEASE );
+    ++ self -> staged;
+
+    return 0;
+}
+
+static
+rc_t KSysURingEnter ( KSysURing *self, uint32_t min_complete )
+{
+    uint32_t to_submit = self -> staged;
+
+    while ( to_submit != 0 || min_complete != 0 )
+    {
+        int submitted = uring_enter ( self -> fd, to_submit, min_complete,
+            min_complete != 0 ? IORING_ENTER_GETEVENTS : 0 );
+        if ( submitted >= 0 )
+        {
+            self -> staged -= ( uint32_t ) submitted;
+            break;
+        }
+
+        if ( errno == EINTR )
+            continue;
+        if ( errno != EAGAIN && errno != EBUSY )
+            return uring_error ( errno, rcWriting );
+
+        /* the kernel is short on resources until completions are reaped */
+        if ( min_complete == 0 )
+            break;
+        to_submit = 0;
+    }
+
+    return 0;
+}
+
+/* Submit
+ */
+rc_t KSysURingSubmit ( KSysURing *self )
+{
+    assert ( self != NULL );
+    return KSysURingEnter ( self, 0 );
+}
+
+/* Reap
+ */
+rc_t KSysURingReap ( KSysURing *self, uint64_t *tag, int32_t *res, bool wait )
+{
+    assert ( self != NULL );
+
+    while ( 1 )
+    {
+        rc_t rc;
+        unsigned head = * self -> cq_head;
+        if ( head != __atomic_load_n ( self -> cq_tail, __ATOMIC_ACQUIRE ) )
+        {
+            const struct io_uring_cqe *cqe = & self -> cqes [ head & * self -> cq_mask ];
+            * tag = cqe -> user_data;
+            * res = cqe -> res;
+            __atomic_store_n ( self -> cq_head, head + 1, __ATOMIC_RELEASE );
+            return 0;
+        }
+
+        if ( ! wait && self -> staged == 0 )
+            return RC ( rcFS, rcQueue, rcReading, rcData, rcIncomplete );
+
+        rc = KSysURingEnter ( self, wait ? 1 : 0 );
+        if ( rc != 0 )
+            return rc;
+
+        if ( ! wait && head == __atomic_load_n ( self -> cq_tail, __ATOMIC_ACQUIRE ) )
+            return RC ( rcFS, rcQueue, rcReading, rcData, rcIncomplete );
+    }
+}
+
+#else /* HAVE_IO_URING */
+
+/* built against headers without io_uring */
+rc_t KSysURingMake ( KSysURing **ring, uint32_t depth )
+{
+    * ring = NULL;
+    return RC ( rcFS, rcQueue, rcConstructing, rcInterface, rcUnsupported );
+}
+
+void KSysURingWhack ( KSysURing *self )
+{
+}
+
+rc_t KSysURingRegisterBuffers ( KSysURing *self,
+    void * const *buffers, const size_t *sizes, uint32_t count )
+{
+    return RC ( rcFS, rcQueue, rcRegistering, rcInterface, rcUnsupported );
+}
+
+rc_t KSysURingPrepare ( KSysURing *self, const KSysFile_v1 *f,
+    uint64_t pos, void *buffer, size_t bsize, int32_t buf_idx, uint64_t tag )
+{
+    return RC ( rcFS, rcQueue, rcInserting, rcInterface, rcUnsupported );
+}
+
+rc_t KSysURingSubmit ( KSysURing *self )
+{
+    return RC ( rcFS, rcQueue, rcWriting, rcInterface, rcUnsupported );
+}
+
+rc_t KSysURingReap ( KSysURing *self, uint64_t *tag, int32_t *res, bool wait )
+{
+    return RC ( rcFS, rcQueue, rcReading, rcInterface, rcUnsupported );
+}
+
+#endif /* HAVE_IO_URING */
@@ -104,6 +104,14 @@ rc_t KMMapROSys ( KMMap *self, uint64_t pos, size_t size );
 rc_t KMMapUnmap ( KMMap *self );
 
 
+/* AdviseSys
+ *  pass usage advice for "size" bytes at "addr" to the system
+ *
+ *  "addr" lies within the mapping but need not be page aligned
+ */
+rc_t KMMapAdviseSys ( const KMMap *self, const char *addr, size_t size, KMMapAdvice advice );
+
+
 #ifdef __cplusplus
 }
 #endif
@@ -237,6 +237,37 @@ LIB_EXPORT rc_t CC KMMapAddrUpdate ( KMMap *self, void **addr )
 }
 
 
+/* Advise
+ *  tell the system how a part of the region is going to be used
+ */
+LIB_EXPORT rc_t CC KMMapAdvise ( const KMMap *self,
+    uint64_t pos, size_t size, KMMapAdvice advice )
+{
+    uint64_t end;
+
+    if ( self == NULL )
+        return RC ( rcFS, rcMemMap, rcAccessing, rcSelf, rcNull );
+
+    if ( advice > kmmaDontNeed )
+        return RC ( rcFS, rcMemMap, rcAccessing, rcParam, rcInvalid );
+
+    /* a region read into allocated memory has nothing to advise */
+    if ( ! self -> sys_mmap )
+        return RC ( rcFS, rcMemMap, rcAccessing, rcMemMap, rcUnsupported );
+
+    /* crop to region */
+    end = pos + size;
+    if ( pos < self -> pos )
+        pos = self -> pos;
+    if ( end > self -> pos + self -> size )
+        end = self -> pos + self -> size;
+    if ( pos >= end )
+        return 0;
+
+    return KMMapAdviseSys ( self, self -> addr + ( size_t ) ( pos - self -> pos ),
+        ( size_t ) ( end - pos ), advice );
+}
+
 /* MallocRgn
  */
 #if USE_MALLOC_MMAP
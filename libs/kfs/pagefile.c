@@ -1330,6 +1330,57 @@ LIB_EXPORT rc_t CC KPageFileGet ( KPageFile *self, KPage **ppage, uint32_t page_
 }
 
 
+/* Has
+ *  answers whether a page is currently cached
+ */
+LIB_EXPORT bool CC KPageFileHas ( const KPageFile *self, uint32_t page_id )
+{
+    if ( self == NULL || page_id == 0 )
+        return false;
+    return KPageFileIndexFind ( ( KPageFile* ) self, page_id ) != NULL;
+}
+
+
+/* Insert
+ *  caches a page read from the backing file by other means
+ */
+LIB_EXPORT rc_t CC KPageFileInsert ( KPageFile *self, uint32_t page_id,
+    const void *data, size_t bytes )
+{
+    rc_t rc;
+    KPage *page;
+
+    if ( self == NULL )
+        return RC ( rcFS, rcFile, rcInserting, rcSelf, rcNull );
+    if ( page_id == 0 )
+        return RC ( rcFS, rcFile, rcInserting, rcId, rcNull );
+    if ( data == NULL )
+        return RC ( rcFS, rcFile, rcInserting, rcParam, rcNull );
+    if ( bytes == 0 || bytes > PGSIZE )
+        return RC ( rcFS, rcFile, rcInserting, rcParam, rcInvalid );
+
+    if ( KPageFileIndexFind ( self, page_id ) != NULL )
+        return 0;
+
+    /* new pages are zeroed */
+    rc = KPageNew ( & page, self -> backing, page_id );
+    if ( rc == 0 )
+    {
+        uint64_t eof = ( ( uint64_t ) ( page_id - 1 ) << PGBITS ) + bytes;
+        memmove ( page -> page, data, bytes );
+
+        /* keep track of eof as reading the page would */
+        if ( self -> backing != NULL && self -> backing -> eof < eof )
+            self -> backing -> eof = eof;
+
+        rc = KPageFileCachePage ( self, page );
+        KPageRelease ( page );
+    }
+
+    return rc;
+}
+
+
 /* PosGet
  *  returns a page corresponding to position
  *
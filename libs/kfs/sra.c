@@ -45,6 +45,9 @@
 struct KToc;
 struct KDirectory;
 
+/* inflate directories of the TOC when first used rather than at open */
+#define TOC_INFLATE_ON_DEMAND 1
+
 
 
 static
@@ -302,11 +305,18 @@ rc_t CC KArcParseSRAInt ( struct KToc * self,
         {
             uint64_t offset;
             offset = SraHeaderGetFileOffset (&header);
+#if TOC_INFLATE_ON_DEMAND
+            /* the buffer stays with the TOC */
+            rc = KTocSetPersisted ( self, arcsize, pbstreeBuffer,
+                                    (uint32_t)(offset - sizeof (header)),
+                                    offset, reverse );
+#else
             rc = KTocInflatePBSTree ( self, arcsize, pbstreeBuffer, 
                                      (uint32_t)(offset - sizeof (header)),
                                      offset,
                                      reverse, "" );
             free ( pbstreeBuffer );
+#endif
             if ( rc != 0 && !silent )
             {
                 LOGERR (klogErr, rc, "File TOC not valid for .sra");
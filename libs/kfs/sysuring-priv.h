@@ -0,0 +1,93 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_sysuring_priv_
+#define _h_sysuring_priv_
+
+#ifndef _h_klib_defs_
+#include <klib/defs.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*--------------------------------------------------------------------------
+ * forwards
+ */
+struct KSysFile_v1;
+
+
+/*--------------------------------------------------------------------------
+ * KSysURing
+ *  an OS submission/completion ring for file reads
+ *  only Linux has one, elsewhere Make reports rcUnsupported
+ */
+typedef struct KSysURing KSysURing;
+
+/* Make
+ *  "depth" [ IN ] - the number of reads that may be in flight
+ */
+rc_t KSysURingMake ( KSysURing **ring, uint32_t depth );
+
+/* Whack
+ */
+void KSysURingWhack ( KSysURing *self );
+
+/* RegisterBuffers
+ *  replaces any registered buffers, "count" of 0 only unregisters
+ */
+rc_t KSysURingRegisterBuffers ( KSysURing *self,
+    void * const *buffers, const size_t *sizes, uint32_t count );
+
+/* Prepare
+ *  stage a read of "f" at "pos" into "buffer"
+ *  "buf_idx" names a registered buffer or is negative
+ *  "tag" is returned by Reap
+ *
+ *  returns rcExhausted when the ring is full
+ */
+rc_t KSysURingPrepare ( KSysURing *self, const struct KSysFile_v1 *f,
+    uint64_t pos, void *buffer, size_t bsize, int32_t buf_idx, uint64_t tag );
+
+/* Submit
+ *  hand staged reads to the kernel
+ */
+rc_t KSysURingSubmit ( KSysURing *self );
+
+/* Reap
+ *  retrieve one completion, submitting anything staged
+ *  "res" receives the byte count or a negative errno
+ *
+ *  returns rcIncomplete when "wait" is false and nothing has completed
+ */
+rc_t KSysURingReap ( KSysURing *self, uint64_t *tag, int32_t *res, bool wait );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _h_sysuring_priv_ */
@@ -45,6 +45,8 @@
 
 
 
+struct KTocPersisted;
+
 /*--------------------------------------------------------------------------
  * KTocEntry
  */
@@ -114,6 +116,14 @@ struct KTocEntry
 	     * Tree of directories, files and links below this directory
 	     */
             BSTree      tree;
+	    /* -----
+	     * For an archive opened from its persisted TOC, the persisted
+	     * entries of this directory until they are inflated into "tree"
+	     * on first use (NULL afterwards).  See KTocEntryInflatePending.
+	     */
+	    struct KTocPersisted * persisted;
+	    const void * pending;
+	    uint32_t    pending_size;
 	} dir;
 	struct KTocEntryFile
 	{
@@ -302,6 +312,34 @@ rc_t KTocEntryPersistNodeDir (void *param, const KTocEntry * n,
 			      size_t * num_writ, 
 			      PTWriteFunc write, void * write_param);
 
+/* ----------------------------------------------------------------------
+ * KTocPersisted
+ *
+ * The persisted TOC of an archive opened without inflating it in full.
+ * Directories keep pointing into "buffer" until first resolved or listed.
+ */
+typedef struct KTocPersisted KTocPersisted;
+struct KTocPersisted
+{
+    /* serializes inflation, since lookups work on a const KToc */
+    struct KLock *	lock;
+    /* hard links are resolved from the root of the TOC */
+    const struct KToc *	toc;
+    void *		buffer;
+    uint64_t		arcsize;
+    uint64_t		offset;
+    bool		rev;
+};
+
+/* InflatePending
+ *  inflate the persisted entries of a directory before its tree is used
+ *  subdirectories stay pending; a no-op for anything else
+ *
+ *  InflatePendingLocked expects the lock of the persisted TOC to be held
+ */
+rc_t KTocEntryInflatePending (const KTocEntry * self);
+rc_t KTocEntryInflatePendingLocked (const KTocEntry * self);
+
 /* ======================================================================
  * KToc struct
  */
@@ -361,6 +399,11 @@ struct KToc
     BSTree		offset_index;
     KSraHeader *	header;
 
+    /* -----
+     * Set for archives whose directories are inflated on first use
+     */
+    KTocPersisted *	persisted;
+
 
     /* -----
      * This is the full path of the archive file as used to open it as a KFile.
@@ -640,6 +683,17 @@ rc_t KTocResolvePathTocEntry( const KToc *self,
                          KTocEntryType * ptype,
                          const char ** unusedpath);
 
+/* ResolvePathTocEntryLocked
+ *  the same, for use while a directory is inflated on demand
+ *  with the lock of the persisted TOC already held
+ */
+rc_t KTocResolvePathTocEntryLocked( const KToc *self,
+                         const KTocEntry ** pnode,
+                         const char *path,
+                         size_t path_len,
+                         KTocEntryType * ptype,
+                         const char ** unusedpath);
+
 /*--------------------------------------------------------------------------
  * Constructors/factories
  */
@@ -816,6 +870,13 @@ KFS_EXTERN rc_t CC KTocEntryPersist( void *param, const void * node,
                                      size_t * num_writ, 
                                      PTWriteFunc write, void * write_param );
 
+/* SetPersisted
+ *  attach the persisted tree of an archive, inflating only the root
+ *  the tree "buffer" is owned by the TOC from here on, even on failure
+ */
+rc_t KTocSetPersisted ( KToc * self, uint64_t arcsize, void * buffer,
+			uint32_t maxsize, uint64_t offset, bool rev );
+
 rc_t KTocInflatePBSTree (KToc * self, uint64_t arcsize, const void * treestart,
                          uint32_t maxsize, uint64_t offset,
                          bool rev, const char * path);
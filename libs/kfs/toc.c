@@ -37,6 +37,7 @@
 #include <klib/log.h>
 #include <klib/debug.h>
 #include <klib/rc.h>
+#include <kproc/lock.h>
 #include <sysalloc.h>
 
 #include "toc-priv.h"
@@ -504,8 +505,12 @@ rc_t KTocInit ( KToc ** self,
 	StringInit ( &pentry->name, pchar, size, (uint32_t)size );
 	pentry->type = ktocentrytype_dir;
 	BSTreeInit(&pentry->u.dir.tree);
+	pentry->u.dir.persisted = NULL;
+	pentry->u.dir.pending = NULL;
+	pentry->u.dir.pending_size = 0;
         BSTreeInit(&(*self)->offset_index);
         (*self)->header = NULL;
+        (*self)->persisted = NULL;
     }
     return rc;
 }
@@ -556,6 +561,12 @@ rc_t KTocRelease ( const KToc *self )
         }
 	BSTreeWhack (&mutable_self->entry.u.dir.tree, KTocEntryWhack, &rc);
 	BSTreeWhack (&mutable_self->offset_index, KTocEntryIndexWhack, &rc);
+	if (mutable_self->persisted != NULL)
+	{
+	    KLockRelease (mutable_self->persisted->lock);
+	    free (mutable_self->persisted->buffer);
+	    free (mutable_self->persisted);
+	}
 	free (mutable_self);
     }
 /*     else */
@@ -1390,12 +1401,14 @@ rc_t KTocAlignmentSet( KToc * self,KSRAFileAlignment align )
  ***** CURRENTLY DOES NOT SUPPORT any form of crossing of
  ***** KDirectory type paths
  *****/
-rc_t KTocResolvePathTocEntry ( const KToc *self,
-                               const KTocEntry ** pentry,
-                               const char *path,	/* must be entirely in the TOC */
-                               size_t path_len,
-                               KTocEntryType * ptype,
-                               const char ** unusedpath )
+static
+rc_t KTocResolvePathTocEntryInt ( const KToc *self,
+                                  const KTocEntry ** pentry,
+                                  const char *path,	/* must be entirely in the TOC */
+                                  size_t path_len,
+                                  KTocEntryType * ptype,
+                                  const char ** unusedpath,
+                                  bool locked )
 {
     const char *  	slash;		/* points to the / following the current facet */
     const char *  	next_facet;	/* points to the start of the current facet */
@@ -1470,6 +1483,18 @@ rc_t KTocResolvePathTocEntry ( const KToc *self,
 	}
 	facet_size = slash - next_facet;	/* how many characters in this facet */
 
+	/* -----
+	 * make sure the directory is no longer only persisted
+	 */
+	rc = locked ? KTocEntryInflatePendingLocked (dentry) : KTocEntryInflatePending (dentry);
+	if (rc != 0)
+	{
+	    *pentry = NULL;
+	    *unusedpath = next_facet;
+	    *ptype = ktocentrytype_unknown;
+	    return rc;
+	}
+
 	/* -----
 	 * build a temporary entry for comparisons
 	 */
@@ -1600,6 +1625,26 @@ rc_t KTocResolvePathTocEntry ( const KToc *self,
     return RC (rcFS, rcToc, rcResolving, rcParam, rcUnexpected);
 }
 
+rc_t KTocResolvePathTocEntry ( const KToc *self,
+                               const KTocEntry ** pentry,
+                               const char *path,	/* must be entirely in the TOC */
+                               size_t path_len,
+                               KTocEntryType * ptype,
+                               const char ** unusedpath )
+{
+    return KTocResolvePathTocEntryInt (self, pentry, path, path_len, ptype, unusedpath, false);
+}
+
+rc_t KTocResolvePathTocEntryLocked ( const KToc *self,
+                                     const KTocEntry ** pentry,
+                                     const char *path,
+                                     size_t path_len,
+                                     KTocEntryType * ptype,
+                                     const char ** unusedpath )
+{
+    return KTocResolvePathTocEntryInt (self, pentry, path, path_len, ptype, unusedpath, true);
+}
+
 /* SRA tocfile only not tar or other archives only */
 rc_t KTocResolvePathFromOffset ( const KToc *self,
                                  const char ** path,
@@ -1635,6 +1680,56 @@ rc_t KTocResolvePathFromOffset ( const KToc *self,
     return rc;
 }
 
+/* ----------------------------------------------------------------------
+ * KTocSetPersisted
+ *
+ * [RET] rc_t					0 for success; anything else for a failure
+ *						see itf/klib/rc.h for general details
+ * [IN]  KToc *		self		TOC self reference: object oriented in C
+ * [IN]  void *			buffer		the persisted tree, owned by the TOC from now on
+ *
+ * Instead of inflating the whole persisted tree, only the root directory
+ * is inflated, validating the tree; all other directories are inflated
+ * when first resolved or listed.
+ */
+rc_t KTocSetPersisted ( KToc * self, uint64_t arcsize, void * buffer,
+			uint32_t maxsize, uint64_t offset, bool rev )
+{
+    rc_t rc;
+    KTocPersisted * persisted;
+
+    assert (self != NULL);
+    assert (self->persisted == NULL);
+
+    persisted = malloc (sizeof * persisted);
+    if (persisted == NULL)
+    {
+	free (buffer);
+	return RC (rcFS, rcToc, rcInflating, rcMemory, rcExhausted);
+    }
+
+    rc = KLockMake (&persisted->lock);
+    if (rc != 0)
+    {
+	free (persisted);
+	free (buffer);
+	return rc;
+    }
+
+    persisted->toc = self;
+    persisted->buffer = buffer;
+    persisted->arcsize = arcsize;
+    persisted->offset = offset;
+    persisted->rev = rev;
+    self->persisted = persisted;
+
+    self->entry.u.dir.persisted = persisted;
+    self->entry.u.dir.pending = buffer;
+    self->entry.u.dir.pending_size = maxsize;
+
+    return KTocEntryInflatePending (&self->entry);
+}
+
 const void * KTocGetArchive( const KToc * self )
 {
     if (self == NULL)
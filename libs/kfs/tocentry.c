@@ -37,6 +37,7 @@
 #include <klib/debug.h>
 #include <klib/rc.h>
 #include <klib/sort.h>
+#include <kproc/lock.h>
 #include <sysalloc.h>
 
 #include "toc-priv.h"
@@ -513,6 +514,9 @@ rc_t KTocEntryNewDirectory ( KTocEntry ** new_entry,
     }
     (*new_entry)->type = ktocentrytype_dir;
     BSTreeInit(&(*new_entry)->u.dir.tree);	/* start with an empty tree */
+    (*new_entry)->u.dir.persisted = NULL;
+    (*new_entry)->u.dir.pending = NULL;
+    (*new_entry)->u.dir.pending_size = 0;
     return 0;
 }
 
@@ -845,6 +849,7 @@ rc_t KTocEntryGetFileOffset ( const KTocEntry * self, uint64_t * offset )
 rc_t KTocEntryGetBSTree ( const KTocEntry * self,const BSTree ** ptree )
 {
     KTocEntryType	type;
+    rc_t		rc;
 
     if (self == NULL)
     {
@@ -858,6 +863,9 @@ rc_t KTocEntryGetBSTree ( const KTocEntry * self,const BSTree ** ptree )
     {
 	return RC  (rcFS, rcToc, rcAccessing, rcParam, rcInvalid);
     }
+    rc = KTocEntryInflatePending (self);
+    if (rc != 0)
+	return rc;
     *ptree = &self->u.dir.tree;
     return 0;
 }
@@ -1080,6 +1088,10 @@ rc_t KTocEntryPersistNodeDir ( void *param, const KTocEntry * n,
 
 /*     start = *num_writ; */
 
+    rc = KTocEntryInflatePending (n);
+    if (rc != 0)
+	return rc;
+
     rc = BSTreePersist (&n->u.dir.tree,
 			num_writ,
 			write,
@@ -1618,7 +1630,7 @@ rc_t KTocEntryInflateNodeHardLink (KToc * toc, const KTocEntryInflateCommon * co
     if (link == NULL)
 	return RC (rcFS, rcTocEntry, rcParsing, rcMemory, rcExhausted);
 
-    memcpy (link, ptr, llen);
+    memcpy (link, *ptr, llen);
     link[llen] = '\0';
 
     rc = KTocCreateHardLink (toc, 
@@ -1744,5 +1756,341 @@ rc_t KTocInflatePBSTree ( KToc * self, uint64_t arcsize, const void * treestart,
 }
 
 
+/* ----------------------------------------------------------------------
+ * KTocEntryNewFromHardLink
+ *
+ * Build the entry for a persisted hard link the way KTocCreateHardLink
+ * does for the full inflation: links to directories stay hard links,
+ * anything else becomes a copy of its target.  The target is resolved
+ * from the root with the lock held, inflating directories on the way.
+ * A target of no known type leaves *entry NULL, like the full inflation.
+ */
+static
+rc_t KTocEntryNewFromHardLink (KTocEntry ** entry, const KTocPersisted * persisted,
+			       const KTocEntryInflateCommon * common, size_t name_size,
+			       const void * ptr, const void * limit)
+{
+    const KTocEntry * targ;
+    KTocEntryType type;
+    const char * unused;
+    uint16_t llen;
+    char * link;
+    rc_t rc;
+
+    *entry = NULL;
+
+    rc = read_u16 (&ptr, limit, persisted->rev, &llen);
+    if (rc)
+	return rc;
+
+    if (check_limit (ptr, limit, llen))
+	return RC (rcFS, rcTocEntry, rcParsing, rcBuffer, rcTooShort);
+
+    link = malloc (llen + 1);
+    if (link == NULL)
+	return RC (rcFS, rcTocEntry, rcParsing, rcMemory, rcExhausted);
+
+    memcpy (link, ptr, llen);
+    link[llen] = '\0';
+
+    rc = KTocResolvePathTocEntryLocked (persisted->toc, &targ, link, llen, &type, &unused);
+    free (link);
+    if (rc)
+	return rc;
+
+    switch (type)
+    {
+    case ktocentrytype_dir:
+	return KTocEntryNewHard (entry, common->name, name_size,
+				 common->mtime, common->access, targ);
+    case ktocentrytype_hardlink:
+	return KTocEntryNewHard (entry, common->name, name_size,
+				 common->mtime, common->access, targ->u.hard_link.ref);
+    case ktocentrytype_file:
+	return KTocEntryNewFile (entry, common->name, name_size,
+				 common->mtime, common->access,
+				 targ->u.contiguous_file.archive_offset,
+				 targ->u.contiguous_file.file_size);
+    case ktocentrytype_zombiefile:
+	return KTocEntryNewZombieFile (entry, common->name, name_size,
+				       common->mtime, common->access,
+				       targ->u.zombie_file.archive_offset,
+				       targ->u.zombie_file.file_size);
+    case ktocentrytype_emptyfile:
+	return KTocEntryNewFile (entry, common->name, name_size,
+				 common->mtime, common->access, 0, 0);
+    case ktocentrytype_chunked:
+	return KTocEntryNewChunked (entry, common->name, name_size,
+				    common->mtime, common->access,
+				    targ->u.chunked_file.file_size,
+				    targ->u.chunked_file.chunks,
+				    targ->u.chunked_file.num_chunks);
+    case ktocentrytype_softlink:
+	return KTocEntryNewSoft (entry, common->name, name_size,
+				 common->mtime, common->access,
+				 targ->u.symbolic_link.link_path.addr,
+				 targ->u.symbolic_link.link_path.size);
+    default:
+	return 0;
+    }
+}
+
+/* ----------------------------------------------------------------------
+ * KTocEntryInflateChild
+ *
+ * PBSTreeForEach callback building the entry for one persisted node
+ * directly into the tree of the directory being inflated: no paths are
+ * assembled and nothing is looked up from the root.  Subdirectories only
+ * remember where their own persisted tree is.
+ *
+ * Hard links are left to a second pass, once the directory holds all
+ * of its other entries, since their targets may lie within it.
+ */
+typedef
+struct KTocEntryInflateChildData
+{
+    KTocEntry * dir;
+    rc_t rc;
+    bool link_pass;
+    bool has_links;
+} KTocEntryInflateChildData;
+
+static
+void CC KTocEntryInflateChild (PBSTNode * n, void * _data)
+{
+    KTocEntryInflateChildData * data;
+    const KTocPersisted * persisted;
+    const void * ptr;
+    const void * limit;
+    KTocEntryInflateCommon common;
+    KTocEntry * entry = NULL;
+    size_t name_size;
+    rc_t rc;
+
+    data = _data;
+    if (data->rc != 0)
+	return;
+    persisted = data->dir->u.dir.persisted;
+    ptr = n->data.addr;
+    limit = (uint8_t*)ptr + n->data.size;
+    rc = KTocEntryInflateNodeCommon (&ptr, limit, &common, "", persisted->rev);
+    if (rc == 0 && (common.type == ktocentrytype_hardlink) != data->link_pass)
+    {
+	if (common.type == ktocentrytype_hardlink)
+	    data->has_links = true;
+	free (common.name);
+	return;
+    }
+    if (rc == 0)
+    {
+	name_size = strlen (common.name);
+	switch (common.type)
+	{
+	default:
+	case ktocentrytype_unknown:
+	case ktocentrytype_notfound:
+	    rc = RC (rcFS, rcTocEntry, rcParsing, rcFile, rcCorrupt);
+	    break;
+	case ktocentrytype_dir:
+	    rc = KTocEntryNewDirectory (&entry, common.name, name_size,
+					common.mtime, common.access);
+	    if (rc == 0)
+	    {
+		entry->u.dir.persisted = data->dir->u.dir.persisted;
+		entry->u.dir.pending = ptr;
+		entry->u.dir.pending_size = (uint32_t)((uint8_t*)limit - (uint8_t*)ptr);
+	    }
+	    break;
+	case ktocentrytype_file:
+	{
+	    uint64_t foffset;
+	    uint64_t size;
+
+	    rc = read_u64 (&ptr, limit, persisted->rev, &foffset);
+	    if (rc == 0)
+		rc = read_u64 (&ptr, limit, persisted->rev, &size);
+	    if (rc == 0)
+	    {
+		if (persisted->arcsize >= persisted->offset + foffset + size)
+		    rc = KTocEntryNewFile (&entry, common.name, name_size,
+					   common.mtime, common.access,
+					   persisted->offset + foffset, size);
+		else
+		    rc = KTocEntryNewZombieFile (&entry, common.name, name_size,
+						 common.mtime, common.access,
+						 persisted->offset + foffset, size);
+	    }
+	    break;
+	}
+	case ktocentrytype_emptyfile:
+	    rc = KTocEntryNewFile (&entry, common.name, name_size,
+				   common.mtime, common.access, 0, 0);
+	    break;
+	case ktocentrytype_chunked:
+	{
+	    uint64_t size;
+	    uint32_t count;
+	    KTocChunk * chunks;
+
+	    rc = read_u64 (&ptr, limit, persisted->rev, &size);
+	    if (rc == 0)
+		rc = read_u32 (&ptr, limit, persisted->rev, &count);
+	    if (rc == 0)
+	    {
+		chunks = malloc (sizeof (KTocChunk) * count);
+		if (chunks == NULL)
+		    rc = RC (rcFS, rcTocEntry, rcParsing, rcMemory, rcExhausted);
+		else
+		{
+		    uint32_t ix;
+		    for (ix = 0; (rc == 0) && (ix < count); ++ix)
+		    {
+			rc = read_u64 (&ptr, limit, persisted->rev, &chunks[ix].logical_position);
+			if (rc == 0)
+			{
+			    rc = read_u64 (&ptr, limit, persisted->rev, &chunks[ix].source_position);
+			    chunks[ix].source_position += persisted->offset;
+			}
+			if (rc == 0)
+			    rc = read_u64 (&ptr, limit, persisted->rev, &chunks[ix].size);
+		    }
+		    if (rc == 0)
+			rc = KTocEntryNewChunked (&entry, common.name, name_size,
+						  common.mtime, common.access,
+						  size, chunks, count);
+		    free (chunks);
+		}
+	    }
+	    break;
+	}
+	case ktocentrytype_softlink:
+	{
+	    uint16_t llen;
+
+	    rc = read_u16 (&ptr, limit, persisted->rev, &llen);
+	    if (rc == 0)
+	    {
+		if (check_limit (ptr, limit, llen))
+		    rc = RC (rcFS, rcTocEntry, rcParsing, rcBuffer, rcTooShort);
+		else
+		    rc = KTocEntryNewSoft (&entry, common.name, name_size,
+					   common.mtime, common.access,
+					   ptr, llen);
+	    }
+	    break;
+	}
+	case ktocentrytype_hardlink:
+	    rc = KTocEntryNewFromHardLink (&entry, persisted, &common, name_size, ptr, limit);
+	    break;
+	}
+	free (common.name);
+
+	if (rc == 0 && entry != NULL)
+	{
+	    rc = BSTreeInsert (&data->dir->u.dir.tree, &entry->node, KTocEntryCmp2);
+	    if (rc != 0)
+		KTocEntryDelete (entry);
+	}
+    }
+    data->rc = rc; /* return */
+}
+
+/* ----------------------------------------------------------------------
+ * KTocEntryInflatePendingLocked
+ *
+ * [RET] rc_t					0 for success; anything else for a failure
+ *						see itf/klib/rc.h for general details
+ * [IN]  const KTocEntry *	self		directory about to have its tree used
+ *
+ * Inflates the persisted entries of a directory of an archive opened
+ * without inflating its whole TOC, with the lock of the persisted TOC
+ * held.  A directory that fails to inflate is left empty and pending,
+ * unless only one of its hard links failed to resolve.
+ */
+rc_t KTocEntryInflatePendingLocked (const KTocEntry * cself)
+{
+    KTocEntry * self = (KTocEntry*)cself; /* strip const: inflating is not a visible change */
+    PBSTree * pbst;
+    rc_t rc;
+
+    assert (self != NULL);
+
+    if (self->type != ktocentrytype_dir || self->u.dir.pending == NULL)
+	return 0;
+
+    rc = PBSTreeMake (&pbst, self->u.dir.pending, self->u.dir.pending_size,
+		      self->u.dir.persisted->rev);
+    if (rc == 0)
+    {
+	KTocEntryInflateChildData data;
+
+	data.dir = self;
+	data.rc = 0;
+	data.link_pass = false;
+	data.has_links = false;
+
+	PBSTreeForEach (pbst, false, KTocEntryInflateChild, &data);
+
+	if (data.rc != 0)
+	{
+	    BSTreeWhack (&self->u.dir.tree, KTocEntryWhack, NULL);
+	    BSTreeInit (&self->u.dir.tree);
+	}
+	else
+	{
+	    /* -----
+	     * no longer pending while the hard links are resolved, so that
+	     * a target within this directory is not inflated a second time
+	     */
+	    self->u.dir.pending = NULL;
+
+	    /* -----
+	     * other directories inflated meanwhile may refer to the
+	     * entries here, so a link that fails to resolve is only
+	     * reported, and the directory stays as it is
+	     */
+	    if (data.has_links)
+	    {
+		data.link_pass = true;
+		PBSTreeForEach (pbst, false, KTocEntryInflateChild, &data);
+	    }
+	}
+
+	rc = data.rc;
+
+	PBSTreeWhack (pbst);
+    }
+    return rc;
+}
+
+/* ----------------------------------------------------------------------
+ * KTocEntryInflatePending
+ *
+ * The same, taking the lock of the persisted TOC.
+ */
+rc_t KTocEntryInflatePending (const KTocEntry * self)
+{
+    KTocPersisted * persisted;
+    rc_t rc;
+
+    assert (self != NULL);
+
+    if (self->type != ktocentrytype_dir)
+	return 0;
+
+    persisted = self->u.dir.persisted;
+    if (persisted == NULL)
+	return 0;
+
+    rc = KLockAcquire (persisted->lock);
+    if (rc == 0)
+    {
+	rc = KTocEntryInflatePendingLocked (self);
+	KLockUnlock (persisted->lock);
+    }
+    return rc;
+}
+
+
 /* end of file tocentry.c */
 
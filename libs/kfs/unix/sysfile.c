@@ -49,6 +49,7 @@ struct KSysFile_v1;
 #include <errno.h>
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <sys/uio.h>
 #include <assert.h>
 #include <string.h>
 
@@ -346,6 +347,47 @@ rc_t KSysFileSetSize_v1 ( KSysFile_v1 *self, uint64_t size )
     return 0;
 }
 
+/* ReadError
+ *  maps "errno" of a failed read
+ */
+static
+rc_t KSysFileReadError_v1 ( const KSysFile_v1 *self, int lerrno )
+{
+    rc_t rc;
+
+    switch ( lerrno )
+    {
+    case EIO:
+        rc = RC ( rcFS, rcFile, rcReading, rcTransfer, rcUnknown );
+        LOGERR (klogErr, rc, "system I/O error - likely broken pipe");
+        return rc;
+
+    case EBADF:
+        rc = RC ( rcFS, rcFile, rcReading, rcFileDesc, rcInvalid );
+        PLOGERR (klogErr,
+                 (klogErr, rc, "system bad file descriptor error fd='$(E)'",
+                  "E=%d", self->fd));
+        return rc;
+
+    case EISDIR:
+        rc = RC ( rcFS, rcFile, rcReading, rcFileDesc, rcIncorrect );
+        LOGERR (klogErr, rc, "system misuse of a directory error");
+        return rc;
+
+    case EINVAL:
+        rc = RC ( rcFS, rcFile, rcReading, rcParam, rcInvalid );
+        LOGERR (klogErr, rc, "system invalid argument error");
+        return rc;
+
+    default:
+        rc = RC ( rcFS, rcFile, rcReading, rcNoObj, rcUnknown );
+        PLOGERR (klogErr,
+                 (klogErr, rc, "unknown system error '$(S)($(E))'",
+                  "S=%!,E=%d", lerrno, lerrno));
+        return rc;
+    }
+}
+
 /* Read
  *  read file from known position
  *
@@ -386,43 +428,81 @@ rc_t KSysFileRead_v1 ( const KSysFile_v1 *self, uint64_t pos,
 
         count = pread ( self -> fd, buffer, bsize, pos );
 
-        if ( count < 0 ) switch ( lerrno = errno )
+        if ( count < 0 )
         {
-        case EINTR:
-            continue;
-        case EIO:
-            rc = RC ( rcFS, rcFile, rcReading, rcTransfer, rcUnknown );
-            LOGERR (klogErr, rc, "system I/O error - likely broken pipe");
+            if ( ( lerrno = errno ) == EINTR )
+                continue;
+            rc = KSysFileReadError_v1 ( self, lerrno );
             return rc;
+        }
 
-        case EBADF:
-            rc = RC ( rcFS, rcFile, rcReading, rcFileDesc, rcInvalid );
-            PLOGERR (klogErr,
-                     (klogErr, rc, "system bad file descriptor error fd='$(E)'",
-                      "E=%d", self->fd));
-            return rc;
+        assert ( num_read != NULL );
+        * num_read = count;
+        break;
+    }
 
-        case EISDIR:
-            rc = RC ( rcFS, rcFile, rcReading, rcFileDesc, rcIncorrect );
-            LOGERR (klogErr, rc, "system misuse of a directory error");
-            return rc;
+    return 0;
+}
 
-        case EINVAL:
-            rc = RC ( rcFS, rcFile, rcReading, rcParam, rcInvalid );
-            LOGERR (klogErr, rc, "system invalid argument error");
-            return rc;
+static
+rc_t KSysFileTimedRead_v1 ( const KSysFile_v1 *self, uint64_t pos,
+    void *buffer, size_t bsize, size_t *num_read, struct timeout_t *tm )
+{
+    /* reads from a regular file do not time out */
+    return KSysFileRead_v1 ( self, pos, buffer, bsize, num_read );
+}
 
-        default:
-            rc = RC ( rcFS, rcFile, rcReading, rcNoObj, rcUnknown );
-            PLOGERR (klogErr,
-                     (klogErr, rc, "unknown system error '$(S)($(E))'",
-                      "S=%!,E=%d", lerrno, lerrno));
-            return rc;
+/* ReadV
+ *  read several ranges of the file
+ *  runs of adjacent ranges are gathered into a single "preadv"
+ */
+#define KSYSFILE_READV_MAX 64
+
+static
+rc_t KSysFileReadV_v1 ( const KSysFile_v1 *self, KFileReadVec *vec, uint32_t count )
+{
+    uint32_t i, j;
+    struct iovec iov [ KSYSFILE_READV_MAX ];
+
+    assert ( self != NULL );
+
+    for ( i = 0; i < count; i = j )
+    {
+        ssize_t total;
+        uint64_t end = vec [ i ] . pos;
+        int n;
+
+        for ( j = i, n = 0; j < count && n < KSYSFILE_READV_MAX && vec [ j ] . pos == end; ++ j, ++ n )
+        {
+            iov [ n ] . iov_base = vec [ j ] . buffer;
+            iov [ n ] . iov_len = vec [ j ] . bsize;
+            end += vec [ j ] . bsize;
         }
 
-        assert ( num_read != NULL );
-        * num_read = count;
-        break;
+#if USE_TIMEOUT
+        {
+            rc_t rc = KSysFileSelect_v1 ( self, select_read | select_exception );
+            if (rc)
+                return rc;
+        }
+#endif
+
+        do
+            total = preadv ( self -> fd, iov, n, ( off_t ) vec [ i ] . pos );
+        while ( total < 0 && errno == EINTR );
+
+        if ( total < 0 )
+            return KSysFileReadError_v1 ( self, errno );
+
+        /* distribute, a short count leaves the rest to the caller */
+        for ( ; i < j; ++ i )
+        {
+            size_t num_read = vec [ i ] . bsize;
+            if ( ( size_t ) total < num_read )
+                num_read = ( size_t ) total;
+            vec [ i ] . num_read = num_read;
+            total -= num_read;
+        }
     }
 
     return 0;
@@ -513,14 +593,23 @@ rc_t KSysFileWrite_v1 ( KSysFile_v1 *self, uint64_t pos,
 }
 
 
+static
+rc_t KSysFileTimedWrite_v1 ( KSysFile_v1 *self, uint64_t pos,
+    const void *buffer, size_t size, size_t *num_writ, struct timeout_t *tm )
+{
+    /* writes to a regular file do not time out */
+    return KSysFileWrite_v1 ( self, pos, buffer, size, num_writ );
+}
+
+
 /* Make
  *  create a new file object
  *  from file descriptor
  */
 static KFile_vt_v1 vtKSysFile =
 {
-    /* version 1.1 */
-    1, 1,
+    /* version 1.3 */
+    1, 3,
 
     /* start minor version 0 methods */
     KSysFileDestroy_v1,
@@ -533,8 +622,17 @@ static KFile_vt_v1 vtKSysFile =
     /* end minor version 0 methods */
 
     /* start minor version == 1 */
-    KSysFileType_v1
+    KSysFileType_v1,
     /* end minor version == 1 */
+
+    /* start minor version == 2 */
+    KSysFileTimedRead_v1,
+    KSysFileTimedWrite_v1,
+    /* end minor version == 2 */
+
+    /* start minor version == 3 */
+    KSysFileReadV_v1
+    /* end minor version == 3 */
 };
 
 static
@@ -1064,3 +1162,89 @@ LIB_EXPORT rc_t CC KFileMakeFDFileWrite ( KFile_v1 **f, bool update, int fd )
 
     return KStdIOFileMake ( f, fd, seekable, update, true );
 }
+
+/* LockRange
+ * UnlockRange
+ *  advisory byte-range locks through fcntl
+ *
+ *  open file description locks belong to the descriptor rather than
+ *  to the process, so they exclude other threads using another file,
+ *  and closing another descriptor of the same file leaves them alone.
+ *  kernels older than 3.15 reject them with EINVAL, and other systems
+ *  lack them: both fall back to process-associated locks
+ */
+#ifdef F_OFD_SETLK
+static bool KSysFileNoOFDLocks;
+#endif
+
+static
+rc_t KSysFileSetLock ( const KFile_v1 *f, uint64_t pos, uint64_t size,
+    short type, bool wait, enum RCContext ctx )
+{
+    uint64_t offset;
+    struct flock fl;
+    const KSysFile_v1 *self;
+    int cmd = wait ? F_SETLKW : F_SETLK;
+
+    if ( f == NULL )
+        return RC ( rcFS, rcFile, ctx, rcSelf, rcNull );
+
+    self = KFileGetSysFile_v1 ( f, & offset );
+    if ( self == NULL )
+        return RC ( rcFS, rcFile, ctx, rcFile, rcUnsupported );
+
+    memset ( & fl, 0, sizeof fl );
+    fl . l_type = type;
+    fl . l_whence = SEEK_SET;
+    fl . l_start = ( off_t ) ( offset + pos );
+    fl . l_len = ( off_t ) size;
+
+#ifdef F_OFD_SETLK
+    if ( ! KSysFileNoOFDLocks )
+        cmd = wait ? F_OFD_SETLKW : F_OFD_SETLK;
+#endif
+
+    while ( fcntl ( self -> fd, cmd, & fl ) != 0 )
+    {
+        switch ( errno )
+        {
+        case EINTR:
+            continue;
+        case EACCES:
+        case EAGAIN:
+            return RC ( rcFS, rcFile, ctx, rcLock, rcBusy );
+        case EDEADLK:
+            return RC ( rcFS, rcFile, ctx, rcLock, rcExcessive );
+        case EBADF:
+            return RC ( rcFS, rcFile, ctx, rcFileDesc, rcInvalid );
+        case ENOLCK:
+            return RC ( rcFS, rcFile, ctx, rcLock, rcExhausted );
+        case EINVAL:
+#ifdef F_OFD_SETLK
+            if ( cmd == F_OFD_SETLK || cmd == F_OFD_SETLKW )
+            {
+                KSysFileNoOFDLocks = true;
+                cmd = wait ? F_SETLKW : F_SETLK;
+                continue;
+            }
+#endif
+            return RC ( rcFS, rcFile, ctx, rcParam, rcInvalid );
+        default:
+            return RC ( rcFS, rcFile, ctx, rcNoObj, rcUnknown );
+        }
+    }
+
+    return 0;
+}
+
+LIB_EXPORT rc_t CC KFileLockRange ( const KFile_v1 *self,
+    uint64_t pos, uint64_t size, bool exclusive, bool wait )
+{
+    return KSysFileSetLock ( self, pos, size,
+        exclusive ? F_WRLCK : F_RDLCK, wait, rcLocking );
+}
+
+LIB_EXPORT rc_t CC KFileUnlockRange ( const KFile_v1 *self, uint64_t pos, uint64_t size )
+{
+    return KSysFileSetLock ( self, pos, size, F_UNLCK, false, rcUnlocking );
+}
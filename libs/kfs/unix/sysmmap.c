@@ -141,3 +141,35 @@ rc_t KMMapUnmap ( KMMap *self )
 
     return 0;
 }
+
+
+/* AdviseSys
+ */
+rc_t KMMapAdviseSys ( const KMMap *self, const char *addr, size_t size, KMMapAdvice advice )
+{
+    static int const sys_advice [] =
+    {
+        MADV_NORMAL,
+        MADV_RANDOM,
+        MADV_SEQUENTIAL,
+        MADV_WILLNEED,
+        MADV_DONTNEED
+    };
+
+    /* madvise wants the address on a page boundary */
+    size_t adj = ( size_t ) addr & ( self -> pg_size - 1 );
+    if ( madvise ( ( void* ) ( addr - adj ), size + adj, sys_advice [ advice ] ) == 0 )
+        return 0;
+
+    switch ( errno )
+    {
+    case EINVAL:
+        return RC ( rcFS, rcMemMap, rcAccessing, rcParam, rcInvalid );
+    case ENOMEM:
+        return RC ( rcFS, rcMemMap, rcAccessing, rcRange, rcInvalid );
+    case EAGAIN:
+        return RC ( rcFS, rcMemMap, rcAccessing, rcMemory, rcExhausted );
+    }
+
+    return RC ( rcFS, rcMemMap, rcAccessing, rcNoObj, rcUnknown );
+}
@@ -1057,3 +1057,19 @@ LIB_EXPORT rc_t CC KFileMakeFDFileWrite ( KFile **f, bool update, int fd )
 {
     return RC (rcFS, rcFile, rcConstructing, rcFunction, rcUnsupported);
 }
+
+/* LockRange
+ * UnlockRange
+ *  not supported under Windows, where byte-range locks are mandatory
+ *  and would fail the reads of other processes rather than block them
+ */
+LIB_EXPORT rc_t CC KFileLockRange ( const KFile *self,
+    uint64_t pos, uint64_t size, bool exclusive, bool wait )
+{
+    return RC (rcFS, rcFile, rcLocking, rcFunction, rcUnsupported);
+}
+
+LIB_EXPORT rc_t CC KFileUnlockRange ( const KFile *self, uint64_t pos, uint64_t size )
+{
+    return RC (rcFS, rcFile, rcUnlocking, rcFunction, rcUnsupported);
+}
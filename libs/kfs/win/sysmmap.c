@@ -136,3 +136,13 @@ rc_t KMMapUnmap ( KMMap *self )
 
     return 0;
 }
+
+
+/* AdviseSys
+ *  Windows has no per-range hints for mapped views;
+ *  the advice is accepted and ignored
+ */
+rc_t KMMapAdviseSys ( const KMMap *self, const char *addr, size_t size, KMMapAdvice advice )
+{
+    return 0;
+}
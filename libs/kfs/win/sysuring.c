@@ -0,0 +1,67 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include <kfs/extern.h>
+#include "../sysuring-priv.h"
+#include <klib/rc.h>
+
+/*--------------------------------------------------------------------------
+ * KSysURing
+ *  no submission ring on this platform
+ *  queued reads are performed synchronously by the caller
+ */
+
+rc_t KSysURingMake ( KSysURing **ring, uint32_t depth )
+{
+    * ring = NULL;
+    return RC ( rcFS, rcQueue, rcConstructing, rcInterface, rcUnsupported );
+}
+
+void KSysURingWhack ( KSysURing *self )
+{
+}
+
+rc_t KSysURingRegisterBuffers ( KSysURing *self,
+    void * const *buffers, const size_t *sizes, uint32_t count )
+{
+    return RC ( rcFS, rcQueue, rcRegistering, rcInterface, rcUnsupported );
+}
+
+rc_t KSysURingPrepare ( KSysURing *self, const struct KSysFile_v1 *f,
+    uint64_t pos, void *buffer, size_t bsize, int32_t buf_idx, uint64_t tag )
+{
+    return RC ( rcFS, rcQueue, rcInserting, rcInterface, rcUnsupported );
+}
+
+rc_t KSysURingSubmit ( KSysURing *self )
+{
+    return RC ( rcFS, rcQueue, rcWriting, rcInterface, rcUnsupported );
+}
+
+rc_t KSysURingReap ( KSysURing *self, uint64_t *tag, int32_t *res, bool wait )
+{
+    return RC ( rcFS, rcQueue, rcReading, rcInterface, rcUnsupported );
+}
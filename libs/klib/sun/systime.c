@@ -50,6 +50,18 @@ LIB_EXPORT KTime_t CC KTimeStamp ( void )
 }
 
 
+/* NsStamp
+ *  monotonic timestamp in nanoseconds
+ */
+LIB_EXPORT uint64_t CC KTimeNsStamp ( void )
+{
+    struct timespec ts;
+    if ( clock_gettime ( CLOCK_MONOTONIC, & ts ) != 0 )
+        return 0;
+    return ( uint64_t ) ts . tv_sec * 1000000000 + ts . tv_nsec;
+}
+
+
 /*--------------------------------------------------------------------------
  * KTime
  *  simple time structure
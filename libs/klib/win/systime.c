@@ -78,6 +78,19 @@ LIB_EXPORT KTime_t CC KTimeStamp ( void )
 }
 
 
+/* NsStamp
+ *  monotonic timestamp in nanoseconds
+ */
+LIB_EXPORT uint64_t CC KTimeNsStamp ( void )
+{
+    LARGE_INTEGER freq, count;
+    if ( ! QueryPerformanceFrequency ( & freq ) || ! QueryPerformanceCounter ( & count ) )
+        return 0;
+    return ( uint64_t ) ( count . QuadPart / freq . QuadPart ) * 1000000000 +
+        ( uint64_t ) ( count . QuadPart % freq . QuadPart ) * 1000000000 / freq . QuadPart;
+}
+
+
 /*--------------------------------------------------------------------------
  * SYSTEMTIME
  */
@@ -116,6 +116,19 @@ struct KClientHttp
     bool ep_valid;
     
     bool reliable;
+
+    /* "sock" was opened here rather than given by the caller,
+       and may be handed to the manager for reuse */
+    bool sock_reusable;
+
+    /* "sock" was taken from the manager's pool of idle connections */
+    bool sock_pooled;
+
+    /* the body of the last response has not been read to its end */
+    bool body_pending;
+
+    /* the server closes "sock" after the last response */
+    bool close_pending;
 };
 
 
@@ -153,6 +166,16 @@ rc_t KClientHttpClear ( KClientHttp *self )
 static
 rc_t KClientHttpWhack ( KClientHttp * self )
 {
+    /* a connection whose last response was read to its end
+       and that the server keeps open can serve another client */
+    if ( self -> sock != NULL && self -> sock_reusable &&
+         self -> vers == 0x01010000 && ! self -> close_pending &&
+         ! self -> body_pending && KClientHttpBlockBufferIsEmpty ( self ) )
+    {
+        KHttpConnPoolKeep ( self -> mgr -> conn_pool, & self -> hostname, self -> port, self -> sock );
+        self -> sock = NULL;
+    }
+
     KClientHttpClear ( self );
     
     KDataBufferWhack ( & self -> block_buffer );
@@ -164,11 +187,20 @@ rc_t KClientHttpWhack ( KClientHttp * self )
     return 0;
 }
 
-rc_t KClientHttpOpen ( KClientHttp * self, const String * hostname, uint32_t port )
+/* Connect
+ *  open a new connection to hostname:port, bypassing the pool
+ */
+static
+rc_t KClientHttpConnect ( KClientHttp * self, const String * hostname, uint32_t port )
 {
     rc_t rc;
     KSocket * sock;
 
+    self -> sock_reusable = false;
+    self -> sock_pooled = false;
+    self -> body_pending = false;
+    self -> close_pending = false;
+
     if ( ! self -> ep_valid )
     {
         rc = KNSManagerInitDNSEndpoint ( self -> mgr, & self -> ep, hostname, port );
@@ -188,6 +220,7 @@ rc_t KClientHttpOpen ( KClientHttp * self, const String * hostname, uint32_t por
         if ( rc == 0 )
         {
             self -> port = port;
+            self -> sock_reusable = true;
             return 0;
         }
     }
@@ -196,6 +229,23 @@ rc_t KClientHttpOpen ( KClientHttp * self, const String * hostname, uint32_t por
     return rc;
 }
 
+rc_t KClientHttpOpen ( KClientHttp * self, const String * hostname, uint32_t port )
+{
+    /* reuse an idle connection to the same server */
+    if ( KHttpConnPoolTake ( self -> mgr -> conn_pool, hostname, port, & self -> sock ) == 0 )
+    {
+        DBGMSG ( DBG_KNS, DBG_FLAG ( DBG_KNS_HTTP ), ( "KClientHttpOpen: reusing connection to '%S'\n", hostname ) );
+        self -> port = port;
+        self -> sock_reusable = true;
+        self -> sock_pooled = true;
+        self -> body_pending = false;
+        self -> close_pending = false;
+        return 0;
+    }
+
+    return KClientHttpConnect ( self, hostname, port );
+}
+
 #if _DEBUGGING
 /* we need this hook to be able to test the re-connection logic */
 static struct KStream * (*ClientHttpReopenCallback) ( void ) = NULL;
@@ -212,6 +262,8 @@ rc_t KClientHttpReopen ( KClientHttp * self )
     if ( ClientHttpReopenCallback != NULL )
     {
         self -> sock = ClientHttpReopenCallback ();
+        self -> sock_reusable = false;
+        self -> sock_pooled = false;
         return 0;
     }
 #endif
@@ -462,101 +514,108 @@ LIB_EXPORT rc_t CC KClientHttpRelease ( const KClientHttp *self )
 }
 
 /* Communication Methods
- *  Read in the http response and return 1 char at a time
+ *  Read in the http response a block at a time
+ *  leaves "block_valid" at 0 when the end of the stream was reached
  */
 static
-rc_t KClientHttpGetCharFromResponse ( KClientHttp *self, char *ch, struct timeout_t *tm )
+rc_t KClientHttpFillBlockBuffer ( KClientHttp *self, struct timeout_t *tm )
 {
     rc_t rc;
     char * buffer = self -> block_buffer . base;
 
-    /* check for data in buffer */
-    if ( KClientHttpBlockBufferIsEmpty ( self ) )
-    {
-        /* check to see ho many bytes are in the buffer */
-        size_t bsize = KDataBufferBytes ( & self -> block_buffer );
-
-        /* First time around, bsize will be 0 */
-        if ( bsize == 0 )
-        {
-            bsize = 64 * 1024;
-            rc = KDataBufferResize ( & self -> block_buffer, bsize );
-            if ( rc != 0 )
-                return rc;
-
-            /* re-assign new base pointer */
-            buffer = self -> block_buffer . base;
-        }
-
-        /* zero out offsets */
-        KClientHttpBlockBufferReset ( self );
+    /* check to see ho many bytes are in the buffer */
+    size_t bsize = KDataBufferBytes ( & self -> block_buffer );
 
-        /* read from the stream into the buffer, and record the bytes read
-           into block_valid */
-        /* NB - do NOT use KStreamReadAll or it will block with http 1.1 
-           because http/1.1 uses keep alive and the read will block until the server 
-           drops the connection */
-        rc = KStreamTimedRead ( self -> sock, buffer, bsize, & self -> block_valid, tm );
+    /* First time around, bsize will be 0 */
+    if ( bsize == 0 )
+    {
+        bsize = 64 * 1024;
+        rc = KDataBufferResize ( & self -> block_buffer, bsize );
         if ( rc != 0 )
-        {
-            KClientHttpClose ( self );
             return rc;
-        }
 
-        /* if nothing was read, we have reached the end of the stream */
-        if ( self -> block_valid == 0 )
-        {
-            KClientHttpClose ( self );
+        /* re-assign new base pointer */
+        buffer = self -> block_buffer . base;
+    }
 
-            /* return nul char */
-            * ch = 0;
-            return 0;
-        }
+    /* zero out offsets */
+    KClientHttpBlockBufferReset ( self );
+
+    /* read from the stream into the buffer, and record the bytes read
+       into block_valid */
+    /* NB - do NOT use KStreamReadAll or it will block with http 1.1 
+       because http/1.1 uses keep alive and the read will block until the server 
+       drops the connection */
+    rc = KStreamTimedRead ( self -> sock, buffer, bsize, & self -> block_valid, tm );
+    if ( rc != 0 )
+    {
+        KClientHttpClose ( self );
+        return rc;
     }
 
-    /* return the next char in the buffer */
-    * ch = buffer [ self -> block_read ++ ];
+    /* if nothing was read, we have reached the end of the stream */
+    if ( self -> block_valid == 0 )
+        KClientHttpClose ( self );
+
     return 0;
 }
 
-/* Read and return entire lines ( until \r\n ) */
+/* Read and return entire lines ( until \r\n )
+ *  the block buffer is scanned for the end of line,
+ *  and the line is copied in runs rather than char by char
+ */
 static
 rc_t KClientHttpGetLine ( KClientHttp *self, struct timeout_t *tm )
 {
     rc_t rc;
-
     char * buffer = self -> line_buffer . base;
     size_t bsize = KDataBufferBytes ( & self -> line_buffer );
+    bool eol = false, crlf = true;
 
     /* num_valid bytes read starts at 0 */
     self -> line_valid = 0;
-    while ( 1 )
+    while ( ! eol )
     {
-        char ch;
+        size_t run;
+        const char * start, * nl, * nul;
 
-        /* get char */
-        rc = KClientHttpGetCharFromResponse ( self, &ch, tm );
-        if ( rc != 0 )
-            break;
+        /* check for data in buffer */
+        if ( KClientHttpBlockBufferIsEmpty ( self ) )
+        {
+            rc = KClientHttpFillBlockBuffer ( self, tm );
+            if ( rc != 0 )
+                return rc;
 
-        if ( ch == '\n' )
+            /* the end of the stream ends the line */
+            if ( self -> block_valid == 0 )
+                break;
+        }
+
+        /* memchr is vectorized in any libc worth its salt */
+        start = ( const char * ) self -> block_buffer . base + self -> block_read;
+        run = self -> block_valid - self -> block_read;
+        nl = memchr ( start, '\n', run );
+        if ( nl != NULL )
         {
-            /* check that there are valid bytes read and the previous char is '\r' */
-            if ( self -> line_valid > 0 && buffer [ self -> line_valid - 1 ] == '\r' )
-            {
-                /* decrement number of valid bytes to remove '\r' */
-                -- self -> line_valid;
-            }
-            /* record end of line */
-            ch = 0;
+            run = nl - start;
+            eol = true;
         }
 
-        /* check if the buffer is full */
-        if ( self -> line_valid == bsize )
+        /* an embedded nul ends the line as well */
+        nul = memchr ( start, 0, run );
+        if ( nul != NULL )
+        {
+            run = nul - start;
+            eol = true;
+            crlf = false;
+        }
+
+        /* check if the buffer can take the run and a terminating nul */
+        if ( self -> line_valid + run >= bsize )
         {
             /* I assume that the header lines will not be too large
-               so only need to increment  by small chunks */
-            bsize += 256;
+               so only need to increment by small chunks */
+            bsize = ( self -> line_valid + run + 256 ) & ~ ( size_t ) 255;
 
             /* TBD - place an upper limit on resize */
 
@@ -569,34 +628,44 @@ rc_t KClientHttpGetLine ( KClientHttp *self, struct timeout_t *tm )
             buffer = self -> line_buffer . base;
         }
 
-        /* buffer is not full, insert char into the buffer */
-        buffer [ self -> line_valid ] = ch;
-        
-        /* get out of loop if end of line */
-        if ( ch == 0 )
-        {
+        memmove ( & buffer [ self -> line_valid ], start, run );
+        self -> line_valid += run;
+
+        /* consume the run, and the '\n' or nul */
+        self -> block_read += eol ? run + 1 : run;
+    }
+
+    /* remove '\r' before '\n' */
+    if ( eol && crlf && self -> line_valid > 0 && buffer [ self -> line_valid - 1 ] == '\r' )
+        -- self -> line_valid;
+
+    /* record end of line */
+    if ( bsize == 0 )
+    {
+        rc = KDataBufferResize ( & self -> line_buffer, 256 );
+        if ( rc != 0 )
+            return rc;
+        buffer = self -> line_buffer . base;
+    }
+    buffer [ self -> line_valid ] = 0;
+
 #if _DEBUGGING
-            if ( KNSManagerIsVerbose ( self -> mgr ) ) {
-                size_t i = 0;
-                KOutMsg ( "KClientHttpGetLine: '" );
-                for (i = 0; i <= self->line_valid; ++i) {
-                    if (isprint(buffer[i])) {
-                        KOutMsg("%c", buffer[i]);
-                    }
-                    else {
-                        KOutMsg("\\%02X", buffer[i]);
-                    }
-                }
-                KOutMsg ( "'\n" );
+    if ( KNSManagerIsVerbose ( self -> mgr ) ) {
+        size_t i = 0;
+        KOutMsg ( "KClientHttpGetLine: '" );
+        for (i = 0; i <= self->line_valid; ++i) {
+            if (isprint(buffer[i])) {
+                KOutMsg("%c", buffer[i]);
+            }
+            else {
+                KOutMsg("\\%02X", buffer[i]);
             }
-#endif
-            break;
         }
-        /* not end of line - increase num of valid bytes read */
-        ++ self -> line_valid;
+        KOutMsg ( "'\n" );
     }
+#endif
 
-    return rc;
+    return 0;
 }
 
 /* AddHeaderString
@@ -923,6 +992,7 @@ struct KClientHttpStream
 
     uint8_t state; /* keeps track of state for chunked reader */
     bool size_unknown; /* for HTTP/1.0 dynamic */
+    bool chunked;
 };
 
 enum 
@@ -1021,6 +1091,13 @@ rc_t CC KClientHttpStreamTimedRead ( const KClientHttpStream *cself,
        keep track of total bytes read within the chunk */
     self -> total_read += * num_read;
 
+    /* the whole body is in */
+    if ( rc == 0 && ! self -> chunked && ! self -> size_unknown &&
+         self -> total_read == self -> content_length )
+    {
+        http -> body_pending = false;
+    }
+
     return rc;
 }
 
@@ -1094,6 +1171,16 @@ rc_t CC KClientHttpStreamTimedReadChunked ( const KClientHttpStream *cself,
         /* check for end of stream */
         if ( self -> content_length == 0 )
         {
+            /* skip any trailer up to the blank line ending the body */
+            do
+                rc = KClientHttpGetLine ( http, tm );
+            while ( rc == 0 && http -> line_valid != 0 );
+
+            if ( rc == 0 )
+                http -> body_pending = false;
+            else
+                KClientHttpClose ( http );
+
             self -> state = end_stream;
             return 0;
         }
@@ -1228,6 +1315,7 @@ rc_t KClientHttpStreamMakeChunked ( KClientHttp *self, KStream **sp, const char
             if ( rc == 0 )
             {
                 s -> http = self;
+                s -> chunked = true;
 
                 /* state should be new_chunk */
                 s -> state = new_chunk;
@@ -1259,6 +1347,16 @@ struct KClientHttpResult
     uint32_t status;
     ver_t version;
 
+    /* headers consulted on every response, parsed once they are in */
+    uint64_t content_length;
+    uint64_t range_pos;
+    uint64_t range_bytes;
+    bool have_content_length;
+    bool have_range;
+    bool chunked;
+    bool other_encoding;
+    bool keep_alive;
+
     KRefcount refcount;
     bool close_connection;
 };
@@ -1280,45 +1378,132 @@ rc_t KClientHttpResultWhack ( KClientHttpResult * self )
 }
 
 
-/* Sends the request and receives the response into a KClientHttpResult obj */
-static 
-rc_t KClientHttpSendReceiveMsg ( KClientHttp *self, KClientHttpResult **rslt,
-    const char *buffer, size_t len, const KDataBuffer *body, const char *url )
+/* ParseFields
+ *  parse the headers consulted on every response once,
+ *  rather than looking them up and parsing them again on
+ *  each call to Size, Range, KeepAlive or GetInputStream
+ */
+static
+const KHttpHeader * KClientHttpResultFindNode ( const KClientHttpResult *self, const char *_name )
 {
-    rc_t rc = 0;
-    size_t sent;
-    timeout_t tm;
+    String name;
+    StringInitCString ( & name, _name );
+    return ( const KHttpHeader * ) BSTreeFind ( & self -> hdrs, & name, KHttpHeaderCmp );
+}
 
-    /* TBD - may want to assert that there is an empty line in "buffer" */
-#if _DEBUGGING
-    if ( KNSManagerIsVerbose ( self -> mgr ) )
-        KOutMsg ( "KClientHttpSendReceiveMsg: '%.*s'\n", len, buffer );
-#endif
+static
+bool KClientHttpParseU64 ( const char *buf, const char *end, uint64_t *num, const char **stop )
+{
+    char * sep;
+    * num = strtou64 ( buf, & sep, 10 );
+    * stop = sep;
+    return sep != buf && sep <= end;
+}
 
-    /* reopen connection if NULL */
-    if ( self -> sock == NULL )
-        rc = KClientHttpOpen ( self, & self -> hostname, self -> port );
+static
+void KClientHttpResultParseFields ( KClientHttpResult *self )
+{
+    const char * sep;
+    const KHttpHeader * node;
+    bool length_ok = true;
 
-    /* ALWAYS want to use write all when sending */
-    if ( rc == 0 )
+    self -> have_content_length = false;
+    self -> have_range = false;
+    self -> chunked = false;
+    self -> other_encoding = false;
+    self -> keep_alive = false;
+
+    /* header values are nul-terminated within their storage */
+    node = KClientHttpResultFindNode ( self, "Content-Length" );
+    if ( node != NULL )
     {
-        TimeoutInit ( & tm, self -> write_timeout );
-        rc = KStreamTimedWriteAll ( self -> sock, buffer, len, & sent, & tm ); 
-        if ( rc != 0 )
+        const char * end = node -> value . addr + node -> value . size;
+        self -> have_content_length =
+            KClientHttpParseU64 ( node -> value . addr, end, & self -> content_length, & sep ) && sep == end;
+        length_ok = self -> have_content_length;
+    }
+
+    /* get Content-Range
+     *  expect: "bytes <first-position>-<last-position>/<total-size>"
+     *  consistent with Content-Length, if given - chunked encoding
+     *  means that it may not exist
+     */
+    node = KClientHttpResultFindNode ( self, "Content-Range" );
+    if ( node != NULL && length_ok )
+    {
+        uint64_t start_pos, end_pos, total;
+        const char * buf = node -> value . addr;
+        const char * end = buf + node -> value . size;
+
+        /* look for separation of 'bytes' and first position */
+        buf = string_chr ( buf, end - buf, ' ' );
+        if ( buf != NULL &&
+             KClientHttpParseU64 ( buf + 1, end, & start_pos, & sep ) && * sep == '-' &&
+             KClientHttpParseU64 ( sep + 1, end, & end_pos, & sep ) && * sep == '/' &&
+             KClientHttpParseU64 ( sep + 1, end, & total, & sep ) && sep == end &&
+             total != 0 && start_pos <= total && end_pos >= start_pos && end_pos <= total )
         {
-            rc_t rc2;
-            KClientHttpClose ( self );
-            rc2 = KClientHttpOpen ( self, & self -> hostname, self -> port );
-            if ( rc2 == 0 )
+            uint64_t length = end_pos - start_pos + 1;
+            if ( ! self -> have_content_length ||
+                 ( self -> content_length == length && length <= total ) )
             {
-                TimeoutInit ( & tm, self -> write_timeout );
-                rc2 = KStreamTimedWriteAll ( self -> sock, buffer, len, & sent, & tm );
-                if ( rc2 == 0 )
-                    rc = 0;
+                self -> range_pos = start_pos;
+                self -> range_bytes = length;
+                self -> have_range = true;
             }
         }
     }
 
+    node = KClientHttpResultFindNode ( self, "Transfer-Encoding" );
+    if ( node != NULL && node -> value . size > 0 )
+    {
+        /* check if chunked encoding */
+        if ( strcase_cmp ( "chunked", sizeof "chunked" - 1,
+            node -> value . addr, node -> value . size, sizeof "chunked" - 1 ) == 0 )
+        {
+            self -> chunked = true;
+        }
+        else
+        {
+            self -> other_encoding = true;
+        }
+    }
+
+    node = KClientHttpResultFindNode ( self, "Connection" );
+    if ( node != NULL )
+    {
+        String compare;
+        CONST_STRING ( & compare, "keep-alive" );
+        self -> keep_alive = ( StringCaseCompare ( & node -> value, & compare ) == 0 );
+    }
+}
+
+/* Sends the request, and the body if any */
+static
+rc_t KClientHttpSendMsg ( KClientHttp *self,
+    const char *buffer, size_t len, const KDataBuffer *body )
+{
+    rc_t rc;
+    size_t sent;
+    timeout_t tm;
+
+    /* ALWAYS want to use write all when sending */
+    TimeoutInit ( & tm, self -> write_timeout );
+    rc = KStreamTimedWriteAll ( self -> sock, buffer, len, & sent, & tm ); 
+    if ( rc != 0 )
+    {
+        rc_t rc2;
+        KClientHttpClose ( self );
+        rc2 = KClientHttpConnect ( self, & self -> hostname, self -> port );
+        if ( rc2 == 0 )
+        {
+            TimeoutInit ( & tm, self -> write_timeout );
+            rc2 = KStreamTimedWriteAll ( self -> sock, buffer, len, & sent, & tm );
+            if ( rc2 == 0 )
+                rc = 0;
+        }
+    }
+
     /* check the data was completely sent */
     if ( rc == 0 && sent != len )
     {
@@ -1336,18 +1521,64 @@ rc_t KClientHttpSendReceiveMsg ( KClientHttp *self, KClientHttpResult **rslt,
             KClientHttpClose ( self );
         }
     }
+
+    return rc;
+}
+
+/* Sends the request and receives the response into a KClientHttpResult obj */
+static 
+rc_t KClientHttpSendReceiveMsg ( KClientHttp *self, KClientHttpResult **rslt,
+    const char *buffer, size_t len, const KDataBuffer *body, const char *url )
+{
+    rc_t rc = 0;
+    timeout_t tm;
+
+    /* TBD - may want to assert that there is an empty line in "buffer" */
+#if _DEBUGGING
+    if ( KNSManagerIsVerbose ( self -> mgr ) )
+        KOutMsg ( "KClientHttpSendReceiveMsg: '%.*s'\n", len, buffer );
+#endif
+
+    /* reopen connection if NULL */
+    if ( self -> sock == NULL )
+        rc = KClientHttpOpen ( self, & self -> hostname, self -> port );
+
     if ( rc == 0 )
     {
         String msg;
         ver_t version;
         uint32_t status;
 
-        /* reinitialize the timeout for reading */
-        TimeoutInit ( & tm, self -> read_timeout );
+        rc = KClientHttpSendMsg ( self, buffer, len, body );
+        if ( rc == 0 )
+        {
+            /* reinitialize the timeout for reading */
+            TimeoutInit ( & tm, self -> read_timeout );
+
+            /* we have now received a response 
+               start reading the header lines */
+            rc = KClientHttpGetStatusLine ( self, & tm, & msg, & status, & version );
+        }
+
+        /* the server may have closed a pooled connection while it sat idle,
+           which no check can see in advance. send again on a new one */
+        if ( rc != 0 && self -> sock_pooled )
+        {
+            DBGMSG ( DBG_KNS, DBG_FLAG ( DBG_KNS_HTTP ), ( "KClientHttpSendReceiveMsg: pooled connection to '%S' failed, reconnecting\n", & self -> hostname ) );
+            KClientHttpClose ( self );
+            KClientHttpBlockBufferReset ( self );
+            KClientHttpLineBufferReset ( self );
+
+            rc = KClientHttpConnect ( self, & self -> hostname, self -> port );
+            if ( rc == 0 )
+                rc = KClientHttpSendMsg ( self, buffer, len, body );
+            if ( rc == 0 )
+            {
+                TimeoutInit ( & tm, self -> read_timeout );
+                rc = KClientHttpGetStatusLine ( self, & tm, & msg, & status, & version );
+            }
+        }
 
-        /* we have now received a response 
-           start reading the header lines */
-        rc = KClientHttpGetStatusLine ( self, & tm, & msg, & status, & version );
         if ( rc == 0 )
         {         
             /* create a result object with enough space for msg string + nul */
@@ -1390,6 +1621,15 @@ rc_t KClientHttpSendReceiveMsg ( KClientHttp *self, KClientHttpResult **rslt,
 
                     if ( rc == 0 )
                     {
+                        KClientHttpResultParseFields ( result );
+
+                        /* the connection may serve another request once the body is read,
+                           unless the server closes it after this response */
+                        self -> close_pending = result -> close_connection ||
+                            ( version < 0x01010000 && ! result -> keep_alive );
+                        self -> body_pending = ! ( status < 200 || status == 204 || status == 304 ||
+                            ( result -> have_content_length && result -> content_length == 0 ) );
+
                         /* assign to OUT result obj */
                         * rslt = result;
                         return 0; 
@@ -1524,35 +1764,9 @@ LIB_EXPORT rc_t CC KClientHttpResultStatus ( const KClientHttpResult *self, uint
  */
 LIB_EXPORT bool CC KClientHttpResultKeepAlive ( const KClientHttpResult *self )
 {
-    rc_t rc;
-
-    if ( self != NULL )
-    {
-        /* we're requiring version 1.1 -
-           some 1.0 servers also supported it... */
-        if ( self -> version == 0x01010000 )
-        {
-            size_t num_writ;
-            char buffer [ 1024 ];
-            size_t bsize = sizeof buffer;
-
-            /* retreive the node that has the keep-alive property */
-            rc = KClientHttpResultGetHeader ( self, "Connection", buffer, bsize, & num_writ );
-            if ( rc == 0 )
-            {
-                String keep_alive, compare;
-
-                /* init strings */
-                StringInitCString ( & keep_alive, buffer );
-                CONST_STRING ( & compare, "keep-alive" );
-
-                /* compare strings for property value */
-                if ( StringCaseCompare ( & keep_alive, & compare ) == 0 )
-                    return true;
-            }
-        }
-    }
-    return false;
+    /* we're requiring version 1.1 -
+       some 1.0 servers also supported it... */
+    return self != NULL && self -> version == 0x01010000 && self -> keep_alive;
 }
 
 
@@ -1567,117 +1781,6 @@ LIB_EXPORT bool CC KClientHttpResultKeepAlive ( const KClientHttpResult *self )
  *  AND WE WILL RESPOND TO THE HTTP "PARTIAL RESULT" OR WHATEVER RETURN CODE,
  *  AND BASICALLY UPDATE WHAT THE RANGE WAS.
  */
-static
-rc_t KClientHttpResultHandleContentRange ( const KClientHttpResult *self, uint64_t *pos, size_t *bytes )
-{
-    rc_t rc;
-    size_t num_read;
-    char buffer [ 1024 ];
-    const size_t bsize = sizeof buffer;
-
-    /* get Content-Range
-     *  expect: "bytes <first-position>-<last-position>/<total-size>"
-     */
-    rc = KClientHttpResultGetHeader ( self, "Content-Range", buffer, bsize, & num_read );
-    if ( rc == 0 )
-    {
-        char * sep;
-        char *buf = buffer;
-        const char *end = & buffer [ num_read ];
-
-        /* look for separation of 'bytes' and first position */
-        sep = string_chr ( buf, end - buf, ' ' );
-        if ( sep == NULL )
-            rc = RC ( rcNS, rcNoTarg, rcParsing, rcNoObj, rcNotFound );
-        else
-        {
-            uint64_t start_pos;
-                        
-            /* buf now points to value */
-            buf = sep + 1;
-
-            /* capture starting position 
-               sep should land on '-' */
-            start_pos = strtou64 ( buf, & sep, 10 );
-
-            /* check if we didnt read anything or sep didnt land on '-' */
-            if ( sep == buf || * sep != '-' )
-                rc =  RC ( rcNS, rcNoTarg, rcParsing, rcNoObj, rcNotFound );
-            else
-            {
-                uint64_t end_pos;
-
-                buf = sep + 1;
-                end_pos = strtou64 ( buf, & sep, 10 );
-                if ( sep == buf || * sep != '/' )
-                    rc =  RC ( rcNS, rcNoTarg, rcParsing, rcNoObj, rcNotFound );                 
-                else
-                {
-                    uint64_t total;
-
-                    buf = sep +1;
-                    total = strtou64 ( buf, &sep, 10 );
-                    if ( sep == buf || * sep != 0 )
-                        rc =  RC ( rcNS, rcNoTarg, rcParsing, rcNoObj, rcNotFound );                 
-                    else
-                    {
-                        /* check variables */
-                        if ( total == 0 ||
-                             start_pos > total ||
-                             end_pos < start_pos ||
-                             end_pos > total )
-                        {
-                            rc = RC ( rcNS, rcNoTarg, rcParsing, rcNoObj, rcNotFound );
-                        }
-                        else
-                        {
-                            uint64_t length;
-                                        
-                            /* get content-length to confirm bytes sent */
-                            rc = KClientHttpResultGetHeader ( self, "Content-Length", buffer, bsize, & num_read );
-                            if ( rc != 0 )
-                            {
-                                            
-                                /* remember that we can have chunked encoding,
-                                   so "Content-Length" may not exist. */
-                                * pos = start_pos;
-                                * bytes = end_pos - start_pos + 1; 
-                                            
-                                return 0;
-                            }
-
-                            buf = buffer;
-                            end = & buffer [ num_read ];
-                                            
-                            /* capture the length */
-                            length  = strtou64 ( buf, & sep, 10 );
-                            if ( sep == buf || * sep != 0 )
-                                rc =  RC ( rcNS, rcNoTarg, rcParsing, rcNoObj, rcNotFound );
-                            else 
-                            {
-                                /* finally check all the acquired information */
-                                if ( ( length != ( ( end_pos - start_pos ) + 1 ) ) ||
-                                     ( length > total ) )
-                                    rc = RC ( rcNS, rcNoTarg, rcParsing, rcNoObj, rcNotFound );
-                                else
-                                {
-                                    /* assign to OUT params */
-                                    * pos = start_pos;
-                                    * bytes = length; 
-                                                    
-                                    return 0;
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
-
-    return rc;
-}
-
 LIB_EXPORT rc_t CC KClientHttpResultRange ( const KClientHttpResult *self, uint64_t *pos, size_t *bytes )
 {
     rc_t rc;
@@ -1692,9 +1795,12 @@ LIB_EXPORT rc_t CC KClientHttpResultRange ( const KClientHttpResult *self, uint6
         {
         case 206:
             /* partial content */
-            rc = KClientHttpResultHandleContentRange ( self, pos, bytes );
-            if ( rc == 0 )
+            if ( self -> have_range )
+            {
+                * pos = self -> range_pos;
+                * bytes = ( size_t ) self -> range_bytes;
                 return 0;
+            }
 
         case 416:
             /* unsatisfiable range */
@@ -1725,30 +1831,11 @@ LIB_EXPORT rc_t CC KClientHttpResultRange ( const KClientHttpResult *self, uint6
  */
 LIB_EXPORT bool CC KClientHttpResultSize ( const KClientHttpResult *self, uint64_t *size )
 {
-    if ( size != NULL && self != NULL )
+    if ( size != NULL && self != NULL && self -> have_content_length )
     {
-        rc_t rc;
-        size_t num_read;
-        char buffer [ 1024 ];
-        const size_t bsize = sizeof buffer;
-        
-        /* check for content-length */
-        rc = KClientHttpResultGetHeader ( self, "Content-Length", buffer, bsize, & num_read );
-        if ( rc == 0 )
-        {
-            char * sep;
-            
-            /* capture length as uint64 */
-            uint64_t length = strtou64 ( buffer, & sep, 10 );
-            if ( sep == buffer || * sep != 0 )
-                rc =  RC ( rcNS, rcNoTarg, rcParsing, rcNoObj, rcNotFound );
-            else
-            {
-                /* assign to OUT param */
-                * size = length;
-                return true;
-            }
-        }
+        /* assign to OUT param */
+        * size = self -> content_length;
+        return true;
     }
     return false;
 }
@@ -1783,6 +1870,10 @@ LIB_EXPORT rc_t CC KClientHttpResultAddHeader ( KClientHttpResult *self,
         rc = KClientHttpVAddHeader ( & self -> hdrs, name, val, args );
         
         va_end ( args );
+
+        /* the header may repair one of the parsed ones */
+        if ( rc == 0 )
+            KClientHttpResultParseFields ( self );
     }
     return rc;
 }
@@ -1849,24 +1940,15 @@ LIB_EXPORT rc_t CC KClientHttpResultGetInputStream ( KClientHttpResult *self, KS
             rc = RC ( rcNS, rcNoTarg, rcValidating, rcSelf, rcNull );
         else
         {
-            char buffer [ 512 ];
-            size_t num_read = 0;
             uint64_t content_length = 0;
 
-            /* find header to check for type of data being received 
-               assign bytes read from value to num_read */
-            rc = KClientHttpResultGetHeader ( self, "Transfer-Encoding", buffer, sizeof buffer, & num_read );
-            if ( rc == 0 && num_read > 0 )
+            /* check for type of data being received */
+            if ( self -> chunked )
+                return KClientHttpStreamMakeChunked ( self -> http, s, "KClientHttpStreamChunked" );
+            if ( self -> other_encoding )
             {
-                /* check if chunked encoding */
-                if ( strcase_cmp ( "chunked", sizeof "chunked" - 1,
-                    buffer, num_read, sizeof "chunked" - 1 ) == 0 )
-                {
-                    return KClientHttpStreamMakeChunked ( self -> http, s, "KClientHttpStreamChunked" );
-                }
                 /* TBD - print actual value */
-                LOGERR ( klogSys, rc, "Transfer-Encoding does not provide a value" );
-
+                LOGERR ( klogSys, 0, "Transfer-Encoding does not provide a value" );
             }
             /* get the content length of the entire stream if known */
             if ( KClientHttpResultSize ( self, & content_length ) )
@@ -2550,6 +2632,10 @@ rc_t KClientHttpRequestSendReceiveNoBodyInt ( KClientHttpRequest *self, KClientH
                 break;
         }
 
+        /* the response to HEAD never has a body */
+        if ( strcmp ( method, "HEAD" ) == 0 )
+            self -> http -> body_pending = false;
+
         /* look at status code */
         rslt = * _rslt;
         switch ( rslt -> status )
@@ -60,6 +60,8 @@ typedef struct KHttpFile KHttpFile;
 #include <klib/time.h> /* KSleep */
 #include <klib/vector.h>
 
+#include <kproc/lock.h>
+#include <kproc/thread.h>
 #include <kproc/timeout.h>
 
 #include <os-native.h>
@@ -87,11 +89,31 @@ struct KHttpFile
 
     char* url;
     KDataBuffer url_buffer;
+
+    /* serializes reads, which share "http" and the pool,
+       e.g. between a reader and a read-ahead thread */
+    KLock *lock;
+
+    /* additional connections for splitting large reads,
+       made upon first use. "pool [ 0 ]" is "http" */
+    KClientHttp **pool;
+    uint32_t pool_count;
+    size_t chunk_size;
+
+    URLBlock block;
+    ver_t vers;
+    bool reliable;
 };
 
 static
 rc_t CC KHttpFileDestroy ( KHttpFile *self )
 {
+    uint32_t i;
+    for ( i = 1; self -> pool != NULL && i < self -> pool_count; ++ i )
+        KClientHttpRelease ( self -> pool [ i ] );
+    free ( self -> pool );
+    KLockRelease ( self -> lock );
+
     KNSManagerRelease ( self -> kns );
     KClientHttpRelease ( self -> http );
     free ( self -> url );
@@ -132,14 +154,12 @@ rc_t CC KHttpFileSetSize ( KHttpFile *self, uint64_t size )
 }
 
 static
-rc_t KHttpFileTimedReadInt ( const KHttpFile *cself,
+rc_t KHttpFileTimedReadInt ( const KHttpFile *self, KClientHttp *http,
     uint64_t aPos, void *aBuf, size_t aBsize,
     size_t *num_read, struct timeout_t *tm, uint32_t * http_status )
 {
     uint64_t pos = aPos;
     rc_t rc;
-    KHttpFile *self = ( KHttpFile * ) cself;
-    KClientHttp *http = self -> http;
     
     * http_status = 0; 
 
@@ -285,7 +305,7 @@ otherwise we are going to hit "Apache return HTTP headers twice" bug */
 }
 
 static
-rc_t CC KHttpFileTimedRead ( const KHttpFile *self,
+rc_t KHttpFileTimedReadConn ( const KHttpFile *self, KClientHttp *http,
     uint64_t pos, void *buffer, size_t bsize,
     size_t *num_read, struct timeout_t *tm )
 {
@@ -300,14 +320,14 @@ rc_t CC KHttpFileTimedRead ( const KHttpFile *self,
         while ( rc == 0 ) 
         {
             uint32_t http_status;
-            rc = KHttpFileTimedReadInt ( self, pos, buffer, bsize, num_read, tm, & http_status );
+            rc = KHttpFileTimedReadInt ( self, http, pos, buffer, bsize, num_read, tm, & http_status );
             if ( rc != 0 ) 
             {   
-                rc_t rc2=KClientHttpReopen ( self -> http );
+                rc_t rc2=KClientHttpReopen ( http );
                 DBGMSG ( DBG_KNS, DBG_FLAG ( DBG_KNS_HTTP ), ( "KHttpFileTimedRead: KHttpFileTimedReadInt failed, reopening\n" ) );
                 if ( rc2 == 0 )
                 {
-                    rc2 = KHttpFileTimedReadInt ( self, pos, buffer, bsize, num_read, tm, & http_status );
+                    rc2 = KHttpFileTimedReadInt ( self, http, pos, buffer, bsize, num_read, tm, & http_status );
                     if ( rc2 == 0 ) 
                     {
                         DBGMSG ( DBG_KNS, DBG_FLAG ( DBG_KNS_HTTP ), ( "KHttpFileTimedRead: reopened successfully\n" ) );
@@ -324,7 +344,7 @@ rc_t CC KHttpFileTimedRead ( const KHttpFile *self,
             {
                 break;
             }
-            rc = KClientHttpReopen ( self -> http );
+            rc = KClientHttpReopen ( http );
         }
         
         {
@@ -336,6 +356,371 @@ rc_t CC KHttpFileTimedRead ( const KHttpFile *self,
     return rc;
 }
 
+/*--------------------------------------------------------------------------
+ * KHttpFileChunks
+ *  a list of file segments that are claimed in order by
+ *  one thread per connection, each reading into the
+ *  segment's own buffer
+ */
+typedef struct KHttpFileChunks KHttpFileChunks;
+struct KHttpFileChunks
+{
+    const KHttpFile *file;
+    struct timeout_t *tm;
+
+    /* "num_read" receives bytes read per segment */
+    KFileReadVec *seg;
+
+    KLock *lock;
+    uint32_t count;
+    uint32_t next;
+    rc_t rc;
+};
+
+static
+rc_t KHttpFileChunksRead ( KHttpFileChunks *self, KClientHttp *http )
+{
+    rc_t rc = 0;
+
+    while ( rc == 0 )
+    {
+        uint32_t idx;
+        size_t total;
+        KFileReadVec *seg;
+
+        /* claim next segment unless some other failed */
+        rc = KLockAcquire ( self -> lock );
+        if ( rc != 0 )
+            break;
+        idx = self -> next;
+        if ( self -> rc != 0 )
+            idx = self -> count;
+        else if ( idx < self -> count )
+            ++ self -> next;
+        KLockUnlock ( self -> lock );
+
+        if ( idx >= self -> count )
+            break;
+
+        seg = & self -> seg [ idx ];
+        for ( total = 0; total < seg -> bsize; )
+        {
+            size_t num_read;
+            struct timeout_t tm, *tmp = NULL;
+            if ( self -> tm != NULL )
+            {
+                TimeoutInit ( & tm, self -> tm -> mS );
+                tmp = & tm;
+            }
+
+            rc = KHttpFileTimedReadConn ( self -> file, http, seg -> pos + total,
+                ( uint8_t* ) seg -> buffer + total, seg -> bsize - total, & num_read, tmp );
+            if ( rc != 0 || num_read == 0 )
+                break;
+            total += num_read;
+        }
+
+        seg -> num_read = total;
+        if ( rc == 0 && total < seg -> bsize )
+            rc = RC ( rcNS, rcFile, rcReading, rcTransfer, rcIncomplete );
+
+        if ( rc != 0 && KLockAcquire ( self -> lock ) == 0 )
+        {
+            if ( self -> rc == 0 )
+                self -> rc = rc;
+            KLockUnlock ( self -> lock );
+        }
+    }
+
+    return rc;
+}
+
+typedef struct KHttpFileChunksWorker KHttpFileChunksWorker;
+struct KHttpFileChunksWorker
+{
+    KHttpFileChunks *chunks;
+    KClientHttp *http;
+};
+
+static
+rc_t CC KHttpFileChunksThread ( const KThread *t, void *data )
+{
+    KHttpFileChunksWorker *w = data;
+    return KHttpFileChunksRead ( w -> chunks, w -> http );
+}
+
+/* MakeConnections
+ *  make the first "count" pooled connections, called under "lock"
+ */
+static
+rc_t KHttpFileMakeConnections ( KHttpFile *self, uint32_t count )
+{
+    rc_t rc = 0;
+    uint32_t i;
+
+    if ( self -> pool == NULL )
+    {
+        self -> pool = calloc ( self -> pool_count, sizeof self -> pool [ 0 ] );
+        if ( self -> pool == NULL )
+            return RC ( rcNS, rcFile, rcReading, rcMemory, rcExhausted );
+        self -> pool [ 0 ] = self -> http;
+    }
+
+    for ( i = 1; rc == 0 && i < count; ++ i )
+    {
+        if ( self -> pool [ i ] == NULL )
+        {
+            const KNSManager *kns = self -> kns;
+            rc = KNSManagerMakeClientHttpInt ( kns, & self -> pool [ i ], & self -> url_buffer, NULL,
+                self -> vers, kns -> http_read_timeout, kns -> http_write_timeout,
+                & self -> block . host, self -> block . port, self -> reliable );
+        }
+    }
+
+    return rc;
+}
+
+/* ChunksRun
+ *  read all segments, on as many pooled connections
+ *  as there are segments, called under "lock"
+ */
+static
+rc_t KHttpFileChunksRun ( KHttpFile *self, KFileReadVec *seg, uint32_t seg_count,
+    struct timeout_t *tm )
+{
+    KHttpFileChunks chunks;
+    KHttpFileChunksWorker workers [ MAX_HTTP_READ_CONNECTIONS ];
+    KThread *threads [ MAX_HTTP_READ_CONNECTIONS ];
+    uint32_t i, count, started = 0;
+    rc_t rc;
+
+    memset ( & chunks, 0, sizeof chunks );
+    chunks . file = self;
+    chunks . tm = tm;
+    chunks . seg = seg;
+    chunks . count = seg_count;
+
+    rc = KLockMake ( & chunks . lock );
+    if ( rc != 0 )
+        return rc;
+
+    count = self -> pool_count;
+    if ( count > seg_count )
+        count = seg_count;
+
+    if ( count > 1 )
+    {
+        /* fewer connections than wanted still make progress */
+        KHttpFileMakeConnections ( self, count );
+
+        for ( i = 1; i < count && self -> pool [ i ] != NULL; ++ i )
+        {
+            workers [ i ] . chunks = & chunks;
+            workers [ i ] . http = self -> pool [ i ];
+            if ( KThreadMake ( & threads [ started ], KHttpFileChunksThread, & workers [ i ] ) == 0 )
+                ++ started;
+        }
+    }
+
+    KHttpFileChunksRead ( & chunks, self -> http );
+
+    for ( i = 0; i < started; ++ i )
+    {
+        rc_t status;
+        KThreadWait ( threads [ i ], & status );
+        KThreadRelease ( threads [ i ] );
+    }
+
+    rc = chunks . rc;
+    KLockRelease ( chunks . lock );
+
+    return rc;
+}
+
+static
+rc_t KHttpFileTimedReadParallel ( const KHttpFile *cself,
+    uint64_t pos, void *buffer, size_t bsize,
+    size_t *num_read, struct timeout_t *tm )
+{
+    KHttpFile *self = ( KHttpFile * ) cself;
+    KFileReadVec *seg;
+    uint32_t i, count;
+    size_t total;
+    rc_t rc;
+
+    count = ( uint32_t ) ( ( bsize + self -> chunk_size - 1 ) / self -> chunk_size );
+    seg = calloc ( count, sizeof seg [ 0 ] );
+    if ( seg == NULL )
+        return RC ( rcNS, rcFile, rcReading, rcMemory, rcExhausted );
+
+    for ( i = 0; i < count; ++ i )
+    {
+        size_t offset = ( size_t ) i * self -> chunk_size;
+        seg [ i ] . pos = pos + offset;
+        seg [ i ] . buffer = ( uint8_t* ) buffer + offset;
+        seg [ i ] . bsize = bsize - offset;
+        if ( seg [ i ] . bsize > self -> chunk_size )
+            seg [ i ] . bsize = self -> chunk_size;
+    }
+
+    rc = KHttpFileChunksRun ( self, seg, count, tm );
+
+    /* report the leading bytes that arrived */
+    for ( total = 0, i = 0; i < count; ++ i )
+    {
+        total += seg [ i ] . num_read;
+        if ( seg [ i ] . num_read < seg [ i ] . bsize )
+            break;
+    }
+
+    * num_read = total;
+    if ( total != 0 )
+        rc = 0;
+
+    free ( seg );
+    return rc;
+}
+
+static
+rc_t CC KHttpFileTimedRead ( const KHttpFile *self,
+    uint64_t pos, void *buffer, size_t bsize,
+    size_t *num_read, struct timeout_t *tm )
+{
+    size_t size = bsize;
+    rc_t rc = KLockAcquire ( self -> lock );
+    if ( rc != 0 )
+    {
+        * num_read = 0;
+        return rc;
+    }
+
+    if ( pos < self -> file_size && pos + size > self -> file_size )
+        size = ( size_t ) ( self -> file_size - pos );
+
+    /* split reads that span at least two chunks of the file */
+    if ( self -> pool_count > 1 && pos < self -> file_size && size / 2 >= self -> chunk_size )
+        rc = KHttpFileTimedReadParallel ( self, pos, buffer, size, num_read, tm );
+    else
+        rc = KHttpFileTimedReadConn ( self, self -> http, pos, buffer, bsize, num_read, tm );
+
+    KLockUnlock ( self -> lock );
+    return rc;
+}
+
+/* ReadV
+ *  ascending ranges that lie close together are merged into
+ *  a single request, and requests are spread over the pooled
+ *  connections
+ */
+static
+rc_t CC KHttpFileReadV ( const KHttpFile *cself, KFileReadVec *vec, uint32_t count )
+{
+    KHttpFile *self = ( KHttpFile * ) cself;
+    KFileReadVec *seg;
+    uint32_t *grp;
+    bool *owned;
+    uint32_t i, n;
+    rc_t rc;
+
+    if ( count == 0 )
+        return 0;
+
+    seg = calloc ( count, sizeof seg [ 0 ] );
+    grp = calloc ( count, sizeof grp [ 0 ] );
+    owned = calloc ( count, sizeof owned [ 0 ] );
+    if ( seg == NULL || grp == NULL || owned == NULL )
+    {
+        free ( owned );
+        free ( grp );
+        free ( seg );
+        return RC ( rcNS, rcFile, rcReading, rcMemory, rcExhausted );
+    }
+
+    /* assign ranges to segments */
+    for ( n = 0, i = 0; i < count; ++ i )
+    {
+        uint64_t pos = vec [ i ] . pos;
+        uint64_t end = pos + vec [ i ] . bsize;
+
+        grp [ i ] = count;
+        if ( pos >= self -> file_size || vec [ i ] . bsize == 0 )
+            continue;
+        if ( end > self -> file_size )
+            end = self -> file_size;
+
+        if ( n != 0 )
+        {
+            KFileReadVec *last = & seg [ n - 1 ];
+            uint64_t last_end = last -> pos + last -> bsize;
+            if ( pos >= last_end && pos - last_end <= HTTP_READV_GAP &&
+                 end - last -> pos <= HTTP_READV_SPAN )
+            {
+                last -> bsize = ( size_t ) ( end - last -> pos );
+                owned [ n - 1 ] = true;
+                grp [ i ] = n - 1;
+                continue;
+            }
+        }
+
+        seg [ n ] . pos = pos;
+        seg [ n ] . buffer = vec [ i ] . buffer;
+        seg [ n ] . bsize = ( size_t ) ( end - pos );
+        grp [ i ] = n ++;
+    }
+
+    /* merged segments read into their own buffer */
+    for ( rc = 0, i = 0; i < n; ++ i )
+    {
+        if ( owned [ i ] )
+        {
+            seg [ i ] . buffer = malloc ( seg [ i ] . bsize );
+            if ( seg [ i ] . buffer == NULL )
+            {
+                rc = RC ( rcNS, rcFile, rcReading, rcMemory, rcExhausted );
+                for ( ; i < n; ++ i )
+                    owned [ i ] = false;
+            }
+        }
+    }
+
+    if ( rc == 0 )
+    {
+        rc = KLockAcquire ( self -> lock );
+        if ( rc == 0 )
+        {
+            rc = KHttpFileChunksRun ( self, seg, n, NULL );
+            KLockUnlock ( self -> lock );
+        }
+
+        /* hand out whatever arrived */
+        for ( i = 0; i < count; ++ i )
+        {
+            if ( grp [ i ] < count )
+            {
+                const KFileReadVec *s = & seg [ grp [ i ] ];
+                size_t offset = ( size_t ) ( vec [ i ] . pos - s -> pos );
+                size_t avail = s -> num_read > offset ? s -> num_read - offset : 0;
+                if ( avail > vec [ i ] . bsize )
+                    avail = vec [ i ] . bsize;
+                if ( owned [ grp [ i ] ] )
+                    memmove ( vec [ i ] . buffer, ( const uint8_t* ) s -> buffer + offset, avail );
+                vec [ i ] . num_read = avail;
+            }
+        }
+    }
+
+    for ( i = 0; i < n; ++ i )
+    {
+        if ( owned [ i ] )
+            free ( seg [ i ] . buffer );
+    }
+    free ( owned );
+    free ( grp );
+    free ( seg );
+
+    return rc;
+}
+
 static
 rc_t CC KHttpFileRead ( const KHttpFile *self, uint64_t pos,
      void *buffer, size_t bsize, size_t *num_read )
@@ -373,7 +758,7 @@ uint32_t CC KHttpFileGetType ( const KHttpFile *self )
 
 static KFile_vt_v1 vtKHttpFile = 
 {
-    1, 2,
+    1, 3,
 
     KHttpFileDestroy,
     KHttpFileGetSysFile,
@@ -384,7 +769,8 @@ static KFile_vt_v1 vtKHttpFile =
     KHttpFileWrite,
     KHttpFileGetType,
     KHttpFileTimedRead,
-    KHttpFileTimedWrite
+    KHttpFileTimedWrite,
+    KHttpFileReadV
 };
 
 static rc_t KNSManagerVMakeHttpFileInt ( const KNSManager *self,
@@ -453,12 +839,29 @@ static rc_t KNSManagerVMakeHttpFileInt ( const KNSManager *self,
                                         {
                                             rc = KNSManagerAddRef ( self );
                                             if ( rc == 0 )
+                                            {
+                                                rc = KLockMake ( & f -> lock );
+                                                if ( rc != 0 )
+                                                    KNSManagerRelease ( self );
+                                            }
+                                            if ( rc == 0 )
                                             {
                                                 f -> kns = self;
                                                 f -> file_size = size;
                                                 f -> http = http;
                                                 f -> url = string_dup ( url, string_size ( url ) );
 
+                                                /* a stream given by the caller can not be multiplied */
+                                                f -> pool_count = 1;
+                                                if ( conn == NULL && self -> http_read_connections > 1 )
+                                                {
+                                                    f -> pool_count = self -> http_read_connections;
+                                                    f -> chunk_size = self -> http_read_chunk;
+                                                    f -> block = block;
+                                                    f -> vers = vers;
+                                                    f -> reliable = reliable;
+                                                }
+
                                                 * file = & f -> dad;
                                                 return 0;
                                             }
@@ -0,0 +1,286 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ==============================================================================
+*
+*/
+
+#include <kns/extern.h>
+
+#include <kns/http.h>
+#include <kns/stream.h>
+
+#include <klib/container.h>
+#include <klib/debug.h> /* DBGMSG */
+#include <klib/rc.h>
+#include <klib/text.h>
+#include <klib/time.h>
+
+#include <kproc/lock.h>
+#include <kproc/timeout.h>
+
+#include <os-native.h>
+
+#include <sysalloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "http-priv.h"
+#include "mgr-priv.h"
+#include "stream-priv.h"
+
+
+/*--------------------------------------------------------------------------
+ * KHttpConnPool
+ *  idle keep-alive connections of a manager, keyed by host and port.
+ *  the least recently returned connection is at the head of the list
+ */
+typedef struct KHttpConn KHttpConn;
+struct KHttpConn
+{
+    DLNode dad;
+    KStream *sock;
+    KTime_t since;
+    uint32_t port;
+    String host;
+    char host_text [ 1 ];
+};
+
+struct KHttpConnPool
+{
+    KLock *lock;
+    DLList idle;
+    uint32_t count;
+
+    uint32_t max_idle;
+    uint32_t max_per_host;
+    uint32_t idle_secs;
+};
+
+static
+void CC KHttpConnWhack ( DLNode *n, void *ignore )
+{
+    KHttpConn *self = ( KHttpConn* ) n;
+    KStreamRelease ( self -> sock );
+    free ( self );
+}
+
+/* IsHealthy
+ *  an idle keep-alive connection has nothing to read.
+ *  data or end of stream means the peer closed it or left
+ *  an unread response behind, so it can not be reused.
+ *  this is only a last check: a close still in flight passes,
+ *  so clients keep a connection only after reading the whole
+ *  response, and resend on a new one if a reused one fails
+ */
+static
+bool KHttpConnIsHealthy ( KStream *sock )
+{
+    char b;
+    size_t num_read;
+    timeout_t tm;
+    rc_t rc;
+
+    TimeoutInit ( & tm, 0 );
+    rc = KStreamTimedRead ( sock, & b, 1, & num_read, & tm );
+    return GetRCObject ( rc ) == ( enum RCObject ) rcTimeout && GetRCState ( rc ) == rcExhausted;
+}
+
+static
+bool KHttpConnMatches ( const KHttpConn *self, const String *host, uint32_t port )
+{
+    return self -> port == port && self -> host . size == host -> size &&
+        strcase_cmp ( self -> host . addr, self -> host . size,
+                      host -> addr, host -> size, ( uint32_t ) host -> len ) == 0;
+}
+
+rc_t KHttpConnPoolMake ( KHttpConnPool **poolp )
+{
+    rc_t rc;
+    KHttpConnPool *pool = calloc ( 1, sizeof * pool );
+    if ( pool == NULL )
+        rc = RC ( rcNS, rcMgr, rcAllocating, rcMemory, rcExhausted );
+    else
+    {
+        rc = KLockMake ( & pool -> lock );
+        if ( rc == 0 )
+        {
+            DLListInit ( & pool -> idle );
+            pool -> max_idle = DFLT_HTTP_POOL_IDLE;
+            pool -> max_per_host = DFLT_HTTP_POOL_PER_HOST;
+            pool -> idle_secs = DFLT_HTTP_POOL_IDLE_SECS;
+            * poolp = pool;
+            return 0;
+        }
+        free ( pool );
+    }
+
+    * poolp = NULL;
+    return rc;
+}
+
+void KHttpConnPoolWhack ( KHttpConnPool *self )
+{
+    if ( self != NULL )
+    {
+        DLListWhack ( & self -> idle, KHttpConnWhack, NULL );
+        KLockRelease ( self -> lock );
+        free ( self );
+    }
+}
+
+/* Expire
+ *  drop connections idle for too long or beyond the limits,
+ *  oldest first. called with lock held
+ */
+static
+void KHttpConnPoolExpire ( KHttpConnPool *self, uint32_t max_idle )
+{
+    KTime_t now = KTimeStamp ();
+    KHttpConn *c = ( KHttpConn* ) DLListHead ( & self -> idle );
+    while ( c != NULL )
+    {
+        KHttpConn *next = ( KHttpConn* ) DLNodeNext ( & c -> dad );
+        if ( self -> count > max_idle || now - c -> since >= ( KTime_t ) self -> idle_secs )
+        {
+            DLListUnlink ( & self -> idle, & c -> dad );
+            -- self -> count;
+            KHttpConnWhack ( & c -> dad, NULL );
+        }
+        c = next;
+    }
+}
+
+rc_t KHttpConnPoolSetLimits ( KHttpConnPool *self,
+    uint32_t max_idle, uint32_t max_per_host, uint32_t idle_secs )
+{
+    rc_t rc = KLockAcquire ( self -> lock );
+    if ( rc == 0 )
+    {
+        self -> max_idle = max_idle;
+        self -> max_per_host = max_per_host;
+        self -> idle_secs = idle_secs;
+        KHttpConnPoolExpire ( self, max_idle );
+        KLockUnlock ( self -> lock );
+    }
+    return rc;
+}
+
+/* Take
+ *  hand out the most recently returned healthy connection to host:port
+ *  returns rcNotFound if there is none
+ */
+rc_t KHttpConnPoolTake ( KHttpConnPool *self,
+    const String *host, uint32_t port, KStream **sock )
+{
+    rc_t rc;
+
+    * sock = NULL;
+    if ( self == NULL )
+        return RC ( rcNS, rcStream, rcOpening, rcConnection, rcNotFound );
+
+    rc = KLockAcquire ( self -> lock );
+    if ( rc == 0 )
+    {
+        KHttpConn *c;
+
+        KHttpConnPoolExpire ( self, self -> max_idle );
+
+        for ( c = ( KHttpConn* ) DLListTail ( & self -> idle ); c != NULL; )
+        {
+            KHttpConn *prev = ( KHttpConn* ) DLNodePrev ( & c -> dad );
+            if ( KHttpConnMatches ( c, host, port ) )
+            {
+                DLListUnlink ( & self -> idle, & c -> dad );
+                -- self -> count;
+
+                if ( KHttpConnIsHealthy ( c -> sock ) )
+                {
+                    * sock = c -> sock;
+                    free ( c );
+                    break;
+                }
+
+                DBGMSG ( DBG_KNS, DBG_FLAG ( DBG_KNS_HTTP ), ( "KHttpConnPoolTake: dropping stale connection to '%S'\n", host ) );
+                KHttpConnWhack ( & c -> dad, NULL );
+            }
+            c = prev;
+        }
+
+        KLockUnlock ( self -> lock );
+
+        if ( * sock == NULL )
+            rc = RC ( rcNS, rcStream, rcOpening, rcConnection, rcNotFound );
+    }
+
+    return rc;
+}
+
+/* Keep
+ *  take ownership of an idle connection to host:port.
+ *  it is closed if unhealthy or beyond the per-host limit
+ */
+void KHttpConnPoolKeep ( KHttpConnPool *self,
+    const String *host, uint32_t port, KStream *sock )
+{
+    KHttpConn *c = NULL;
+
+    if ( self != NULL && self -> max_idle != 0 && self -> max_per_host != 0 &&
+         KHttpConnIsHealthy ( sock ) && KLockAcquire ( self -> lock ) == 0 )
+    {
+        KHttpConn *oldest = NULL;
+        uint32_t same = 0;
+        for ( c = ( KHttpConn* ) DLListHead ( & self -> idle ); c != NULL;
+              c = ( KHttpConn* ) DLNodeNext ( & c -> dad ) )
+        {
+            if ( KHttpConnMatches ( c, host, port ) && same ++ == 0 )
+                oldest = c;
+        }
+
+        /* make room for the newest */
+        if ( same >= self -> max_per_host )
+        {
+            DLListUnlink ( & self -> idle, & oldest -> dad );
+            -- self -> count;
+            KHttpConnWhack ( & oldest -> dad, NULL );
+        }
+
+        c = malloc ( sizeof * c + host -> size );
+        if ( c != NULL )
+        {
+            string_copy ( c -> host_text, host -> size + 1, host -> addr, host -> size );
+            StringInit ( & c -> host, c -> host_text, host -> size, host -> len );
+            c -> port = port;
+            c -> sock = sock;
+            c -> since = KTimeStamp ();
+            DLListPushTail ( & self -> idle, & c -> dad );
+            ++ self -> count;
+
+            KHttpConnPoolExpire ( self, self -> max_idle );
+        }
+
+        KLockUnlock ( self -> lock );
+    }
+
+    if ( c == NULL )
+        KStreamRelease ( sock );
+}
@@ -51,6 +51,43 @@
 #define MAX_HTTP_WRITE_LIMIT ( 15 * 1000 )
 #endif
 
+/* limits for splitting a KHttpFile read among connections */
+#ifndef MAX_HTTP_READ_CONNECTIONS
+#define MAX_HTTP_READ_CONNECTIONS 16
+#endif
+
+#ifndef MIN_HTTP_READ_CHUNK
+#define MIN_HTTP_READ_CHUNK ( 1024 )
+#endif
+
+#ifndef DFLT_HTTP_READ_CHUNK
+#define DFLT_HTTP_READ_CHUNK ( 1024 * 1024 )
+#endif
+
+/* limits for merging the ranges of a KHttpFile vectored read:
+   the largest gap read through rather than making another request,
+   and the largest merged request */
+#ifndef HTTP_READV_GAP
+#define HTTP_READV_GAP ( 64 * 1024 )
+#endif
+
+#ifndef HTTP_READV_SPAN
+#define HTTP_READV_SPAN ( 16 * 1024 * 1024 )
+#endif
+
+/* default limits for idle keep-alive connections of a manager */
+#ifndef DFLT_HTTP_POOL_IDLE
+#define DFLT_HTTP_POOL_IDLE 32
+#endif
+
+#ifndef DFLT_HTTP_POOL_PER_HOST
+#define DFLT_HTTP_POOL_PER_HOST 4
+#endif
+
+#ifndef DFLT_HTTP_POOL_IDLE_SECS
+#define DFLT_HTTP_POOL_IDLE_SECS 30
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -134,6 +171,30 @@ rc_t KClientHttpMakeRequestInt ( struct KClientHttp const *self,
 extern void SetClientHttpReopenCallback ( struct KStream * (*fn) ( void ) ); 
 #endif
 
+/*--------------------------------------------------------------------------
+ * KHttpConnPool
+ *  idle keep-alive connections shared by the clients of a manager
+ */
+typedef struct KHttpConnPool KHttpConnPool;
+
+rc_t KHttpConnPoolMake ( KHttpConnPool **pool );
+void KHttpConnPoolWhack ( KHttpConnPool *self );
+
+rc_t KHttpConnPoolSetLimits ( KHttpConnPool *self,
+    uint32_t max_idle, uint32_t max_per_host, uint32_t idle_secs );
+
+/* Take
+ *  returns rcNotFound unless a healthy idle connection to host:port exists
+ */
+rc_t KHttpConnPoolTake ( KHttpConnPool *self,
+    struct String const *host, uint32_t port, struct KStream **sock );
+
+/* Keep
+ *  takes ownership of "sock", closing it when it can not be kept
+ */
+void KHttpConnPoolKeep ( KHttpConnPool *self,
+    struct String const *host, uint32_t port, struct KStream *sock );
+
 #ifdef __cplusplus
 }
 #endif
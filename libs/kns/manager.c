@@ -67,6 +67,7 @@ rc_t KNSManagerWhack ( KNSManager * self )
     rc_t rc;
     KConfigRelease ( self -> kfg );
     rc = HttpRetrySpecsDestroy ( & self -> retry_specs );
+    KHttpConnPoolWhack ( self -> conn_pool );
     free ( self );
     KNSManagerCleanup ();
     return rc;
@@ -122,6 +123,8 @@ LIB_EXPORT rc_t CC KNSManagerMakeConfig ( KNSManager **mgrp, KConfig* kfg )
             mgr -> conn_write_timeout = MAX_CONN_WRITE_LIMIT;
             mgr -> http_read_timeout = MAX_HTTP_READ_LIMIT;
             mgr -> http_write_timeout = MAX_HTTP_WRITE_LIMIT;
+            mgr -> http_read_connections = 1;
+            mgr -> http_read_chunk = DFLT_HTTP_READ_CHUNK;
             mgr -> maxTotalWaitForReliableURLs_ms = 10 * 60 * 1000; /* 10 min */
             mgr -> maxNumberOfRetriesOnFailureForReliableURLs = 10;
             mgr -> verbose = false;
@@ -143,8 +146,13 @@ LIB_EXPORT rc_t CC KNSManagerMakeConfig ( KNSManager **mgrp, KConfig* kfg )
                     rc = HttpRetrySpecsInit ( & mgr -> retry_specs, mgr -> kfg );
                     if ( rc == 0 )
                     {
-                        * mgrp = mgr;
-                        return 0;
+                        rc = KHttpConnPoolMake ( & mgr -> conn_pool );
+                        if ( rc == 0 )
+                        {
+                            * mgrp = mgr;
+                            return 0;
+                        }
+                        HttpRetrySpecsDestroy ( & mgr -> retry_specs );
                     }
                     KConfigRelease ( kfg );
                 }
@@ -351,6 +359,52 @@ LIB_EXPORT rc_t CC KNSManagerSetHTTPTimeouts ( KNSManager *self,
 }
 
 
+/* SetHTTPParallelRead
+ *  sets how HTTP files made afterwards split large reads
+ *
+ *  "connections" [ IN ] - number of connections a file may read over
+ *  at once. 0 or 1 keeps to a single connection
+ *
+ *  "chunk_size" [ IN ] - size in bytes of the range requested at
+ *  a time on each connection. 0 selects the default
+ */
+LIB_EXPORT rc_t CC KNSManagerSetHTTPParallelRead ( KNSManager *self,
+    uint32_t connections, size_t chunk_size )
+{
+    if ( self == NULL )
+        return RC ( rcNS, rcMgr, rcUpdating, rcSelf, rcNull );
+
+    /* limit values */
+    if ( connections == 0 )
+        connections = 1;
+    else if ( connections > MAX_HTTP_READ_CONNECTIONS )
+        connections = MAX_HTTP_READ_CONNECTIONS;
+
+    if ( chunk_size == 0 )
+        chunk_size = DFLT_HTTP_READ_CHUNK;
+    else if ( chunk_size < MIN_HTTP_READ_CHUNK )
+        chunk_size = MIN_HTTP_READ_CHUNK;
+
+    self -> http_read_connections = connections;
+    self -> http_read_chunk = chunk_size;
+
+    return 0;
+}
+
+
+/* SetHTTPConnectionPool
+ *  sets limits on idle keep-alive connections kept for reuse
+ */
+LIB_EXPORT rc_t CC KNSManagerSetHTTPConnectionPool ( KNSManager *self,
+    uint32_t max_idle, uint32_t max_per_host, uint32_t idle_secs )
+{
+    if ( self == NULL )
+        return RC ( rcNS, rcMgr, rcUpdating, rcSelf, rcNull );
+
+    return KHttpConnPoolSetLimits ( self -> conn_pool, max_idle, max_per_host, idle_secs );
+}
+
+
 LIB_EXPORT rc_t CC KNSManagerSetUserAgent ( KNSManager * self, const char * fmt, ... )
 {
     /* 6/18/14 - don't check "self", since the current implementation
@@ -45,6 +45,7 @@ extern "C" {
 
 struct KConfig;
 struct HttpRetrySpecs;
+struct KHttpConnPool;
 
 struct KNSManager
 {
@@ -59,6 +60,14 @@ struct KNSManager
     int32_t conn_write_timeout;
     int32_t http_read_timeout;
     int32_t http_write_timeout;
+
+    /* KHttpFile reads spanning at least two chunks
+       are split among this many connections */
+    uint32_t http_read_connections;
+    size_t http_read_chunk;
+
+    /* idle keep-alive connections */
+    struct KHttpConnPool *conn_pool;
     
     uint32_t maxTotalWaitForReliableURLs_ms;
     uint8_t  maxNumberOfRetriesOnFailureForReliableURLs;
@@ -53,6 +53,17 @@
 
 #endif
 
+/* AVX2 evaluators are built with per-function target attributes
+   and chosen at run time, so the library itself needs no special
+   compiler flags and still runs on any SSE2 processor */
+#if INTEL_INTRINSICS && ( defined __x86_64__ || defined __i386__ ) && ! defined __INTEL_COMPILER && \
+    ( defined __clang__ || ( defined __GNUC__ && ( __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) ) ) )
+#include <immintrin.h>
+#define NSS_AVX2 1
+#else
+#define NSS_AVX2 0
+#endif
+
 #if INTEL_INTRINSICS
 
 #if USE_MEMALIGN
@@ -90,6 +101,12 @@ typedef union
 
 static int8_t fasta_2na_map [ 128 ];
 static int8_t fasta_4na_map [ 128 ];
+
+#if NSS_AVX2
+/* set by NucStrstrInit when the processor supports AVX2 */
+static int nss_avx2;
+#endif
+
 static uint16_t expand_2na [ 256 ] =
    /* AAAA    AAAC    AAAG    AAAT    AACA    AACC    AACG    AACT */
 {   0x1111, 0x1112, 0x1114, 0x1118, 0x1121, 0x1122, 0x1124, 0x1128,
@@ -1511,6 +1528,11 @@ void NucStrstrInit ( void )
     for ( i = 0; i < 256; ++ i )
         expand_2na [ i ] = bswap_16 ( expand_2na [ i ] );
 #endif
+
+#if NSS_AVX2
+    __builtin_cpu_init ();
+    nss_avx2 = __builtin_cpu_supports ( "avx2" );
+#endif
 }
 
 /* NucStrstrMake
@@ -2216,6 +2238,11 @@ int eval_2na_8 ( const NucStrFastaExpr *self,
     /* used for shifting buffer, testing exit */
     unsigned int num_passes, stop;
 
+#if qbytes < 16
+    /* leading alignments to discard on the first pass */
+    unsigned int skip;
+#endif
+
     /* kludge for streaming in a byte at a time
        only needed when qbytes > 1 */
 #if qbytes > 1
@@ -2266,6 +2293,12 @@ int eval_2na_8 ( const NucStrFastaExpr *self,
 
     /* for reporting - give a buffer alignment */
     ALIGN_2NA_HEADER ( buffer, pos & ~ 3, len );
+#if qbytes < 16
+    /* only the leading element may begin before "pos",
+       so every alignment of the others must be tested */
+    skip = pos & 3;
+    pos &= ~ 3;
+#endif
     switch ( pos & 3 )
     {
     default:
@@ -2310,6 +2343,19 @@ int eval_2na_8 ( const NucStrFastaExpr *self,
                 /* adjust pos */
                 pos &= ~ 3;
 
+#if qbytes < 16
+                /* drop leading element matches before "pos" */
+                if ( skip != 0 )
+                {
+                    ra &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 1 )
+                        rb &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 2 )
+                        rc &= ~ ( ( 1 << qbytes ) - 1 );
+                    skip = 0;
+                }
+#endif
+
                 /* test for any promising results */
                 if ( ( ra | rb | rc | rd ) != 0 )
                 {
@@ -2509,6 +2555,11 @@ int eval_2na_16 ( const NucStrFastaExpr *self,
     /* used for shifting buffer, testing exit */
     unsigned int num_passes, stop;
 
+#if qbytes < 16
+    /* leading alignments to discard on the first pass */
+    unsigned int skip;
+#endif
+
     /* kludge for streaming in a byte at a time
        only needed when qbytes > 1 */
 #if qbytes > 1
@@ -2559,6 +2610,12 @@ int eval_2na_16 ( const NucStrFastaExpr *self,
 
     /* for reporting - give a buffer alignment */
     ALIGN_2NA_HEADER ( buffer, pos & ~ 3, len );
+#if qbytes < 16
+    /* only the leading element may begin before "pos",
+       so every alignment of the others must be tested */
+    skip = pos & 3;
+    pos &= ~ 3;
+#endif
     switch ( pos & 3 )
     {
     default:
@@ -2603,6 +2660,19 @@ int eval_2na_16 ( const NucStrFastaExpr *self,
                 /* adjust pos */
                 pos &= ~ 3;
 
+#if qbytes < 16
+                /* drop leading element matches before "pos" */
+                if ( skip != 0 )
+                {
+                    ra &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 1 )
+                        rb &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 2 )
+                        rc &= ~ ( ( 1 << qbytes ) - 1 );
+                    skip = 0;
+                }
+#endif
+
                 /* test for any promising results */
                 if ( ( ra | rb | rc | rd ) != 0 )
                 {
@@ -2802,6 +2872,11 @@ int eval_2na_32 ( const NucStrFastaExpr *self,
     /* used for shifting buffer, testing exit */
     unsigned int num_passes, stop;
 
+#if qbytes < 16
+    /* leading alignments to discard on the first pass */
+    unsigned int skip;
+#endif
+
     /* kludge for streaming in a byte at a time
        only needed when qbytes > 1 */
 #if qbytes > 1
@@ -2852,6 +2927,12 @@ int eval_2na_32 ( const NucStrFastaExpr *self,
 
     /* for reporting - give a buffer alignment */
     ALIGN_2NA_HEADER ( buffer, pos & ~ 3, len );
+#if qbytes < 16
+    /* only the leading element may begin before "pos",
+       so every alignment of the others must be tested */
+    skip = pos & 3;
+    pos &= ~ 3;
+#endif
     switch ( pos & 3 )
     {
     default:
@@ -2896,6 +2977,19 @@ int eval_2na_32 ( const NucStrFastaExpr *self,
                 /* adjust pos */
                 pos &= ~ 3;
 
+#if qbytes < 16
+                /* drop leading element matches before "pos" */
+                if ( skip != 0 )
+                {
+                    ra &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 1 )
+                        rb &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 2 )
+                        rc &= ~ ( ( 1 << qbytes ) - 1 );
+                    skip = 0;
+                }
+#endif
+
                 /* test for any promising results */
                 if ( ( ra | rb | rc | rd ) != 0 )
                 {
@@ -3096,6 +3190,11 @@ int eval_2na_64 ( const NucStrFastaExpr *self,
     /* used for shifting buffer, testing exit */
     unsigned int num_passes, stop;
 
+#if qbytes < 16
+    /* leading alignments to discard on the first pass */
+    unsigned int skip;
+#endif
+
     /* kludge for streaming in a byte at a time
        only needed when qbytes > 1 */
 #if qbytes > 1
@@ -3146,6 +3245,12 @@ int eval_2na_64 ( const NucStrFastaExpr *self,
 
     /* for reporting - give a buffer alignment */
     ALIGN_2NA_HEADER ( buffer, pos & ~ 3, len );
+#if qbytes < 16
+    /* only the leading element may begin before "pos",
+       so every alignment of the others must be tested */
+    skip = pos & 3;
+    pos &= ~ 3;
+#endif
     switch ( pos & 3 )
     {
     default:
@@ -3190,6 +3295,19 @@ int eval_2na_64 ( const NucStrFastaExpr *self,
                 /* adjust pos */
                 pos &= ~ 3;
 
+#if qbytes < 16
+                /* drop leading element matches before "pos" */
+                if ( skip != 0 )
+                {
+                    ra &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 1 )
+                        rb &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 2 )
+                        rc &= ~ ( ( 1 << qbytes ) - 1 );
+                    skip = 0;
+                }
+#endif
+
                 /* test for any promising results */
                 if ( ( ra | rb | rc | rd ) != 0 )
                 {
@@ -3389,6 +3507,11 @@ int eval_2na_128 ( const NucStrFastaExpr *self,
     /* used for shifting buffer, testing exit */
     unsigned int num_passes, stop;
 
+#if qbytes < 16
+    /* leading alignments to discard on the first pass */
+    unsigned int skip;
+#endif
+
     /* kludge for streaming in a byte at a time
        only needed when qbytes > 1 */
 #if qbytes > 1
@@ -3439,6 +3562,12 @@ int eval_2na_128 ( const NucStrFastaExpr *self,
 
     /* for reporting - give a buffer alignment */
     ALIGN_2NA_HEADER ( buffer, pos & ~ 3, len );
+#if qbytes < 16
+    /* only the leading element may begin before "pos",
+       so every alignment of the others must be tested */
+    skip = pos & 3;
+    pos &= ~ 3;
+#endif
     switch ( pos & 3 )
     {
     default:
@@ -3483,6 +3612,19 @@ int eval_2na_128 ( const NucStrFastaExpr *self,
                 /* adjust pos */
                 pos &= ~ 3;
 
+#if qbytes < 16
+                /* drop leading element matches before "pos" */
+                if ( skip != 0 )
+                {
+                    ra &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 1 )
+                        rb &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 2 )
+                        rc &= ~ ( ( 1 << qbytes ) - 1 );
+                    skip = 0;
+                }
+#endif
+
                 /* test for any promising results */
                 if ( ( ra | rb | rc | rd ) != 0 )
                 {
@@ -3683,6 +3825,11 @@ int eval_2na_pos ( const NucStrFastaExpr *self,
     /* used for shifting buffer, testing exit */
     unsigned int num_passes, stop;
 
+#if qbytes < 16
+    /* leading alignments to discard on the first pass */
+    unsigned int skip;
+#endif
+
     /* used to hold entry position */
 #if positional
     unsigned int start;
@@ -3743,6 +3890,12 @@ int eval_2na_pos ( const NucStrFastaExpr *self,
 
     /* for reporting - give a buffer alignment */
     ALIGN_2NA_HEADER ( buffer, pos & ~ 3, len );
+#if qbytes < 16
+    /* only the leading element may begin before "pos",
+       so every alignment of the others must be tested */
+    skip = pos & 3;
+    pos &= ~ 3;
+#endif
     switch ( pos & 3 )
     {
     default:
@@ -3787,6 +3940,19 @@ int eval_2na_pos ( const NucStrFastaExpr *self,
                 /* adjust pos */
                 pos &= ~ 3;
 
+#if qbytes < 16
+                /* drop leading element matches before "pos" */
+                if ( skip != 0 )
+                {
+                    ra &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 1 )
+                        rb &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 2 )
+                        rc &= ~ ( ( 1 << qbytes ) - 1 );
+                    skip = 0;
+                }
+#endif
+
                 /* test for any promising results */
                 if ( ( ra | rb | rc | rd ) != 0 )
                 {
@@ -4077,6 +4243,11 @@ int eval_4na_16 ( const NucStrFastaExpr *self,
     /* used for shifting buffer, testing exit */
     unsigned int num_passes, stop;
 
+#if qbytes < 16
+    /* leading alignments to discard on the first pass */
+    unsigned int skip;
+#endif
+
 #if qbytes > 2
     const uint8_t *p;
 #endif
@@ -4121,6 +4292,12 @@ int eval_4na_16 ( const NucStrFastaExpr *self,
 
     /* for reporting - give a buffer alignment */
     ALIGN_4NA_HEADER ( buffer, pos & ~ 3, len );
+#if qbytes < 16
+    /* only the leading element may begin before "pos",
+       so every alignment of the others must be tested */
+    skip = pos & 3;
+    pos &= ~ 3;
+#endif
     switch ( pos & 3 )
     {
     default:
@@ -4169,6 +4346,19 @@ int eval_4na_16 ( const NucStrFastaExpr *self,
                 /* adjust pos */
                 pos &= ~ 3;
 
+#if qbytes < 16
+                /* drop leading element matches before "pos" */
+                if ( skip != 0 )
+                {
+                    ra &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 1 )
+                        rb &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 2 )
+                        rc &= ~ ( ( 1 << qbytes ) - 1 );
+                    skip = 0;
+                }
+#endif
+
                 /* test for any promising results */
                 if ( ( ra | rb | rc | rd ) != 0 )
                 {
@@ -4299,6 +4489,11 @@ int eval_4na_32 ( const NucStrFastaExpr *self,
     /* used for shifting buffer, testing exit */
     unsigned int num_passes, stop;
 
+#if qbytes < 16
+    /* leading alignments to discard on the first pass */
+    unsigned int skip;
+#endif
+
 #if qbytes > 2
     const uint8_t *p;
 #endif
@@ -4343,6 +4538,12 @@ int eval_4na_32 ( const NucStrFastaExpr *self,
 
     /* for reporting - give a buffer alignment */
     ALIGN_4NA_HEADER ( buffer, pos & ~ 3, len );
+#if qbytes < 16
+    /* only the leading element may begin before "pos",
+       so every alignment of the others must be tested */
+    skip = pos & 3;
+    pos &= ~ 3;
+#endif
     switch ( pos & 3 )
     {
     default:
@@ -4391,6 +4592,19 @@ int eval_4na_32 ( const NucStrFastaExpr *self,
                 /* adjust pos */
                 pos &= ~ 3;
 
+#if qbytes < 16
+                /* drop leading element matches before "pos" */
+                if ( skip != 0 )
+                {
+                    ra &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 1 )
+                        rb &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 2 )
+                        rc &= ~ ( ( 1 << qbytes ) - 1 );
+                    skip = 0;
+                }
+#endif
+
                 /* test for any promising results */
                 if ( ( ra | rb | rc | rd ) != 0 )
                 {
@@ -4522,6 +4736,11 @@ int eval_4na_64 ( const NucStrFastaExpr *self,
     /* used for shifting buffer, testing exit */
     unsigned int num_passes, stop;
 
+#if qbytes < 16
+    /* leading alignments to discard on the first pass */
+    unsigned int skip;
+#endif
+
 #if qbytes > 2
     const uint8_t *p;
 #endif
@@ -4566,6 +4785,12 @@ int eval_4na_64 ( const NucStrFastaExpr *self,
 
     /* for reporting - give a buffer alignment */
     ALIGN_4NA_HEADER ( buffer, pos & ~ 3, len );
+#if qbytes < 16
+    /* only the leading element may begin before "pos",
+       so every alignment of the others must be tested */
+    skip = pos & 3;
+    pos &= ~ 3;
+#endif
     switch ( pos & 3 )
     {
     default:
@@ -4614,6 +4839,19 @@ int eval_4na_64 ( const NucStrFastaExpr *self,
                 /* adjust pos */
                 pos &= ~ 3;
 
+#if qbytes < 16
+                /* drop leading element matches before "pos" */
+                if ( skip != 0 )
+                {
+                    ra &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 1 )
+                        rb &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 2 )
+                        rc &= ~ ( ( 1 << qbytes ) - 1 );
+                    skip = 0;
+                }
+#endif
+
                 /* test for any promising results */
                 if ( ( ra | rb | rc | rd ) != 0 )
                 {
@@ -4744,6 +4982,11 @@ int eval_4na_128 ( const NucStrFastaExpr *self,
     /* used for shifting buffer, testing exit */
     unsigned int num_passes, stop;
 
+#if qbytes < 16
+    /* leading alignments to discard on the first pass */
+    unsigned int skip;
+#endif
+
 #if qbytes > 2
     const uint8_t *p;
 #endif
@@ -4788,6 +5031,12 @@ int eval_4na_128 ( const NucStrFastaExpr *self,
 
     /* for reporting - give a buffer alignment */
     ALIGN_4NA_HEADER ( buffer, pos & ~ 3, len );
+#if qbytes < 16
+    /* only the leading element may begin before "pos",
+       so every alignment of the others must be tested */
+    skip = pos & 3;
+    pos &= ~ 3;
+#endif
     switch ( pos & 3 )
     {
     default:
@@ -4836,6 +5085,19 @@ int eval_4na_128 ( const NucStrFastaExpr *self,
                 /* adjust pos */
                 pos &= ~ 3;
 
+#if qbytes < 16
+                /* drop leading element matches before "pos" */
+                if ( skip != 0 )
+                {
+                    ra &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 1 )
+                        rb &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 2 )
+                        rc &= ~ ( ( 1 << qbytes ) - 1 );
+                    skip = 0;
+                }
+#endif
+
                 /* test for any promising results */
                 if ( ( ra | rb | rc | rd ) != 0 )
                 {
@@ -4967,6 +5229,11 @@ int eval_4na_pos ( const NucStrFastaExpr *self,
     /* used for shifting buffer, testing exit */
     unsigned int num_passes, stop;
 
+#if qbytes < 16
+    /* leading alignments to discard on the first pass */
+    unsigned int skip;
+#endif
+
     /* used to hold entry position */
 #if positional
     unsigned int start;
@@ -5021,6 +5288,12 @@ int eval_4na_pos ( const NucStrFastaExpr *self,
 
     /* for reporting - give a buffer alignment */
     ALIGN_4NA_HEADER ( buffer, pos & ~ 3, len );
+#if qbytes < 16
+    /* only the leading element may begin before "pos",
+       so every alignment of the others must be tested */
+    skip = pos & 3;
+    pos &= ~ 3;
+#endif
     switch ( pos & 3 )
     {
     default:
@@ -5069,6 +5342,19 @@ int eval_4na_pos ( const NucStrFastaExpr *self,
                 /* adjust pos */
                 pos &= ~ 3;
 
+#if qbytes < 16
+                /* drop leading element matches before "pos" */
+                if ( skip != 0 )
+                {
+                    ra &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 1 )
+                        rb &= ~ ( ( 1 << qbytes ) - 1 );
+                    if ( skip > 2 )
+                        rc &= ~ ( ( 1 << qbytes ) - 1 );
+                    skip = 0;
+                }
+#endif
+
                 /* test for any promising results */
                 if ( ( ra | rb | rc | rd ) != 0 )
                 {
@@ -5198,6 +5484,224 @@ int eval_4na_pos ( const NucStrFastaExpr *self,
 }
 #endif /* INTEL_INTRINSICS */
 
+#if NSS_AVX2
+/* AVX2 evaluators
+ *  the query patterns are replicated in elements of "qbytes" that
+ *  no alignment ever straddles, so rather than streaming the sequence
+ *  through one 128-bit register a byte at a time, a block of 32 byte
+ *  offsets is tested with one unaligned 256-bit load per byte offset
+ *  within an element. blocks are only taken while every load stays
+ *  within the sequence, and the remainder goes to the SSE evaluator.
+ *
+ *  4na loads expand 16 bytes of 2na into 32 bytes of 4na, so their
+ *  blocks cover 16 byte offsets of the sequence.
+ */
+typedef int ( * nss_eval_f ) ( const NucStrFastaExpr *self,
+    const void *ncbi2na, unsigned int pos, unsigned int len );
+
+__attribute__ ( ( target ( "avx2" ) ) )
+static __inline__
+__m256i nss_load_avx2 ( const uint8_t *src, int na4 )
+{
+    __m256i w, hi, lo, tbl;
+
+    if ( ! na4 )
+        return _mm256_loadu_si256 ( ( const __m256i* ) src );
+
+    /* every 2na nibble is two bases and expands to one byte of
+       4na, ordered as in the byte-swapped expand_2na */
+    tbl = _mm256_setr_epi8 (
+        0x11, 0x12, 0x14, 0x18, 0x21, 0x22, 0x24, 0x28,
+        0x41, 0x42, 0x44, 0x48, ( char ) 0x81, ( char ) 0x82, ( char ) 0x84, ( char ) 0x88,
+        0x11, 0x12, 0x14, 0x18, 0x21, 0x22, 0x24, 0x28,
+        0x41, 0x42, 0x44, 0x48, ( char ) 0x81, ( char ) 0x82, ( char ) 0x84, ( char ) 0x88 );
+
+    w = _mm256_cvtepu8_epi16 ( _mm_loadu_si128 ( ( const __m128i* ) src ) );
+    hi = _mm256_shuffle_epi8 ( tbl, _mm256_srli_epi16 ( w, 4 ) );
+    lo = _mm256_shuffle_epi8 ( tbl, _mm256_and_si256 ( w, _mm256_set1_epi16 ( 0x0F ) ) );
+
+    /* leading bases go into the low byte of each word */
+    return _mm256_or_si256 ( _mm256_and_si256 ( hi, _mm256_set1_epi16 ( 0xFF ) ),
+        _mm256_slli_epi16 ( lo, 8 ) );
+}
+
+__attribute__ ( ( target ( "avx2" ) ) )
+static __inline__
+__m256i nss_match_avx2 ( __m256i buffer, __m256i p, __m256i m,
+    unsigned int qbytes, int na4 )
+{
+    __m256i ri, rj;
+
+    if ( na4 )
+    {
+        ri = _mm256_and_si256 ( buffer, p );
+        rj = _mm256_and_si256 ( buffer, m );
+    }
+    else
+    {
+        ri = _mm256_and_si256 ( buffer, m );
+        rj = p;
+    }
+
+    switch ( qbytes )
+    {
+    case 1:
+        return _mm256_cmpeq_epi8 ( ri, rj );
+    case 2:
+        return _mm256_cmpeq_epi16 ( ri, rj );
+    case 4:
+        return _mm256_cmpeq_epi32 ( ri, rj );
+    case 8:
+        return _mm256_cmpeq_epi64 ( ri, rj );
+    }
+
+    /* both halves of a 16 byte element must match */
+    ri = _mm256_cmpeq_epi64 ( ri, rj );
+    return _mm256_and_si256 ( ri, _mm256_shuffle_epi32 ( ri, 0x4E ) );
+}
+
+/* one bit per matching element of a byte mask */
+static __inline__
+uint32_t nss_elements ( uint32_t bits, unsigned int qbytes )
+{
+    switch ( qbytes )
+    {
+    case 1:
+        return bits;
+    case 2:
+        return bits & 0x55555555;
+    case 4:
+        return bits & 0x11111111;
+    case 8:
+        return bits & 0x01010101;
+    }
+    return bits & 0x00010001;
+}
+
+__attribute__ ( ( always_inline, target ( "avx2" ) ) )
+static __inline__
+int eval_avx2 ( const NucStrFastaExpr *self, const void *ncbi2na,
+    unsigned int pos, unsigned int len, unsigned int qbytes,
+    int na4, int positional, nss_eval_f tail )
+{
+    __m256i p [ 4 ], m [ 4 ];
+    unsigned int a, k, b, start, stop, end, block, loads, first;
+    const uint8_t *seq = ncbi2na;
+    int found;
+
+    /* this test is performed outside */
+    assert ( len >= self -> size );
+
+    /* same limits as the SSE evaluators */
+    len += pos;
+    start = pos;
+    stop = len - self -> size;
+    end = ( len + 3 ) >> 2;
+
+    /* byte offsets tested per block and the loads covering them */
+    block = na4 ? 16 : 32;
+    loads = na4 ? qbytes / 2 : qbytes;
+
+    for ( a = 0; a < 4; ++ a )
+    {
+        p [ a ] = _mm256_broadcastsi128_si256 ( _mm_load_si128 (
+            ( const __m128i* ) self -> query [ a ] . pattern . b ) );
+        m [ a ] = _mm256_broadcastsi128_si256 ( _mm_load_si128 (
+            ( const __m128i* ) self -> query [ a ] . mask . b ) );
+    }
+
+    for ( b = pos >> 2; b + loads - 1 + block <= end && ( b << 2 ) <= stop; b += block )
+    {
+        __m256i hits = _mm256_setzero_si256 ();
+        for ( k = 0; k < loads; ++ k )
+        {
+            __m256i buffer = nss_load_avx2 ( seq + b + k, na4 );
+            for ( a = 0; a < 4; ++ a )
+                hits = _mm256_or_si256 ( hits, nss_match_avx2 ( buffer, p [ a ], m [ a ], qbytes, na4 ) );
+        }
+
+        if ( _mm256_testz_si256 ( hits, hits ) )
+            continue;
+
+        /* find the first match within range, since the block may
+           start before "pos" and run past "stop" */
+        for ( found = 0, first = 0, k = 0; k < loads; ++ k )
+        {
+            __m256i buffer = nss_load_avx2 ( seq + b + k, na4 );
+            for ( a = 0; a < 4; ++ a )
+            {
+                uint32_t bits = nss_elements ( ( uint32_t ) _mm256_movemask_epi8 (
+                    nss_match_avx2 ( buffer, p [ a ], m [ a ], qbytes, na4 ) ), qbytes );
+                for ( ; bits != 0; bits &= bits - 1 )
+                {
+                    unsigned int off = uint32_lsbit ( bits );
+                    unsigned int at = ( ( b + k + ( na4 ? off >> 1 : off ) ) << 2 ) + a;
+                    if ( at >= start && at <= stop && ( ! found || at < first ) )
+                    {
+                        found = 1;
+                        first = at;
+                    }
+                }
+            }
+        }
+
+        if ( found )
+            return positional ? ( int ) ( first - start + 1 ) : 1;
+    }
+
+    /* hand the tail to the SSE evaluator */
+    pos = b << 2;
+    if ( pos < start )
+        pos = start;
+    if ( pos > stop )
+        return 0;
+
+    /* the SSE code is not VEX encoded and would pay
+       for the dirty upper halves on every instruction */
+    _mm256_zeroupper ();
+
+    found = ( * tail ) ( self, ncbi2na, pos, len - pos );
+    if ( positional && found != 0 )
+        found += pos - start;
+    return found;
+}
+
+#define NSS_EVAL_AVX2( type, qbytes, na4, positional )                  \
+__attribute__ ( ( target ( "avx2" ) ) )                                 \
+static                                                                  \
+int eval_ ## type ## _avx2 ( const NucStrFastaExpr *self,              \
+    const void *ncbi2na, unsigned int pos, unsigned int len )           \
+{                                                                       \
+    return eval_avx2 ( self, ncbi2na, pos, len,                         \
+        qbytes, na4, positional, eval_ ## type );                       \
+}
+
+NSS_EVAL_AVX2 ( 2na_8, 1, 0, 0 )
+NSS_EVAL_AVX2 ( 2na_16, 2, 0, 0 )
+NSS_EVAL_AVX2 ( 2na_32, 4, 0, 0 )
+NSS_EVAL_AVX2 ( 2na_64, 8, 0, 0 )
+NSS_EVAL_AVX2 ( 2na_128, 16, 0, 0 )
+NSS_EVAL_AVX2 ( 2na_pos, 16, 0, 1 )
+NSS_EVAL_AVX2 ( 4na_16, 2, 1, 0 )
+NSS_EVAL_AVX2 ( 4na_32, 4, 1, 0 )
+NSS_EVAL_AVX2 ( 4na_64, 8, 1, 0 )
+NSS_EVAL_AVX2 ( 4na_128, 16, 1, 0 )
+NSS_EVAL_AVX2 ( 4na_pos, 16, 1, 1 )
+
+#undef NSS_EVAL_AVX2
+
+/* AVX2 when selected by NucStrstrInit */
+#define NSS_EVAL( type, self, ncbi2na, pos, len ) \
+    ( nss_avx2 ? eval_ ## type ## _avx2 ( self, ncbi2na, pos, len ) : \
+      eval_ ## type ( self, ncbi2na, pos, len ) )
+
+#else
+
+#define NSS_EVAL( type, self, ncbi2na, pos, len ) \
+    eval_ ## type ( self, ncbi2na, pos, len )
+
+#endif /* NSS_AVX2 */
+
 
 /* NucStrstrSearch
  *  search buffer from starting position
@@ -5226,49 +5730,49 @@ LIB_EXPORT int CC NucStrstrSearch ( const NucStrstr *self,
         case type_2na_64:
             if ( len < self -> fasta . size ) return 0;
 	    if(selflen) *selflen=self -> fasta . size;
-            return eval_2na_64 ( & self -> fasta, ncbi2na, pos, len );
+            return NSS_EVAL ( 2na_64, & self -> fasta, ncbi2na, pos, len );
         case type_4na_64:
             if ( len < self -> fasta . size ) return 0;
 	    if(selflen) *selflen=self -> fasta . size;
-            return eval_4na_64 ( & self -> fasta, ncbi2na, pos, len );
+            return NSS_EVAL ( 4na_64, & self -> fasta, ncbi2na, pos, len );
 #if INTEL_INTRINSICS
         case type_2na_8:
             if ( len < self -> fasta . size ) return 0;
 	    if(selflen) *selflen=self -> fasta . size;
-            return eval_2na_8 ( & self -> fasta, ncbi2na, pos, len );
+            return NSS_EVAL ( 2na_8, & self -> fasta, ncbi2na, pos, len );
         case type_2na_16:
             if ( len < self -> fasta . size ) return 0;
 	    if(selflen) *selflen=self -> fasta . size;
-            return eval_2na_16 ( & self -> fasta, ncbi2na, pos, len );
+            return NSS_EVAL ( 2na_16, & self -> fasta, ncbi2na, pos, len );
         case type_2na_32:
             if ( len < self -> fasta . size ) return 0;
 	    if(selflen) *selflen=self -> fasta . size;
-            return eval_2na_32 ( & self -> fasta, ncbi2na, pos, len );
+            return NSS_EVAL ( 2na_32, & self -> fasta, ncbi2na, pos, len );
         case type_2na_128:
             if ( len < self -> fasta . size ) return 0;
 	    if(selflen) *selflen=self -> fasta . size;
-            return eval_2na_128 ( & self -> fasta, ncbi2na, pos, len );
+            return NSS_EVAL ( 2na_128, & self -> fasta, ncbi2na, pos, len );
         case type_4na_16:
             if ( len < self -> fasta . size ) return 0;
 	    if(selflen) *selflen=self -> fasta . size;
-            return eval_4na_16 ( & self -> fasta, ncbi2na, pos, len );
+            return NSS_EVAL ( 4na_16, & self -> fasta, ncbi2na, pos, len );
         case type_4na_32:
             if ( len < self -> fasta . size ) return 0;
 	    if(selflen) *selflen=self -> fasta . size;
-            return eval_4na_32 ( & self -> fasta, ncbi2na, pos, len );
+            return NSS_EVAL ( 4na_32, & self -> fasta, ncbi2na, pos, len );
         case type_4na_128:
             if ( len < self -> fasta . size ) return 0;
 	    if(selflen) *selflen=self -> fasta . size;
-            return eval_4na_128 ( & self -> fasta, ncbi2na, pos, len );
+            return NSS_EVAL ( 4na_128, & self -> fasta, ncbi2na, pos, len );
 #endif
         case type_2na_pos:
             if ( len < self -> fasta . size ) return 0;
 	    if(selflen) *selflen=self -> fasta . size;
-            return eval_2na_pos ( & self -> fasta, ncbi2na, pos, len );
+            return NSS_EVAL ( 2na_pos, & self -> fasta, ncbi2na, pos, len );
         case type_4na_pos:
             if ( len < self -> fasta . size ) return 0;
 	    if(selflen) *selflen=self -> fasta . size;
-            return eval_4na_pos ( & self -> fasta, ncbi2na, pos, len );
+            return NSS_EVAL ( 4na_pos, & self -> fasta, ncbi2na, pos, len );
         case type_OP:
             found = NucStrstrSearch ( self -> boolean . left, ncbi2na, pos, len, selflen);
             switch ( self -> boolean . op )
@@ -69,24 +69,26 @@ struct BlobHeaders;
 struct VProduction;
 struct VBlobPageMapCache;
 
-typedef struct PageMapProcessRequest{
-    struct PageMap *pm;        /**** deserialized form **/
-    KDataBuffer data;   /**** serialized   form **/
-    uint32_t    row_count;
-    uint64_t    elem_count;
-    rc_t rc;            /**** results **/
-
-    volatile enum {
-        ePMPR_STATE_NONE=0,
-        ePMPR_STATE_SERIALIZE_REQUESTED,
-        ePMPR_STATE_DESERIALIZE_REQUESTED,
-        ePMPR_STATE_SERIALIZE_DONE,
-        ePMPR_STATE_DESERIALIZE_DONE,
-	ePMPR_STATE_EXIT
-    } state;            /**** request state      **/
-    struct KLock      *lock;
-    struct KCondition *cond;
-} PageMapProcessRequest;
+struct PageMapProcessRequest;
+struct String;
+
+/*--------------------------------------------------------------------------
+ * PageMapProcessPool
+ *  manager-wide pool of threads deserializing page maps
+ *  while blob data are being decoded. each request belongs
+ *  to a blob until its page map is resolved.
+ */
+typedef struct PageMapProcessPool PageMapProcessPool;
+
+/* Make
+ *  start "num_threads" workers
+ */
+rc_t PageMapProcessPoolMake ( PageMapProcessPool **pool, uint32_t num_threads );
+
+/* Release
+ *  the pool stays alive while requests are outstanding
+ */
+void PageMapProcessPoolRelease ( PageMapProcessPool *self );
 
 
 /*--------------------------------------------------------------------------
@@ -100,6 +102,7 @@ struct VBlob
     struct PageMap *pm;
     struct BlobHeaders *headers;
     struct VBlobPageMapCache *spmc; /* cache for split */
+    struct PageMapProcessRequest *pmpr; /* "pm" while it is being deserialized */
     KDataBuffer data;
     KRefcount refcount;
 
@@ -152,7 +155,7 @@ rc_t VBlobCreateFromData(
                          int64_t start_id, int64_t stop_id,
                          const KDataBuffer *src,
                          uint32_t elem_bits,
-			 PageMapProcessRequest const *pmpr
+                         PageMapProcessPool *pool
 );
 
 rc_t VBlobCreateFromSingleRow(
@@ -176,7 +179,13 @@ rc_t VBlobSubblob( const struct VBlob *self,struct VBlob **sub, int64_t start_id
 
 void VBlobPageMapOptimize( struct VBlob **self );
 
-#define LAST_BLOB_CACHE_SIZE 256
+/* recently used blobs kept per column for lookup without a search */
+#define LAST_BLOB_CACHE_DEPTH 2
+#define LAST_BLOB_CACHE_MAX_DEPTH 64
+
+/* blobs of fewer rows come from regrouping or single-row productions,
+   are cheap to rebuild and would only churn the caches */
+#define CACHE_MIN_BLOB_ROWS 5
 
 
 typedef struct VBlobMRUCache VBlobMRUCache; /** forward declaration **/
@@ -187,17 +196,153 @@ typedef  struct VBlobMRUCacheCursorContext {  /** to be used to pass cache conte
 
 VBlobMRUCache * VBlobMRUCacheMake(uint64_t capacity );
 void VBlobMRUCacheDestroy( VBlobMRUCache *self );
+/* Find
+ *  returns a new reference to the blob containing "row_id", or NULL
+ */
 const VBlob* VBlobMRUCacheFind(const VBlobMRUCache *cself, uint32_t col_idx, int64_t row_id);
 rc_t VBlobMRUCacheSave(const VBlobMRUCache *cself, uint32_t col_idx, const VBlob *blob);
 
+/* Hit
+ *  Find for reading a cell, counting the hit under the same lock.
+ *  while the cache is used by a single thread, the blob is kept alive
+ *  by the column's slots of recently used blobs and no reference is
+ *  taken; otherwise "*ref" is set and the caller owns a new reference
+ */
+const VBlob* VBlobMRUCacheHit(const VBlobMRUCache *cself, uint32_t col_idx, int64_t row_id, bool *ref);
+
+/* Contains
+ *  whether a blob containing "row_id" is cached, leaving
+ *  the order of recently used blobs and the LRU as they are
+ */
+bool VBlobMRUCacheContains(const VBlobMRUCache *cself, uint32_t col_idx, int64_t row_id);
+
+/* Reserve
+ *  size the per-column slots of recently used blobs for
+ *  "columns" VDB and "phys_columns" physical columns up front;
+ *  slots for columns beyond are added on first use
+ */
+rc_t VBlobMRUCacheReserve ( VBlobMRUCache *self, uint32_t columns, uint32_t phys_columns );
+
+/* SetDepth
+ *  number of recently used blobs kept per column, 1 .. LAST_BLOB_CACHE_MAX_DEPTH
+ */
+rc_t VBlobMRUCacheSetDepth ( VBlobMRUCache *self, uint32_t depth );
+
 uint64_t VBlobMRUCacheGetCapacity(const VBlobMRUCache *cself);
 uint64_t VBlobMRUCacheSetCapacity(VBlobMRUCache *self,uint64_t capacity );
 
 void VBlobMRUCacheSuspendFlush(VBlobMRUCache *self);
 void VBlobMRUCacheResumeFlush (VBlobMRUCache *self);
 
+/* EnableLocking
+ *  serialize Find and Save so that blobs may be published
+ *  from background threads; cannot be turned off again
+ */
+rc_t VBlobMRUCacheEnableLocking ( VBlobMRUCache *self );
+
+/* Pin
+ *  remember a blob obtained from a VBlobSharedCache as last used
+ *  for "col_idx" without charging it against capacity, for as long
+ *  as it remains the most recent blob of the column;
+ *  takes over the caller's reference
+ */
+void VBlobMRUCachePin ( const VBlobMRUCache *self, uint32_t col_idx, const VBlob *blob );
+
+/* RecordHit
+ * RecordMiss
+ *  account for a cursor read of "col_idx" served from a cached blob,
+ *  or one that had to decode "blob" taking "decode_ns"
+ */
+void VBlobMRUCacheRecordHit ( const VBlobMRUCache *self, uint32_t col_idx );
+void VBlobMRUCacheRecordMiss ( const VBlobMRUCache *self, uint32_t col_idx,
+    const VBlob *blob, uint64_t decode_ns );
+
+/* GetStats
+ *  "col_idx" is 0 for totals
+ */
+struct VCursorCacheStats;
+rc_t VBlobMRUCacheGetStats ( const VBlobMRUCache *self, uint32_t col_idx,
+    struct VCursorCacheStats *stats );
 
-rc_t PageMapProcessGetPagemap(const PageMapProcessRequest *self,struct PageMap **pm);
+
+/*--------------------------------------------------------------------------
+ * VBlobCacheBudget
+ *  memory that adaptive VBlobMRUCaches may borrow on top of
+ *  their base capacities, shared through the manager
+ */
+typedef struct VBlobCacheBudget VBlobCacheBudget;
+
+rc_t VBlobCacheBudgetMake ( VBlobCacheBudget **budget, size_t limit );
+void VBlobCacheBudgetDestroy ( VBlobCacheBudget *self );
+void VBlobCacheBudgetSetLimit ( VBlobCacheBudget *self, size_t limit );
+
+/* SetAdaptive
+ *  let the capacity of "self" grow from and shrink back to "budget",
+ *  starting from its current capacity. NULL returns what was borrowed
+ *  and restores that capacity. the budget must outlive the cache
+ */
+rc_t VBlobMRUCacheSetAdaptive ( VBlobMRUCache *self, VBlobCacheBudget *budget );
+
+
+/*--------------------------------------------------------------------------
+ * VBlobSharedCache
+ *  decoded blobs shared by all read cursors of a manager, across threads,
+ *  under a single byte budget. entries are keyed by ( table, column,
+ *  start_id ). a table key stands for the underlying KTable read through
+ *  a given table schema, so every VTable opened on the same path shares
+ *  it; keys are serial numbers handed out by TableKey and held until the
+ *  last VTable using one calls ReleaseTable, since the KTable's address
+ *  may be reused once it is freed. the column key is the column's
+ *  context id within the table schema.
+ */
+typedef struct VBlobSharedCache VBlobSharedCache;
+
+rc_t VBlobSharedCacheMake ( VBlobSharedCache **cache, size_t capacity );
+void VBlobSharedCacheDestroy ( VBlobSharedCache *self );
+void VBlobSharedCacheSetCapacity ( VBlobSharedCache *self, size_t capacity );
+
+/* TableKey
+ *  returns the key of a table, attaching "*key" to the key of
+ *  ( "ktbl", "name", "vers" ) if it is 0
+ */
+uint64_t VBlobSharedCacheTableKey ( VBlobSharedCache *self, const void *ktbl,
+    struct String const *name, uint32_t vers, uint64_t *key );
+
+/* Find
+ *  returns a new reference to a cached blob holding "row_id", or NULL
+ */
+const VBlob * VBlobSharedCacheFind ( VBlobSharedCache *self,
+    uint64_t tbl, uint64_t col, int64_t row_id );
+
+/* Claim
+ *  called after a miss, with the id range [ first, last ] of the page
+ *  expected to hold "row_id". waits while another thread decodes an
+ *  overlapping page: if that produced the row, "blob" receives a new
+ *  reference to it. otherwise "blob" is NULL and the range is claimed
+ *  for the caller, who must decode it and end the claim with Publish
+ */
+rc_t VBlobSharedCacheClaim ( VBlobSharedCache *self, uint64_t tbl, uint64_t col,
+    int64_t row_id, int64_t first, int64_t last, const VBlob **blob );
+
+/* Publish
+ *  end the claim starting at "first", caching "blob" unless NULL,
+ *  and wake any threads waiting on it
+ */
+void VBlobSharedCachePublish ( VBlobSharedCache *self, uint64_t tbl, uint64_t col,
+    int64_t first, const VBlob *blob );
+
+/* ReleaseTable
+ *  detach a VTable from its table key, forgetting all blobs
+ *  of the table once no VTable uses it
+ */
+void VBlobSharedCacheReleaseTable ( VBlobSharedCache *self, uint64_t tbl );
+
+
+/* ResolvePageMap
+ *  make "pm" available, waiting for a background request if needed.
+ *  the blob must not yet be visible to other threads.
+ */
+rc_t VBlobResolvePageMap ( const VBlob *self );
 
 
 #ifdef __cplusplus
@@ -42,13 +42,17 @@
 #include <kdb/btree.h>
 #include <vdb/schema.h>
 #include <vdb/xform.h>
+#include <vdb/cursor.h>
 #include <klib/log.h>
+#include <klib/time.h>
 #include <sysalloc.h>
 #include <bitstr.h>
 
 #include <kproc/timeout.h>
 #include <kproc/lock.h>
 #include <kproc/cond.h>
+#include <kproc/thread.h>
+#include <klib/refcount.h>
 
 #include <assert.h>
 #include <stdlib.h>
@@ -91,6 +95,7 @@ rc_t VBlobNew ( VBlob **lhs, int64_t start_id, int64_t stop_id, const char *name
         y->pm = NULL;
         y->headers = NULL;
         y->spmc = NULL;
+        y->pmpr = NULL;
         memset(&y->data, 0, sizeof(y->data));
         y->no_cache = 0;
         strcpy(&(((char *)y->name)[0]), name);
@@ -119,7 +124,14 @@ rc_t VBlobNewAsArray(struct VBlob **lhs, int64_t start_id, int64_t stop_id, uint
 	return rc;
 }
 
+static rc_t PageMapProcessRequestFinish ( struct PageMapProcessRequest *req, bool wanted, struct PageMap **pm );
+
 static rc_t VBlobDestroy( VBlob *that ) {
+    if (that->pmpr) {
+        struct PageMap *pm = NULL;
+        PageMapProcessRequestFinish(that->pmpr, false, &pm);
+        PageMapRelease(pm);
+    }
     if (that->spmc) {
         int i;
         
@@ -375,69 +387,246 @@ static rc_t encode_header_v2(
     return 0;
 }
 
+/*--------------------------------------------------------------------------
+ * PageMapProcessPool
+ */
+enum
+{
+    ePMPR_STATE_QUEUED,
+    ePMPR_STATE_RUNNING,
+    ePMPR_STATE_DONE
+};
+
+typedef struct PageMapProcessRequest PageMapProcessRequest;
+struct PageMapProcessRequest
+{
+    DLNode dad;
+    PageMapProcessPool *pool;
+    struct PageMap *pm;         /**** deserialized form **/
+    KDataBuffer data;           /**** serialized   form **/
+    uint32_t row_count;
+    rc_t rc;                    /**** results **/
+    uint8_t state;
+};
+
+struct PageMapProcessPool
+{
+    KLock *lock;
+    KCondition *work;           /**** requests queued or exit **/
+    KCondition *done;           /**** requests completed **/
+    DLList queue;
+    KThread **threads;
+    uint32_t num_threads;
+    KRefcount refcount;
+    bool exit;
+};
+
 static
-rc_t PageMapProcessRequestLock(PageMapProcessRequest *self)
+rc_t CC run_pagemap_thread ( const KThread *t, void *data )
 {
-	rc_t rc=RC(rcVDB,rcPagemap, rcConstructing, rcSelf, rcNull);
-	if(self){
-		/*** no plans to wait here the thread should be released by now ****/
-		rc = KLockAcquire(self->lock);
-		if(rc == 0){
-			if(self->state != ePMPR_STATE_NONE){ /*** thread is not released yet **/
-				assert(0); /** should not happen ***/
-				KLockUnlock(self->lock);
-				rc=RC(rcVDB, rcPagemap, rcConstructing, rcThread, rcBusy);
-			}
-		}
-	}
-	return rc;
+    PageMapProcessPool *self = data;
+    rc_t rc = KLockAcquire ( self -> lock );
+    if ( rc == 0 )
+    {
+        while ( ! self -> exit )
+        {
+            PageMapProcessRequest *req = ( PageMapProcessRequest* ) DLListPopHead ( & self -> queue );
+            if ( req == NULL )
+            {
+                rc = KConditionWait ( self -> work, self -> lock );
+                if ( rc != 0 )
+                    break;
+                continue;
+            }
+
+            req -> state = ePMPR_STATE_RUNNING;
+            KLockUnlock ( self -> lock );
+
+            /* rows are expanded lazily as they are looked up */
+            req -> rc = PageMapDeserialize ( & req -> pm, req -> data . base, req -> data . elem_count, req -> row_count );
+
+            rc = KLockAcquire ( self -> lock );
+            if ( rc != 0 )
+                break;
+            req -> state = ePMPR_STATE_DONE;
+            KConditionBroadcast ( self -> done );
+        }
+        KLockUnlock ( self -> lock );
+    }
+    return rc;
 }
 
 static
-void PageMapProcessRequestLaunch(PageMapProcessRequest *self)
-{
-	KConditionSignal ( self -> cond );
-	KLockUnlock(self -> lock);
-}
-
-rc_t PageMapProcessGetPagemap(const PageMapProcessRequest *cself,struct PageMap **pm)
-{
-	rc_t rc=RC(rcVDB,rcPagemap, rcConstructing, rcSelf, rcNull);
-        if(cself){
-	    PageMapProcessRequest *self=(PageMapProcessRequest*)cself;
-	    if(self->lock == NULL){
-		/** NOT LOCKABLE **/
-		rc=0;
-	    } else if((rc = KLockAcquire ( self->lock ))==0){
-CHECK_AGAIN:
-		switch(self->state){
-		 case ePMPR_STATE_DESERIALIZE_REQUESTED:
-			/*fprintf(stderr,"Waiting for pagemap %p\n",cself->lock);*/
-			rc = KConditionWait ( self -> cond, self -> lock );
-                        goto CHECK_AGAIN;
-		 case ePMPR_STATE_DESERIALIZE_DONE:
-			assert(self->pm);
-			/*fprintf(stderr,"Pagemap %p Used R:%6d|DR:%d|LR:%d\n",self->lock, self->pm->row_count,self->pm->data_recs,self->pm->leng_recs);*/
-			*pm=self->pm;
-			self->pm = NULL;
-			KDataBufferWhack(&self->data);
-			self->row_count = 0;
-			self->state = ePMPR_STATE_NONE;
-			KConditionSignal(self->cond);
-			KLockUnlock(self -> lock);
-			break;
-		case ePMPR_STATE_NONE: /* not requested */
-			KLockUnlock(self -> lock);
-		    rc = 0;
-		    break;
-		 default: /** should never happen ***/
-			assert(0);
-			KLockUnlock(self -> lock);
-			return RC(rcVDB, rcPagemap, rcConverting, rcParam, rcInvalid );
-		}
-	    }
+void PageMapProcessPoolWhack ( PageMapProcessPool *self )
+{
+    uint32_t i;
+
+    if ( KLockAcquire ( self -> lock ) == 0 )
+    {
+        self -> exit = true;
+        KConditionBroadcast ( self -> work );
+        KLockUnlock ( self -> lock );
+    }
+
+    for ( i = 0; i < self -> num_threads; ++ i )
+    {
+        KThreadWait ( self -> threads [ i ], NULL );
+        KThreadRelease ( self -> threads [ i ] );
+    }
+
+    /* every request holds a reference */
+    assert ( DLListHead ( & self -> queue ) == NULL );
+
+    KConditionRelease ( self -> done );
+    KConditionRelease ( self -> work );
+    KLockRelease ( self -> lock );
+    free ( self -> threads );
+    free ( self );
+}
+
+rc_t PageMapProcessPoolMake ( PageMapProcessPool **poolp, uint32_t num_threads )
+{
+    rc_t rc;
+    PageMapProcessPool *pool;
+
+    assert ( poolp != NULL );
+    assert ( num_threads > 0 );
+
+    pool = calloc ( 1, sizeof * pool );
+    if ( pool == NULL )
+        return RC ( rcVDB, rcPagemap, rcConstructing, rcMemory, rcExhausted );
+
+    pool -> threads = calloc ( num_threads, sizeof pool -> threads [ 0 ] );
+    if ( pool -> threads == NULL )
+    {
+        free ( pool );
+        return RC ( rcVDB, rcPagemap, rcConstructing, rcMemory, rcExhausted );
+    }
+
+    DLListInit ( & pool -> queue );
+    KRefcountInit ( & pool -> refcount, 1, "PageMapProcessPool", "make", "pmpool" );
+
+    rc = KLockMake ( & pool -> lock );
+    if ( rc == 0 )
+        rc = KConditionMake ( & pool -> work );
+    if ( rc == 0 )
+        rc = KConditionMake ( & pool -> done );
+    for ( ; rc == 0 && pool -> num_threads < num_threads; ++ pool -> num_threads )
+        rc = KThreadMake ( & pool -> threads [ pool -> num_threads ], run_pagemap_thread, pool );
+
+    if ( rc == 0 )
+    {
+        * poolp = pool;
+        return 0;
+    }
+
+    PageMapProcessPoolWhack ( pool );
+    * poolp = NULL;
+    return rc;
+}
+
+void PageMapProcessPoolRelease ( PageMapProcessPool *self )
+{
+    if ( self != NULL )
+    {
+        switch ( KRefcountDrop ( & self -> refcount, "PageMapProcessPool" ) )
+        {
+        case krefWhack:
+            PageMapProcessPoolWhack ( self );
+            break;
         }
-        return rc;
+    }
+}
+
+/* Submit
+ *  queue deserialization of the page map found in "data"
+ */
+static
+rc_t PageMapProcessPoolSubmit ( PageMapProcessPool *self, VBlob *blob,
+    const KDataBuffer *data, uint32_t offset, uint32_t size )
+{
+    rc_t rc;
+    PageMapProcessRequest *req = calloc ( 1, sizeof * req );
+    if ( req == NULL )
+        return RC ( rcVDB, rcPagemap, rcConstructing, rcMemory, rcExhausted );
+
+    rc = KDataBufferSub ( data, & req -> data, offset, size );
+    if ( rc == 0 )
+    {
+        rc = KLockAcquire ( self -> lock );
+        if ( rc == 0 )
+        {
+            KRefcountAdd ( & self -> refcount, "PageMapProcessPool" );
+            req -> pool = self;
+            req -> row_count = BlobRowCount ( blob );
+            req -> state = ePMPR_STATE_QUEUED;
+            DLListPushTail ( & self -> queue, & req -> dad );
+            KConditionSignal ( self -> work );
+            KLockUnlock ( self -> lock );
+
+            blob -> pmpr = req;
+            return 0;
+        }
+        KDataBufferWhack ( & req -> data );
+    }
+    free ( req );
+    return rc;
+}
+
+/* Finish
+ *  collect the result of a request, taking it over from the
+ *  queue when no worker got to it. when the page map is no
+ *  longer "wanted", a queued request is simply dropped.
+ */
+static
+rc_t PageMapProcessRequestFinish ( PageMapProcessRequest *req, bool wanted, struct PageMap **pm )
+{
+    PageMapProcessPool *pool = req -> pool;
+    rc_t rc = KLockAcquire ( pool -> lock );
+    if ( rc == 0 )
+    {
+        bool steal = req -> state == ePMPR_STATE_QUEUED;
+        if ( steal )
+        {
+            DLListUnlink ( & pool -> queue, & req -> dad );
+            req -> state = ePMPR_STATE_RUNNING;
+        }
+        else
+        {
+            while ( rc == 0 && req -> state != ePMPR_STATE_DONE )
+                rc = KConditionWait ( pool -> done, pool -> lock );
+        }
+        KLockUnlock ( pool -> lock );
+
+        if ( rc == 0 )
+        {
+            if ( steal && wanted )
+                req -> rc = PageMapDeserialize ( & req -> pm, req -> data . base, req -> data . elem_count, req -> row_count );
+            rc = req -> rc;
+            * pm = req -> pm;
+
+            KDataBufferWhack ( & req -> data );
+            free ( req );
+            PageMapProcessPoolRelease ( pool );
+        }
+    }
+    return rc;
+}
+
+rc_t VBlobResolvePageMap ( const VBlob *cself )
+{
+    PageMapProcessRequest *req;
+    VBlob *self = ( VBlob* ) cself;
+
+    if ( self == NULL )
+        return RC ( rcVDB, rcBlob, rcAccessing, rcSelf, rcNull );
+    if ( self -> pmpr == NULL )
+        return 0;
+
+    assert ( self -> pm == NULL );
+    req = self -> pmpr;
+    self -> pmpr = NULL;
+    return PageMapProcessRequestFinish ( req, true, & self -> pm );
 }
 
 
@@ -446,7 +635,7 @@ rc_t VBlobCreateFromData_v2(
                             VBlob **lhs,
                             const KDataBuffer *data,
                             int64_t start_id, int64_t stop_id,
-                            uint32_t elem_bits, PageMapProcessRequest *pmpr
+                            uint32_t elem_bits, PageMapProcessPool *pool
 ) {
     uint64_t ssize = data->elem_count;
     uint32_t hsize;
@@ -484,14 +673,7 @@ rc_t VBlobCreateFromData_v2(
             rc = BlobHeadersCreateFromData(&y->headers, src+offset , hsize);
         if (rc == 0) {
             if (msize > 0) {
-                if(PageMapProcessRequestLock(pmpr)==0) {
-                    KDataBufferSub(data, &pmpr->data, pagemap_offset, msize);
-                    pmpr->row_count = BlobRowCount(y);
-                    pmpr->state = ePMPR_STATE_DESERIALIZE_REQUESTED;
-                    /*fprintf(stderr,"Pagemap %p Requested R:%6d|SZ:%d|%ld:%ld\n",pmpr->lock, pmpr->row_count,msize,start_id, stop_id);*/
-                    PageMapProcessRequestLaunch(pmpr);
-                }
-                else {
+                if (pool == NULL || PageMapProcessPoolSubmit(pool, y, data, pagemap_offset, msize) != 0) {
                     KDataBuffer tdata;
                     KDataBufferSub(data, &tdata, pagemap_offset, msize);
                     rc = PageMapDeserialize(&y->pm, tdata.base,tdata.elem_count, BlobRowCount(y));
@@ -936,7 +1118,7 @@ rc_t VBlobSerialize ( const VBlob *self, KDataBuffer *result ) {
 rc_t VBlobCreateFromData ( struct VBlob **lhs,
                          int64_t start_id, int64_t stop_id,
                          const KDataBuffer *src,
-                         uint32_t elem_bits , PageMapProcessRequest const *pmpr)
+                         uint32_t elem_bits , PageMapProcessPool *pool)
 {
     VBlob *y = NULL;
     rc_t rc;
@@ -951,7 +1133,7 @@ rc_t VBlobCreateFromData ( struct VBlob **lhs,
     if ((((const uint8_t *)src->base)[0] & 0x80) == 0)
         rc = VBlobCreateFromData_v1(&y, src, start_id, stop_id, elem_bits);
     else
-        rc = VBlobCreateFromData_v2(&y, src, start_id, stop_id, elem_bits, (PageMapProcessRequest*)pmpr);
+        rc = VBlobCreateFromData_v2(&y, src, start_id, stop_id, elem_bits, pool);
 
     if (rc == 0)
         *lhs = y;
@@ -1374,6 +1556,20 @@ rc_t VBlobCacheWhack (uint64_t start_id, const void *n, void *ignore )
     return 0;
 }
 
+/* memory held by a blob, for cache accounting */
+static
+size_t VBlobCacheBytes ( const VBlob *blob )
+{
+    size_t bytes = sizeof ( VBlob ) + KDataBufferBytes ( & blob -> data );
+    if ( blob -> pm != NULL )
+    {
+        bytes += KDataBufferBytes ( & blob -> pm -> cstorage )
+            + KDataBufferBytes ( & blob -> pm -> dstorage )
+            + KDataBufferBytes ( & blob -> pm -> istorage );
+    }
+    return bytes;
+}
+
 static
 rc_t VBlobCacheMake ( VBlobCache **bcp, const VBlob *blob, uint32_t col_idx, size_t blob_size )
 {
@@ -1389,11 +1585,110 @@ rc_t VBlobCacheMake ( VBlobCache **bcp, const VBlob *blob, uint32_t col_idx, siz
     return 0;
 }
 
+/* most recently used blobs of each column, "depth" per column
+   and most recent first, so that the common case needs no search */
 typedef struct VBlobLast {
-	const VBlob *b1;
-	const VBlob *b2;
+	const VBlob **blobs;
+	uint32_t count; /* columns */
 } VBlobLast;
 
+/*--------------------------------------------------------------------------
+ * VBlobCacheBudget
+ */
+struct VBlobCacheBudget
+{
+    KLock *lock;
+    size_t limit;
+    size_t used;
+};
+
+rc_t VBlobCacheBudgetMake ( VBlobCacheBudget **budgetp, size_t limit )
+{
+    rc_t rc;
+    VBlobCacheBudget *budget = malloc ( sizeof * budget );
+    if ( budget == NULL )
+        return RC ( rcVDB, rcCursor, rcConstructing, rcMemory, rcExhausted );
+
+    rc = KLockMake ( & budget -> lock );
+    if ( rc != 0 )
+    {
+        free ( budget );
+        return rc;
+    }
+
+    budget -> limit = limit;
+    budget -> used = 0;
+    * budgetp = budget;
+    return 0;
+}
+
+void VBlobCacheBudgetDestroy ( VBlobCacheBudget *self )
+{
+    if ( self != NULL )
+    {
+        KLockRelease ( self -> lock );
+        free ( self );
+    }
+}
+
+void VBlobCacheBudgetSetLimit ( VBlobCacheBudget *self, size_t limit )
+{
+    if ( self != NULL && KLockAcquire ( self -> lock ) == 0 )
+    {
+        self -> limit = limit;
+        KLockUnlock ( self -> lock );
+    }
+}
+
+/* Borrow
+ *  grants up to "bytes", as far as the limit allows
+ */
+static
+size_t VBlobCacheBudgetBorrow ( VBlobCacheBudget *self, size_t bytes )
+{
+    size_t granted = 0;
+    if ( KLockAcquire ( self -> lock ) == 0 )
+    {
+        if ( self -> used < self -> limit )
+        {
+            granted = self -> limit - self -> used;
+            if ( granted > bytes )
+                granted = bytes;
+            self -> used += granted;
+        }
+        KLockUnlock ( self -> lock );
+    }
+    return granted;
+}
+
+static
+void VBlobCacheBudgetReturn ( VBlobCacheBudget *self, size_t bytes )
+{
+    if ( bytes != 0 && KLockAcquire ( self -> lock ) == 0 )
+    {
+        assert ( self -> used >= bytes );
+        self -> used -= bytes;
+        KLockUnlock ( self -> lock );
+    }
+}
+
+
+/*--------------------------------------------------------------------------
+ * VBlobMRUCache
+ */
+
+/* blobs recently evicted by an adaptive cache; a blob found here
+   when it is saved again tells how much more capacity would have kept it */
+#define MRU_GHOST_COUNT 64
+/* saves without such a blob after which an adaptive cache gives back memory */
+#define MRU_ADAPT_WINDOW 256
+
+typedef struct VBlobGhost {
+    int64_t start_id;
+    uint64_t evicted_at; /* evicted_bytes of cache after this blob was dropped */
+    uint32_t col_idx;
+} VBlobGhost;
+
 struct VBlobMRUCache { /* read-only blob cache */
     Vector v_cache; /*** cache VDB columns ***/
     Vector p_cache; /*** cache physical columns ***/
@@ -1401,8 +1696,23 @@ struct VBlobMRUCache { /* read-only blob cache */
     size_t capacity;
     size_t contents;
     /* last blob cache */
-    VBlobLast v_last[LAST_BLOB_CACHE_SIZE]; /** last blob to be cached per given col_idx, limiting col_idx  **/
-    VBlobLast p_last[LAST_BLOB_CACHE_SIZE]; /** last physical blob to be cached per given col_idx, limiting col_idx  **/
+    VBlobLast v_last; /** last blobs to be cached per given col_idx **/
+    VBlobLast p_last; /** last physical blobs to be cached per given col_idx **/
+    uint32_t depth;
+    /* optional lock when blobs are published from other threads */
+    KLock *lock;
+    /* statistics, in total and per VDB column */
+    VCursorCacheStats stats;
+    VCursorCacheStats *col_stats;
+    uint32_t col_stats_count;
+    /* adaptive capacity, if budget is set */
+    VBlobCacheBudget *budget;
+    size_t base_capacity;
+    size_t borrowed;
+    uint64_t evicted_bytes;
+    uint32_t quiet_saves;
+    uint32_t ghost_next;
+    VBlobGhost ghosts[MRU_GHOST_COUNT];
 	bool suspend_flush;
 };
 
@@ -1416,16 +1726,37 @@ VBlobMRUCache * VBlobMRUCacheMake(uint64_t capacity )
 		VectorInit ( & self -> v_cache, 1, 16);
 		VectorInit ( & self -> p_cache, 1, 16);
 		DLListInit ( & self -> lru );
-		memset(self -> v_last,0,LAST_BLOB_CACHE_SIZE*sizeof(*self -> v_last));
-		memset(self -> p_last,0,LAST_BLOB_CACHE_SIZE*sizeof(*self -> p_last));
+		memset(&self -> v_last,0,sizeof self -> v_last);
+		memset(&self -> p_last,0,sizeof self -> p_last);
+		self->depth = LAST_BLOB_CACHE_DEPTH;
 		self->capacity = capacity;
 		self->contents = 0;
+		self->lock = NULL;
+		memset(&self->stats,0,sizeof self->stats);
+		self->col_stats = NULL;
+		self->col_stats_count = 0;
+		self->budget = NULL;
+		self->base_capacity = capacity;
+		self->borrowed = 0;
+		self->evicted_bytes = 0;
+		self->quiet_saves = 0;
+		self->ghost_next = 0;
+		memset(self->ghosts,0,sizeof self->ghosts);
 		self->suspend_flush = false;
 	}
    }
    return self;
 }
 
+rc_t VBlobMRUCacheEnableLocking ( VBlobMRUCache *self )
+{
+    if ( self == NULL )
+        return RC ( rcVDB, rcCursor, rcUpdating, rcSelf, rcNull );
+    if ( self -> lock != NULL )
+        return 0;
+    return KLockMake ( & self -> lock );
+}
+
 void VBlobMRUCacheItemDestroy( void *item, void *data )
 {
     if ( item != NULL ) {
@@ -1435,19 +1766,172 @@ void VBlobMRUCacheItemDestroy( void *item, void *data )
 }
 
 
+static
+void VBlobLastWhack ( VBlobLast *self, uint32_t depth )
+{
+    uint32_t i;
+    for ( i = 0; i < self -> count * depth; ++ i )
+        VBlobRelease ( ( VBlob* ) self -> blobs [ i ] );
+    free ( self -> blobs );
+    self -> blobs = NULL;
+    self -> count = 0;
+}
+
+/* Get
+ *  returns the slots of 1-based "col_idx", or NULL if there are
+ *  none yet and "grow" is false or memory is exhausted
+ */
+static
+const VBlob ** VBlobLastGet ( VBlobLast *self, uint32_t depth, uint32_t col_idx, bool grow )
+{
+    if ( col_idx > self -> count )
+    {
+        uint32_t count = col_idx + 16;
+        const VBlob **blobs;
+
+        if ( ! grow )
+            return NULL;
+
+        blobs = realloc ( self -> blobs, ( size_t ) count * depth * sizeof * blobs );
+        if ( blobs == NULL )
+            return NULL;
+        memset ( blobs + ( size_t ) self -> count * depth, 0,
+            ( size_t ) ( count - self -> count ) * depth * sizeof * blobs );
+        self -> blobs = blobs;
+        self -> count = count;
+    }
+    return self -> blobs + ( size_t ) ( col_idx - 1 ) * depth;
+}
+
+/* Find
+ *  looks for a blob containing "row_id", making it the most recent
+ */
+static
+const VBlob * VBlobLastFind ( const VBlob **slots, uint32_t depth, int64_t row_id )
+{
+    uint32_t i;
+    for ( i = 0; i < depth && slots [ i ] != NULL; ++ i )
+    {
+        const VBlob *blob = slots [ i ];
+        if ( row_id >= blob -> start_id && row_id <= blob -> stop_id )
+        {
+            if ( i != 0 )
+            {
+                memmove ( slots + 1, slots, i * sizeof * slots );
+                slots [ 0 ] = blob;
+            }
+            return blob;
+        }
+    }
+    return NULL;
+}
+
+/* Push
+ *  makes "blob" the most recent, taking over a reference
+ */
+static
+void VBlobLastPush ( const VBlob **slots, uint32_t depth, const VBlob *blob )
+{
+    if ( slots [ depth - 1 ] != NULL )
+        VBlobRelease ( ( VBlob* ) slots [ depth - 1 ] );
+    memmove ( slots + 1, slots, ( depth - 1 ) * sizeof * slots );
+    slots [ 0 ] = blob;
+}
+
+/* Drop
+ *  releases "blob" from all but the most recent slot, keeping
+ *  the others in order. the most recent blob of a column stays,
+ *  since cells handed out for the current row point into it
+ */
+static
+void VBlobLastDrop ( const VBlob **slots, uint32_t depth, const VBlob *blob )
+{
+    uint32_t i;
+    for ( i = 1; i < depth && slots [ i ] != NULL; ++ i )
+    {
+        if ( slots [ i ] == blob )
+        {
+            VBlobRelease ( ( VBlob* ) blob );
+            memmove ( slots + i, slots + i + 1, ( depth - i - 1 ) * sizeof * slots );
+            slots [ depth - 1 ] = NULL;
+            break;
+        }
+    }
+}
+
+rc_t VBlobMRUCacheReserve ( VBlobMRUCache *self, uint32_t columns, uint32_t phys_columns )
+{
+    rc_t rc = 0;
+
+    if ( self == NULL )
+        return RC ( rcVDB, rcCursor, rcResizing, rcSelf, rcNull );
+
+    if ( self -> lock != NULL )
+    {
+        rc = KLockAcquire ( self -> lock );
+        if ( rc != 0 )
+            return rc;
+    }
+
+    if ( ( columns != 0 && VBlobLastGet ( & self -> v_last, self -> depth, columns, true ) == NULL ) ||
+         ( phys_columns != 0 && VBlobLastGet ( & self -> p_last, self -> depth, phys_columns, true ) == NULL ) )
+        rc = RC ( rcVDB, rcCursor, rcResizing, rcMemory, rcExhausted );
+
+    if ( self -> lock != NULL )
+        KLockUnlock ( self -> lock );
+
+    return rc;
+}
+
+rc_t VBlobMRUCacheSetDepth ( VBlobMRUCache *self, uint32_t depth )
+{
+    rc_t rc = 0;
+
+    if ( self == NULL )
+        return RC ( rcVDB, rcCursor, rcUpdating, rcSelf, rcNull );
+    if ( depth == 0 || depth > LAST_BLOB_CACHE_MAX_DEPTH )
+        return RC ( rcVDB, rcCursor, rcUpdating, rcParam, rcInvalid );
+
+    if ( self -> lock != NULL )
+    {
+        rc = KLockAcquire ( self -> lock );
+        if ( rc != 0 )
+            return rc;
+    }
+
+    if ( depth != self -> depth )
+    {
+        uint32_t columns = self -> v_last . count;
+        uint32_t phys_columns = self -> p_last . count;
+
+        /* blobs are still found in the cache proper */
+        VBlobLastWhack ( & self -> v_last, self -> depth );
+        VBlobLastWhack ( & self -> p_last, self -> depth );
+        self -> depth = depth;
+
+        if ( ( columns != 0 && VBlobLastGet ( & self -> v_last, depth, columns, true ) == NULL ) ||
+             ( phys_columns != 0 && VBlobLastGet ( & self -> p_last, depth, phys_columns, true ) == NULL ) )
+            rc = RC ( rcVDB, rcCursor, rcUpdating, rcMemory, rcExhausted );
+    }
+
+    if ( self -> lock != NULL )
+        KLockUnlock ( self -> lock );
+
+    return rc;
+}
+
 void VBlobMRUCacheDestroy( VBlobMRUCache *self )
 {
     if(self){
-	int i;
 	VectorWhack ( & self -> v_cache, VBlobMRUCacheItemDestroy, NULL );
 	VectorWhack ( & self -> p_cache, VBlobMRUCacheItemDestroy, NULL );
 	DLListInit ( & self -> lru );
-	for(i=0;i<LAST_BLOB_CACHE_SIZE;i++){
-	    VBlobRelease(self -> p_last[i].b1);
-	    VBlobRelease(self -> p_last[i].b2);
-	    VBlobRelease(self -> v_last[i].b1);
-	    VBlobRelease(self -> v_last[i].b2);
-	}
+	VBlobLastWhack ( & self -> p_last, self -> depth );
+	VBlobLastWhack ( & self -> v_last, self -> depth );
+	if(self->budget)
+	    VBlobCacheBudgetReturn(self->budget,self->borrowed);
+	free(self->col_stats);
+	KLockRelease(self->lock);
 	free(self);
     }
 }
@@ -1467,48 +1951,79 @@ static VBlobCache * find_in_kvector(const KVector *cself,int64_t id)
 	return NULL;
 }
 
-const VBlob* VBlobMRUCacheFind(const VBlobMRUCache *cself, uint32_t col_idx, int64_t row_id)
+/* Unslot
+ *  a blob leaving the cache must not stay alive in the slots
+ *  of its column, where it would escape the capacity
+ */
+static
+void VBlobMRUCacheUnslot(VBlobMRUCache *self, const VBlobCache *bc)
+{
+    const VBlob **slots;
+    if(bc->col_idx > PHYSPROD_INDEX_OFFSET)
+	slots = VBlobLastGet(&self->p_last,self->depth,bc->col_idx-PHYSPROD_INDEX_OFFSET,false);
+    else
+	slots = VBlobLastGet(&self->v_last,self->depth,bc->col_idx,false);
+    if(slots)
+	VBlobLastDrop(slots,self->depth,bc->blob);
+}
+
+/* Demoted
+ *  after the most recent slot changed hands, releases the blob
+ *  it held unless the cache still accounts for it
+ */
+static
+void VBlobMRUCacheDemoted(VBlobMRUCache *self, const KVector *cache, const VBlob **slots)
+{
+    const VBlob *blob = self->depth > 1 ? slots[1] : NULL;
+    if(blob){
+	VBlobCache *bc = NULL;
+	if(cache == NULL || KVectorGetPtr(cache,blob->start_id,(void**)&bc) != 0 || bc == NULL || bc->blob != blob)
+	    VBlobLastDrop(slots,self->depth,blob);
+    }
+}
+
+static
+const VBlob* VBlobMRUCacheFindInt(const VBlobMRUCache *cself, uint32_t col_idx, int64_t row_id)
 {
     VBlobMRUCache *self = (VBlobMRUCache*)cself;
     const VBlob* blob;
+    const VBlob **slots;
     KVector  *cache;
     bool    is_phys=false;
     VBlobLast   *last_blobs;
 
     if(col_idx > PHYSPROD_INDEX_OFFSET){
 	is_phys=true;
-	last_blobs = self->p_last;
+	last_blobs = &self->p_last;
 	col_idx -= PHYSPROD_INDEX_OFFSET;
     } else {
 	is_phys=false;
-	last_blobs = self->v_last;
+	last_blobs = &self->v_last;
     } 
 
-    if(col_idx <= LAST_BLOB_CACHE_SIZE){
-	blob = last_blobs[col_idx-1].b1;
-	if(blob && row_id >= blob->start_id && row_id <= blob->stop_id){
-		return blob;
-	}
-	blob = last_blobs[col_idx-1].b2;
-	if(blob && row_id >= blob->start_id && row_id <= blob->stop_id){
-		last_blobs[col_idx-1].b2 = last_blobs[col_idx-1].b1;
-		last_blobs[col_idx-1].b1 = blob;
+    cache = is_phys?VectorGet(&cself->p_cache,col_idx):VectorGet(&cself->v_cache,col_idx);
+    slots = VBlobLastGet(last_blobs,self->depth,col_idx,false);
+    if(slots){
+	const VBlob *recent = slots[0];
+	blob = VBlobLastFind(slots,self->depth,row_id);
+	if(blob){
+		if(slots[0] != recent)
+			VBlobMRUCacheDemoted(self,cache,slots);
 		return blob;
 	}
     }
-    cache = is_phys?VectorGet(&cself->p_cache,col_idx):VectorGet(&cself->v_cache,col_idx);
     if(cache) {
 	    /* check cache for entry */
 	    VBlobCache *bc = find_in_kvector ( cache, row_id );
 	    if ( bc != NULL )
 	    {
 		/* save in MRU */
-		if(col_idx <= LAST_BLOB_CACHE_SIZE) {
-			if(last_blobs[col_idx-1].b2) VBlobRelease(last_blobs[col_idx-1].b2);
-			last_blobs[col_idx-1].b2 = last_blobs[col_idx-1].b1;
-			last_blobs[col_idx-1].b1 = bc->blob;
+		slots = VBlobLastGet(last_blobs,self->depth,col_idx,true);
+		if(slots) {
 			if(VBlobAddRef ((VBlob*)bc->blob)!=0)
 				return NULL;
+			VBlobLastPush(slots,self->depth,bc->blob);
+			VBlobMRUCacheDemoted(self,cache,slots);
 		}
 		/* maintain LRU */
 		DLListUnlink  (&self->lru,&bc->ln);
@@ -1528,6 +2043,8 @@ static rc_t  insert_unique_into_kvector(VBlobMRUCache *self,KVector *cache,int64
 		assert(existing[0]->blob->start_id == bc->blob->start_id);
 		if(existing[0]->blob->stop_id < bc->blob->stop_id){/** new blob is bigger - replace with ned blob **/
 			DLListUnlink  (&self->lru,&(existing[0]->ln));
+			self -> contents -= existing[0]->size;
+			VBlobMRUCacheUnslot(self, existing[0]);
 			VBlobCacheWhack (existing[0]->blob->start_id, existing[0], NULL );
 		} else {
 			return RC ( rcVDB, rcVector, rcInserting, rcBlob, rcExists );
@@ -1537,26 +2054,155 @@ static rc_t  insert_unique_into_kvector(VBlobMRUCache *self,KVector *cache,int64
 }
 
 
-rc_t VBlobMRUCacheSave(const VBlobMRUCache *cself, uint32_t col_idx, const VBlob *blob)
+const VBlob* VBlobMRUCacheFind(const VBlobMRUCache *cself, uint32_t col_idx, int64_t row_id)
+{
+    const VBlob *blob;
+
+    if ( cself -> lock != NULL && KLockAcquire ( cself -> lock ) != 0 )
+        return NULL;
+
+    /* the reference is taken under the lock, before another
+       thread saving into the cache gets a chance to evict it */
+    blob = VBlobMRUCacheFindInt ( cself, col_idx, row_id );
+    if ( blob != NULL && VBlobAddRef ( ( VBlob* ) blob ) != 0 )
+        blob = NULL;
+
+    if ( cself -> lock != NULL )
+        KLockUnlock ( cself -> lock );
+
+    return blob;
+}
+
+bool VBlobMRUCacheContains(const VBlobMRUCache *cself, uint32_t col_idx, int64_t row_id)
+{
+    VBlobMRUCache *self = (VBlobMRUCache*)cself;
+    const VBlob **slots;
+    const KVector *cache;
+    bool found = false;
+
+    if ( self -> lock != NULL && KLockAcquire ( self -> lock ) != 0 )
+        return false;
+
+    if(col_idx > PHYSPROD_INDEX_OFFSET){
+	col_idx -= PHYSPROD_INDEX_OFFSET;
+	slots = VBlobLastGet(&self->p_last,self->depth,col_idx,false);
+	cache = VectorGet(&self->p_cache,col_idx);
+    } else {
+	slots = VBlobLastGet(&self->v_last,self->depth,col_idx,false);
+	cache = VectorGet(&self->v_cache,col_idx);
+    }
+    if(slots){
+	uint32_t i;
+	for(i = 0; i < self->depth && slots[i] != NULL && !found; ++i)
+	    found = row_id >= slots[i]->start_id && row_id <= slots[i]->stop_id;
+    }
+    if(!found && cache)
+	found = find_in_kvector(cache,row_id) != NULL;
+
+    if ( self -> lock != NULL )
+        KLockUnlock ( self -> lock );
+
+    return found;
+}
+
+static
+VCursorCacheStats * VBlobMRUCacheColStats(VBlobMRUCache *self, uint32_t col_idx)
+{
+    if(col_idx == 0 || col_idx > PHYSPROD_INDEX_OFFSET)
+	return NULL;
+    if(col_idx > self->col_stats_count){
+	uint32_t count = col_idx + 16;
+	VCursorCacheStats *col_stats = realloc(self->col_stats, count * sizeof *col_stats);
+	if(col_stats == NULL)
+	    return NULL;
+	memset(col_stats + self->col_stats_count, 0, (count - self->col_stats_count) * sizeof *col_stats);
+	self->col_stats = col_stats;
+	self->col_stats_count = count;
+    }
+    return &self->col_stats[col_idx-1];
+}
+
+/* Adapt
+ *  called for every blob saved by an adaptive cache before accounting
+ */
+static
+void VBlobMRUCacheAdapt(VBlobMRUCache *self, uint32_t col_idx, const VBlob *blob, size_t blob_size)
+{
+    size_t want = 0;
+    uint32_t i;
+
+    for(i=0;i<MRU_GHOST_COUNT;i++){
+	VBlobGhost *g = &self->ghosts[i];
+	if(g->col_idx == col_idx && g->start_id == blob->start_id){
+	    /* everything evicted since, plus the blob itself, would have had to fit */
+	    want = (size_t)(self->evicted_bytes - g->evicted_at) + blob_size;
+	    g->col_idx = 0;
+	    break;
+	}
+    }
+
+    /* at most double per step */
+    if(want > self->capacity)
+	want = self->capacity;
+    /* and make room for a blob larger than all of it */
+    if(blob_size > self->capacity && blob_size - self->capacity > want)
+	want = blob_size - self->capacity;
+
+    if(want > 0){
+	size_t granted = VBlobCacheBudgetBorrow(self->budget, want);
+	self->capacity += granted;
+	self->borrowed += granted;
+	self->quiet_saves = 0;
+    } else if(++self->quiet_saves >= MRU_ADAPT_WINDOW){
+	size_t give = self->capacity / 8;
+	if(give > self->borrowed)
+	    give = self->borrowed;
+	self->capacity -= give;
+	self->borrowed -= give;
+	VBlobCacheBudgetReturn(self->budget, give);
+	self->quiet_saves = 0;
+    }
+}
+
+static
+void VBlobMRUCacheEvicted(VBlobMRUCache *self, const VBlobCache *bc)
+{
+    VCursorCacheStats *cs = VBlobMRUCacheColStats(self, bc->col_idx);
+
+    ++self->stats.evictions;
+    if(cs)
+	++cs->evictions;
+    self->evicted_bytes += bc->size;
+
+    if(self->budget){
+	VBlobGhost *g = &self->ghosts[self->ghost_next];
+	g->col_idx = bc->col_idx;
+	g->start_id = bc->blob->start_id;
+	g->evicted_at = self->evicted_bytes;
+	self->ghost_next = (self->ghost_next + 1) % MRU_GHOST_COUNT;
+    }
+}
+
+static
+rc_t VBlobMRUCacheSaveInt(const VBlobMRUCache *cself, uint32_t col_idx, const VBlob *blob)
 {
     rc_t   rc;
-    size_t blob_size =sizeof(VBlobCache) + sizeof(VBlob);
+    size_t blob_size;
     VBlobCache *bc=NULL;
     VBlobMRUCache *self = (VBlobMRUCache*)cself;
 
     if(blob->no_cache) return 0;
 
-    blob_size  += KDataBufferBytes(&blob->data);
-    if (blob->pm != NULL) {
-        blob_size += 
-                  KDataBufferBytes(&blob->pm->cstorage)
-                + KDataBufferBytes(&blob->pm->dstorage)
-                + KDataBufferBytes(&blob->pm->istorage);
+    blob_size = sizeof(VBlobCache) + VBlobCacheBytes(blob);
+    if(self -> budget != NULL)
+	VBlobMRUCacheAdapt(self, col_idx, blob, blob_size);
+    /* an exhausted budget must not leave a blob that empties the cache on
+       every save: raise the capacity outside of the budget, as without one */
+    if(blob_size > self -> capacity) {
+	/** auto-raise capacity for large blob **/
+	self -> capacity = blob_size;
+	++self -> stats.raises;
     }
-    /** auto-raise capacity for large blob **/
-    if(blob_size > self -> capacity) self -> capacity = blob_size;
-
-    
 
     /* now cache the blob */
     rc = VBlobCacheMake ( & bc, blob, col_idx, blob_size );
@@ -1567,7 +2213,7 @@ rc_t VBlobMRUCacheSave(const VBlobMRUCache *cself, uint32_t col_idx, const VBlob
         VBlobLast   *last_blobs;
 
 	if(col_idx > PHYSPROD_INDEX_OFFSET){
-		last_blobs = self->p_last;
+		last_blobs = &self->p_last;
 		col_idx -= PHYSPROD_INDEX_OFFSET;
 		cache = VectorGet(&cself->p_cache,col_idx);
 		if(cache==NULL){
@@ -1575,7 +2221,7 @@ rc_t VBlobMRUCacheSave(const VBlobMRUCache *cself, uint32_t col_idx, const VBlob
 			VectorSet(&self->p_cache,col_idx,cache);
 		}
 	} else {
-		last_blobs = self->v_last;
+		last_blobs = &self->v_last;
 		cache = VectorGet(&cself->v_cache,col_idx);
 		if(cache==NULL){
 			KVectorMake(&cache);
@@ -1589,13 +2235,13 @@ rc_t VBlobMRUCacheSave(const VBlobMRUCache *cself, uint32_t col_idx, const VBlob
 			rc = 0;
 		} else {
 				/* remember as last used  **/
-			if(col_idx <= LAST_BLOB_CACHE_SIZE) {
-				if(last_blobs[col_idx-1].b2) VBlobRelease(last_blobs[col_idx-1].b2);
-				last_blobs[col_idx-1].b2 = last_blobs[col_idx-1].b1;
-				last_blobs[col_idx-1].b1 = bc->blob;
+			const VBlob **slots = VBlobLastGet(last_blobs,self->depth,col_idx,true);
+			if(slots) {
 				rc = VBlobAddRef ((VBlob*)bc->blob);
 				if(rc != 0)
 				   return rc;
+				VBlobLastPush(slots,self->depth,bc->blob);
+				VBlobMRUCacheDemoted(self,cache,slots);
 			}
 			/* perform accounting */
 			self -> contents += blob_size;
@@ -1614,6 +2260,8 @@ rc_t VBlobMRUCacheSave(const VBlobMRUCache *cself, uint32_t col_idx, const VBlob
 				}
 				KVectorUnset(cache,existing->blob->start_id);
 				self -> contents -= existing -> size;
+				VBlobMRUCacheEvicted(self, existing);
+				VBlobMRUCacheUnslot(self, existing);
 				VBlobCacheWhack (existing->blob->start_id,existing,NULL);
 			}
 			/* insert at head of list */
@@ -1623,6 +2271,52 @@ rc_t VBlobMRUCacheSave(const VBlobMRUCache *cself, uint32_t col_idx, const VBlob
     return 0;
 }
 
+rc_t VBlobMRUCacheSave(const VBlobMRUCache *cself, uint32_t col_idx, const VBlob *blob)
+{
+    rc_t rc;
+
+    if ( cself -> lock == NULL )
+        return VBlobMRUCacheSaveInt ( cself, col_idx, blob );
+
+    rc = KLockAcquire ( cself -> lock );
+    if ( rc == 0 )
+    {
+        rc = VBlobMRUCacheSaveInt ( cself, col_idx, blob );
+        KLockUnlock ( cself -> lock );
+    }
+
+    return rc;
+}
+
+void VBlobMRUCachePin(const VBlobMRUCache *cself, uint32_t col_idx, const VBlob *blob)
+{
+    VBlobMRUCache *self = (VBlobMRUCache*)cself;
+    const VBlob **slots;
+
+    if ( self -> lock != NULL && KLockAcquire ( self -> lock ) != 0 )
+    {
+        VBlobRelease ( ( VBlob* ) blob );
+        return;
+    }
+
+    slots = VBlobLastGet ( & self -> v_last, self -> depth, col_idx, true );
+    if ( slots != NULL )
+    {
+        /* counted by the shared cache rather than this one */
+        VBlobLastPush ( slots, self -> depth, blob );
+        VBlobMRUCacheDemoted ( self, VectorGet ( & self -> v_cache, col_idx ), slots );
+    }
+    else
+    {
+        /* no slot to pin to, fall back to caching it here as well */
+        VBlobMRUCacheSaveInt ( self, col_idx, blob );
+        VBlobRelease ( ( VBlob* ) blob );
+    }
+
+    if ( self -> lock != NULL )
+        KLockUnlock ( self -> lock );
+}
+
 uint64_t VBlobMRUCacheGetCapacity(const VBlobMRUCache *cself)
 {
 	if(cself){
@@ -1634,18 +2328,819 @@ uint64_t VBlobMRUCacheSetCapacity(VBlobMRUCache *self,uint64_t capacity )
 {
 	uint64_t old_capacity=0;
 	if(self){
+		if(self->lock != NULL && KLockAcquire(self->lock) != 0)
+			return 0;
 		old_capacity = self->capacity;
 		self->capacity=capacity;
+		/* an explicit capacity becomes the new base */
+		self->base_capacity=capacity;
+		if(self->budget){
+			VBlobCacheBudgetReturn(self->budget,self->borrowed);
+			self->borrowed=0;
+		}
+		if(self->lock != NULL)
+			KLockUnlock(self->lock);
 	}
 	return old_capacity;
 }
+
+rc_t VBlobMRUCacheSetAdaptive(VBlobMRUCache *self, VBlobCacheBudget *budget)
+{
+    rc_t rc = 0;
+
+    if ( self == NULL )
+        return RC ( rcVDB, rcCursor, rcUpdating, rcSelf, rcNull );
+
+    if ( self -> lock != NULL )
+    {
+        rc = KLockAcquire ( self -> lock );
+        if ( rc != 0 )
+            return rc;
+    }
+
+    if ( self -> budget != NULL )
+    {
+        VBlobCacheBudgetReturn ( self -> budget, self -> borrowed );
+        self -> capacity = self -> base_capacity;
+        self -> borrowed = 0;
+    }
+
+    self -> budget = budget;
+    self -> base_capacity = self -> capacity;
+    self -> quiet_saves = 0;
+    memset ( self -> ghosts, 0, sizeof self -> ghosts );
+
+    if ( self -> lock != NULL )
+        KLockUnlock ( self -> lock );
+
+    return rc;
+}
+
+static
+void VBlobMRUCacheCountHit(VBlobMRUCache *self, uint32_t col_idx)
+{
+    VCursorCacheStats *cs;
+
+    ++ self -> stats . hits;
+    cs = VBlobMRUCacheColStats ( self, col_idx );
+    if ( cs != NULL )
+        ++ cs -> hits;
+}
+
+void VBlobMRUCacheRecordHit(const VBlobMRUCache *cself, uint32_t col_idx)
+{
+    VBlobMRUCache *self = (VBlobMRUCache*)cself;
+
+    if ( self -> lock != NULL && KLockAcquire ( self -> lock ) != 0 )
+        return;
+
+    VBlobMRUCacheCountHit ( self, col_idx );
+
+    if ( self -> lock != NULL )
+        KLockUnlock ( self -> lock );
+}
+
+const VBlob* VBlobMRUCacheHit(const VBlobMRUCache *cself, uint32_t col_idx, int64_t row_id, bool *ref)
+{
+    const VBlob *blob;
+
+    * ref = false;
+    if ( cself -> lock == NULL )
+        blob = VBlobMRUCacheFindInt ( cself, col_idx, row_id );
+    else
+    {
+        if ( KLockAcquire ( cself -> lock ) != 0 )
+            return NULL;
+
+        blob = VBlobMRUCacheFindInt ( cself, col_idx, row_id );
+        if ( blob != NULL )
+        {
+            if ( VBlobAddRef ( ( VBlob* ) blob ) != 0 )
+                blob = NULL;
+            else
+                * ref = true;
+        }
+    }
+
+    if ( blob != NULL )
+        VBlobMRUCacheCountHit ( ( VBlobMRUCache* ) cself, col_idx );
+
+    if ( cself -> lock != NULL )
+        KLockUnlock ( cself -> lock );
+
+    return blob;
+}
+
+void VBlobMRUCacheRecordMiss(const VBlobMRUCache *cself, uint32_t col_idx,
+    const VBlob *blob, uint64_t decode_ns)
+{
+    VBlobMRUCache *self = (VBlobMRUCache*)cself;
+    VCursorCacheStats *cs;
+    size_t bytes = ( blob != NULL ) ? VBlobCacheBytes ( blob ) : 0;
+
+    if ( self -> lock != NULL && KLockAcquire ( self -> lock ) != 0 )
+        return;
+
+    ++ self -> stats . misses;
+    self -> stats . bytes_decoded += bytes;
+    self -> stats . decode_ns += decode_ns;
+    cs = VBlobMRUCacheColStats ( self, col_idx );
+    if ( cs != NULL )
+    {
+        ++ cs -> misses;
+        cs -> bytes_decoded += bytes;
+        cs -> decode_ns += decode_ns;
+    }
+
+    if ( self -> lock != NULL )
+        KLockUnlock ( self -> lock );
+}
+
+rc_t VBlobMRUCacheGetStats(const VBlobMRUCache *self, uint32_t col_idx, VCursorCacheStats *stats)
+{
+    rc_t rc = 0;
+
+    if ( self -> lock != NULL )
+    {
+        rc = KLockAcquire ( self -> lock );
+        if ( rc != 0 )
+            return rc;
+    }
+
+    if ( col_idx == 0 )
+        * stats = self -> stats;
+    else
+    {
+        memset ( stats, 0, sizeof * stats );
+        if ( col_idx <= self -> col_stats_count )
+            * stats = self -> col_stats [ col_idx - 1 ];
+    }
+    stats -> capacity = self -> capacity;
+
+    if ( self -> lock != NULL )
+        KLockUnlock ( self -> lock );
+
+    return rc;
+}
+static
+void VBlobMRUCacheSetFlush(VBlobMRUCache *self, bool suspend)
+{
+    if ( self -> lock != NULL && KLockAcquire ( self -> lock ) != 0 )
+        return;
+    self -> suspend_flush = suspend;
+    if ( self -> lock != NULL )
+        KLockUnlock ( self -> lock );
+}
+
 void VBlobMRUCacheSuspendFlush(VBlobMRUCache *self)
 {
-	self->suspend_flush=true;
+	VBlobMRUCacheSetFlush(self,true);
 }
 	
 void VBlobMRUCacheResumeFlush(VBlobMRUCache *self)
 {
-	self->suspend_flush=false;
+	VBlobMRUCacheSetFlush(self,false);
+}
+
+
+
+/*--------------------------------------------------------------------------
+ * VBlobSharedCache
+ *  entries are spread over shards by ( table, column ), so that all
+ *  blobs of a column live in one shard and can be found by any row
+ *  they contain. each shard keeps its own LRU, while the byte budget
+ *  is global: an insertion that overflows it evicts from its own shard
+ *  first and then from the others in turn.
+ */
+#define SHARED_BLOB_CACHE_SHARDS 16
+
+typedef struct VBlobSharedColumn VBlobSharedColumn;
+struct VBlobSharedColumn
+{
+    BSTNode n;
+    uint64_t tbl;
+    uint64_t col;
+    KVector *blobs;     /* VBlobSharedEntry* by start_id */
+    DLList flights;     /* VBlobSharedFlight pages being decoded */
+};
+
+typedef struct VBlobSharedEntry VBlobSharedEntry;
+struct VBlobSharedEntry
+{
+    DLNode ln;
+    VBlobSharedColumn *col;
+    const VBlob *blob;
+    size_t size;
+};
+
+typedef struct VBlobSharedFlight VBlobSharedFlight;
+struct VBlobSharedFlight
+{
+    DLNode ln;
+    int64_t first;
+    int64_t last;
+};
+
+typedef struct VBlobSharedShard VBlobSharedShard;
+struct VBlobSharedShard
+{
+    KLock *lock;
+    KCondition *landed; /* broadcast whenever a flight ends */
+    BSTree columns;
+    DLList lru;
+};
+
+/* a physical table read through one table schema,
+   shared by every VTable opened on it */
+typedef struct VBlobSharedTable VBlobSharedTable;
+struct VBlobSharedTable
+{
+    BSTNode n;
+    const void *ktbl;
+    uint32_t vers;
+    uint32_t users;
+    uint64_t key;
+    String name;
+};
+
+struct VBlobSharedCache
+{
+    VBlobSharedShard shard [ SHARED_BLOB_CACHE_SHARDS ];
+    KLock *budget_lock;
+    size_t capacity;
+    size_t contents;
+    BSTree tables;      /* VBlobSharedTable, guarded by budget_lock */
+    uint64_t last_tbl;  /* last table key handed out */
+};
+
+typedef struct VBlobSharedKey VBlobSharedKey;
+struct VBlobSharedKey
+{
+    uint64_t tbl;
+    uint64_t col;
+};
+
+static
+uint32_t VBlobSharedCacheShardIdx ( uint64_t tbl, uint64_t col )
+{
+    uint64_t h = ( tbl * 0x9E3779B97F4A7C15ULL ) ^ col;
+    h ^= h >> 29;
+    h ^= h >> 13;
+    return ( uint32_t ) ( h % SHARED_BLOB_CACHE_SHARDS );
+}
+
+static
+int CC VBlobSharedColumnCmp ( const void *item, const BSTNode *n )
+{
+    const VBlobSharedKey *a = item;
+    const VBlobSharedColumn *b = ( const VBlobSharedColumn* ) n;
+
+    if ( a -> tbl != b -> tbl )
+        return a -> tbl < b -> tbl ? -1 : 1;
+    if ( a -> col != b -> col )
+        return a -> col < b -> col ? -1 : 1;
+    return 0;
+}
+
+static
+int CC VBlobSharedColumnSort ( const BSTNode *item, const BSTNode *n )
+{
+    const VBlobSharedColumn *a = ( const VBlobSharedColumn* ) item;
+    VBlobSharedKey key;
+    key . tbl = a -> tbl;
+    key . col = a -> col;
+    return VBlobSharedColumnCmp ( & key, n );
+}
+
+/* matches any column of a table */
+static
+int CC VBlobSharedColumnTblCmp ( const void *item, const BSTNode *n )
+{
+    const uint64_t *tbl = item;
+    const VBlobSharedColumn *b = ( const VBlobSharedColumn* ) n;
+    if ( * tbl != b -> tbl )
+        return * tbl < b -> tbl ? -1 : 1;
+    return 0;
+}
+
+static
+void VBlobSharedCacheAccount ( VBlobSharedCache *self, size_t added, size_t removed )
+{
+    KLockAcquire ( self -> budget_lock );
+    self -> contents += added;
+    self -> contents -= removed;
+    KLockUnlock ( self -> budget_lock );
 }
 
+static
+bool VBlobSharedCacheOverBudget ( VBlobSharedCache *self )
+{
+    bool over;
+    KLockAcquire ( self -> budget_lock );
+    over = self -> contents > self -> capacity;
+    KLockUnlock ( self -> budget_lock );
+    return over;
+}
+
+/* EntryWhack
+ *  drop an entry already unlinked from its shard's LRU
+ */
+static
+void VBlobSharedEntryWhack ( VBlobSharedCache *self, VBlobSharedEntry *e, bool unset )
+{
+    if ( unset )
+        KVectorUnset ( e -> col -> blobs, e -> blob -> start_id );
+    VBlobSharedCacheAccount ( self, 0, e -> size );
+    VBlobRelease ( ( VBlob* ) e -> blob );
+    free ( e );
+}
+
+typedef struct VBlobSharedWhackData VBlobSharedWhackData;
+struct VBlobSharedWhackData
+{
+    VBlobSharedCache *self;
+    VBlobSharedShard *shard;
+};
+
+static
+rc_t CC VBlobSharedEntryWhackVisit ( uint64_t start_id, const void *n, void *data )
+{
+    VBlobSharedWhackData *pb = data;
+    VBlobSharedEntry *e = ( VBlobSharedEntry* ) n;
+
+    DLListUnlink ( & pb -> shard -> lru, & e -> ln );
+    VBlobSharedEntryWhack ( pb -> self, e, false );
+    return 0;
+}
+
+static
+void VBlobSharedColumnWhack ( VBlobSharedColumn *col, VBlobSharedWhackData *pb )
+{
+    DLNode *ln;
+
+    KVectorVisitPtr ( col -> blobs, false, VBlobSharedEntryWhackVisit, pb );
+    KVectorRelease ( col -> blobs );
+
+    /* nobody may be waiting on a column being destroyed */
+    while ( ( ln = DLListPopHead ( & col -> flights ) ) != NULL )
+        free ( ln );
+
+    free ( col );
+}
+
+static
+void CC VBlobSharedColumnWhackNode ( BSTNode *n, void *data )
+{
+    VBlobSharedColumnWhack ( ( VBlobSharedColumn* ) n, data );
+}
+
+static
+void CC VBlobSharedTableWhack ( BSTNode *n, void *ignore )
+{
+    free ( n );
+}
+
+rc_t VBlobSharedCacheMake ( VBlobSharedCache **cachep, size_t capacity )
+{
+    rc_t rc;
+    uint32_t i;
+    VBlobSharedCache *self;
+
+    assert ( cachep != NULL );
+
+    self = calloc ( 1, sizeof * self );
+    if ( self == NULL )
+        return RC ( rcVDB, rcMgr, rcConstructing, rcMemory, rcExhausted );
+
+    self -> capacity = capacity;
+
+    BSTreeInit ( & self -> tables );
+    rc = KLockMake ( & self -> budget_lock );
+    for ( i = 0; rc == 0 && i < SHARED_BLOB_CACHE_SHARDS; ++ i )
+    {
+        VBlobSharedShard *shard = & self -> shard [ i ];
+        BSTreeInit ( & shard -> columns );
+        DLListInit ( & shard -> lru );
+        rc = KLockMake ( & shard -> lock );
+        if ( rc == 0 )
+            rc = KConditionMake ( & shard -> landed );
+    }
+
+    if ( rc != 0 )
+    {
+        VBlobSharedCacheDestroy ( self );
+        self = NULL;
+    }
+
+    * cachep = self;
+    return rc;
+}
+
+void VBlobSharedCacheDestroy ( VBlobSharedCache *self )
+{
+    if ( self != NULL )
+    {
+        uint32_t i;
+        for ( i = 0; i < SHARED_BLOB_CACHE_SHARDS; ++ i )
+        {
+            VBlobSharedWhackData pb;
+            pb . self = self;
+            pb . shard = & self -> shard [ i ];
+
+            BSTreeWhack ( & pb . shard -> columns, VBlobSharedColumnWhackNode, & pb );
+            KConditionRelease ( pb . shard -> landed );
+            KLockRelease ( pb . shard -> lock );
+        }
+        BSTreeWhack ( & self -> tables, VBlobSharedTableWhack, NULL );
+        KLockRelease ( self -> budget_lock );
+        free ( self );
+    }
+}
+
+/* Trim
+ *  evict least recently used blobs until within budget,
+ *  starting with the shard that just grew
+ */
+static
+void VBlobSharedCacheTrim ( VBlobSharedCache *self, uint32_t start )
+{
+    uint32_t i;
+    for ( i = 0; i < SHARED_BLOB_CACHE_SHARDS && VBlobSharedCacheOverBudget ( self ); ++ i )
+    {
+        VBlobSharedShard *shard = & self -> shard [ ( start + i ) % SHARED_BLOB_CACHE_SHARDS ];
+        if ( KLockAcquire ( shard -> lock ) == 0 )
+        {
+            while ( VBlobSharedCacheOverBudget ( self ) )
+            {
+                DLNode *last = DLListPopTail ( & shard -> lru );
+                if ( last == NULL )
+                    break;
+                VBlobSharedEntryWhack ( self, ( VBlobSharedEntry* ) last, true );
+            }
+            KLockUnlock ( shard -> lock );
+        }
+    }
+}
+
+void VBlobSharedCacheSetCapacity ( VBlobSharedCache *self, size_t capacity )
+{
+    if ( self != NULL )
+    {
+        KLockAcquire ( self -> budget_lock );
+        self -> capacity = capacity;
+        KLockUnlock ( self -> budget_lock );
+
+        VBlobSharedCacheTrim ( self, 0 );
+    }
+}
+
+typedef struct VBlobSharedTableKey VBlobSharedTableKey;
+struct VBlobSharedTableKey
+{
+    const void *ktbl;
+    const String *name;
+    uint32_t vers;
+};
+
+static
+int CC VBlobSharedTableCmp ( const void *item, const BSTNode *n )
+{
+    const VBlobSharedTableKey *a = item;
+    const VBlobSharedTable *b = ( const VBlobSharedTable* ) n;
+
+    if ( a -> ktbl != b -> ktbl )
+        return ( size_t ) a -> ktbl < ( size_t ) b -> ktbl ? -1 : 1;
+    if ( a -> vers != b -> vers )
+        return a -> vers < b -> vers ? -1 : 1;
+    return StringCompare ( a -> name, & b -> name );
+}
+
+static
+int CC VBlobSharedTableSort ( const BSTNode *item, const BSTNode *n )
+{
+    const VBlobSharedTable *a = ( const VBlobSharedTable* ) item;
+    VBlobSharedTableKey key;
+    key . ktbl = a -> ktbl;
+    key . name = & a -> name;
+    key . vers = a -> vers;
+    return VBlobSharedTableCmp ( & key, n );
+}
+
+typedef struct VBlobSharedTableFindData VBlobSharedTableFindData;
+struct VBlobSharedTableFindData
+{
+    uint64_t key;
+    VBlobSharedTable *found;
+};
+
+static
+bool CC VBlobSharedTableHasKey ( BSTNode *n, void *data )
+{
+    VBlobSharedTableFindData *pb = data;
+    if ( ( ( const VBlobSharedTable* ) n ) -> key != pb -> key )
+        return false;
+    pb -> found = ( VBlobSharedTable* ) n;
+    return true;
+}
+
+uint64_t VBlobSharedCacheTableKey ( VBlobSharedCache *self, const void *ktbl,
+    const String *name, uint32_t vers, uint64_t *key )
+{
+    uint64_t tbl = 0;
+    if ( KLockAcquire ( self -> budget_lock ) == 0 )
+    {
+        if ( * key == 0 )
+        {
+            VBlobSharedTable *t;
+            VBlobSharedTableKey tkey;
+            tkey . ktbl = ktbl;
+            tkey . name = name;
+            tkey . vers = vers;
+
+            t = ( VBlobSharedTable* ) BSTreeFind ( & self -> tables, & tkey, VBlobSharedTableCmp );
+            if ( t == NULL )
+            {
+                t = malloc ( sizeof * t + name -> size );
+                if ( t != NULL )
+                {
+                    char *text = ( char* ) ( t + 1 );
+                    memmove ( text, name -> addr, name -> size );
+                    StringInit ( & t -> name, text, name -> size, name -> len );
+                    t -> ktbl = ktbl;
+                    t -> vers = vers;
+                    t -> users = 0;
+                    t -> key = ++ self -> last_tbl;
+                    BSTreeInsert ( & self -> tables, & t -> n, VBlobSharedTableSort );
+                }
+            }
+            if ( t != NULL )
+            {
+                ++ t -> users;
+                * key = t -> key;
+            }
+        }
+        tbl = * key;
+        KLockUnlock ( self -> budget_lock );
+    }
+    return tbl;
+}
+
+/* FindInt
+ *  look up a blob holding "row_id" with the shard locked
+ */
+static
+const VBlob * VBlobSharedCacheFindInt ( VBlobSharedShard *shard, VBlobSharedColumn *col, int64_t row_id )
+{
+    VBlobSharedEntry *e;
+    int64_t start_id;
+
+    if ( col == NULL )
+        return NULL;
+
+    if ( KVectorGetPrevPtr ( col -> blobs, ( uint64_t* ) & start_id, ( uint64_t ) row_id + 1, ( void** ) & e ) != 0 || e == NULL )
+        return NULL;
+    if ( row_id < e -> blob -> start_id || row_id > e -> blob -> stop_id )
+        return NULL;
+
+    DLListUnlink ( & shard -> lru, & e -> ln );
+    DLListPushHead ( & shard -> lru, & e -> ln );
+
+    if ( VBlobAddRef ( ( VBlob* ) e -> blob ) != 0 )
+        return NULL;
+    return e -> blob;
+}
+
+const VBlob * VBlobSharedCacheFind ( VBlobSharedCache *self, uint64_t tbl, uint64_t col, int64_t row_id )
+{
+    const VBlob *blob = NULL;
+    VBlobSharedShard *shard = & self -> shard [ VBlobSharedCacheShardIdx ( tbl, col ) ];
+
+    if ( KLockAcquire ( shard -> lock ) == 0 )
+    {
+        VBlobSharedKey key;
+        key . tbl = tbl;
+        key . col = col;
+
+        blob = VBlobSharedCacheFindInt ( shard,
+            ( VBlobSharedColumn* ) BSTreeFind ( & shard -> columns, & key, VBlobSharedColumnCmp ), row_id );
+
+        KLockUnlock ( shard -> lock );
+    }
+
+    return blob;
+}
+
+static
+VBlobSharedFlight * VBlobSharedColumnFindFlight ( const VBlobSharedColumn *col, int64_t first, int64_t last )
+{
+    DLNode *ln;
+    for ( ln = DLListHead ( & col -> flights ); ln != NULL; ln = DLNodeNext ( ln ) )
+    {
+        VBlobSharedFlight *f = ( VBlobSharedFlight* ) ln;
+        if ( f -> first <= last && f -> last >= first )
+            return f;
+    }
+    return NULL;
+}
+
+rc_t VBlobSharedCacheClaim ( VBlobSharedCache *self, uint64_t tbl, uint64_t col,
+    int64_t row_id, int64_t first, int64_t last, const VBlob **blob )
+{
+    rc_t rc;
+    VBlobSharedKey key;
+    VBlobSharedColumn *scol;
+    VBlobSharedFlight *flight;
+    VBlobSharedShard *shard = & self -> shard [ VBlobSharedCacheShardIdx ( tbl, col ) ];
+
+    assert ( blob != NULL );
+    * blob = NULL;
+
+    key . tbl = tbl;
+    key . col = col;
+
+    rc = KLockAcquire ( shard -> lock );
+    if ( rc != 0 )
+        return rc;
+
+    scol = ( VBlobSharedColumn* ) BSTreeFind ( & shard -> columns, & key, VBlobSharedColumnCmp );
+    if ( scol == NULL )
+    {
+        scol = calloc ( 1, sizeof * scol );
+        if ( scol == NULL )
+            rc = RC ( rcVDB, rcBlob, rcReading, rcMemory, rcExhausted );
+        else
+        {
+            scol -> tbl = tbl;
+            scol -> col = col;
+            DLListInit ( & scol -> flights );
+            rc = KVectorMake ( & scol -> blobs );
+            if ( rc != 0 )
+            {
+                free ( scol );
+                scol = NULL;
+            }
+            else
+            {
+                BSTreeInsert ( & shard -> columns, & scol -> n, VBlobSharedColumnSort );
+            }
+        }
+    }
+
+    /* wait out anyone decoding the page that holds our row */
+    while ( rc == 0 )
+    {
+        * blob = VBlobSharedCacheFindInt ( shard, scol, row_id );
+        if ( * blob != NULL )
+            break;
+
+        if ( VBlobSharedColumnFindFlight ( scol, first, last ) == NULL )
+        {
+            flight = malloc ( sizeof * flight );
+            if ( flight == NULL )
+                rc = RC ( rcVDB, rcBlob, rcReading, rcMemory, rcExhausted );
+            else
+            {
+                flight -> first = first;
+                flight -> last = last;
+                DLListPushTail ( & scol -> flights, & flight -> ln );
+            }
+            break;
+        }
+
+        rc = KConditionWait ( shard -> landed, shard -> lock );
+    }
+
+    KLockUnlock ( shard -> lock );
+    return rc;
+}
+
+void VBlobSharedCachePublish ( VBlobSharedCache *self, uint64_t tbl, uint64_t col,
+    int64_t first, const VBlob *blob )
+{
+    VBlobSharedKey key;
+    VBlobSharedColumn *scol;
+    VBlobSharedEntry *e = NULL;
+    bool cached = false;
+    uint32_t idx = VBlobSharedCacheShardIdx ( tbl, col );
+    VBlobSharedShard *shard = & self -> shard [ idx ];
+
+    if ( blob != NULL && ! blob -> no_cache )
+    {
+        /* readers in other threads must not find work left in the page map,
+           nor a request still queued on the pagemap pool */
+        if ( VBlobResolvePageMap ( blob ) == 0 &&
+             ( blob -> pm == NULL || PageMapExpandAll ( blob -> pm ) == 0 ) )
+        {
+            e = malloc ( sizeof * e );
+            if ( e != NULL )
+            {
+                e -> blob = blob;
+                e -> size = sizeof * e + VBlobCacheBytes ( blob );
+                VBlobAddRef ( ( VBlob* ) blob );
+            }
+        }
+    }
+
+    key . tbl = tbl;
+    key . col = col;
+
+    if ( KLockAcquire ( shard -> lock ) != 0 )
+        scol = NULL;
+    else
+    {
+        scol = ( VBlobSharedColumn* ) BSTreeFind ( & shard -> columns, & key, VBlobSharedColumnCmp );
+        if ( scol != NULL )
+        {
+            VBlobSharedFlight *flight = VBlobSharedColumnFindFlight ( scol, first, first );
+            if ( flight != NULL )
+            {
+                DLListUnlink ( & scol -> flights, & flight -> ln );
+                free ( flight );
+            }
+
+            if ( e != NULL )
+            {
+                VBlobSharedEntry *existing;
+                e -> col = scol;
+                if ( KVectorGetPtr ( scol -> blobs, blob -> start_id, ( void** ) & existing ) == 0 && existing != NULL )
+                {
+                    /* keep whichever covers more rows */
+                    if ( existing -> blob -> stop_id >= blob -> stop_id )
+                        scol = NULL;
+                    else
+                    {
+                        DLListUnlink ( & shard -> lru, & existing -> ln );
+                        VBlobSharedEntryWhack ( self, existing, true );
+                    }
+                }
+                if ( scol != NULL && KVectorSetPtr ( scol -> blobs, blob -> start_id, e ) == 0 )
+                {
+                    DLListPushHead ( & shard -> lru, & e -> ln );
+                    VBlobSharedCacheAccount ( self, e -> size, 0 );
+                    cached = true;
+                }
+            }
+
+            KConditionBroadcast ( shard -> landed );
+        }
+        KLockUnlock ( shard -> lock );
+    }
+
+    if ( cached )
+        VBlobSharedCacheTrim ( self, idx );
+    else if ( e != NULL )
+    {
+        VBlobRelease ( ( VBlob* ) e -> blob );
+        free ( e );
+    }
+}
+
+static
+void VBlobSharedCacheDropTable ( VBlobSharedCache *self, uint64_t tbl )
+{
+    uint32_t i;
+    for ( i = 0; i < SHARED_BLOB_CACHE_SHARDS; ++ i )
+    {
+        VBlobSharedWhackData pb;
+        pb . self = self;
+        pb . shard = & self -> shard [ i ];
+
+        if ( KLockAcquire ( pb . shard -> lock ) == 0 )
+        {
+            BSTNode *n;
+            while ( ( n = BSTreeFind ( & pb . shard -> columns, & tbl, VBlobSharedColumnTblCmp ) ) != NULL )
+            {
+                BSTreeUnlink ( & pb . shard -> columns, n );
+                VBlobSharedColumnWhack ( ( VBlobSharedColumn* ) n, & pb );
+            }
+            KLockUnlock ( pb . shard -> lock );
+        }
+    }
+}
+
+void VBlobSharedCacheReleaseTable ( VBlobSharedCache *self, uint64_t tbl )
+{
+    if ( self != NULL && tbl != 0 )
+    {
+        bool last = false;
+        if ( KLockAcquire ( self -> budget_lock ) == 0 )
+        {
+            VBlobSharedTableFindData pb;
+            pb . key = tbl;
+            pb . found = NULL;
+
+            BSTreeDoUntil ( & self -> tables, false, VBlobSharedTableHasKey, & pb );
+            if ( pb . found != NULL && -- pb . found -> users == 0 )
+            {
+                BSTreeUnlink ( & self -> tables, & pb . found -> n );
+                free ( pb . found );
+                last = true;
+            }
+            KLockUnlock ( self -> budget_lock );
+        }
+
+        /* keys are never reused, so blobs can be dropped outside the lock */
+        if ( last )
+            VBlobSharedCacheDropTable ( self, tbl );
+    }
+}
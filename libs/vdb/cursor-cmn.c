@@ -61,6 +61,7 @@
 #include <klib/rc.h>
 #include <klib/printf.h>
 #include <klib/sort.h>
+#include <klib/time.h>
 #include <bitstr.h>
 #include <os-native.h>
 #include <sysalloc.h>
@@ -261,6 +262,7 @@ rc_t VCursorDestroy ( VCursor *self )
 {
     KRefcountWhack ( & self -> refcount, "VCursor" );
     if(self->cache_curs) VCursorDestroy((VCursor*)self->cache_curs);
+    VCursorPrefetchWhack ( self -> prefetch );
     VBlobMRUCacheDestroy ( self->blob_mru_cache);
 
     if ( self -> user_whack != NULL )
@@ -275,6 +277,7 @@ rc_t VCursorDestroy ( VCursor *self )
     VectorWhack ( & self -> row, VCursorVColumnWhack_checked, NULL );
     VectorWhack ( & self -> v_cache_curs, NULL, NULL );
     VectorWhack ( & self -> v_cache_cidx, NULL, NULL );
+    VNamelistRelease ( self -> projection );
 
     VSchemaRelease ( self -> schema );
 
@@ -421,6 +424,78 @@ rc_t VCursorSupplementName ( const KSymTable *tbl,
     return rc;
 }
 
+/* Projects
+ *  true if no projection was declared, or if it declares "name"
+ *  or the column whose vdbcache companion "name" is
+ */
+static
+bool VCursorProjectionHas ( const VNamelist *projection, const char *name, size_t size )
+{
+    uint32_t i, count;
+    if ( VNameListCount ( projection, & count ) != 0 )
+        return false;
+    for ( i = 0; i < count; ++ i )
+    {
+        const char *declared;
+        if ( VNameListGet ( projection, i, & declared ) == 0 &&
+             string_size ( declared ) == size && memcmp ( declared, name, size ) == 0 )
+            return true;
+    }
+    return false;
+}
+
+static
+bool VCursorProjects ( const VCursor *self, const char *name, size_t size )
+{
+    if ( self -> projection == NULL )
+        return true;
+    if ( VCursorProjectionHas ( self -> projection, name, size ) )
+        return true;
+    if ( size > 6 && memcmp ( name + size - 6, "_CACHE", 6 ) == 0 )
+        return VCursorProjectionHas ( self -> projection, name, size - 6 );
+    return false;
+}
+
+/* SupplementWanted
+ *  a projected cursor only supplements names that implement a
+ *  virtual production, which any column may reach, and names of
+ *  declared columns missing from schema
+ */
+static
+bool VCursorSupplementWanted ( const KSymTable *tbl, const VCursor *self, const char *name )
+{
+    bool wanted;
+    const KSymbol *sym;
+    String pname;
+    char local [ 256 ], *buffer = local;
+    size_t size;
+
+    if ( self -> projection == NULL )
+        return true;
+
+    /* physical name string, sized from the name */
+    size = string_size ( name );
+    if ( size + 2 > sizeof local )
+    {
+        buffer = malloc ( size + 2 );
+        if ( buffer == NULL )
+            return true;
+    }
+    buffer [ 0 ] = '.';
+    memmove ( buffer + 1, name, size + 1 );
+
+    StringInit ( & pname, buffer, size + 1, string_len ( buffer, size + 1 ) );
+    sym = KSymTableFind ( tbl, & pname );
+    if ( sym != NULL )
+        wanted = sym -> type == eVirtual;
+    else
+        wanted = VCursorProjects ( self, name, size );
+
+    if ( buffer != local )
+        free ( buffer );
+    return wanted;
+}
+
 static
 rc_t VCursorSupplementPhysical ( const KSymTable *tbl, const VCursor *self )
 {
@@ -434,7 +509,7 @@ rc_t VCursorSupplementPhysical ( const KSymTable *tbl, const VCursor *self )
         {
             const char *name;
             rc = KNamelistGet ( names, i, & name );
-            if ( rc == 0 )
+            if ( rc == 0 && VCursorSupplementWanted ( tbl, self, name ) )
                 rc = VCursorSupplementName ( tbl, self -> stbl, NULL, name );
         }
         KNamelistRelease ( names );
@@ -461,7 +536,7 @@ rc_t VCursorSupplementStatic ( const KSymTable *tbl, const VCursor *self )
         {
             const char *name;
             rc = KNamelistGet ( names, i, & name );
-            if ( rc == 0 )
+            if ( rc == 0 && VCursorSupplementWanted ( tbl, self, name ) )
             {
                 const KMDataNode *node;
                 rc = KMDataNodeOpenNodeRead ( root, & node, "%s", name );
@@ -517,8 +592,24 @@ rc_t VCursorSupplementSchema ( const VCursor *self )
  *  "capacity" [ IN ] - the maximum bytes to cache on the cursor before
  *  dropping least recently used blobs
  */
+static
+rc_t VCursorMakeProjection ( VCursor *self, const char * const *columns, uint32_t count )
+{
+    uint32_t i;
+    rc_t rc = VNamelistMake ( & self -> projection, count + 1 );
+    for ( i = 0; rc == 0 && i < count; ++ i )
+    {
+        if ( columns [ i ] == NULL || columns [ i ] [ 0 ] == 0 )
+            rc = RC ( rcVDB, rcCursor, rcConstructing, rcName, rcEmpty );
+        else
+            rc = VNamelistAppend ( self -> projection, columns [ i ] );
+    }
+    return rc;
+}
+
 static rc_t VTableCreateCachedCursorReadImpl ( const VTable *self,
-    const VCursor **cursp, size_t capacity, bool create_pagemap_thread  )
+    const VCursor **cursp, size_t capacity, bool create_pagemap_thread,
+    const char * const *columns, uint32_t count )
 {
     rc_t rc;
 #if DISABLE_READ_CACHE
@@ -537,14 +628,24 @@ static rc_t VTableCreateCachedCursorReadImpl ( const VTable *self,
 #endif
             rc = VCursorMake ( & curs, self );
             if ( rc == 0 ) {
-                curs -> blob_mru_cache = VBlobMRUCacheMake(capacity);
+                /* blobs handed out by the shared cache are pinned in a local one */
+                curs -> shared_blob_cache = self -> mgr -> blob_cache . ptr;
+                if ( curs -> shared_blob_cache != NULL )
+                    curs -> shared_blob_key = VBlobSharedCacheTableKey ( curs -> shared_blob_cache,
+                        self -> ktbl, & self -> stbl -> name -> name, self -> stbl -> version,
+                        & ( ( VTable* ) self ) -> shared_blob_key );
+                curs -> blob_mru_cache = VBlobMRUCacheMake(
+                    ( curs -> shared_blob_cache != NULL && capacity == 0 ) ? 1 : capacity );
                 curs -> read_only = true;
-                rc = VCursorSupplementSchema ( curs );
+                if ( columns != NULL )
+                    rc = VCursorMakeProjection ( curs, columns, count );
+                if ( rc == 0 )
+                    rc = VCursorSupplementSchema ( curs );
                
 #if 0  
                 if ( create_pagemap_thread && capacity > 0 && rc == 0 )
                 {
-                    rc = VCursorLaunchPagemapThread ( curs );
+                    rc = VCursorAttachPagemapPool ( curs );
                     if ( rc != 0 )
                     {
                         if ( GetRCState( rc ) == rcNotAvailable )
@@ -562,7 +663,7 @@ static rc_t VTableCreateCachedCursorReadImpl ( const VTable *self,
                     if(rc==0 && self->cache_tbl){
 			rc_t rc2;
 			const VCursor * cache_curs;
-			rc2 = VTableCreateCachedCursorReadImpl(self->cache_tbl,&cache_curs,64*1024*1024,create_pagemap_thread);
+			rc2 = VTableCreateCachedCursorReadImpl(self->cache_tbl,&cache_curs,64*1024*1024,create_pagemap_thread,columns,count);
 			DBGMSG(DBG_VDB, DBG_FLAG(DBG_VDB_VDB), ("VTableCreateCachedCursorReadImpl(vdbcache) = %d\n", rc2));
 			if(rc2 == 0){
 				((VCursor*) (*cursp)) -> cache_curs = cache_curs;
@@ -581,7 +682,22 @@ static rc_t VTableCreateCachedCursorReadImpl ( const VTable *self,
 LIB_EXPORT rc_t CC VTableCreateCachedCursorRead ( const VTable *self,
     const VCursor **cursp, size_t capacity )
 {
-	return VTableCreateCachedCursorReadImpl(self,cursp,capacity,true);
+	return VTableCreateCachedCursorReadImpl(self,cursp,capacity,true,NULL,0);
+}
+
+/* CreateProjectedCursorRead
+ *  creates a cached read cursor that declares its columns up front
+ */
+LIB_EXPORT rc_t CC VTableCreateProjectedCursorRead ( const VTable *self,
+    const VCursor **cursp, size_t capacity, const char * const *columns, uint32_t count )
+{
+    if ( columns == NULL )
+    {
+        if ( cursp != NULL )
+            * cursp = NULL;
+        return RC ( rcVDB, rcTable, rcOpening, rcParam, rcNull );
+    }
+    return VTableCreateCachedCursorReadImpl ( self, cursp, capacity, true, columns, count );
 }
 
 /**
@@ -589,7 +705,7 @@ LIB_EXPORT rc_t CC VTableCreateCachedCursorRead ( const VTable *self,
 ****/
 rc_t  VTableCreateCursorReadInternal(const VTable *self, const VCursor **cursp)
 {
-	return VTableCreateCachedCursorReadImpl(self,cursp,0,false);
+	return VTableCreateCachedCursorReadImpl(self,cursp,0,false,NULL,0);
 }
 
 /* CreateCursor
@@ -745,6 +861,9 @@ rc_t VCursorAddColspec ( VCursor *self, uint32_t *idx, const char *colspec )
         & cast, & name, & type, colspec, "VCursorAddColspec", true );
     if ( scol == NULL || type != eColumn )
         rc = RC ( rcVDB, rcCursor, rcUpdating, rcColumn, rcNotFound );
+    /* a projected cursor was only prepared for its declared columns */
+    else if ( ! VCursorProjects ( self, scol -> name -> name . addr, scol -> name -> name . size ) )
+        rc = RC ( rcVDB, rcCursor, rcUpdating, rcColumn, rcNotFound );
     else
     {
         Vector cx_bind;
@@ -1333,6 +1452,12 @@ rc_t VCursorOpenRead ( VCursor *self, const KDlset *libs )
         {
             self -> row_id = self -> start_id = self -> end_id = 1;
             self -> state = vcReady;
+            /* columns added later get their slots on first use */
+            if ( self -> blob_mru_cache != NULL )
+            {
+                VBlobMRUCacheReserve ( self -> blob_mru_cache,
+                    VectorStart ( & self -> row ) + VectorLength ( & self -> row ) - 1, self -> phys_cnt );
+            }
 	    if(self->cache_curs){
 		VCursorOpenRead((VCursor*)self->cache_curs, libs);
 	    }
@@ -1447,6 +1572,56 @@ rc_t VCursorCloseRowRead ( VCursor *self )
  *  elements read into buffer. if the return code indicates that the
  *  buffer is too small, "row_len" will give the required buffer length.
  */
+/* ReadSharedBlob
+ *  obtain the blob of a column through the manager's shared cache,
+ *  decoding it at most once across all cursors on the table.
+ *  returns a new reference, or NULL if the blob should be read as usual
+ */
+static
+rc_t VCursorReadSharedBlob ( const VCursor *self, const VColumn *col, uint32_t col_idx,
+    int64_t row_id, const VBlob **blobp )
+{
+    rc_t rc = 0;
+    int64_t first, last;
+    VBlobSharedCache *shared = self -> shared_blob_cache;
+    uint64_t ckey = ( ( uint64_t ) col -> scol -> cid . ctx << 32 ) | col -> scol -> cid . id;
+    const VBlob *blob = VBlobSharedCacheFind ( shared, self -> shared_blob_key, ckey, row_id );
+
+    if ( blob != NULL )
+        VBlobMRUCacheRecordHit ( self -> blob_mru_cache, col_idx );
+    else
+    {
+        /* claim the page expected to hold the row */
+        if ( VColumnPageIdRange ( col, row_id, & first, & last ) != 0 || row_id < first || row_id > last )
+            first = last = row_id;
+
+        rc = VBlobSharedCacheClaim ( shared, self -> shared_blob_key, ckey, row_id, first, last, & blob );
+        if ( rc == 0 && blob != NULL )
+            VBlobMRUCacheRecordHit ( self -> blob_mru_cache, col_idx );
+        else if ( rc == 0 )
+        {
+            uint32_t elem_bits, boff, row_len, repeat_count;
+            const void *base;
+            VBlobMRUCacheCursorContext cctx;
+            uint64_t started = KTimeNsStamp ();
+            cctx.cache = self -> blob_mru_cache;
+            cctx.col_idx = col_idx;
+
+            rc = VColumnReadBlob ( col, & blob, row_id, & elem_bits, & base, & boff, & row_len, & repeat_count, & cctx );
+            if ( rc != 0 )
+                blob = NULL;
+            else
+                VBlobMRUCacheRecordMiss ( self -> blob_mru_cache, col_idx, blob, KTimeNsStamp () - started );
+
+            VBlobSharedCachePublish ( shared, self -> shared_blob_key, ckey, first,
+                ( blob != NULL && blob -> stop_id - blob -> start_id >= CACHE_MIN_BLOB_ROWS ) ? blob : NULL );
+        }
+    }
+
+    * blobp = blob;
+    return rc;
+}
+
 static
 rc_t VCursorReadColumnDirectInt ( const VCursor *cself, int64_t row_id, uint32_t col_idx,
     uint32_t *elem_bits, const void **base, uint32_t *boff, uint32_t *row_len, uint32_t *repeat_count,
@@ -1465,26 +1640,54 @@ rc_t VCursorReadColumnDirectInt ( const VCursor *cself, int64_t row_id, uint32_t
         return VColumnRead ( col, row_id, elem_bits, base, boff, row_len, (VBlob**) rslt );
 
     /* check MRU blob */
-    blob = VBlobMRUCacheFind(cself->blob_mru_cache,col_idx,row_id);
-    if(blob){
-        assert(row_id >= blob->start_id && row_id <= blob->stop_id);
-        /* if the caller wants the blob back... */
-        if ( rslt != NULL )
+    {
+        bool ref;
+        blob = VBlobMRUCacheHit(cself->blob_mru_cache,col_idx,row_id,&ref);
+        if(blob){
+            assert(row_id >= blob->start_id && row_id <= blob->stop_id);
+            /* if the caller wants the blob back... */
+            if ( rslt != NULL )
+                    * rslt = blob;
+            /* ask column to read from blob */
+            rc = VColumnReadCachedBlob ( col, blob, row_id, elem_bits, base, boff, row_len, repeat_count);
+            /* the column's slot of last used blobs keeps it alive for the caller */
+            if ( ref )
+                VBlobRelease ( ( VBlob* ) blob );
+            return rc;
+        }
+    }
+    /* cursor parameters may alter column output, so such cursors keep to themselves */
+    if ( cself -> shared_blob_cache != NULL && cself -> shared_blob_key != 0 && cself -> named_params . root == NULL )
+    {
+        rc = VCursorReadSharedBlob ( cself, col, col_idx, row_id, & blob );
+        if ( rc != 0 )
+        {
+            if(rslt) *rslt = NULL;
+            return rc;
+        }
+        if ( blob != NULL )
+        {
+            /* keep the blob alive for the caller past eviction from the shared cache */
+            VBlobMRUCachePin ( cself -> blob_mru_cache, col_idx, blob );
+            if ( rslt != NULL )
                 * rslt = blob;
-        /* ask column to read from blob */
-        return VColumnReadCachedBlob ( col, blob, row_id, elem_bits, base, boff, row_len, repeat_count);
+            return VColumnReadCachedBlob ( col, blob, row_id, elem_bits, base, boff, row_len, repeat_count);
+        }
     }
     { /* ask column to produce a blob to be cached */
 	VBlobMRUCacheCursorContext cctx;
+	uint64_t started = KTimeNsStamp();
 	cctx.cache=cself -> blob_mru_cache;
 	cctx.col_idx = col_idx;
 	rc = VColumnReadBlob(col,&blob,row_id,elem_bits,base,boff,row_len,repeat_count,&cctx);
+	if ( rc == 0 && blob != NULL )
+	    VBlobMRUCacheRecordMiss(cself->blob_mru_cache,col_idx,blob,KTimeNsStamp()-started);
     }
     if ( rc != 0 || blob == NULL ){
         if(rslt) *rslt = NULL;
         return rc;
     }
-    if(blob->stop_id > blob->start_id + 4)
+    if(blob->stop_id - blob->start_id >= CACHE_MIN_BLOB_ROWS)
 	    rc_cache=VBlobMRUCacheSave(cself->blob_mru_cache, col_idx, blob);
     if(rslt==NULL){ /** user does not care about the blob ***/
         if( rc_cache == 0){
@@ -2076,6 +2279,208 @@ LIB_EXPORT rc_t CC VCursorCellDataDirect ( const VCursor *self, int64_t row_id,
     return rc;
 }
 
+static
+rc_t VCursorCellDataPinnedInt ( const VCursor *self, int64_t row_id, uint32_t col_idx, VCellRef *ref )
+{
+    rc_t rc;
+    const VBlob *blob = NULL;
+    const VColumn *col = ( const void* ) VectorGet ( & self -> row, col_idx );
+    if ( col == NULL )
+        return RC ( rcVDB, rcCursor, rcReading, rcColumn, rcInvalid );
+
+    if ( self -> blob_mru_cache == NULL )
+    {
+        /* without a cache the column hands over its own reference */
+        return VColumnReadBlob ( col, & ref -> blob, row_id, & ref -> elem_bits,
+            & ref -> base, & ref -> boff, & ref -> row_len, NULL, NULL );
+    }
+
+    /* the blob may belong to the cache, so take a reference of our own */
+    rc = VCursorReadColumnDirectInt ( self, row_id, col_idx, & ref -> elem_bits,
+        & ref -> base, & ref -> boff, & ref -> row_len, NULL, & blob );
+    if ( rc == 0 )
+    {
+        rc = VBlobAddRef ( ( VBlob* ) blob );
+        if ( rc == 0 )
+            ref -> blob = blob;
+    }
+    return rc;
+}
+
+LIB_EXPORT rc_t CC VCursorCellDataPinned ( const VCursor *self, int64_t row_id,
+    uint32_t col_idx, VCellRef *ref )
+{
+    rc_t rc;
+
+    if ( ref == NULL )
+        return RC ( rcVDB, rcCursor, rcReading, rcParam, rcNull );
+
+    memset ( ref, 0, sizeof * ref );
+
+    if ( self == NULL )
+        return RC ( rcVDB, rcCursor, rcReading, rcSelf, rcNull );
+    if ( ! self -> read_only )
+        return RC ( rcVDB, rcCursor, rcReading, rcCursor, rcWriteonly );
+
+    switch ( self -> state )
+    {
+    case vcConstruct:
+        return RC ( rcVDB, rcCursor, rcReading, rcCursor, rcNotOpen );
+    case vcReady:
+    case vcRowOpen:
+        break;
+    default:
+        return RC ( rcVDB, rcCursor, rcReading, rcCursor, rcInvalid );
+    }
+
+    /* prefer a non-empty cell from the cache cursor, as "CellDataDirect" does */
+    if ( self -> cache_curs != NULL )
+    {
+        const VCursor *curs = VectorGet ( & self -> v_cache_curs, col_idx );
+        if ( curs != NULL )
+        {
+            uint32_t cidx = ( uint32_t ) ( uint64_t ) VectorGet ( & self -> v_cache_cidx, col_idx );
+            rc = VCursorCellDataPinnedInt ( curs, row_id, cidx, ref );
+            if ( rc == 0 )
+            {
+                if ( ref -> row_len > 0 )
+                    return 0;
+                VCellRefRelease ( ref );
+            }
+            memset ( ref, 0, sizeof * ref );
+        }
+    }
+
+    rc = VCursorCellDataPinnedInt ( self, row_id, col_idx, ref );
+    if ( rc != 0 )
+        memset ( ref, 0, sizeof * ref );
+    return rc;
+}
+
+LIB_EXPORT rc_t CC VCellRefRelease ( VCellRef *ref )
+{
+    rc_t rc = 0;
+    if ( ref != NULL )
+    {
+        if ( ref -> blob != NULL )
+            rc = VBlobRelease ( ( VBlob* ) ref -> blob );
+        memset ( ref, 0, sizeof * ref );
+    }
+    return rc;
+}
+
+static
+rc_t VCursorReadBatchBlob ( const VCursor *self, const VColumn *col, const VBlob *blob,
+    int64_t row_id, uint64_t count, VCursorBatchFunc f, void *data )
+{
+    rc_t rc;
+    uint64_t i, avail = 0;
+    PageMapIterator iter;
+    uint32_t elem_bits = VTypedescSizeof ( & col -> desc );
+
+    /* the page map may still be under construction on the pagemap thread */
+    rc = VBlobResolvePageMap ( blob );
+    if ( rc != 0 )
+        return rc;
+
+    if ( blob -> pm != NULL )
+    {
+        rc = PageMapNewIterator ( blob -> pm, & iter, row_id - blob -> start_id, count );
+        if ( rc != 0 )
+            return rc;
+
+        /* the map may describe fewer rows than the blob's id range, e.g. static columns */
+        avail = iter . last_row - iter . cur_row;
+    }
+
+    for ( i = 0; rc == 0 && i < count; ++ i )
+    {
+        uint64_t start;
+        uint32_t boff, row_len;
+        const void *base;
+
+        if ( i < avail )
+        {
+            row_len = PageMapIteratorDataLength ( & iter );
+            start = ( uint64_t ) PageMapIteratorDataOffset ( & iter ) * elem_bits;
+            base = ( const uint8_t* ) blob -> data . base + ( start >> 3 );
+            boff = ( uint32_t ) start & 7;
+            PageMapIteratorNext ( & iter );
+        }
+        else
+        {
+            uint32_t bits, repeat_count;
+            rc = VColumnReadCachedBlob ( col, blob, row_id + i, & bits, & base, & boff, & row_len, & repeat_count );
+            if ( rc != 0 )
+                break;
+        }
+
+        rc = ( * f ) ( row_id + i, elem_bits, base, boff, row_len, data );
+    }
+
+    return rc;
+}
+
+LIB_EXPORT rc_t CC VCursorReadBatch ( const VCursor *self, uint32_t col_idx,
+    int64_t first_row, uint64_t count, VCursorBatchFunc f, void *data )
+{
+    rc_t rc = 0;
+    const VColumn *col;
+    int64_t row_id, end_id;
+
+    if ( self == NULL )
+        return RC ( rcVDB, rcCursor, rcReading, rcSelf, rcNull );
+    if ( f == NULL )
+        return RC ( rcVDB, rcCursor, rcReading, rcFunction, rcNull );
+    if ( ! self -> read_only )
+        return RC ( rcVDB, rcCursor, rcReading, rcCursor, rcWriteonly );
+
+    switch ( self -> state )
+    {
+    case vcConstruct:
+        return RC ( rcVDB, rcCursor, rcReading, rcCursor, rcNotOpen );
+    case vcReady:
+    case vcRowOpen:
+        break;
+    default:
+        return RC ( rcVDB, rcCursor, rcReading, rcCursor, rcInvalid );
+    }
+
+    col = ( const void* ) VectorGet ( & self -> row, col_idx );
+    if ( col == NULL )
+        return RC ( rcVDB, rcCursor, rcReading, rcColumn, rcInvalid );
+
+    end_id = first_row + ( int64_t ) count;
+    for ( row_id = first_row; rc == 0 && row_id < end_id; )
+    {
+        /* columns served by a cache cursor keep their per-row fallback logic */
+        if ( self -> cache_curs != NULL )
+        {
+            uint32_t elem_bits, boff, row_len;
+            const void *base;
+
+            rc = VCursorCellDataDirect ( self, row_id, col_idx, & elem_bits, & base, & boff, & row_len );
+            if ( rc == 0 )
+                rc = ( * f ) ( row_id, elem_bits, base, boff, row_len, data );
+            ++ row_id;
+        }
+        else
+        {
+            const VBlob *blob;
+            rc = VCursorGetBlobDirect ( self, & blob, row_id, col_idx );
+            if ( rc == 0 )
+            {
+                int64_t stop_id = blob -> stop_id < end_id ? blob -> stop_id : end_id - 1;
+                rc = VCursorReadBatchBlob ( self, col, blob, row_id, stop_id - row_id + 1, f, data );
+                row_id = stop_id + 1;
+                VBlobRelease ( ( VBlob* ) blob );
+            }
+        }
+    }
+
+    return rc;
+}
+
 LIB_EXPORT rc_t CC VCursorDataPrefetch ( const VCursor *cself, const int64_t *row_ids, uint32_t col_idx, uint32_t num_rows,int64_t min_valid_row_id, int64_t max_valid_row_id, bool continue_on_error)
 {
 	rc_t rc=0;
@@ -2104,15 +2509,18 @@ LIB_EXPORT rc_t CC VCursorDataPrefetch ( const VCursor *cself, const int64_t *ro
 						blob=(VBlob*)VBlobMRUCacheFind(cself->blob_mru_cache,col_idx,row_id);
 						if(blob){
 							last_cached_row_id = blob->stop_id;
+							VBlobRelease(blob);
 						} else { /* prefetch it **/
 							/** ask production for the blob **/
 							VBlobMRUCacheCursorContext cctx;
+							uint64_t started = KTimeNsStamp();
 
 							cctx.cache=cself -> blob_mru_cache;
 							cctx.col_idx = col_idx;
 							rc = VProductionReadBlob ( col->in, & blob, row_id, 1, &cctx );
 							if(rc == 0){
 								rc_t rc_cache;
+								VBlobMRUCacheRecordMiss(cself->blob_mru_cache,col_idx,blob,KTimeNsStamp()-started);
 								/** always cache prefetch requests **/
 								if(first_time){ 
 									VBlobMRUCacheResumeFlush(cself->blob_mru_cache); /** next call will clean cache if too big **/
@@ -2504,112 +2912,20 @@ LIB_EXPORT struct VSchema const * CC VCursorGetSchema ( struct VCursor const *se
 }
 
 
-static rc_t run_pagemap_thread ( const KThread *t, void *data )
-{
-    rc_t rc;
-    VCursor *self = data;
-    /* acquire lock */
-    MTCURSOR_DBG (( "run_pagemap_thread: acquiring lock\n" ));
-    while((rc = KLockAcquire ( self -> pmpr.lock ))==0){
-CHECK_AGAIN:
-	switch(self->pmpr.state){
-	 case ePMPR_STATE_NONE: 		/* wait for new request */
-	 case ePMPR_STATE_SERIALIZE_DONE: 	/* wait for result pickup **/
-	 case ePMPR_STATE_DESERIALIZE_DONE:	/* wait for result pickup **/
-		MTCURSOR_DBG (( "run_pagemap_thread: waiting for new request\n" ));
-		rc = KConditionWait ( self -> pmpr.cond, self -> pmpr.lock );
-		goto CHECK_AGAIN;
-	 case ePMPR_STATE_EXIT: /** exit requested ***/
-		MTCURSOR_DBG (( "run_pagemap_thread: exit by request\n" ));
-		KLockUnlock(self -> pmpr.lock);
-		return 0;
-	 case ePMPR_STATE_DESERIALIZE_REQUESTED:
-		MTCURSOR_DBG (( "run_pagemap_thread: request to deserialize\n" ));
-		self->pmpr.rc = PageMapDeserialize(&self->pmpr.pm,self->pmpr.data.base,self->pmpr.data.elem_count,self->pmpr.row_count);
-		if(self->pmpr.rc == 0){
-			self->pmpr.rc=PageMapExpandFull(self->pmpr.pm);
-			/*self->pmpr.rc=PageMapExpand(self->pmpr.pm,self->pmpr.row_count<2048?self->pmpr.row_count-1:2048);*/
-			assert(self->pmpr.rc == 0);
-		}
-		self->pmpr.state = ePMPR_STATE_DESERIALIZE_DONE;
-		/*fprintf(stderr,"Pagemap %p Done R:%6d|DR:%d|LR:%d\n",self->pmpr.lock, self->pmpr.pm->row_count,self->pmpr.pm->data_recs,self->pmpr.pm->leng_recs);*/
-		KConditionSignal ( self -> pmpr.cond );
-		KLockUnlock(self -> pmpr.lock);
-		break;
-	 case ePMPR_STATE_SERIALIZE_REQUESTED:
-		MTCURSOR_DBG (( "run_pagemap_thread: request to serialize\n" ));
-		self->pmpr.rc = PageMapSerialize(self->pmpr.pm,&self->pmpr.data,0,&self->pmpr.elem_count);
-		self->pmpr.state = ePMPR_STATE_SERIALIZE_DONE;
-		KConditionSignal ( self -> pmpr.cond );
-		KLockUnlock(self -> pmpr.lock);
-		break;
-	 default:
-		assert(0);
-		KLockUnlock(self -> pmpr.lock);
-		return RC(rcVDB, rcPagemap, rcConverting, rcParam, rcInvalid );
-	 
-	}
-    }
-    MTCURSOR_DBG (( "run_pagemap_thread: exit\n" ));
-    return rc;
-}
-
-rc_t VCursorLaunchPagemapThread(VCursor *curs)
+rc_t VCursorAttachPagemapPool(VCursor *curs)
 {
 	rc_t rc;
 
     assert ( curs != NULL );
-	curs -> pagemap_thread = NULL; /** if fails - will not use **/
+	curs -> pagemap_pool = NULL; /** if fails - will not use **/
 
     if ( s_disable_pagemap_thread )
         return RC ( rcVDB, rcCursor, rcExecuting, rcThread, rcNotAvailable );
 
-	rc = KLockMake ( & curs -> pmpr.lock );
-	if(rc == 0)
-    {
-		rc = KConditionMake ( & curs -> pmpr.cond );
-        if(rc == 0)
-        {
-            rc = KThreadMake ( & curs -> pagemap_thread, run_pagemap_thread, curs );
-            if ( rc == 0 )
-                return 0;
-
-            KConditionRelease ( curs -> pmpr . cond );
-            curs -> pmpr . cond = NULL;
-        }
-
-        KLockRelease ( curs -> pmpr . lock );
-        curs -> pmpr . lock = NULL;
-    }
-
-	return rc;
-}
-
-rc_t VCursorTerminatePagemapThread(VCursor *self)
-{
-	rc_t rc=0;
-
-    assert ( self != NULL );
-
-	if(self -> pagemap_thread != NULL)
-    {
-		rc = KLockAcquire ( self -> pmpr.lock );
-		if ( rc == 0 )
-        {
-			self -> pmpr.state = ePMPR_STATE_EXIT;
-			KConditionSignal ( self -> pmpr.cond );
-			KLockUnlock ( self -> pmpr.lock );
-		}
-		KThreadWait ( self -> pagemap_thread, NULL );
-	}
-
-	KThreadRelease ( self -> pagemap_thread );
-	KConditionRelease ( self -> pmpr.cond );
-	KLockRelease ( self -> pmpr.lock );
-
-    self -> pagemap_thread = NULL;
-    self -> pmpr . cond = NULL;
-    self -> pmpr . lock = NULL;
+    /* one pool serves every cursor of the manager */
+	rc = VDBManagerGetPagemapPool ( curs -> tbl -> mgr, & curs -> pagemap_pool );
+	if ( rc != 0 )
+        curs -> pagemap_pool = NULL;
 
 	return rc;
 }
@@ -2668,3 +2984,118 @@ LIB_EXPORT uint64_t CC VCursorGetCacheCapacity(const VCursor *self)
 	if(self) return VBlobMRUCacheGetCapacity(self->blob_mru_cache);
 	return 0;
 }
+
+/* ListPhysicalColumns
+ *  lists physical columns opened by the cursor
+ */
+LIB_EXPORT rc_t CC VCursorListPhysicalColumns ( const VCursor *self, KNamelist **names )
+{
+    rc_t rc;
+    VNamelist *list;
+    uint32_t i, end;
+
+    if ( names == NULL )
+        return RC ( rcVDB, rcCursor, rcListing, rcParam, rcNull );
+
+    * names = NULL;
+
+    if ( self == NULL )
+        return RC ( rcVDB, rcCursor, rcListing, rcSelf, rcNull );
+
+    rc = VNamelistMake ( & list, 16 );
+    if ( rc != 0 )
+        return rc;
+
+    /* physical columns are cached by context, then by member */
+    i = VectorStart ( & self -> phys . cache );
+    end = i + VectorLength ( & self -> phys . cache );
+    for ( ; rc == 0 && i < end; ++ i )
+    {
+        const Vector *ctx = VectorGet ( & self -> phys . cache, i );
+        if ( ctx != NULL )
+        {
+            uint32_t j = VectorStart ( ctx );
+            uint32_t jend = j + VectorLength ( ctx );
+            for ( ; rc == 0 && j < jend; ++ j )
+            {
+                const VPhysical *phys = VectorGet ( ctx, j );
+                if ( phys != NULL && ( phys -> kcol != NULL || phys -> knode != NULL ) )
+                {
+                    String name = phys -> smbr -> name -> name;
+                    if ( name . size != 0 && name . addr [ 0 ] == '.' )
+                    {
+                        ++ name . addr;
+                        -- name . size;
+                        -- name . len;
+                    }
+                    rc = VNamelistAppendString ( list, & name );
+                }
+            }
+        }
+    }
+
+    if ( rc == 0 )
+        rc = VNamelistToNamelist ( list, names );
+
+    VNamelistRelease ( list );
+    return rc;
+}
+
+/* SetCacheDepth
+ *  number of recently used blobs kept per column
+ */
+LIB_EXPORT rc_t CC VCursorSetCacheDepth ( const VCursor *self, uint32_t depth )
+{
+    if ( self == NULL )
+        return RC ( rcVDB, rcCursor, rcUpdating, rcSelf, rcNull );
+    if ( self -> state != vcConstruct )
+        return RC ( rcVDB, rcCursor, rcUpdating, rcCursor, rcBusy );
+    if ( self -> blob_mru_cache == NULL )
+        return RC ( rcVDB, rcCursor, rcUpdating, rcBuffer, rcNotAvailable );
+
+    return VBlobMRUCacheSetDepth ( self -> blob_mru_cache, depth );
+}
+
+/* GetCacheStats
+ *  report how well the blob cache serves reads
+ */
+LIB_EXPORT rc_t CC VCursorGetCacheStats ( const VCursor *self,
+    uint32_t col_idx, VCursorCacheStats *stats )
+{
+    if ( stats == NULL )
+        return RC ( rcVDB, rcCursor, rcAccessing, rcParam, rcNull );
+
+    memset ( stats, 0, sizeof * stats );
+
+    if ( self == NULL )
+        return RC ( rcVDB, rcCursor, rcAccessing, rcSelf, rcNull );
+    if ( col_idx != 0 && VectorGet ( & self -> row, col_idx ) == NULL )
+        return RC ( rcVDB, rcCursor, rcAccessing, rcColumn, rcInvalid );
+    if ( self -> blob_mru_cache == NULL )
+        return RC ( rcVDB, rcCursor, rcAccessing, rcBuffer, rcNotAvailable );
+
+    return VBlobMRUCacheGetStats ( self -> blob_mru_cache, col_idx, stats );
+}
+
+/* SetCacheAdaptive
+ *  let cache capacity follow the re-reference distance
+ */
+LIB_EXPORT rc_t CC VCursorSetCacheAdaptive ( const VCursor *self, bool enable )
+{
+    rc_t rc;
+    VBlobCacheBudget *budget = NULL;
+
+    if ( self == NULL )
+        return RC ( rcVDB, rcCursor, rcUpdating, rcSelf, rcNull );
+    if ( self -> blob_mru_cache == NULL )
+        return RC ( rcVDB, rcCursor, rcUpdating, rcBuffer, rcNotAvailable );
+
+    if ( enable )
+    {
+        rc = VDBManagerGetCacheBudget ( self -> tbl -> mgr, & budget );
+        if ( rc != 0 )
+            return rc;
+    }
+
+    return VBlobMRUCacheSetAdaptive ( self -> blob_mru_cache, budget );
+}
@@ -77,13 +77,16 @@ struct KLock;
 struct KCondition;
 struct KThread;
 struct KNamelist;
+struct VNamelist;
 struct KDlset;
 struct VTable;
 struct VCtxId;
 struct VSchema;
 struct SColumn;
+struct VCursorEncodePool;
 struct VColumn;
 struct VPhysical;
+struct VCursorPrefetch;
 
 
 /*--------------------------------------------------------------------------
@@ -172,9 +175,12 @@ struct VCursor
     struct KLock *flush_lock;
     struct KCondition *flush_cond;
 
-    /* background pagemap conversion objects */
-    struct KThread *pagemap_thread;
-    PageMapProcessRequest pmpr;
+    /* threads encoding columns during flush */
+    uint32_t flush_threads;
+    struct VCursorEncodePool *encode_pool;
+
+    /* manager's background pagemap conversion ( not owned ) */
+    PageMapProcessPool *pagemap_pool;
 
     /* user data */
     void *user;
@@ -189,6 +195,13 @@ struct VCursor
     /* read-only blob cache */
     VBlobMRUCache *blob_mru_cache;
 
+    /* manager's cache shared with other read cursors ( not owned ) */
+    VBlobSharedCache *shared_blob_cache;
+    uint64_t shared_blob_key;
+
+    /* outstanding asynchronous prefetch ( owned ) */
+    struct VCursorPrefetch *prefetch;
+
     /* external row of VColumn* by ord ( owned ) */
     Vector row;
     
@@ -236,6 +249,8 @@ struct VCursor
     bool is_sub_cursor; 
     /* cursor for VDB columns located in separate db.tbl ***/
     const struct VCursor* cache_curs;
+    /* simple names of the only columns a projected cursor may add ( owned ) */
+    struct VNamelist *projection;
 };
 
 
@@ -310,9 +325,14 @@ rc_t VCursorOpenRowRead ( struct VCursor *self );
 rc_t VCursorCloseRowRead ( struct VCursor *self );
 
 
-/** pagemap supporting thread **/
-rc_t VCursorLaunchPagemapThread(struct VCursor *self);
-rc_t VCursorTerminatePagemapThread(struct VCursor *self);
+/* PrefetchWhack
+ *  cancel and collect outstanding asynchronous prefetch
+ */
+void VCursorPrefetchWhack ( struct VCursorPrefetch *self );
+
+
+/** pagemap supporting threads **/
+rc_t VCursorAttachPagemapPool(struct VCursor *self);
 
 
 #ifdef __cplusplus
@@ -35,6 +35,7 @@
 
 #include "schema-priv.h"
 #include "linker-priv.h"
+#include "blob-priv.h"
 
 #include <vdb/manager.h>
 #include <vdb/database.h>
@@ -90,6 +91,9 @@ rc_t VDBManagerWhack ( VDBManager *self )
 
         VSchemaRelease ( self -> schema );
         VLinkerRelease ( self -> linker );
+        VBlobSharedCacheDestroy ( self -> blob_cache . ptr );
+        PageMapProcessPoolRelease ( self -> pagemap_pool . ptr );
+        VBlobCacheBudgetDestroy ( self -> cache_budget . ptr );
         free ( self );
         return 0;
     }
@@ -490,6 +494,131 @@ LIB_EXPORT rc_t CC VDBManagerSetUserData ( const VDBManager *cself,
     return 0;
 }
 
+/* EnableSharedBlobCache
+ *  share decoded blobs among read cursors
+ */
+LIB_EXPORT rc_t CC VDBManagerEnableSharedBlobCache ( const VDBManager *cself, size_t capacity )
+{
+    rc_t rc;
+    VBlobSharedCache *cache;
+    VDBManager *self = ( VDBManager* ) cself;
+
+    if ( cself == NULL )
+        return RC ( rcVDB, rcMgr, rcUpdating, rcSelf, rcNull );
+
+    cache = self -> blob_cache . ptr;
+    if ( cache != NULL )
+    {
+        VBlobSharedCacheSetCapacity ( cache, capacity );
+        return 0;
+    }
+
+    rc = VBlobSharedCacheMake ( & cache, capacity );
+    if ( rc == 0 )
+    {
+        /* another thread may have enabled it meanwhile */
+        VBlobSharedCache *existing = atomic_test_and_set_ptr ( & self -> blob_cache, cache, NULL );
+        if ( existing != NULL )
+        {
+            VBlobSharedCacheDestroy ( cache );
+            VBlobSharedCacheSetCapacity ( existing, capacity );
+        }
+    }
+
+    return rc;
+}
+
+/* GetPagemapPool
+ *  returns the pool of pagemap workers, starting it on first use
+ */
+rc_t VDBManagerGetPagemapPool ( const VDBManager *cself, PageMapProcessPool **poolp )
+{
+    rc_t rc;
+    PageMapProcessPool *pool;
+    VDBManager *self = ( VDBManager* ) cself;
+
+    assert ( self != NULL );
+    assert ( poolp != NULL );
+
+    pool = self -> pagemap_pool . ptr;
+    if ( pool == NULL )
+    {
+        rc = PageMapProcessPoolMake ( & pool, VDB_PAGEMAP_THREADS );
+        if ( rc != 0 )
+            return rc;
+
+        /* another cursor may have started it meanwhile */
+        {
+            PageMapProcessPool *existing = atomic_test_and_set_ptr ( & self -> pagemap_pool, pool, NULL );
+            if ( existing != NULL )
+            {
+                PageMapProcessPoolRelease ( pool );
+                pool = existing;
+            }
+        }
+    }
+
+    * poolp = pool;
+    return 0;
+}
+
+/* SetCacheBudget
+ *  limit the memory adaptive cursor caches may add together
+ */
+static
+rc_t VDBManagerMakeCacheBudget ( VDBManager *self, size_t bytes, VBlobCacheBudget **budgetp )
+{
+    VBlobCacheBudget *budget;
+    rc_t rc = VBlobCacheBudgetMake ( & budget, bytes );
+    if ( rc == 0 )
+    {
+        /* another thread may have made it meanwhile */
+        VBlobCacheBudget *existing = atomic_test_and_set_ptr ( & self -> cache_budget, budget, NULL );
+        if ( existing != NULL )
+        {
+            VBlobCacheBudgetDestroy ( budget );
+            budget = existing;
+        }
+        * budgetp = budget;
+    }
+    return rc;
+}
+
+LIB_EXPORT rc_t CC VDBManagerSetCacheBudget ( const VDBManager *cself, size_t bytes )
+{
+    rc_t rc = 0;
+    VBlobCacheBudget *budget;
+    VDBManager *self = ( VDBManager* ) cself;
+
+    if ( cself == NULL )
+        return RC ( rcVDB, rcMgr, rcUpdating, rcSelf, rcNull );
+
+    budget = self -> cache_budget . ptr;
+    if ( budget == NULL )
+        rc = VDBManagerMakeCacheBudget ( self, bytes, & budget );
+    if ( rc == 0 )
+        VBlobCacheBudgetSetLimit ( budget, bytes );
+
+    return rc;
+}
+
+/* GetCacheBudget
+ *  returns the budget of adaptive cursor caches, creating it on first use
+ */
+rc_t VDBManagerGetCacheBudget ( const VDBManager *cself, VBlobCacheBudget **budgetp )
+{
+    VDBManager *self = ( VDBManager* ) cself;
+
+    assert ( self != NULL );
+    assert ( budgetp != NULL );
+
+    * budgetp = self -> cache_budget . ptr;
+    if ( * budgetp != NULL )
+        return 0;
+
+    return VDBManagerMakeCacheBudget ( self, VDB_CACHE_BUDGET, budgetp );
+}
+
 /* OpenKDBManager
  *  returns a new reference to KDBManager used by VDBManager
  */
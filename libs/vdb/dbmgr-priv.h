@@ -43,6 +43,8 @@
 #include <klib/refcount.h>
 #endif
 
+#include <atomic.h>
+
 #ifndef KONST
 #define KONST
 #endif
@@ -59,6 +61,9 @@ extern "C" {
 struct KDBManager;
 struct VSchema;
 struct VLinker;
+struct VBlobSharedCache;
+struct PageMapProcessPool;
+struct VBlobCacheBudget;
 
 
 /*--------------------------------------------------------------------------
@@ -80,6 +85,15 @@ struct VDBManager
     void *user;
     void ( CC * user_whack ) ( void *data );
 
+    /* blobs shared by all read cursors, once enabled ( struct VBlobSharedCache* ) */
+    atomic_ptr_t blob_cache;
+
+    /* pagemap workers for all cursors, once needed ( struct PageMapProcessPool* ) */
+    atomic_ptr_t pagemap_pool;
+
+    /* memory for adaptive cursor caches, once needed ( struct VBlobCacheBudget* ) */
+    atomic_ptr_t cache_budget;
+
     /* open references */
     KRefcount refcount;
 };
@@ -91,6 +105,20 @@ struct VDBManager
 VDBManager *VDBManagerAttach ( const VDBManager *self );
 rc_t VDBManagerSever ( const VDBManager *self );
 
+/* GetPagemapPool
+ *  returns the pool of pagemap workers, starting it on first use
+ *  the pool is owned by manager
+ */
+#define VDB_PAGEMAP_THREADS 4
+rc_t VDBManagerGetPagemapPool ( const VDBManager *self, struct PageMapProcessPool **pool );
+
+/* GetCacheBudget
+ *  returns the budget of adaptive cursor caches, creating it on first use
+ *  the budget is owned by manager
+ */
+#define VDB_CACHE_BUDGET ( ( size_t ) 256 * 1024 * 1024 )
+rc_t VDBManagerGetCacheBudget ( const VDBManager *self, struct VBlobCacheBudget **budget );
+
 
 /* ConfigPaths
  *  looks for configuration information to set
@@ -98,6 +98,9 @@ LIB_EXPORT rc_t CC VDBManagerMakeReadWithVFSManager ( const VDBManager ** mgrp,
                         {
                             mgr -> user = NULL;
                             mgr -> user_whack = NULL;
+                            mgr -> blob_cache . ptr = NULL;
+                            mgr -> pagemap_pool . ptr = NULL;
+                            mgr -> cache_budget . ptr = NULL;
                             KRefcountInit ( & mgr -> refcount, 1, "VDBManager", "make-read", "vmgr" );
                             * mgrp = mgr;
                             return 0;
@@ -189,6 +189,7 @@ extern VTRANSFACT_DECL ( vdb_extract_token );
 extern VTRANSFACT_DECL ( vdb_fixed_vec_sum );
 extern VTRANSFACT_DECL ( vdb_floor );
 extern VTRANSFACT_DECL ( vdb_funzip );
+extern VTRANSFACT_DECL ( vdb_ibpunzip );
 extern VTRANSFACT_DECL ( vdb_integral );
 extern VTRANSFACT_DECL ( vdb_integral_0 );
 extern VTRANSFACT_DECL ( vdb_iunzip );
@@ -213,6 +214,7 @@ extern VTRANSFACT_DECL ( vdb_trunc );
 extern VTRANSFACT_DECL ( vdb_undelta );
 extern VTRANSFACT_DECL ( vdb_unpack );
 extern VTRANSFACT_DECL ( vdb_unzip );
+extern VTRANSFACT_DECL ( vdb_unzstd );
 extern VTRANSFACT_DECL ( vdb_vec_sum );
 
 struct KTable;
@@ -576,6 +578,7 @@ rc_t VLinkerInitFactoriesRead ( VLinker *self,  KSymTable *tbl, const SchemaEnv
         { vdb_fixed_vec_sum, "vdb:fixed_vec_sum" },
         { vdb_floor, "vdb:floor" },
         { vdb_funzip, "vdb:funzip" },
+        { vdb_ibpunzip, "vdb:ibpunzip" },
         { vdb_integral, "vdb:integral" },
         { vdb_integral_0, "vdb:integral_0" },
         { vdb_iunzip, "vdb:iunzip" },
@@ -599,6 +602,7 @@ rc_t VLinkerInitFactoriesRead ( VLinker *self,  KSymTable *tbl, const SchemaEnv
         { vdb_undelta, "vdb:undelta" },
         { vdb_unpack, "vdb:unpack" },
         { vdb_unzip, "vdb:unzip" },
+        { vdb_unzstd, "vdb:unzstd" },
         { vdb_vec_sum, "vdb:vec_sum" },
 
         { vdb_hello, "vdb:hello" }
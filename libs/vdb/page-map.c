@@ -204,6 +204,15 @@ rc_t PageMapExpandFull(const PageMap *cself)
 ******************/
 }
 
+rc_t PageMapExpandAll(const PageMap *cself)
+{
+	if(cself->data_recs == 1 || (cself->random_access && cself->leng_recs == 1))
+		return 0; /** lookups never expand these **/
+	if(cself->row_count == 0 || cself->exp_row_last >= cself->row_count)
+		return 0;
+	return PageMapExpand(cself, cself->row_count - 1);
+}
+
 rc_t PageMapExpand(const PageMap *cself, row_count_t upto)
 {
 	rc_t	rc;
@@ -341,7 +350,9 @@ static rc_t PageMapFindRegion(const PageMap *cself,uint64_t row,PageMapRegion **
 	}
 
 	if(cself->exp_rgn_cnt > 1){
-		i_rgn = cself->i_rgn_last;
+		i_rgn = ( pm_size_t ) atomic32_read ( & cself->i_rgn_last );
+		if(i_rgn >= cself->exp_rgn_cnt)
+			i_rgn = 0;
 		left = 0;
 		right = cself->exp_rgn_cnt - 1;
 		while(right > left){
@@ -362,13 +373,9 @@ static rc_t PageMapFindRegion(const PageMap *cself,uint64_t row,PageMapRegion **
 	} else {
 		i_rgn = 0;
 	}
-	{
-		PageMap *self = (PageMap *)cself;
-		self->i_rgn_last = i_rgn;
-		self->rgn_last = (PageMapRegion*)self->istorage.base+cself->i_rgn_last;
-	}
-	assert(cself->rgn_last->start_row <= row);
-	assert(cself->rgn_last->start_row + cself->rgn_last->numrows > row);
+	atomic32_set ( & ( ( PageMap* ) cself ) -> i_rgn_last, ( int ) i_rgn );
+	assert(((PageMapRegion*)cself->istorage.base + i_rgn)->start_row <= row);
+	assert(((PageMapRegion*)cself->istorage.base + i_rgn)->start_row + ((PageMapRegion*)cself->istorage.base + i_rgn)->numrows > row);
 	if(pmr) *pmr=(PageMapRegion*)cself->istorage.base + i_rgn;
 	return 0;
 }
@@ -521,6 +528,7 @@ rc_t PageMapFindRow(const PageMap *cself,uint64_t row,uint32_t * data_offset,uin
 rc_t PageMapNewIterator(const PageMap *self, PageMapIterator *lhs, uint64_t first_row, uint64_t num_rows)
 {
     rc_t rc;
+    PageMapRegion *pmr;
 
     if (first_row + num_rows > self->row_count)
         num_rows = self->row_count - first_row;
@@ -556,13 +564,14 @@ rc_t PageMapNewIterator(const PageMap *self, PageMapIterator *lhs, uint64_t firs
 	    rc = PageMapExpand(self,lhs->last_row-1);
 	    if(rc) return rc;
     }
-    rc = PageMapFindRow(self,first_row,NULL,NULL,NULL);
+    rc = PageMapFindRegion(self,first_row,&pmr);
     if(rc) return rc;
     lhs->rgns    = (PageMapRegion**) &self->istorage.base;
     lhs->exp_base = (elem_count_t**) &self->dstorage.base;
-    lhs->cur_rgn  = self->i_rgn_last;
-    lhs->cur_rgn_row = lhs->cur_row - (*lhs->rgns)[self->i_rgn_last].start_row;
-    assert(lhs->cur_rgn_row < (*lhs->rgns)[self->i_rgn_last].numrows);
+    /** take the region found rather than i_rgn_last, which another reader of a shared map may have moved **/
+    lhs->cur_rgn  = (pm_size_t)(pmr - *lhs->rgns);
+    lhs->cur_rgn_row = lhs->cur_row - pmr->start_row;
+    assert(lhs->cur_rgn_row < pmr->numrows);
     return  0;
 }
 
@@ -39,6 +39,7 @@
 
 #include <klib/data-buffer.h>
 #include <klib/refcount.h>
+#include <atomic32.h>
 
 #if _DEBUGGING
 #define _HEAVY_PAGEMAP_DEBUGGING 0
@@ -113,8 +114,8 @@ typedef struct PageMap {
     KDataBuffer			istorage;	/* binary searchable storage for expansion regions */
     KDataBuffer			dstorage;	/* storage for expanded data */
 /** LAST SEARCH CONTROL *****/
-    pm_size_t			i_rgn_last; 	/* region index found in previous lookup **/
-    PageMapRegion*		rgn_last; 	/* redundant - region found in previous lookup **/
+    atomic32_t			i_rgn_last; 	/* region index found in previous lookup; only a hint,
+    						   since readers of a shared map move it concurrently **/
 
 /****************************/
 
@@ -380,5 +381,7 @@ bool PageMapHasRows(const PageMap *self);
 rc_t PageMapExpand(const PageMap *cself, row_count_t upto);
 rc_t PageMapExpandFull(const PageMap *cself);
 rc_t PageMapPreExpandFull(const PageMap *cself, row_count_t upto);
+/*** expand every row so that lookups no longer modify the map, e.g. before the map is shared between threads ***/
+rc_t PageMapExpandAll(const PageMap *cself);
 
 #endif /* _h_page_map_ */
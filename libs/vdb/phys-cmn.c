@@ -575,7 +575,7 @@ rc_t VPhysicalReadBlob ( VPhysical *self, VBlob **vblob, int64_t id, uint32_t el
     {
 	    if((*vblob)->pm==NULL)
         {
-            rc = PageMapProcessGetPagemap(&self->curs->pmpr,&(*vblob)->pm);
+            rc = VBlobResolvePageMap(*vblob);
 	    }
     }
 
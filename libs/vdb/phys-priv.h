@@ -103,7 +103,8 @@ struct VPhysical
     /* output of decompression schema */
     struct VProduction *b2p;
 
-    /* output of compression schema */
+    /* input and output of compression schema */
+    struct VProduction *p2b;
     struct VProduction *b2s;
 
     /* write production
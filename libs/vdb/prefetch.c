@@ -0,0 +1,620 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include <vdb/extern.h>
+
+#define TRACK_REFERENCES 0
+
+#define KONST const
+#define SKONST
+#include "cursor-priv.h"
+#include "column-priv.h"
+#include "schema-priv.h"
+#include "prod-priv.h"
+#include "phys-priv.h"
+#undef KONST
+#undef SKONST
+#include "blob-priv.h"
+
+#include <vdb/cursor.h>
+#include <vdb/table.h>
+#include <vdb/schema.h>
+#include <kdb/column.h>
+#include <klib/symbol.h>
+#include <klib/refcount.h>
+#include <klib/sort.h>
+#include <klib/rc.h>
+#include <klib/time.h>
+#include <sysalloc.h>
+
+#include <kproc/lock.h>
+#include <kproc/thread.h>
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+
+#define DEFAULT_PREFETCH_THREADS 4
+#define MAX_PREFETCH_THREADS 64
+
+
+/*--------------------------------------------------------------------------
+ * VCursorPrefetch
+ *  a set of sorted row ids being decoded by a pool of worker threads
+ *  each worker opens its own read cursor onto the table, since
+ *  productions carry per-cursor state and cannot be shared.
+ *  rows are grouped by the blob holding them before workers start,
+ *  and a group is handed to a single worker, so that no blob is
+ *  decoded by several workers at once.
+ *  decoded blobs are published into the owning cursor's cache.
+ */
+struct VCursorPrefetch
+{
+    /* owning cursor - not attached, since the cursor collects us */
+    const VCursor *curs;
+
+    /* sorted unique row ids */
+    int64_t *row_ids;
+    uint32_t num_rows;
+
+    /* groups of rows within a single blob:
+       row_ids [ groups [ i ] ] .. row_ids [ groups [ i + 1 ] - 1 ] */
+    uint32_t *groups;
+    uint32_t num_groups;
+
+    /* next unclaimed group, guarded by lock */
+    uint32_t next;
+
+    /* column within owning cursor */
+    uint32_t col_idx;
+
+    /* first error seen by any worker */
+    rc_t rc;
+
+    /* workers still running, guarded by lock */
+    uint32_t running;
+
+    KLock *lock;
+
+    /* serializes joining between Wait and Whack */
+    KLock *join_lock;
+
+    KThread *threads [ MAX_PREFETCH_THREADS ];
+    uint32_t num_threads;
+
+    KRefcount refcount;
+
+    bool continue_on_error;
+    bool canceled;
+    bool joined;
+
+    /* column spec to be added to worker cursors */
+    char colspec [ 1 ];
+};
+
+
+static
+void VCursorPrefetchDestroy ( VCursorPrefetch *self )
+{
+    uint32_t i;
+
+    /* threads must have been collected */
+    assert ( self -> joined );
+    for ( i = 0; i < self -> num_threads; ++ i )
+        KThreadRelease ( self -> threads [ i ] );
+
+    KLockRelease ( self -> join_lock );
+    KLockRelease ( self -> lock );
+    free ( self -> groups );
+    free ( self -> row_ids );
+    free ( self );
+}
+
+LIB_EXPORT rc_t CC VCursorPrefetchRelease ( const VCursorPrefetch *self )
+{
+    if ( self != NULL )
+    {
+        switch ( KRefcountDrop ( & self -> refcount, "VCursorPrefetch" ) )
+        {
+        case krefWhack:
+            VCursorPrefetchDestroy ( ( VCursorPrefetch* ) self );
+            break;
+        case krefNegative:
+            return RC ( rcVDB, rcCursor, rcReleasing, rcRange, rcExcessive );
+        }
+    }
+    return 0;
+}
+
+/* Claim
+ *  hand out the next group of rows
+ */
+static
+bool VCursorPrefetchClaim ( VCursorPrefetch *self, uint32_t *begin, uint32_t *end )
+{
+    bool claimed = false;
+
+    if ( KLockAcquire ( self -> lock ) == 0 )
+    {
+        if ( self -> next < self -> num_groups )
+        {
+            * begin = self -> groups [ self -> next ];
+            * end = self -> groups [ ++ self -> next ];
+            claimed = true;
+        }
+        KLockUnlock ( self -> lock );
+    }
+
+    return claimed;
+}
+
+/* Finish
+ *  the last worker to leave lets the cache trim itself again
+ */
+static
+void VCursorPrefetchFinish ( VCursorPrefetch *self )
+{
+    if ( KLockAcquire ( self -> lock ) == 0 )
+    {
+        assert ( self -> running != 0 );
+        if ( -- self -> running == 0 )
+            VBlobMRUCacheResumeFlush ( self -> curs -> blob_mru_cache );
+        KLockUnlock ( self -> lock );
+    }
+}
+
+/* Fail
+ *  remember a failed blob decode
+ *  returns true if work should go on
+ */
+static
+bool VCursorPrefetchFail ( VCursorPrefetch *self, rc_t rc )
+{
+    bool go_on = self -> continue_on_error;
+
+    if ( ! go_on && KLockAcquire ( self -> lock ) == 0 )
+    {
+        if ( self -> rc == 0 )
+        {
+            /* stop handing out work */
+            self -> rc = rc;
+            self -> next = self -> num_groups;
+        }
+        KLockUnlock ( self -> lock );
+    }
+
+    return go_on;
+}
+
+static
+rc_t CC run_prefetch_thread ( const KThread *t, void *data )
+{
+    VCursorPrefetch *self = data;
+
+    uint32_t idx;
+    const VCursor *curs;
+    rc_t rc = VTableCreateCursorRead ( self -> curs -> tbl, & curs );
+    if ( rc == 0 )
+    {
+        rc = VCursorAddColumn ( curs, & idx, "%s", self -> colspec );
+        if ( rc == 0 )
+            rc = VCursorOpen ( curs );
+        if ( rc == 0 )
+        {
+            uint32_t begin, end;
+            const VBlobMRUCache *cache = self -> curs -> blob_mru_cache;
+            const VColumn *col = VectorGet ( & curs -> row, idx );
+            assert ( col != NULL );
+
+            while ( VCursorPrefetchClaim ( self, & begin, & end ) )
+            {
+                /* rows of the group may still span several blobs */
+                int64_t start_id = 1, stop_id = 0;
+                for ( ; begin < end; ++ begin )
+                {
+                    VBlob *blob;
+                    uint64_t started;
+                    int64_t row_id = self -> row_ids [ begin ];
+
+                    if ( row_id >= start_id && row_id <= stop_id )
+                        continue;
+                    if ( VBlobMRUCacheContains ( cache, self -> col_idx, row_id ) )
+                        continue;
+
+                    started = KTimeNsStamp ();
+                    rc = VProductionReadBlob ( col -> in, & blob, row_id, 1, NULL );
+                    if ( rc != 0 )
+                    {
+                        if ( ! VCursorPrefetchFail ( self, rc ) )
+                            break;
+                        continue;
+                    }
+
+                    VBlobMRUCacheRecordMiss ( cache, self -> col_idx,
+                        blob, KTimeNsStamp () - started );
+                    /* always cache prefetch requests */
+                    VBlobMRUCacheSave ( cache, self -> col_idx, blob );
+                    start_id = blob -> start_id;
+                    stop_id = blob -> stop_id;
+                    VBlobRelease ( blob );
+                }
+            }
+            rc = 0;
+        }
+
+        VCursorRelease ( curs );
+    }
+
+    if ( rc != 0 )
+        VCursorPrefetchFail ( self, rc );
+
+    VCursorPrefetchFinish ( self );
+
+    return rc;
+}
+
+/* Join
+ *  collect all worker threads
+ *  the worker lock cannot be held here, since workers need it to finish
+ */
+static
+void VCursorPrefetchJoin ( VCursorPrefetch *self )
+{
+    if ( KLockAcquire ( self -> join_lock ) == 0 )
+    {
+        if ( ! self -> joined )
+        {
+            uint32_t i;
+            for ( i = 0; i < self -> num_threads; ++ i )
+                KThreadWait ( self -> threads [ i ], NULL );
+            self -> joined = true;
+        }
+        KLockUnlock ( self -> join_lock );
+    }
+}
+
+LIB_EXPORT rc_t CC VCursorPrefetchWait ( VCursorPrefetch *self, rc_t *status )
+{
+    if ( self == NULL )
+        return RC ( rcVDB, rcCursor, rcWaiting, rcSelf, rcNull );
+
+    /* the owning cursor may have collected us already */
+    VCursorPrefetchJoin ( self );
+
+    if ( status != NULL )
+        * status = self -> rc;
+
+    if ( self -> canceled )
+        return RC ( rcVDB, rcCursor, rcWaiting, rcThread, rcCanceled );
+
+    return 0;
+}
+
+void VCursorPrefetchWhack ( VCursorPrefetch *self )
+{
+    if ( self != NULL )
+    {
+        /* cancel remaining work */
+        if ( KLockAcquire ( self -> lock ) == 0 )
+        {
+            if ( self -> next < self -> num_groups )
+            {
+                self -> next = self -> num_groups;
+                self -> canceled = true;
+            }
+            KLockUnlock ( self -> lock );
+        }
+
+        VCursorPrefetchJoin ( self );
+        VCursorPrefetchRelease ( self );
+    }
+}
+
+/* Group
+ *  group sorted rows by the blob holding them. the blob a read
+ *  production hands out lies within the blobs of every physical
+ *  column it reads, so rows sharing those are grouped together,
+ *  as found in the index of each physical column opened by "curs".
+ *  rows not located by any column are left in groups of their own.
+ */
+static
+rc_t VCursorPrefetchGroup ( VCursorPrefetch *self, const VCursor *curs )
+{
+    rc_t rc = 0;
+    uint32_t i, end, n = self -> num_rows;
+
+    int64_t *first = malloc ( ( n + 1 ) * ( 3 * sizeof * first + sizeof ( uint32_t ) ) );
+    int64_t *last = first + n;
+    int64_t *blob_first = last + n;
+    uint32_t *blob_span = ( uint32_t* ) ( blob_first + n );
+
+    self -> groups = malloc ( ( n + 1 ) * sizeof self -> groups [ 0 ] );
+    if ( first == NULL || self -> groups == NULL )
+    {
+        free ( first );
+        return RC ( rcVDB, rcCursor, rcReading, rcMemory, rcExhausted );
+    }
+
+    for ( i = 0; i < n; ++ i )
+    {
+        first [ i ] = INT64_MIN;
+        last [ i ] = INT64_MAX;
+    }
+
+    /* physical columns are cached by context, then by member */
+    i = VectorStart ( & curs -> phys . cache );
+    end = i + VectorLength ( & curs -> phys . cache );
+    for ( ; rc == 0 && i < end; ++ i )
+    {
+        const Vector *ctx = VectorGet ( & curs -> phys . cache, i );
+        if ( ctx != NULL )
+        {
+            uint32_t j = VectorStart ( ctx );
+            uint32_t jend = j + VectorLength ( ctx );
+            for ( ; rc == 0 && j < jend; ++ j )
+            {
+                const VPhysical *phys = VectorGet ( ctx, j );
+                if ( phys != NULL && phys != FAILED_PHYSICAL && phys -> kcol != NULL )
+                {
+                    uint32_t k;
+                    rc = KColumnLocateBlobs ( phys -> kcol, self -> row_ids, n, blob_first, blob_span );
+                    for ( k = 0; rc == 0 && k < n; ++ k )
+                    {
+                        if ( blob_span [ k ] != 0 )
+                        {
+                            if ( first [ k ] < blob_first [ k ] )
+                                first [ k ] = blob_first [ k ];
+                            if ( last [ k ] > blob_first [ k ] + blob_span [ k ] - 1 )
+                                last [ k ] = blob_first [ k ] + blob_span [ k ] - 1;
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    if ( rc == 0 )
+    {
+        self -> num_groups = 0;
+        for ( i = 0; i < n; ++ i )
+        {
+            if ( i == 0 || first [ i ] == INT64_MIN ||
+                 first [ i ] != first [ i - 1 ] || last [ i ] != last [ i - 1 ] )
+            {
+                self -> groups [ self -> num_groups ++ ] = i;
+            }
+        }
+        self -> groups [ self -> num_groups ] = n;
+    }
+
+    free ( first );
+    return rc;
+}
+
+/* Plan
+ *  group the rows as seen by a cursor reading the same column
+ */
+static
+rc_t VCursorPrefetchPlan ( VCursorPrefetch *self )
+{
+    const VCursor *curs;
+    rc_t rc = VTableCreateCursorRead ( self -> curs -> tbl, & curs );
+    if ( rc == 0 )
+    {
+        uint32_t idx;
+        rc = VCursorAddColumn ( curs, & idx, "%s", self -> colspec );
+        if ( rc == 0 )
+            rc = VCursorOpen ( curs );
+        if ( rc == 0 )
+            rc = VCursorPrefetchGroup ( self, curs );
+        VCursorRelease ( curs );
+    }
+    return rc;
+}
+
+/* Colspec
+ *  produce a "(typedecl)name" column spec for worker cursors
+ *  into an allocation grown until the typedecl fits
+ */
+static
+rc_t VCursorPrefetchColspec ( const VCursor *curs, const VColumn *col, char **colspec )
+{
+    const String *name = & col -> scol -> name -> name;
+    size_t bsize;
+
+    for ( bsize = 256 + name -> size; ; bsize += bsize )
+    {
+        rc_t rc;
+        char *buffer = malloc ( bsize );
+        if ( buffer == NULL )
+            return RC ( rcVDB, rcCursor, rcReading, rcMemory, rcExhausted );
+
+        rc = VTypedeclToText ( & col -> td, curs -> schema, buffer + 1, bsize - 1 );
+        if ( rc == 0 )
+        {
+            size_t len = strlen ( buffer + 1 ) + 1;
+            if ( len + 2 + name -> size <= bsize )
+            {
+                buffer [ 0 ] = '(';
+                buffer [ len ++ ] = ')';
+                memcpy ( & buffer [ len ], name -> addr, name -> size );
+                buffer [ len + name -> size ] = 0;
+                * colspec = buffer;
+                return 0;
+            }
+        }
+        free ( buffer );
+
+        if ( rc != 0 && GetRCState ( rc ) != rcInsufficient )
+            return rc;
+        if ( bsize > 64 * 1024 )
+            return RC ( rcVDB, rcCursor, rcReading, rcName, rcExcessive );
+    }
+}
+
+LIB_EXPORT rc_t CC VCursorDataPrefetchAsync ( const VCursor *cself,
+    const int64_t *row_ids, uint32_t col_idx, uint32_t num_rows,
+    int64_t min_valid_row_id, int64_t max_valid_row_id, bool continue_on_error,
+    uint32_t num_threads, VCursorPrefetch **handle )
+{
+    rc_t rc;
+    const VColumn *col;
+    VCursor *self = ( VCursor* ) cself;
+
+    if ( handle != NULL )
+        * handle = NULL;
+
+    if ( self == NULL )
+        return RC ( rcVDB, rcCursor, rcReading, rcSelf, rcNull );
+    if ( row_ids == NULL && num_rows != 0 )
+        return RC ( rcVDB, rcCursor, rcReading, rcParam, rcNull );
+    if ( ! self -> read_only )
+        return RC ( rcVDB, rcCursor, rcReading, rcCursor, rcWriteonly );
+
+    col = ( const void* ) VectorGet ( & self -> row, col_idx );
+    if ( col == NULL )
+        return RC ( rcVDB, rcCursor, rcReading, rcColumn, rcInvalid );
+
+    /* only one prefetch at a time; let the previous one complete */
+    if ( self -> prefetch != NULL )
+    {
+        VCursorPrefetchJoin ( self -> prefetch );
+        VCursorPrefetchRelease ( self -> prefetch );
+        self -> prefetch = NULL;
+    }
+
+    if ( self -> blob_mru_cache == NULL || num_rows == 0 )
+        return 0;
+
+    rc = VBlobMRUCacheEnableLocking ( self -> blob_mru_cache );
+    if ( rc == 0 )
+    {
+        char *colspec;
+        VCursorPrefetch *pf = NULL;
+
+        rc = VCursorPrefetchColspec ( self, col, & colspec );
+        if ( rc == 0 )
+        {
+            pf = calloc ( 1, sizeof * pf + strlen ( colspec ) );
+            if ( pf == NULL )
+                rc = RC ( rcVDB, rcCursor, rcReading, rcMemory, rcExhausted );
+            else
+                strcpy ( pf -> colspec, colspec );
+            free ( colspec );
+        }
+        if ( pf != NULL )
+        {
+            pf -> row_ids = malloc ( num_rows * sizeof pf -> row_ids [ 0 ] );
+            if ( pf -> row_ids == NULL )
+                rc = RC ( rcVDB, rcCursor, rcReading, rcMemory, rcExhausted );
+            else
+            {
+                uint32_t i, unique;
+                for ( i = 0; i < num_rows; ++ i )
+                {
+                    int64_t row_id = row_ids [ i ];
+                    if ( row_id >= min_valid_row_id && row_id <= max_valid_row_id )
+                        pf -> row_ids [ pf -> num_rows ++ ] = row_id;
+                }
+                ksort_int64_t ( pf -> row_ids, pf -> num_rows );
+                for ( i = unique = 0; i < pf -> num_rows; ++ i )
+                {
+                    if ( unique == 0 || pf -> row_ids [ unique - 1 ] != pf -> row_ids [ i ] )
+                        pf -> row_ids [ unique ++ ] = pf -> row_ids [ i ];
+                }
+                pf -> num_rows = unique;
+
+                pf -> curs = self;
+                rc = VCursorPrefetchPlan ( pf );
+                if ( rc == 0 )
+                    rc = KLockMake ( & pf -> lock );
+                if ( rc == 0 )
+                    rc = KLockMake ( & pf -> join_lock );
+            }
+
+            if ( rc == 0 )
+            {
+                pf -> col_idx = col_idx;
+                pf -> continue_on_error = continue_on_error;
+                KRefcountInit ( & pf -> refcount, 1, "VCursorPrefetch", "make", "prefetch" );
+
+                if ( num_threads == 0 )
+                    num_threads = DEFAULT_PREFETCH_THREADS;
+                if ( num_threads > MAX_PREFETCH_THREADS )
+                    num_threads = MAX_PREFETCH_THREADS;
+                if ( num_threads > pf -> num_groups )
+                    num_threads = pf -> num_groups;
+
+                /* cache was trimmed by the last regular save;
+                   keep every prefetched blob until the last worker is done */
+                if ( num_threads != 0 )
+                    VBlobMRUCacheSuspendFlush ( self -> blob_mru_cache );
+
+                /* count workers before any of them can finish */
+                pf -> running = num_threads;
+                for ( ; pf -> num_threads < num_threads; ++ pf -> num_threads )
+                {
+                    rc = KThreadMake ( & pf -> threads [ pf -> num_threads ], run_prefetch_thread, pf );
+                    if ( rc != 0 )
+                        break;
+                }
+                if ( pf -> num_threads < num_threads )
+                {
+                    /* account for the workers that never started */
+                    uint32_t i;
+                    for ( i = pf -> num_threads; i < num_threads; ++ i )
+                        VCursorPrefetchFinish ( pf );
+                }
+
+                /* running with fewer workers is okay */
+                if ( pf -> num_threads != 0 )
+                    rc = 0;
+
+                if ( rc == 0 )
+                {
+                    self -> prefetch = pf;
+                    if ( handle != NULL )
+                    {
+                        KRefcountAdd ( & pf -> refcount, "VCursorPrefetch" );
+                        * handle = pf;
+                    }
+                    return 0;
+                }
+
+                pf -> joined = true;
+            }
+
+            KLockRelease ( pf -> join_lock );
+            KLockRelease ( pf -> lock );
+            free ( pf -> groups );
+            free ( pf -> row_ids );
+            free ( pf );
+        }
+    }
+
+    return rc;
+}
@@ -238,17 +238,17 @@ rc_t VSimpleProdSerial2Blob ( VSimpleProd *self, VBlob **rslt, int64_t id, uint3
             /* create a new, fluffy blob having rowmap and headers */
             VBlob *y;
 #if LAUNCH_PAGEMAP_THREAD
-            if(self->curs->pagemap_thread == NULL){
+            if(self->curs->pagemap_pool == NULL){
                 VCursor *curs = (VCursor*) self->curs;
                 if(--curs->launch_cnt<=0){
-                    /* ignoring errors because we operate with or without thread */
-                    VCursorLaunchPagemapThread(curs);
+                    /* ignoring errors because we operate with or without the pool */
+                    VCursorAttachPagemapPool(curs);
                 }
             }
 #endif
 		
             rc = VBlobCreateFromData ( & y, sblob -> start_id, sblob -> stop_id,
-                & buffer, VTypedescSizeof ( & self -> dad . desc ), self->curs->pagemap_thread?&self->curs->pmpr:NULL );
+                & buffer, VTypedescSizeof ( & self -> dad . desc ), self->curs->pagemap_pool );
             KDataBufferWhack ( & buffer );
 
             /* return on success */
@@ -759,10 +759,11 @@ rc_t VFunctionProdCallArrayFunc( VFunctionProd *self, VBlob **prslt,
 #endif
     TRACK_BLOB( VBlobNew, rslt );
     if (rc == 0) {
+        rc = VBlobResolvePageMap(sblob);
         rslt->pm = sblob->pm;
         PageMapAddRef(rslt->pm);
         
-        if (sblob->headers) {
+        if (rc == 0 && sblob->headers) {
             if ( self -> dad . chain == chainEncoding )
                 rc = BlobHeadersCreateChild(sblob->headers, &rslt->headers);
             else {
@@ -833,7 +834,7 @@ rc_t VFunctionProdCallPageFunc( VFunctionProd *self, VBlob **rslt, int64_t id,
 
 
         if(b->pm == NULL){
-            rc=PageMapProcessGetPagemap(&self->curs->pmpr,(PageMap**)(&b->pm));
+            rc=VBlobResolvePageMap(b);
             if(rc != 0) return rc;
         }
         
@@ -1185,17 +1186,24 @@ rc_t VFunctionProdCallBlobFunc( VFunctionProd *self, VBlob **prslt,
     
     TRACK_BLOB(VBlobNew,rslt);
     
-    /* blob funcs are not allowed to change page maps */
-    rslt->pm = sblob->pm;
-    PageMapAddRef(rslt->pm);
-    
     rslt->byte_order = sblob->byte_order;
     
+    /* blob funcs are not allowed to change page maps */
     if (self->dad.chain == chainEncoding){
+        rslt->pm = sblob->pm;
+        PageMapAddRef(rslt->pm);
         rc = VFunctionProdCallBlobFuncEncoding(self, rslt, id, info, sblob);
 	vblob_release( sblob, NULL );
     } else {
         rc = VFunctionProdCallBlobFuncDecoding(self, rslt, id, info, sblob);
+        /* the source page map may still be deserializing;
+           wait for it only after decoding has been done */
+        if (rc == 0)
+            rc = VBlobResolvePageMap(sblob);
+        if (rc == 0) {
+            rslt->pm = sblob->pm;
+            PageMapAddRef(rslt->pm);
+        }
     }
     
     if (rc == 0) {
@@ -1221,7 +1229,7 @@ rc_t VFunctionProdCallBlobNFunc( VFunctionProd *self, VBlob **rslt,
 	for(i=0;i<argc;i++){
 		VBlob const *vb=argv[i];
 		if(vb->pm == NULL){
-			rc=PageMapProcessGetPagemap(&self->curs->pmpr,(PageMap**)(&vb->pm));
+			rc=VBlobResolvePageMap(vb);
 			if(rc != 0) return rc;
 		}
 	}
@@ -1267,6 +1275,8 @@ rc_t VFunctionProdCallLegacyBlobFunc( VFunctionProd *self, VBlob **prslt,
                 rslt->byte_order = dst.byte_order;
 
                 rc = KDataBufferCast(&rslt->data, &rslt->data, elem_size, true);
+                if (rc == 0)
+                    rc = VBlobResolvePageMap(sblob);
                 if (rc == 0) {
                     rslt->pm = sblob->pm;
                     PageMapAddRef(rslt->pm);
@@ -1301,6 +1311,11 @@ rc_t VFunctionProdCallByteswap ( VFunctionProd *self, VBlob **vblob,
                            self->dad.desc.intrinsic_bits * self->dad.desc.intrinsic_dim,
                            false );
     if ( rc == 0 )
+    {
+        /* pick up a page map still being deserialized */
+        rc = VBlobResolvePageMap ( blob );
+    }
+    if ( rc == 0 )
     {
         /* legacy blob check
          * repair missing pagemap
@@ -2176,8 +2191,6 @@ rc_t VProductionReadBlob ( const VProduction *cself, VBlob **vblob, int64_t id,
 	/** lets try to get answers from the cursor **/
 	blob=(VBlob*) VBlobMRUCacheFind(self->cctx.cache,self->cctx.col_idx,id);
 	if(blob){
-		rc = VBlobAddRef ( blob );
-                if ( rc != 0 ) return rc;
 		*vblob=blob;
 		return 0;
 	}
@@ -2275,7 +2288,7 @@ rc_t VProductionReadBlob ( const VProduction *cself, VBlob **vblob, int64_t id,
     if ( ! blob -> no_cache )
         return 0;
 #endif
-    if(cctx == NULL && self->cctx.cache != NULL && blob->stop_id > blob->start_id + 4){/** we will benefit from caching here **/
+    if(cctx == NULL && self->cctx.cache != NULL && blob->stop_id - blob->start_id >= CACHE_MIN_BLOB_ROWS){/** we will benefit from caching here **/
 		VBlobMRUCacheSave(self->cctx.cache,self->cctx.col_idx,blob);
 		return 0;
     }
@@ -77,6 +77,10 @@ rc_t VTableWhack ( VTable *self )
     BSTreeWhack ( & self -> write_col_cache, VColumnRefWhack, NULL );
     VTableRelease(self -> cache_tbl);
 
+    /* shared blobs are keyed by the underlying table */
+    if ( self -> mgr != NULL )
+        VBlobSharedCacheReleaseTable ( self -> mgr -> blob_cache . ptr, self -> shared_blob_key );
+
     KMDataNodeRelease ( self -> col_node );
     KMetadataRelease ( self -> meta );
     KTableRelease ( self -> ktbl );
@@ -142,6 +142,9 @@ struct VTable
 
    /* cache table for cached virtual columns if any */
     const VTable *cache_tbl;
+
+    /* key of the table's blobs in the manager's shared cache, 0 until used */
+    uint64_t shared_blob_key;
 };
 
 
@@ -54,6 +54,7 @@
 #include <kproc/lock.h>
 #include <kproc/cond.h>
 #include <kproc/thread.h>
+#include <atomic32.h>
 
 #if _DEBUGGING
 /* set to 1 to trigger behavior to simulate
@@ -80,6 +81,12 @@
 static
 rc_t VCursorFlushPageInt ( VCursor *self );
 
+#if VCURSOR_FLUSH_THREAD
+typedef struct VCursorEncodePool VCursorEncodePool;
+static
+void VCursorEncodePoolWhack ( VCursorEncodePool *self );
+#endif
+
 
 /* Whack
  */
@@ -106,11 +113,11 @@ rc_t VCursorWhack ( VCursor *self )
     }
 
     MTCURSOR_DBG (( "VCursorWhack: finishing\n" ));
+    VCursorEncodePoolWhack ( self -> encode_pool );
     KThreadRelease ( self -> flush_thread );
     KConditionRelease ( self -> flush_cond );
     KLockRelease ( self -> flush_lock );
 #endif
-    VCursorTerminatePagemapThread(self);
     return VCursorDestroy ( self );
 }
 
@@ -861,6 +868,328 @@ bool CC run_trigger_prods ( void *item, void *data )
     return false;
 }
 
+#if VCURSOR_FLUSH_THREAD
+/* pre-encoding
+ *  the compression chain of each physical column, from its page-to-blob
+ *  production up to blob-to-serial, is private to that column. once the
+ *  page blobs have been pulled through the shared write productions, the
+ *  chains may be run concurrently, leaving their output in the production
+ *  caches to be picked up when the triggers run serially as before.
+ */
+typedef struct run_encode_data run_encode_data;
+struct run_encode_data
+{
+    Vector phys;
+    VBlob **blobs;
+    rc_t *rcs;          /* one per column */
+    int64_t id;
+    uint32_t cnt;
+    atomic32_t next;
+
+    /* set on the first failure: columns after it are left to the
+       triggers, while all columns before it were already claimed */
+    atomic32_t failed;
+};
+
+static
+void run_encode_job ( run_encode_data *pb )
+{
+    uint32_t count = VectorLength ( & pb -> phys );
+
+    while ( atomic32_read ( & pb -> failed ) == 0 )
+    {
+        VPhysical *phys;
+        uint32_t i = atomic32_read_and_add ( & pb -> next, 1 );
+        if ( i >= count )
+            break;
+
+        phys = VectorGet ( & pb -> phys, i );
+        pb -> rcs [ i ] = VProductionReadBlob ( phys -> b2s, & pb -> blobs [ i ], pb -> id, pb -> cnt, NULL );
+        if ( pb -> rcs [ i ] != 0 )
+        {
+            pb -> blobs [ i ] = NULL;
+            atomic32_set ( & pb -> failed, 1 );
+        }
+    }
+}
+
+/* VCursorEncodePool
+ *  workers living as long as the cursor, or until the number of flush
+ *  threads changes. the flushing thread posts one job per page, takes
+ *  its share of the work and then waits for every worker that joined
+ *  the job to leave it.
+ */
+struct VCursorEncodePool
+{
+    KLock *lock;
+    KCondition *posted;     /* a job was posted, or the pool is quitting */
+    KCondition *left;       /* a worker left the current job */
+    run_encode_data *job;
+    uint32_t serial;        /* incremented with every job posted */
+    uint32_t busy;          /* workers in the current job */
+    uint32_t num_workers;
+    bool quit;
+    KThread *workers [ 1 ];
+};
+
+static
+rc_t CC run_encode_thread ( const KThread *t, void *data )
+{
+    VCursorEncodePool *self = data;
+    uint32_t seen = 0;
+
+    rc_t rc = KLockAcquire ( self -> lock );
+    if ( rc == 0 )
+    {
+        for ( ; ; )
+        {
+            run_encode_data *job;
+
+            while ( ! self -> quit && ( self -> job == NULL || self -> serial == seen ) )
+            {
+                rc = KConditionWait ( self -> posted, self -> lock );
+                if ( rc != 0 )
+                    break;
+            }
+            if ( rc != 0 || self -> quit )
+                break;
+
+            seen = self -> serial;
+            job = self -> job;
+            ++ self -> busy;
+            KLockUnlock ( self -> lock );
+
+            run_encode_job ( job );
+
+            rc = KLockAcquire ( self -> lock );
+            if ( rc != 0 )
+                return rc;
+
+            -- self -> busy;
+            KConditionSignal ( self -> left );
+        }
+
+        KLockUnlock ( self -> lock );
+    }
+
+    return rc;
+}
+
+static
+void VCursorEncodePoolWhack ( VCursorEncodePool *self )
+{
+    if ( self != NULL )
+    {
+        uint32_t i;
+
+        if ( self -> num_workers != 0 && KLockAcquire ( self -> lock ) == 0 )
+        {
+            self -> quit = true;
+            KConditionBroadcast ( self -> posted );
+            KLockUnlock ( self -> lock );
+        }
+
+        for ( i = 0; i < self -> num_workers; ++ i )
+        {
+            KThreadWait ( self -> workers [ i ], NULL );
+            KThreadRelease ( self -> workers [ i ] );
+        }
+
+        KConditionRelease ( self -> left );
+        KConditionRelease ( self -> posted );
+        KLockRelease ( self -> lock );
+        free ( self );
+    }
+}
+
+static
+rc_t VCursorEncodePoolMake ( VCursorEncodePool **poolp, uint32_t num_workers )
+{
+    rc_t rc;
+    VCursorEncodePool *self;
+
+    assert ( num_workers != 0 );
+    self = calloc ( 1, sizeof * self + ( num_workers - 1 ) * sizeof self -> workers [ 0 ] );
+    if ( self == NULL )
+        rc = RC ( rcVDB, rcCursor, rcConstructing, rcMemory, rcExhausted );
+    else
+    {
+        rc = KLockMake ( & self -> lock );
+        if ( rc == 0 )
+            rc = KConditionMake ( & self -> posted );
+        if ( rc == 0 )
+            rc = KConditionMake ( & self -> left );
+        while ( rc == 0 && self -> num_workers < num_workers )
+        {
+            rc = KThreadMake ( & self -> workers [ self -> num_workers ], run_encode_thread, self );
+            if ( rc == 0 )
+                ++ self -> num_workers;
+        }
+
+        if ( rc != 0 )
+        {
+            VCursorEncodePoolWhack ( self );
+            self = NULL;
+        }
+    }
+
+    * poolp = self;
+    return rc;
+}
+
+static
+void VCursorEncodePoolRun ( VCursorEncodePool *self, run_encode_data *job )
+{
+    if ( KLockAcquire ( self -> lock ) != 0 )
+    {
+        run_encode_job ( job );
+        return;
+    }
+
+    self -> job = job;
+    ++ self -> serial;
+    KConditionBroadcast ( self -> posted );
+    KLockUnlock ( self -> lock );
+
+    /* the flushing thread takes its share of the work */
+    run_encode_job ( job );
+
+    /* the job lives on the caller's stack */
+    if ( KLockAcquire ( self -> lock ) == 0 )
+    {
+        while ( self -> busy != 0 )
+        {
+            if ( KConditionWait ( self -> left, self -> lock ) != 0 )
+                break;
+        }
+        self -> job = NULL;
+        KLockUnlock ( self -> lock );
+    }
+}
+
+static
+bool VCursorPreparePhysEncode ( VPhysical *phys, int64_t id, uint32_t cnt )
+{
+    rc_t rc;
+    VBlob *vblob;
+    bool single_row, cached;
+
+    if ( phys == NULL || phys == FAILED_PHYSICAL || phys -> p2b == NULL || phys -> b2s == NULL )
+        return false;
+
+    /* single rows may remain static and skip encoding */
+    rc = VProductionReadBlob ( phys -> in, & vblob, id, cnt, NULL );
+    if ( rc != 0 )
+        return false;
+    single_row = VBlobIsSingleRow ( vblob );
+    TRACK_BLOB ( VBlobRelease, vblob );
+    ( void ) VBlobRelease ( vblob );
+    if ( single_row )
+        return false;
+
+    /* the page blob must stay cached, or the chain would reach into shared productions */
+    rc = VProductionReadBlob ( phys -> p2b, & vblob, id, cnt, NULL );
+    if ( rc != 0 )
+        return false;
+    cached = vblob -> pm != NULL && ! vblob -> no_cache;
+    TRACK_BLOB ( VBlobRelease, vblob );
+    ( void ) VBlobRelease ( vblob );
+
+    return cached;
+}
+
+static
+rc_t VCursorPreEncode ( VCursor *self, int64_t id, uint32_t cnt )
+{
+    rc_t rc = 0;
+    uint32_t i, end, count;
+    run_encode_data pb;
+
+    VectorInit ( & pb . phys, 0, 16 );
+
+    /* serially pull page blobs through the shared productions */
+    i = VectorStart ( & self -> phys . cache );
+    end = i + VectorLength ( & self -> phys . cache );
+    for ( ; i < end; ++ i )
+    {
+        const Vector *ctx = VectorGet ( & self -> phys . cache, i );
+        if ( ctx != NULL )
+        {
+            uint32_t j = VectorStart ( ctx );
+            uint32_t jend = j + VectorLength ( ctx );
+            for ( ; j < jend; ++ j )
+            {
+                VPhysical *phys = VectorGet ( ctx, j );
+                if ( VCursorPreparePhysEncode ( phys, id, cnt ) )
+                {
+                    if ( VectorAppend ( & pb . phys, NULL, phys ) != 0 )
+                        break;
+                }
+            }
+        }
+    }
+
+    count = VectorLength ( & pb . phys );
+    if ( count < 2 )
+    {
+        VectorWhack ( & pb . phys, NULL, NULL );
+        return 0;
+    }
+
+    pb . blobs = calloc ( count, sizeof pb . blobs [ 0 ] + sizeof pb . rcs [ 0 ] );
+    if ( pb . blobs == NULL )
+    {
+        VectorWhack ( & pb . phys, NULL, NULL );
+        return 0;
+    }
+    pb . rcs = ( rc_t* ) ( pb . blobs + count );
+    pb . id = id;
+    pb . cnt = cnt;
+    atomic32_set ( & pb . next, 0 );
+    atomic32_set ( & pb . failed, 0 );
+
+    VCursorEncodePoolRun ( self -> encode_pool, & pb );
+
+    /* encoded blobs stay cached on their productions */
+    for ( i = 0; i < count; ++ i )
+    {
+        if ( rc == 0 )
+            rc = pb . rcs [ i ];
+        TRACK_BLOB ( VBlobRelease, pb . blobs [ i ] );
+        ( void ) VBlobRelease ( pb . blobs [ i ] );
+    }
+
+    free ( pb . blobs );
+    VectorWhack ( & pb . phys, NULL, NULL );
+
+    /* the first failure in column order */
+    return rc;
+}
+#endif
+
+static
+bool run_flush_prods ( VCursor *self, run_trigger_prod_data *pb )
+{
+#if VCURSOR_FLUSH_THREAD
+    rc_t rc = 0;
+    if ( self -> encode_pool != NULL )
+        rc = VCursorPreEncode ( self, pb -> id, pb -> cnt );
+#endif
+    /* writes happen here, in trigger order. a column that failed to
+       encode above fails again when its trigger runs, so the error is
+       the one the serial path reports */
+    if ( VectorDoUntil ( & self -> trig, false, run_trigger_prods, pb ) )
+        return true;
+#if VCURSOR_FLUSH_THREAD
+    if ( rc != 0 )
+    {
+        pb -> rc = rc;
+        return true;
+    }
+#endif
+    return false;
+}
+
 #if VCURSOR_FLUSH_THREAD
 static
 rc_t CC run_flush_thread ( const KThread *t, void *data )
@@ -903,7 +1232,7 @@ rc_t CC run_flush_thread ( const KThread *t, void *data )
             KLockUnlock ( self -> flush_lock );
 
             /* run productions from trigger roots */
-            failed = VectorDoUntil ( & self -> trig, false, run_trigger_prods, & pb );
+            failed = run_flush_prods ( self, & pb );
 
             /* drop page buffers */
             MTCURSOR_DBG (( "run_flush_thread: dropping page buffers\n" ));
@@ -1074,7 +1403,7 @@ rc_t VCursorFlushPageInt ( VCursor *self )
                 pb . id = self -> start_id;
                 pb . cnt = self -> end_id - self -> start_id;
                 pb . rc = 0;
-                if ( ! VectorDoUntil ( & self -> trig, false, run_trigger_prods, & pb ) )
+                if ( ! run_flush_prods ( self, & pb ) )
                 {
                     self -> start_id = self -> end_id;
                     self -> end_id = self -> row_id + 1;
@@ -1159,6 +1488,58 @@ LIB_EXPORT rc_t CC VCursorFlushPage ( VCursor *self )
     return rc;
 }
 
+/* SetFlushThreads
+ *  sets the number of threads encoding columns of a flushed page
+ */
+LIB_EXPORT rc_t CC VCursorSetFlushThreads ( VCursor *self, uint32_t count )
+{
+    rc_t rc = 0;
+
+    if ( self == NULL )
+        return RC ( rcVDB, rcCursor, rcUpdating, rcSelf, rcNull );
+    if ( self -> read_only )
+        return RC ( rcVDB, rcCursor, rcUpdating, rcCursor, rcReadonly );
+
+#if VCURSOR_FLUSH_THREAD
+    /* let a page being flushed finish with the current workers */
+    if ( self -> flush_lock != NULL )
+    {
+        rc = KLockAcquire ( self -> flush_lock );
+        if ( rc != 0 )
+            return rc;
+        while ( self -> flush_state == vfBusy )
+        {
+            rc = KConditionWait ( self -> flush_cond, self -> flush_lock );
+            if ( rc != 0 )
+            {
+                KLockUnlock ( self -> flush_lock );
+                return rc;
+            }
+        }
+    }
+
+    if ( count != self -> flush_threads )
+    {
+        VCursorEncodePoolWhack ( self -> encode_pool );
+        self -> encode_pool = NULL;
+
+        /* the flushing thread is one of the encoders */
+        if ( count > 1 )
+            rc = VCursorEncodePoolMake ( & self -> encode_pool, count - 1 );
+    }
+#endif
+
+    if ( rc == 0 )
+        self -> flush_threads = count;
+
+#if VCURSOR_FLUSH_THREAD
+    if ( self -> flush_lock != NULL )
+        KLockUnlock ( self -> flush_lock );
+#endif
+
+    return rc;
+}
+
 LIB_EXPORT rc_t CC VCursorCommit ( VCursor *self )
 {
     rc_t rc = VCursorFlushPage ( self );
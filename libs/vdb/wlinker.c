@@ -57,8 +57,10 @@ extern VTRANSFACT_DECL ( idx_text_insert );
 extern VTRANSFACT_DECL ( vdb_bzip );
 extern VTRANSFACT_DECL ( vdb_checksum );
 extern VTRANSFACT_DECL ( vdb_fzip );
+extern VTRANSFACT_DECL ( vdb_ibpzip );
 extern VTRANSFACT_DECL ( vdb_rlencode );
 extern VTRANSFACT_DECL ( vdb_zip );
+extern VTRANSFACT_DECL ( vdb_zstd );
 
 /* InitFactories
  */
@@ -85,8 +87,10 @@ rc_t VLinkerInitFactories ( VLinker *self, struct KSymTable *tbl, struct SchemaE
         { vdb_bzip, "vdb:bzip" },
         { vdb_checksum, "vdb:checksum" },
         { vdb_fzip, "vdb:fzip" },
+        { vdb_ibpzip, "vdb:ibpzip" },
         { vdb_rlencode, "vdb:rlencode" },
-        { vdb_zip, "vdb:zip" }
+        { vdb_zip, "vdb:zip" },
+        { vdb_zstd, "vdb:zstd" }
     };
 
     rc_t rc = VLinkerInitFactoriesRead ( self, tbl, env );
@@ -347,6 +347,8 @@ rc_t VProdResolvePhysicalWrite ( const VProdResolve *self, VPhysical *phys )
     */
     rc = VSimpleProdMake ( & prod, pr . owned,  pr . curs,
         prodSimplePage2Blob, name, & fd, & desc, NULL, phys -> in, chainEncoding );
+    if ( rc == 0 )
+        phys -> p2b = prod;
     if ( rc == 0 && enc != NULL )
     {
         /* in <- p2b <- encoding-func */
@@ -89,6 +89,16 @@
 
 #define DEFAULT_CACHE_BLOCKSIZE ( 32768 * 4 )
 
+/* remote files read without a cache location are fetched ahead
+   only when a window is configured, and only if large enough */
+#define KFG_READ_AHEAD_WINDOW "/libs/vfs/read_ahead/window"
+#define KFG_READ_AHEAD_MIN_SIZE "/libs/vfs/read_ahead/min_size"
+#define DEFAULT_READ_AHEAD_MIN_SIZE ( 64 * 1024 * 1024 )
+
+/* the directory of a cache location is trimmed to this many bytes,
+   least recently used files first, each time a cache file is opened */
+#define KFG_CACHE_BUDGET "/libs/vfs/cache/budget"
+
 #define VFS_KRYPTO_PASSWORD_MAX_SIZE 4096
 
 /*--------------------------------------------------------------------------
@@ -206,6 +216,46 @@ LIB_EXPORT rc_t CC VFSManagerRelease ( const VFSManager *self )
 
 
 
+/*--------------------------------------------------------------------------
+ * VFSManagerReadAheadWindow
+ *  read-ahead runs a thread per file, so it is off unless
+ *  KFG_READ_AHEAD_WINDOW is set, and smaller files are left alone
+ */
+static
+size_t VFSManagerReadAheadWindow ( const VFSManager * self, const KFile * f )
+{
+    uint64_t window, min_size, size;
+
+    if ( KConfigReadU64 ( self -> cfg, KFG_READ_AHEAD_WINDOW, & window ) != 0 || window == 0 )
+        return 0;
+
+    if ( KConfigReadU64 ( self -> cfg, KFG_READ_AHEAD_MIN_SIZE, & min_size ) != 0 )
+        min_size = DEFAULT_READ_AHEAD_MIN_SIZE;
+
+    if ( KFileSize ( f, & size ) != 0 || size < min_size )
+        return 0;
+
+    return ( size_t ) window;
+}
+
+/*--------------------------------------------------------------------------
+ * VFSManagerTrimCacheDir
+ *  keeps the directory of a cache location within KFG_CACHE_BUDGET
+ */
+static
+void VFSManagerTrimCacheDir ( const VFSManager * self, const char * cache_location )
+{
+    uint64_t budget;
+    const char * slash = strrchr ( cache_location, '/' );
+
+    if ( slash == NULL || KConfigReadU64 ( self -> cfg, KFG_CACHE_BUDGET, & budget ) != 0 )
+        return;
+
+    /* eviction only saves disk space, failing to trim does not fail the open */
+    KDirectoryTrimCacheDir ( self -> cwd, budget, NULL, "%.*s",
+                             ( int ) ( slash - cache_location ), cache_location );
+}
+
 /*--------------------------------------------------------------------------
  * VFSManagerMakeHTTPFile
  */
@@ -227,14 +277,21 @@ rc_t VFSManagerMakeHTTPFile( const VFSManager * self, const KFile **cfp,
         rc_t rc2;
         if ( cache_location == NULL )
         {
-            /* there is no cache_location! just wrap the remote file in a buffer */
-            rc2 = KBufFileMakeRead ( & temp_file, * cfp, 128 * 1024 * 1024 );
+            /* there is no cache_location! just wrap the remote file in a buffer,
+               fetching ahead while it is read sequentially if configured */
+            size_t window = VFSManagerReadAheadWindow ( self, * cfp );
+            if ( window != 0 )
+                rc2 = KBufFileMakeReadAhead ( & temp_file, * cfp, 128 * 1024 * 1024, window );
+            else
+                rc2 = KBufFileMakeRead ( & temp_file, * cfp, 128 * 1024 * 1024 );
         }
         else
         {
             /* we do have a cache_location! wrap the remote file in a cacheteefile */
             rc2 = KDirectoryMakeCacheTee ( self->cwd, &temp_file, *cfp,
                                            DEFAULT_CACHE_BLOCKSIZE, "%s", cache_location );
+            if ( rc2 == 0 )
+                VFSManagerTrimCacheDir ( self, cache_location );
         }
         if ( rc2 == 0 )
         {
@@ -0,0 +1,406 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+#include <vdb/extern.h>
+
+#include <klib/defs.h>
+#include <klib/rc.h>
+#include <vdb/xform.h>
+#include <vdb/schema.h>
+#include <sysalloc.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "ibpzip-common.h"
+
+/* vector kernels are built with per-function target attributes
+   and chosen at run time, so the library itself needs no special
+   compiler flags and still runs on any x86 processor */
+#if ( defined __x86_64__ || defined __i386__ ) && ! defined __INTEL_COMPILER && \
+    ( defined __clang__ || ( defined __GNUC__ && ( __GNUC__ > 4 || ( __GNUC__ == 4 && __GNUC_MINOR__ >= 9 ) ) ) )
+#define IBP_X86_KERNELS 1
+#include <immintrin.h>
+#else
+#define IBP_X86_KERNELS 0
+#endif
+
+/* unpacks one block of up to 32-bit elements into 32-bit words */
+typedef void ( * ibp_unpack32_f ) ( uint32_t *out, const uint8_t *in,
+    uint32_t width, bool delta, uint32_t base );
+
+typedef struct ibpunzip_t ibpunzip_t;
+struct ibpunzip_t
+{
+    ibp_unpack32_f unpack32;
+};
+
+static
+void ibp_unpack32_scalar ( uint32_t *out, const uint8_t *in,
+    uint32_t width, bool delta, uint32_t base )
+{
+    uint32_t lane, row;
+    uint32_t const mask = width == 32 ? UINT32_MAX : ( ( uint32_t ) 1 << width ) - 1;
+
+    for ( lane = 0; lane < IBP_LANES; ++ lane )
+    {
+        uint32_t prev = base;
+        for ( row = 0; row < IBP_ROWS; ++ row )
+        {
+            uint32_t v = 0;
+            if ( width != 0 )
+            {
+                uint32_t const pos = row * width;
+                uint32_t const w = pos >> 5, s = pos & 31;
+
+                v = ibp_load32 ( in + ( w * IBP_LANES + lane ) * 4 ) >> s;
+                if ( s + width > 32 )
+                    v |= ibp_load32 ( in + ( ( w + 1 ) * IBP_LANES + lane ) * 4 ) << ( 32 - s );
+                v &= mask;
+            }
+
+            if ( delta )
+            {
+                prev += ibp_unzigzag32 ( v );
+                out [ row * IBP_LANES + lane ] = prev;
+            }
+            else
+            {
+                out [ row * IBP_LANES + lane ] = base + v;
+            }
+        }
+    }
+}
+
+#if IBP_X86_KERNELS
+
+/* one row of words is two 128-bit halves, lanes 0..3 and 4..7 */
+__attribute__ ( ( target ( "sse2" ) ) )
+static
+void ibp_unpack32_sse2 ( uint32_t *out, const uint8_t *in,
+    uint32_t width, bool delta, uint32_t base )
+{
+    uint32_t row;
+    __m128i const mask = _mm_set1_epi32 ( ( int ) ( width == 32 ? UINT32_MAX : ( ( uint32_t ) 1 << width ) - 1 ) );
+    __m128i const one = _mm_set1_epi32 ( 1 );
+    __m128i const zero = _mm_setzero_si128 ();
+    __m128i acc0 = _mm_set1_epi32 ( ( int ) base );
+    __m128i acc1 = acc0;
+
+    for ( row = 0; row < IBP_ROWS; ++ row )
+    {
+        __m128i v0 = zero, v1 = zero;
+        if ( width != 0 )
+        {
+            uint32_t const pos = row * width;
+            uint32_t const w = pos >> 5, s = pos & 31;
+            const __m128i *p = ( const __m128i* ) ( in + w * IBP_LANES * 4 );
+            __m128i const shift = _mm_cvtsi32_si128 ( ( int ) s );
+
+            v0 = _mm_srl_epi32 ( _mm_loadu_si128 ( p ), shift );
+            v1 = _mm_srl_epi32 ( _mm_loadu_si128 ( p + 1 ), shift );
+            if ( s + width > 32 )
+            {
+                __m128i const back = _mm_cvtsi32_si128 ( ( int ) ( 32 - s ) );
+                v0 = _mm_or_si128 ( v0, _mm_sll_epi32 ( _mm_loadu_si128 ( p + 2 ), back ) );
+                v1 = _mm_or_si128 ( v1, _mm_sll_epi32 ( _mm_loadu_si128 ( p + 3 ), back ) );
+            }
+            v0 = _mm_and_si128 ( v0, mask );
+            v1 = _mm_and_si128 ( v1, mask );
+        }
+
+        if ( delta )
+        {
+            v0 = _mm_xor_si128 ( _mm_srli_epi32 ( v0, 1 ), _mm_sub_epi32 ( zero, _mm_and_si128 ( v0, one ) ) );
+            v1 = _mm_xor_si128 ( _mm_srli_epi32 ( v1, 1 ), _mm_sub_epi32 ( zero, _mm_and_si128 ( v1, one ) ) );
+            acc0 = _mm_add_epi32 ( acc0, v0 );
+            acc1 = _mm_add_epi32 ( acc1, v1 );
+            _mm_storeu_si128 ( ( __m128i* ) ( out + row * IBP_LANES ), acc0 );
+            _mm_storeu_si128 ( ( __m128i* ) ( out + row * IBP_LANES + 4 ), acc1 );
+        }
+        else
+        {
+            _mm_storeu_si128 ( ( __m128i* ) ( out + row * IBP_LANES ), _mm_add_epi32 ( v0, acc0 ) );
+            _mm_storeu_si128 ( ( __m128i* ) ( out + row * IBP_LANES + 4 ), _mm_add_epi32 ( v1, acc1 ) );
+        }
+    }
+}
+
+/* one row of words is one 256-bit register */
+__attribute__ ( ( target ( "avx2" ) ) )
+static
+void ibp_unpack32_avx2 ( uint32_t *out, const uint8_t *in,
+    uint32_t width, bool delta, uint32_t base )
+{
+    uint32_t row;
+    __m256i const mask = _mm256_set1_epi32 ( ( int ) ( width == 32 ? UINT32_MAX : ( ( uint32_t ) 1 << width ) - 1 ) );
+    __m256i const one = _mm256_set1_epi32 ( 1 );
+    __m256i const zero = _mm256_setzero_si256 ();
+    __m256i acc = _mm256_set1_epi32 ( ( int ) base );
+
+    for ( row = 0; row < IBP_ROWS; ++ row )
+    {
+        __m256i v = zero;
+        if ( width != 0 )
+        {
+            uint32_t const pos = row * width;
+            uint32_t const w = pos >> 5, s = pos & 31;
+            const __m256i *p = ( const __m256i* ) ( in + w * IBP_LANES * 4 );
+
+            v = _mm256_srl_epi32 ( _mm256_loadu_si256 ( p ), _mm_cvtsi32_si128 ( ( int ) s ) );
+            if ( s + width > 32 )
+                v = _mm256_or_si256 ( v, _mm256_sll_epi32 ( _mm256_loadu_si256 ( p + 1 ), _mm_cvtsi32_si128 ( ( int ) ( 32 - s ) ) ) );
+            v = _mm256_and_si256 ( v, mask );
+        }
+
+        if ( delta )
+        {
+            v = _mm256_xor_si256 ( _mm256_srli_epi32 ( v, 1 ), _mm256_sub_epi32 ( zero, _mm256_and_si256 ( v, one ) ) );
+            acc = _mm256_add_epi32 ( acc, v );
+            _mm256_storeu_si256 ( ( __m256i* ) ( out + row * IBP_LANES ), acc );
+        }
+        else
+        {
+            _mm256_storeu_si256 ( ( __m256i* ) ( out + row * IBP_LANES ), _mm256_add_epi32 ( v, acc ) );
+        }
+    }
+}
+
+#endif /* IBP_X86_KERNELS */
+
+static
+ibp_unpack32_f ibp_select_unpack32 ( void )
+{
+#if IBP_X86_KERNELS
+    __builtin_cpu_init ();
+    if ( __builtin_cpu_supports ( "avx2" ) )
+        return ibp_unpack32_avx2;
+    if ( __builtin_cpu_supports ( "sse2" ) )
+        return ibp_unpack32_sse2;
+#endif
+    return ibp_unpack32_scalar;
+}
+
+/* 64-bit elements may be up to 64 bits wide, spanning three words */
+static
+uint64_t ibp_read_bits ( const uint8_t *in, uint32_t lane, uint32_t pos, uint32_t width )
+{
+    uint64_t v = 0;
+    uint32_t got = 0;
+
+    while ( got < width )
+    {
+        uint32_t const s = pos & 31;
+        uint32_t take = 32 - s;
+        if ( take > width - got )
+            take = width - got;
+
+        v |= ( ( uint64_t ) ( ibp_load32 ( in + ( ( pos >> 5 ) * IBP_LANES + lane ) * 4 ) >> s )
+               & ( ( ( uint64_t ) 1 << take ) - 1 ) ) << got;
+
+        got += take;
+        pos += take;
+    }
+    return v;
+}
+
+static
+void ibp_unpack64 ( uint64_t *out, const uint8_t *in,
+    uint32_t width, bool delta, uint64_t base )
+{
+    uint32_t lane, row;
+
+    for ( lane = 0; lane < IBP_LANES; ++ lane )
+    {
+        uint64_t prev = base;
+        for ( row = 0; row < IBP_ROWS; ++ row )
+        {
+            uint64_t const v = ibp_read_bits ( in, lane, row * width, width );
+            if ( delta )
+            {
+                prev += ibp_unzigzag64 ( v );
+                out [ row * IBP_LANES + lane ] = prev;
+            }
+            else
+            {
+                out [ row * IBP_LANES + lane ] = base + v;
+            }
+        }
+    }
+}
+
+/* ibp_decode_range
+ *  decodes elements [ first, first + n ) of a blob of "count" elements
+ *  into "dst". the directory gives the width, and so the offset, of every
+ *  block without touching the packed data, so only the blocks holding
+ *  the range are unpacked: a single row costs one block, not the blob.
+ */
+static
+rc_t ibp_decode_range ( void *dst, uint64_t first, uint64_t n, uint64_t count,
+    uint32_t elem_bits, const uint8_t *src, size_t ssize, ibp_unpack32_f unpack32 )
+{
+    uint32_t tmp32 [ IBP_BLOCK_ELEMS ];
+    uint64_t tmp64 [ IBP_BLOCK_ELEMS ];
+
+    uint32_t const max_width = elem_bits == 64 ? 64 : 32;
+    uint32_t const base_bytes = elem_bits == 64 ? 8 : 4;
+    uint64_t const blocks = ( count + IBP_BLOCK_ELEMS - 1 ) / IBP_BLOCK_ELEMS;
+    uint64_t const dir = blocks * ( 1 + base_bytes );
+    uint64_t const b_first = first / IBP_BLOCK_ELEMS;
+    uint64_t offset, start = 0, b;
+
+    if ( count == 0 || dir > ssize )
+        return RC ( rcXF, rcFunction, rcExecuting, rcData, rcCorrupt );
+    if ( n == 0 || first >= count || n > count - first )
+        return RC ( rcXF, rcFunction, rcExecuting, rcRange, rcInvalid );
+
+    /* check the directory against the data before unpacking */
+    for ( offset = dir, b = 0; b < blocks; ++ b )
+    {
+        uint32_t const width = src [ b ] & IBP_DESC_WIDTH;
+        if ( width > max_width )
+            return RC ( rcXF, rcFunction, rcExecuting, rcData, rcCorrupt );
+        if ( b == b_first )
+            start = offset;
+        offset += IBP_BLOCK_BYTES ( width );
+    }
+    if ( offset != ssize )
+        return RC ( rcXF, rcFunction, rcExecuting, rcData, rcCorrupt );
+
+    for ( offset = start, b = b_first; b * IBP_BLOCK_ELEMS < first + n; ++ b )
+    {
+        uint64_t const block_first = b * IBP_BLOCK_ELEMS;
+        uint32_t const width = src [ b ] & IBP_DESC_WIDTH;
+        bool const delta = ( src [ b ] & IBP_DESC_DELTA ) != 0;
+
+        /* the part of this block inside the range */
+        uint32_t const lo = first > block_first ? ( uint32_t ) ( first - block_first ) : 0;
+        uint32_t const hi = first + n - block_first < IBP_BLOCK_ELEMS
+            ? ( uint32_t ) ( first + n - block_first ) : IBP_BLOCK_ELEMS;
+        uint64_t const at = block_first + lo - first;
+        uint32_t i;
+
+        switch ( elem_bits )
+        {
+        case 8:
+            unpack32 ( tmp32, src + offset, width, delta, ibp_load32 ( src + blocks + b * 4 ) );
+            for ( i = lo; i < hi; ++ i )
+                ( ( uint8_t* ) dst ) [ at + i - lo ] = ( uint8_t ) tmp32 [ i ];
+            break;
+        case 16:
+            unpack32 ( tmp32, src + offset, width, delta, ibp_load32 ( src + blocks + b * 4 ) );
+            for ( i = lo; i < hi; ++ i )
+                ( ( uint16_t* ) dst ) [ at + i - lo ] = ( uint16_t ) tmp32 [ i ];
+            break;
+        case 32:
+            /* whole blocks are unpacked in place */
+            if ( lo == 0 && hi == IBP_BLOCK_ELEMS )
+                unpack32 ( ( uint32_t* ) dst + at, src + offset, width, delta, ibp_load32 ( src + blocks + b * 4 ) );
+            else
+            {
+                unpack32 ( tmp32, src + offset, width, delta, ibp_load32 ( src + blocks + b * 4 ) );
+                memmove ( ( uint32_t* ) dst + at, tmp32 + lo, ( hi - lo ) * sizeof tmp32 [ 0 ] );
+            }
+            break;
+        default:
+            ibp_unpack64 ( tmp64, src + offset, width, delta, ibp_load64 ( src + blocks + b * 8 ) );
+            memmove ( ( uint64_t* ) dst + at, tmp64 + lo, ( hi - lo ) * sizeof tmp64 [ 0 ] );
+            break;
+        }
+
+        offset += IBP_BLOCK_BYTES ( width );
+    }
+
+    return 0;
+}
+
+static
+rc_t ibp_decode ( void *dst, uint64_t count, uint32_t elem_bits,
+    const uint8_t *src, size_t ssize, ibp_unpack32_f unpack32 )
+{
+    return ibp_decode_range ( dst, 0, count, count, elem_bits, src, ssize, unpack32 );
+}
+
+static
+rc_t CC ibpunzip_func ( void *Self, const VXformInfo *info,
+    VBlobResult *dst, const VBlobData *src, VBlobHeader *hdr )
+{
+    rc_t rc;
+    int64_t elem_bits;
+    uint64_t dbits;
+    const ibpunzip_t *self = Self;
+
+    if ( VBlobHeaderVersion ( hdr ) != 1 )
+        return RC ( rcXF, rcFunction, rcExecuting, rcParam, rcBadVersion );
+
+    rc = VBlobHeaderArgPopHead ( hdr, & elem_bits );
+    if ( rc != 0 )
+        return rc;
+
+    dbits = ( uint64_t ) dst -> elem_count * dst -> elem_bits;
+    if ( ( elem_bits != 8 && elem_bits != 16 && elem_bits != 32 && elem_bits != 64 ) ||
+         dbits % elem_bits != 0 )
+    {
+        return RC ( rcXF, rcFunction, rcExecuting, rcData, rcCorrupt );
+    }
+
+    dst -> byte_order = vboNative;
+    return ibp_decode ( dst -> data, dbits / elem_bits, ( uint32_t ) elem_bits, src -> data,
+        ( size_t ) ( ( ( uint64_t ) src -> elem_count * src -> elem_bits + 7 ) >> 3 ), self -> unpack32 );
+}
+
+static
+void CC ibpunzip_whack ( void *ptr )
+{
+    free ( ptr );
+}
+
+/* ibpunzip
+ *  function izip_set ibpunzip #1.0 ( ibp_fmt in );
+ */
+VTRANSFACT_IMPL ( vdb_ibpunzip, 1, 0, 0 ) ( const void *Self, const VXfactInfo *info,
+    VFuncDesc *rslt, const VFactoryParams *cp, const VFunctionParams *dp )
+{
+    ibpunzip_t *self;
+
+    if ( info -> fdesc . desc . domain != vtdInt && info -> fdesc . desc . domain != vtdUint )
+        return RC ( rcXF, rcFunction, rcConstructing, rcParam, rcInvalid );
+
+    self = malloc ( sizeof * self );
+    if ( self == NULL )
+        return RC ( rcXF, rcFunction, rcConstructing, rcMemory, rcExhausted );
+
+    /* the kernel is picked once, for the processor we are running on */
+    self -> unpack32 = ibp_select_unpack32 ();
+
+    rslt -> self = self;
+    rslt -> whack = ibpunzip_whack;
+    rslt -> variant = vftBlob;
+    rslt -> u . bf = ibpunzip_func;
+
+    return 0;
+}
@@ -0,0 +1,122 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+#ifndef _h_ibpzip_common_
+#define _h_ibpzip_common_
+
+#include <klib/defs.h>
+#include <stdint.h>
+#include <string.h>
+#include <endian.h>
+#include <byteswap.h>
+
+/* ibpzip format, blob header version 1
+ *
+ *  the one header argument is the element size in bits.
+ *
+ *  elements are coded in blocks of IBP_BLOCK_ELEMS, the last one
+ *  padded by repeating its final element. each block is either
+ *  frame-of-reference coded, holding element - base, or delta
+ *  coded, holding the zig-zagged difference from the element one
+ *  row of IBP_LANES earlier, the first row being relative to base.
+ *
+ *  all arithmetic is modulo 2^32 for elements of up to 32 bits
+ *  and modulo 2^64 for 64-bit elements.
+ *
+ *  data := desc [ blocks ] base [ blocks ] packed [ blocks ]
+ *
+ *  desc   - one byte: bit width in bits 0..6, delta coding in bit 7
+ *  base   - little-endian, 4 bytes or 8 for 64-bit elements
+ *  packed - IBP_BLOCK_BYTES ( width ) bytes of little-endian 32-bit
+ *           words. element i is in lane i % IBP_LANES; each lane
+ *           is a stream of width-bit values, and word k of lane l
+ *           is stored at word index k * IBP_LANES + l, so that
+ *           a row of words loads into one 256-bit register.
+ *
+ *  the directory gives every block's offset, so any block can
+ *  be decoded without the others.
+ */
+#define IBP_LANES 8
+#define IBP_ROWS 32
+#define IBP_BLOCK_ELEMS ( IBP_LANES * IBP_ROWS )
+#define IBP_BLOCK_BYTES( width ) ( ( size_t ) ( width ) * IBP_ROWS )
+
+#define IBP_DESC_DELTA 0x80
+#define IBP_DESC_WIDTH 0x7F
+
+static __inline__
+uint32_t ibp_load32 ( const uint8_t *p )
+{
+    uint32_t v;
+    memcpy ( & v, p, sizeof v );
+#if __BYTE_ORDER == __BIG_ENDIAN
+    v = bswap_32 ( v );
+#endif
+    return v;
+}
+
+static __inline__
+void ibp_store32 ( uint8_t *p, uint32_t v )
+{
+#if __BYTE_ORDER == __BIG_ENDIAN
+    v = bswap_32 ( v );
+#endif
+    memcpy ( p, & v, sizeof v );
+}
+
+static __inline__
+uint64_t ibp_load64 ( const uint8_t *p )
+{
+    uint64_t v;
+    memcpy ( & v, p, sizeof v );
+#if __BYTE_ORDER == __BIG_ENDIAN
+    v = bswap_64 ( v );
+#endif
+    return v;
+}
+
+static __inline__
+void ibp_store64 ( uint8_t *p, uint64_t v )
+{
+#if __BYTE_ORDER == __BIG_ENDIAN
+    v = bswap_64 ( v );
+#endif
+    memcpy ( p, & v, sizeof v );
+}
+
+static __inline__
+uint32_t ibp_unzigzag32 ( uint32_t z )
+{
+    return ( z >> 1 ) ^ ( 0 - ( z & 1 ) );
+}
+
+static __inline__
+uint64_t ibp_unzigzag64 ( uint64_t z )
+{
+    return ( z >> 1 ) ^ ( 0 - ( z & 1 ) );
+}
+
+#endif /* _h_ibpzip_common_ */
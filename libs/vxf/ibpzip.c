@@ -0,0 +1,282 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+#include <vdb/extern.h>
+
+#include <klib/defs.h>
+#include <klib/rc.h>
+#include <vdb/xform.h>
+#include <vdb/schema.h>
+#include <sysalloc.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "ibpzip-common.h"
+
+typedef struct ibpzip_t ibpzip_t;
+struct ibpzip_t
+{
+    uint32_t elem_bits;
+    bool is_signed;
+};
+
+static
+uint32_t ibp_bit_width ( uint64_t v )
+{
+    uint32_t w = 0;
+    for ( ; v != 0; v >>= 1 )
+        ++ w;
+    return w;
+}
+
+/* loads one block into the coding domain, widening to 32 bits
+   with sign extension for signed elements and padding the block
+   with its last element */
+static
+void ibp_load_block ( uint64_t *x, const void *src, uint64_t first,
+    uint32_t n, uint32_t elem_bits, bool is_signed )
+{
+    uint32_t i;
+
+    switch ( elem_bits )
+    {
+    case 8:
+        for ( i = 0; i < n; ++ i )
+        {
+            x [ i ] = is_signed
+                ? ( uint32_t ) ( int32_t ) ( ( const int8_t* ) src ) [ first + i ]
+                : ( ( const uint8_t* ) src ) [ first + i ];
+        }
+        break;
+    case 16:
+        for ( i = 0; i < n; ++ i )
+        {
+            x [ i ] = is_signed
+                ? ( uint32_t ) ( int32_t ) ( ( const int16_t* ) src ) [ first + i ]
+                : ( ( const uint16_t* ) src ) [ first + i ];
+        }
+        break;
+    case 32:
+        for ( i = 0; i < n; ++ i )
+            x [ i ] = ( ( const uint32_t* ) src ) [ first + i ];
+        break;
+    default:
+        for ( i = 0; i < n; ++ i )
+            x [ i ] = ( ( const uint64_t* ) src ) [ first + i ];
+        break;
+    }
+
+    for ( ; i < IBP_BLOCK_ELEMS; ++ i )
+        x [ i ] = x [ n - 1 ];
+}
+
+static
+void ibp_write_bits ( uint32_t *words, uint32_t lane, uint32_t pos, uint32_t width, uint64_t v )
+{
+    while ( width != 0 )
+    {
+        uint32_t const s = pos & 31;
+        uint32_t take = 32 - s;
+        if ( take > width )
+            take = width;
+
+        words [ ( pos >> 5 ) * IBP_LANES + lane ] |=
+            ( uint32_t ) ( v & ( ( ( uint64_t ) 1 << take ) - 1 ) ) << s;
+
+        v >>= take;
+        pos += take;
+        width -= take;
+    }
+}
+
+static
+rc_t ibp_encode ( uint8_t *dst, size_t dsize, size_t *used,
+    const void *src, uint64_t count, uint32_t elem_bits, bool is_signed )
+{
+    uint64_t x [ IBP_BLOCK_ELEMS ];
+    uint64_t z [ IBP_BLOCK_ELEMS ];
+    uint32_t words [ IBP_LANES * 64 ];
+
+    /* arithmetic is done on 32 or 64 bits; signed values are
+       compared with their sign bit flipped */
+    uint64_t const mask = elem_bits == 64 ? UINT64_MAX : UINT32_MAX;
+    uint64_t const sign = elem_bits == 64 ? ( ( uint64_t ) 1 << 63 ) : ( ( uint64_t ) 1 << 31 );
+    uint64_t const flip = is_signed ? sign : 0;
+    uint32_t const base_bytes = elem_bits == 64 ? 8 : 4;
+
+    uint64_t const blocks = ( count + IBP_BLOCK_ELEMS - 1 ) / IBP_BLOCK_ELEMS;
+    uint64_t const dir = blocks * ( 1 + base_bytes );
+    uint64_t offset, b;
+
+    * used = 0;
+    if ( count == 0 || dir > dsize )
+        return RC ( rcXF, rcFunction, rcExecuting, rcBuffer, rcInsufficient );
+
+    for ( offset = dir, b = 0; b < blocks; ++ b )
+    {
+        uint64_t lo, hi, zor, base;
+        uint32_t i, width, for_width, delta_width;
+        uint32_t const n = count - b * IBP_BLOCK_ELEMS < IBP_BLOCK_ELEMS
+            ? ( uint32_t ) ( count - b * IBP_BLOCK_ELEMS ) : IBP_BLOCK_ELEMS;
+        bool delta;
+
+        ibp_load_block ( x, src, b * IBP_BLOCK_ELEMS, n, elem_bits, is_signed );
+
+        /* frame of reference */
+        lo = hi = x [ 0 ] ^ flip;
+        for ( i = 1; i < IBP_BLOCK_ELEMS; ++ i )
+        {
+            uint64_t const k = x [ i ] ^ flip;
+            if ( k < lo )
+                lo = k;
+            else if ( k > hi )
+                hi = k;
+        }
+        for_width = ibp_bit_width ( hi - lo );
+
+        /* zig-zagged deltas against the previous row */
+        for ( zor = 0, i = 0; i < IBP_BLOCK_ELEMS; ++ i )
+        {
+            uint64_t const prev = i < IBP_LANES ? x [ 0 ] : x [ i - IBP_LANES ];
+            uint64_t const d = ( x [ i ] - prev ) & mask;
+            z [ i ] = ( ( d << 1 ) ^ ( ( d & sign ) != 0 ? mask : 0 ) ) & mask;
+            zor |= z [ i ];
+        }
+        delta_width = ibp_bit_width ( zor );
+
+        /* frame of reference decodes faster, so it wins ties */
+        delta = delta_width < for_width;
+        if ( delta )
+        {
+            width = delta_width;
+            base = x [ 0 ];
+        }
+        else
+        {
+            width = for_width;
+            base = lo ^ flip;
+            for ( i = 0; i < IBP_BLOCK_ELEMS; ++ i )
+                z [ i ] = ( x [ i ] - base ) & mask;
+        }
+
+        if ( offset + IBP_BLOCK_BYTES ( width ) > dsize )
+            return RC ( rcXF, rcFunction, rcExecuting, rcBuffer, rcInsufficient );
+
+        memset ( words, 0, IBP_BLOCK_BYTES ( width ) );
+        for ( i = 0; i < IBP_BLOCK_ELEMS; ++ i )
+            ibp_write_bits ( words, i % IBP_LANES, ( i / IBP_LANES ) * width, width, z [ i ] );
+        for ( i = 0; i < width * IBP_LANES; ++ i )
+            ibp_store32 ( dst + offset + i * 4, words [ i ] );
+
+        dst [ b ] = ( uint8_t ) ( width | ( delta ? IBP_DESC_DELTA : 0 ) );
+        if ( base_bytes == 8 )
+            ibp_store64 ( dst + blocks + b * 8, base );
+        else
+            ibp_store32 ( dst + blocks + b * 4, ( uint32_t ) base );
+
+        offset += IBP_BLOCK_BYTES ( width );
+    }
+
+    * used = ( size_t ) offset;
+    return 0;
+}
+
+static
+rc_t CC ibpzip_func ( void *Self, const VXformInfo *info,
+    VBlobResult *dst, const VBlobData *src, VBlobHeader *hdr )
+{
+    rc_t rc;
+    size_t used;
+    const ibpzip_t *self = Self;
+
+    /* required output size */
+    size_t const dsize = ( ( size_t ) dst -> elem_count * dst -> elem_bits + 7 ) >> 3;
+
+    /* input elements */
+    uint64_t const sbits = ( uint64_t ) src -> elem_count * src -> elem_bits;
+    if ( sbits % self -> elem_bits != 0 )
+        return RC ( rcXF, rcFunction, rcExecuting, rcData, rcInvalid );
+
+    VBlobHeaderSetVersion ( hdr, 1 );
+    VBlobHeaderArgPushTail ( hdr, self -> elem_bits );
+
+    rc = ibp_encode ( dst -> data, dsize, & used, src -> data,
+        sbits / self -> elem_bits, self -> elem_bits, self -> is_signed );
+    if ( rc == 0 )
+    {
+        dst -> byte_order = vboNative;
+        dst -> elem_bits = 1;
+        dst -> elem_count = ( uint64_t ) used << 3;
+    }
+    return rc;
+}
+
+static
+void CC ibpzip_whack ( void *ptr )
+{
+    free ( ptr );
+}
+
+/* ibpzip
+ *  function ibp_fmt ibpzip #1.0 ( izip_set in );
+ */
+VTRANSFACT_IMPL ( vdb_ibpzip, 1, 0, 0 ) ( const void *Self, const VXfactInfo *info,
+    VFuncDesc *rslt, const VFactoryParams *cp, const VFunctionParams *dp )
+{
+    ibpzip_t *self;
+
+    if ( dp -> argc != 1 )
+        return RC ( rcXF, rcFunction, rcConstructing, rcParam, rcInvalid );
+
+    switch ( dp -> argv [ 0 ] . desc . intrinsic_bits )
+    {
+    case 8:
+    case 16:
+    case 32:
+    case 64:
+        break;
+    default:
+        return RC ( rcXF, rcFunction, rcConstructing, rcParam, rcInvalid );
+    }
+    if ( dp -> argv [ 0 ] . desc . domain != vtdInt && dp -> argv [ 0 ] . desc . domain != vtdUint )
+        return RC ( rcXF, rcFunction, rcConstructing, rcParam, rcInvalid );
+
+    self = malloc ( sizeof * self );
+    if ( self == NULL )
+        return RC ( rcXF, rcFunction, rcConstructing, rcMemory, rcExhausted );
+
+    self -> elem_bits = dp -> argv [ 0 ] . desc . intrinsic_bits;
+    self -> is_signed = dp -> argv [ 0 ] . desc . domain == vtdInt;
+
+    rslt -> self = self;
+    rslt -> whack = ibpzip_whack;
+    rslt -> variant = vftBlob;
+    rslt -> u . bf = ibpzip_func;
+
+    return 0;
+}
@@ -40,30 +40,58 @@
 #include <zlib.h>
 #include <assert.h>
 
-static rc_t invoke_zlib(void *dst, size_t dsize, const void *src, size_t ssize, int windowBits)
+/* the inflate stream is set up on first use and reset for
+   every following blob; a production is only ever run by one thread */
+typedef struct unzip_t unzip_t;
+struct unzip_t
+{
+    z_stream s;
+    int windowBits;
+    bool initialized;
+};
+
+static rc_t prepare_zlib(unzip_t *self)
 {
     int zr;
-    rc_t rc = 0;
 
-    z_stream s;
-    memset ( & s, 0, sizeof s );
+    if (self->initialized)
+    {
+        zr = inflateReset(&self->s);
+        if (zr == Z_OK)
+            return 0;
+        inflateEnd(&self->s);
+        self->initialized = false;
+    }
 
-    s.next_in = (void *)src;
-    s.avail_in = ssize;
-    s.next_out = dst;
-    s.avail_out = dsize;
-    
-    zr = inflateInit2(&s, windowBits);
+    memset ( & self->s, 0, sizeof self->s );
+    zr = inflateInit2(&self->s, self->windowBits);
     switch (zr)
     {
         case Z_OK:
-            break;
+            self->initialized = true;
+            return 0;
         case Z_MEM_ERROR:
             return RC(rcXF, rcFunction, rcExecuting, rcMemory, rcExhausted);
         default:
             return RC(rcXF, rcFunction, rcExecuting, rcNoObj, rcUnexpected);
     }
-    zr = inflate(&s, Z_FINISH);
+}
+
+/* inflates straight into the blob's destination buffer */
+static rc_t invoke_zlib(unzip_t *self, void *dst, size_t dsize, const void *src, size_t ssize)
+{
+    int zr;
+    z_stream *s = &self->s;
+    rc_t rc = prepare_zlib(self);
+    if (rc != 0)
+        return rc;
+
+    s->next_in = (void *)src;
+    s->avail_in = ssize;
+    s->next_out = dst;
+    s->avail_out = dsize;
+    
+    zr = inflate(s, Z_FINISH);
     switch (zr)
     {
     case Z_STREAM_END:
@@ -83,33 +111,47 @@ static rc_t invoke_zlib(void *dst, size_t dsize, const void *src, size_t ssize,
         rc = RC(rcXF, rcFunction, rcExecuting, rcNoObj, rcUnexpected);
         break;
     }
-    zr = inflateEnd(&s);
-    switch (zr)
-    {
-        case Z_OK:
-            break;
-        default:
-            if (rc == 0)
-                rc = RC(rcXF, rcFunction, rcExecuting, rcData, rcCorrupt);
-    }
 
     return rc;
 }
 
+static
+void CC unzip_whack ( void *ptr )
+{
+    unzip_t *self = ptr;
+    if ( self -> initialized )
+        inflateEnd ( & self -> s );
+    free ( self );
+}
+
+static
+rc_t unzip_make ( VFuncDesc *rslt, int windowBits )
+{
+    unzip_t *self = calloc ( 1, sizeof * self );
+    if ( self == NULL )
+        return RC ( rcXF, rcFunction, rcConstructing, rcMemory, rcExhausted );
+
+    self -> windowBits = windowBits;
+    rslt -> self = self;
+    rslt -> whack = unzip_whack;
+    return 0;
+}
+
 static
 rc_t unzip_func_v1(
+                   unzip_t *self,
                    const VXformInfo *info,
                    VBlobResult *dst,
                    const VBlobData *src
 ) {
     dst->byte_order = src->byte_order;
-    return invoke_zlib(dst->data, (((size_t)dst->elem_count * dst->elem_bits + 7) >> 3),
-                       src->data, (((size_t)src->elem_count * src->elem_bits + 7) >> 3),
-                       -15);
+    return invoke_zlib(self, dst->data, (((size_t)dst->elem_count * dst->elem_bits + 7) >> 3),
+                       src->data, (((size_t)src->elem_count * src->elem_bits + 7) >> 3));
 }
 
 static
 rc_t unzip_func_v2(
+                   unzip_t *self,
                    const VXformInfo *info,
                    VBlobResult *dst,
                    const VBlobData *src,
@@ -126,9 +168,8 @@ rc_t unzip_func_v2(
         /* the feed to zlib MUST be byte aligned
            so the output must be as well */
         assert ( ( dst -> elem_count & 7 ) == 0 );
-        rc = invoke_zlib(dst->data, (((size_t)dst->elem_count) >> 3),
-                         src->data, (((size_t)src->elem_count * src->elem_bits + 7) >> 3),
-                         -15);
+        rc = invoke_zlib(self, dst->data, (((size_t)dst->elem_count) >> 3),
+                         src->data, (((size_t)src->elem_count * src->elem_bits + 7) >> 3));
 
         /* if the original, uncompressed source was NOT byte aligned,
            back off the rounded up byte and add in the original bit count */
@@ -167,7 +208,7 @@ rc_t CC legacy_unzip_func ( void *self, const VXformInfo *info,
         if ( rc != 0 )
             break;
 
-        rc = invoke_zlib ( dst -> base, bytes, & in [ 1 ], (size_t)KDataBufferBytes ( src ) - 4, 15 );
+        rc = invoke_zlib ( self, dst -> base, bytes, & in [ 1 ], (size_t)KDataBufferBytes ( src ) - 4 );
         if ( rc == 0 )
         {
             dst -> elem_bits = 1;
@@ -198,10 +239,10 @@ rc_t CC unzip_func(
     
     switch (version) {
     case 1:
-        return unzip_func_v1(info, dst, src);
+        return unzip_func_v1(Self, info, dst, src);
         break;
     case 2:
-        return unzip_func_v2(info, dst, src, hdr);
+        return unzip_func_v2(Self, info, dst, src, hdr);
         break;
     default:
         return RC(rcXF, rcFunction, rcExecuting, rcParam, rcBadVersion);
@@ -214,10 +255,13 @@ rc_t CC unzip_func(
 VTRANSFACT_IMPL ( vdb_unzip, 1, 0, 0 ) ( const void *self, const VXfactInfo *info,
     VFuncDesc *rslt, const VFactoryParams *cp, const VFunctionParams *dp )
 {
-    rslt->variant = vftBlob;
-    rslt->u.bf = unzip_func;
-
-    return 0;
+    rc_t rc = unzip_make ( rslt, -15 );
+    if ( rc == 0 )
+    {
+        rslt->variant = vftBlob;
+        rslt->u.bf = unzip_func;
+    }
+    return rc;
 }
 
 /* NCBI:unzip
@@ -227,8 +271,11 @@ VTRANSFACT_IMPL ( NCBI_unzip, 1, 0, 0 ) ( const void *self, const VXfactInfo *in
     VFuncDesc *rslt, const VFactoryParams *cp, const VFunctionParams *dp )
 {
     VNoHdrBlobFunc f = legacy_unzip_func;
-    rslt->variant = vftLegacyBlob;
-    rslt->u.bf = ( VBlobFunc ) f;
-
-    return 0;
+    rc_t rc = unzip_make ( rslt, 15 );
+    if ( rc == 0 )
+    {
+        rslt->variant = vftLegacyBlob;
+        rslt->u.bf = ( VBlobFunc ) f;
+    }
+    return rc;
 }
@@ -0,0 +1,226 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+#include <vdb/extern.h>
+#include <klib/defs.h>
+#include <klib/rc.h>
+#include <vdb/xform.h>
+#include <vdb/schema.h>
+#include <vdb/table.h>
+#include <kdb/meta.h>
+#include <klib/data-buffer.h>
+#include <sysalloc.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zstd.h>
+#include <zstd_errors.h>
+#include <assert.h>
+
+#include "zstd-common.h"
+
+typedef struct unzstd_t unzstd_t;
+struct unzstd_t
+{
+    ZSTD_DCtx *dctx;
+    ZSTD_DDict *ddict;
+};
+
+rc_t VZstdLoadDictionary ( const VXfactInfo *info,
+    const VFactoryParams *cp, uint32_t arg, KDataBuffer *dict )
+{
+    rc_t rc;
+    const KMetadata *meta;
+
+    memset ( dict, 0, sizeof * dict );
+    if ( cp -> argc <= arg || cp -> argv [ arg ] . count == 0 )
+        return 0;
+
+    rc = VTableOpenMetadataRead ( info -> tbl, & meta );
+    if ( rc == 0 )
+    {
+        const KMDataNode *node;
+        rc = KMetadataOpenNodeRead ( meta, & node, "%.*s",
+            cp -> argv [ arg ] . count, cp -> argv [ arg ] . data . ascii );
+        if ( rc == 0 )
+        {
+            size_t num_read, remaining;
+            rc = KMDataNodeRead ( node, 0, NULL, 0, & num_read, & remaining );
+            if ( rc == 0 && remaining != 0 )
+            {
+                rc = KDataBufferMakeBytes ( dict, remaining );
+                if ( rc == 0 )
+                {
+                    size_t size = remaining;
+                    rc = KMDataNodeRead ( node, 0, dict -> base, size, & num_read, & remaining );
+                    if ( rc == 0 && num_read != size )
+                        rc = RC ( rcXF, rcFunction, rcConstructing, rcData, rcInsufficient );
+                    if ( rc != 0 )
+                        KDataBufferWhack ( dict );
+                }
+            }
+            KMDataNodeRelease ( node );
+        }
+        else if ( GetRCState ( rc ) == rcNotFound )
+        {
+            /* no dictionary has been stored */
+            rc = 0;
+        }
+        KMetadataRelease ( meta );
+    }
+
+    return rc;
+}
+
+static
+rc_t invoke_zstd ( unzstd_t *self, void *dst, size_t dsize, const void *src, size_t ssize )
+{
+    size_t zr;
+
+    /* raw content dictionaries leave no id in the frame, and frames
+       written without a dictionary never reference one, so always use it */
+    if ( self -> ddict != NULL )
+        zr = ZSTD_decompress_usingDDict ( self -> dctx, dst, dsize, src, ssize, self -> ddict );
+    else
+        zr = ZSTD_decompressDCtx ( self -> dctx, dst, dsize, src, ssize );
+
+    if ( ZSTD_isError ( zr ) )
+    {
+        switch ( ZSTD_getErrorCode ( zr ) )
+        {
+        case ZSTD_error_dstSize_tooSmall:
+            return RC ( rcXF, rcFunction, rcExecuting, rcBuffer, rcInsufficient );
+        case ZSTD_error_memory_allocation:
+            return RC ( rcXF, rcFunction, rcExecuting, rcMemory, rcExhausted );
+        case ZSTD_error_dictionary_wrong:
+            return RC ( rcXF, rcFunction, rcExecuting, rcData, rcInconsistent );
+        default:
+            return RC ( rcXF, rcFunction, rcExecuting, rcData, rcCorrupt );
+        }
+    }
+
+    if ( zr != dsize )
+        return RC ( rcXF, rcFunction, rcExecuting, rcData, rcCorrupt );
+
+    return 0;
+}
+
+static
+rc_t unzstd_func_v1 ( unzstd_t *self, VBlobResult *dst, const VBlobData *src )
+{
+    dst -> byte_order = src -> byte_order;
+    return invoke_zstd ( self, dst -> data, ( ( ( size_t ) dst -> elem_count * dst -> elem_bits + 7 ) >> 3 ),
+                         src -> data, ( ( ( size_t ) src -> elem_count * src -> elem_bits + 7 ) >> 3 ) );
+}
+
+static
+rc_t unzstd_func_v2 ( unzstd_t *self, VBlobResult *dst, const VBlobData *src, VBlobHeader *hdr )
+{
+    int64_t trailing;
+    rc_t rc = VBlobHeaderArgPopHead ( hdr, & trailing );
+    if ( rc == 0 )
+    {
+        dst -> elem_count *= dst -> elem_bits;
+        dst -> byte_order = src -> byte_order;
+        dst -> elem_bits = 1;
+
+        assert ( ( dst -> elem_count & 7 ) == 0 );
+        rc = invoke_zstd ( self, dst -> data, ( ( size_t ) dst -> elem_count ) >> 3,
+                           src -> data, ( ( ( size_t ) src -> elem_count * src -> elem_bits + 7 ) >> 3 ) );
+
+        /* back off the rounded up byte and add in the original bit count */
+        if ( rc == 0 && trailing != 0 )
+            dst -> elem_count -= 8 - trailing;
+    }
+
+    return rc;
+}
+
+static
+rc_t CC unzstd_func ( void *Self, const VXformInfo *info,
+    VBlobResult *dst, const VBlobData *src, VBlobHeader *hdr )
+{
+    unzstd_t *self = Self;
+
+    switch ( VBlobHeaderVersion ( hdr ) )
+    {
+    case 1:
+        return unzstd_func_v1 ( self, dst, src );
+    case 2:
+        return unzstd_func_v2 ( self, dst, src, hdr );
+    }
+
+    return RC ( rcXF, rcFunction, rcExecuting, rcParam, rcBadVersion );
+}
+
+static
+void CC unzstd_whack ( void *ptr )
+{
+    unzstd_t *self = ptr;
+    ZSTD_freeDDict ( self -> ddict );
+    ZSTD_freeDCtx ( self -> dctx );
+    free ( self );
+}
+
+/* unzstd
+ *  function any unzstd #1.0 < * ascii dict > ( zstd_fmt in );
+ */
+VTRANSFACT_IMPL ( vdb_unzstd, 1, 0, 0 ) ( const void *Self, const VXfactInfo *info,
+    VFuncDesc *rslt, const VFactoryParams *cp, const VFunctionParams *dp )
+{
+    rc_t rc;
+    KDataBuffer dict;
+    unzstd_t *self = calloc ( 1, sizeof * self );
+    if ( self == NULL )
+        return RC ( rcXF, rcFunction, rcConstructing, rcMemory, rcExhausted );
+
+    /* the context is reused by every blob of this production */
+    self -> dctx = ZSTD_createDCtx ();
+    if ( self -> dctx == NULL )
+        rc = RC ( rcXF, rcFunction, rcConstructing, rcMemory, rcExhausted );
+    else
+        rc = VZstdLoadDictionary ( info, cp, 0, & dict );
+    if ( rc == 0 && dict . elem_count != 0 )
+    {
+        self -> ddict = ZSTD_createDDict ( dict . base, ( size_t ) dict . elem_count );
+        if ( self -> ddict == NULL )
+            rc = RC ( rcXF, rcFunction, rcConstructing, rcData, rcInvalid );
+        KDataBufferWhack ( & dict );
+    }
+
+    if ( rc != 0 )
+    {
+        unzstd_whack ( self );
+        return rc;
+    }
+
+    rslt -> self = self;
+    rslt -> whack = unzstd_whack;
+    rslt -> variant = vftBlob;
+    rslt -> u . bf = unzstd_func;
+
+    return 0;
+}
@@ -59,9 +59,14 @@
 
 #define BUFFER_GROWTH_RATE (64 * 1024)
 
+/* the deflate stream is set up on first use and reset for
+   every following blob, rather than being made and torn down
+   for each one; a production is only ever run by one thread */
 struct self_t {
+    z_stream s;
     int32_t strategy;
     int32_t level;
+    bool initialized;
 };
 
 #if _DEBUGGING
@@ -76,57 +81,72 @@ static void debug_print_z_stream(const z_stream *s) {
 */
 #endif
 
-static rc_t invoke_zlib(void *dst, uint32_t *dsize, const void *src, uint32_t ssize, int32_t strategy, int32_t level) {
-    z_stream s;
+static rc_t prepare_zlib(struct self_t *self) {
     int zr;
-    rc_t rc = 0;
-    
-    memset(&s, 0, sizeof(s));
-    s.next_in = (void *)src;
-    s.avail_in = ssize;
-    s.next_out = dst;
-    s.avail_out = *dsize;
-    
-    *dsize = 0;
-    zr = deflateInit2(&s, level, Z_DEFLATED, -15, 9, strategy);
+
+    if (self->initialized) {
+        zr = deflateReset(&self->s);
+        if (zr == Z_OK)
+            return 0;
+#if _DEBUGGING
+        fprintf(stderr, "deflateReset: unexpected zlib error %i: %s\n", zr, self->s.msg);
+#endif
+        deflateEnd(&self->s);
+        self->initialized = false;
+    }
+
+    memset(&self->s, 0, sizeof(self->s));
+    zr = deflateInit2(&self->s, self->level, Z_DEFLATED, -15, 9, self->strategy);
     switch (zr) {
     case 0:
-        break;
+        self->initialized = true;
+        return 0;
     case Z_MEM_ERROR:
         return RC(rcXF, rcFunction, rcExecuting, rcMemory, rcExhausted);
     case Z_STREAM_ERROR:
         return RC(rcXF, rcFunction, rcExecuting, rcParam, rcInvalid);
     default:
 #if _DEBUGGING
-        fprintf(stderr, "deflateInit2: unexpected zlib error %i: %s (strategy: %i, level: %i)\n", zr, s.msg, strategy, level);
+        fprintf(stderr, "deflateInit2: unexpected zlib error %i: %s (strategy: %i, level: %i)\n", zr, self->s.msg, self->strategy, self->level);
 #endif
         return RC(rcXF, rcFunction, rcExecuting, rcSelf, rcUnexpected);
     }
-    zr = deflate(&s, Z_FINISH);
+}
+
+static rc_t invoke_zlib(struct self_t *self, void *dst, uint32_t *dsize, const void *src, uint32_t ssize) {
+    z_stream *s = &self->s;
+    uint32_t const limit = *dsize;
+    int zr;
+    rc_t rc;
+    
+    *dsize = 0;
+    rc = prepare_zlib(self);
+    if (rc != 0)
+        return rc;
+
+    s->next_in = (void *)src;
+    s->avail_in = ssize;
+    s->next_out = dst;
+    s->avail_out = limit;
+    
+    zr = deflate(s, Z_FINISH);
     switch (zr) {
     case Z_STREAM_END:
+        assert(s->total_out <= UINT32_MAX);
+        *dsize = (uint32_t)s->total_out;
         break;
     case Z_OK:
-        s.total_out = 0;
+        /* output did not fit; the stream is reset before the next blob */
         break;
     default:
 #if _DEBUGGING
-        fprintf(stderr, "deflate: unexpected zlib error %i: %s\n", zr, s.msg);
+        fprintf(stderr, "deflate: unexpected zlib error %i: %s\n", zr, s->msg);
 #endif
+        deflateEnd(s);
+        self->initialized = false;
         rc = RC(rcXF, rcFunction, rcExecuting, rcSelf, rcUnexpected);
         break;
     }
-    zr = deflateEnd(&s);
-    if (zr != Z_OK && s.total_out != 0) {
-#if _DEBUGGING
-        fprintf(stderr, "deflateEnd: unexpected zlib error %i: %s\n", zr, s.msg);
-#endif
-        rc = RC(rcXF, rcFunction, rcExecuting, rcSelf, rcUnexpected);
-    }
-    if (rc == 0) {
-        assert(s.total_out <= UINT32_MAX);
-        *dsize = (uint32_t)s.total_out;
-    }
     return rc;
 }
 
@@ -159,7 +179,7 @@ rc_t CC zip_func(
         VBlobHeaderArgPushTail ( hdr, ( int64_t ) ( sbits & 7 ) );
     }
 
-    rc = invoke_zlib ( dst -> data, & dsize, src -> data, ssize, self->strategy, self->level);
+    rc = invoke_zlib ( self, dst -> data, & dsize, src -> data, ssize );
     if (rc == 0) {
         dst->elem_bits = 1;
         dst->byte_order = src->byte_order;
@@ -174,7 +194,10 @@ rc_t CC zip_func(
 static
 void CC vxf_zip_wrapper( void *ptr )
 {
-	free( ptr );
+    struct self_t *self = ptr;
+    if ( self -> initialized )
+        deflateEnd ( & self -> s );
+    free( ptr );
 }
 
 /* zip
@@ -200,7 +223,7 @@ VTRANSFACT_IMPL(vdb_zip, 1, 0, 0) (const void *self, const VXfactInfo *info, VFu
         }
     }
 
-    ctx = malloc(sizeof(*ctx));
+    ctx = calloc(1, sizeof(*ctx));
     if (ctx) {
         ctx->strategy = strategy;
         ctx->level = level;
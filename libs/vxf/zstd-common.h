@@ -0,0 +1,49 @@
+/*===========================================================================
+ *
+ *                            PUBLIC DOMAIN NOTICE
+ *               National Center for Biotechnology Information
+ *
+ *  This software/database is a "United States Government Work" under the
+ *  terms of the United States Copyright Act.  It was written as part of
+ *  the author's official duties as a United States Government employee and
+ *  thus cannot be copyrighted.  This software/database is freely available
+ *  to the public for use. The National Library of Medicine and the U.S.
+ *  Government have not placed any restriction on its use or reproduction.
+ *
+ *  Although all reasonable efforts have been taken to ensure the accuracy
+ *  and reliability of the software and data, the NLM and the U.S.
+ *  Government do not and cannot warrant the performance or results that
+ *  may be obtained by using this software or data. The NLM and the U.S.
+ *  Government disclaim all warranties, express or implied, including
+ *  warranties of performance, merchantability or fitness for any particular
+ *  purpose.
+ *
+ *  Please cite the author in any work or product based on this material.
+ *
+ * ===========================================================================
+ *
+ */
+
+#ifndef _h_vxf_zstd_common_
+#define _h_vxf_zstd_common_
+
+#ifndef _h_klib_defs_
+#include <klib/defs.h>
+#endif
+
+struct KDataBuffer;
+struct VXfactInfo;
+struct VFactoryParams;
+
+/* VZstdLoadDictionary
+ *  reads a trained dictionary from the table metadata node named by
+ *  factory parameter "arg", when the parameter is given.
+ *
+ *  "dict" [ OUT ] - receives the dictionary bytes. it stays empty
+ *  ( elem_count == 0 ) when no node is named or the node does not exist,
+ *  in which case compression proceeds without a dictionary.
+ */
+rc_t VZstdLoadDictionary ( const struct VXfactInfo *info,
+    const struct VFactoryParams *cp, uint32_t arg, struct KDataBuffer *dict );
+
+#endif /* _h_vxf_zstd_common_ */
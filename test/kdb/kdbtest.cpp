@@ -36,7 +36,10 @@
 #include <kdb/database.h>
 #include <kdb/index.h>
 #include <kdb/table.h>
+#include <kdb/column.h>
 
+#include <klib/rc.h>
+#include <kproc/thread.h>
 #include <vfs/manager.h>
 
 using namespace std;
@@ -78,6 +81,188 @@ TEST_CASE(KDBManagerVPathType)
     
 }
 
+// idx2col holds 1024 blobs, indexed by idx2 in 32 blocks;
+// blob i covers ( i % 5 ) + 1 rows starting at row i * 5 + 1
+static const int64_t Idx2ColRows = 1024 * 5;
+
+static void Idx2ColExpected ( int64_t id, int64_t & first, uint32_t & span )
+{
+    int64_t i = ( id - 1 ) / 5;
+    first = i * 5 + 1;
+    span = ( uint32_t ) ( i % 5 ) + 1;
+    if ( id >= first + span )
+        first = span = 0;
+}
+
+static rc_t Idx2ColCheck ( const KColumn * col, bool descending )
+{
+    static const uint32_t count = 512;
+    int64_t ids [ count ], first [ count ];
+    uint32_t span [ count ];
+
+    for ( int64_t start = 1; start <= Idx2ColRows; start += count )
+    {
+        uint32_t i;
+        for ( i = 0; i < count; ++ i )
+            ids [ i ] = descending ? Idx2ColRows + 1 - start - i : start + i;
+
+        rc_t rc = KColumnLocateBlobs ( col, ids, count, first, span );
+        if ( rc != 0 )
+            return rc;
+
+        for ( i = 0; i < count; ++ i )
+        {
+            int64_t f;
+            uint32_t s;
+            Idx2ColExpected ( ids [ i ], f, s );
+            if ( first [ i ] != f || span [ i ] != s )
+                return RC ( rcDB, rcIndex, rcValidating, rcData, rcInvalid );
+        }
+    }
+    return 0;
+}
+
+static rc_t Idx2ColOpen ( const KDBManager ** mgr, const KColumn ** col, size_t limit )
+{
+    rc_t rc = KDBManagerMakeRead ( mgr, NULL );
+    if ( rc == 0 )
+    {
+        rc = KDBManagerSetIndexCacheLimit ( * mgr, limit );
+        if ( rc == 0 )
+            rc = KDBManagerOpenColumnRead ( * mgr, col, "idx2col" );
+        if ( rc != 0 )
+            KDBManagerRelease ( * mgr );
+    }
+    return rc;
+}
+
+TEST_CASE(IndexCache_LocateBlobs)
+{
+    // no cache, room for a few blocks, and for all of them
+    const size_t limits [] = { 0, 2048, 1024 * 1024 };
+    for ( size_t i = 0; i < sizeof limits / sizeof limits [ 0 ]; ++ i )
+    {
+        const KDBManager * mgr;
+        const KColumn * col;
+        REQUIRE_RC ( Idx2ColOpen ( & mgr, & col, limits [ i ] ) );
+
+        REQUIRE_RC ( Idx2ColCheck ( col, false ) );
+        REQUIRE_RC ( Idx2ColCheck ( col, true ) );
+
+        const KColumnBlob * blob;
+        REQUIRE_RC ( KColumnOpenBlobRead ( col, & blob, 32 ) );
+        int64_t first;
+        uint32_t count;
+        REQUIRE_RC ( KColumnBlobIdRange ( blob, & first, & count ) );
+        REQUIRE_EQ ( first, ( int64_t ) 31 );
+        REQUIRE_EQ ( count, ( uint32_t ) 2 );
+        REQUIRE_RC ( KColumnBlobRelease ( blob ) );
+
+        REQUIRE_RC_FAIL ( KColumnOpenBlobRead ( col, & blob, 33 ) );
+
+        REQUIRE_RC ( KColumnRelease ( col ) );
+        REQUIRE_RC ( KDBManagerRelease ( mgr ) );
+    }
+}
+
+static rc_t CC Idx2ColThread ( const KThread * self, void * data )
+{
+    const KColumn * col = ( const KColumn * ) data;
+    rc_t rc = 0;
+    for ( int round = 0; rc == 0 && round < 64; ++ round )
+        rc = Idx2ColCheck ( col, round % 2 != 0 );
+    return rc;
+}
+
+TEST_CASE(IndexCache_Concurrent)
+{
+    // both threads walk the column in opposite directions,
+    // evicting blocks the other is using
+    const KDBManager * mgr;
+    const KColumn * col;
+    REQUIRE_RC ( Idx2ColOpen ( & mgr, & col, 2048 ) );
+
+    KThread * t;
+    REQUIRE_RC ( KThreadMake ( & t, Idx2ColThread, ( void * ) col ) );
+    rc_t rc = 0;
+    for ( int round = 0; rc == 0 && round < 64; ++ round )
+        rc = Idx2ColCheck ( col, round % 2 == 0 );
+    rc_t status;
+    REQUIRE_RC ( KThreadWait ( t, & status ) );
+    REQUIRE_RC ( KThreadRelease ( t ) );
+    REQUIRE_RC ( rc );
+    REQUIRE_RC ( status );
+
+    REQUIRE_RC ( KColumnRelease ( col ) );
+    REQUIRE_RC ( KDBManagerRelease ( mgr ) );
+}
+
+// each blob of idx2col holds the low byte of its number
+static rc_t Idx2ColReadBlobs ( const KColumn * col, bool descending )
+{
+    for ( int n = 0; n < 1024; ++ n )
+    {
+        int i = descending ? 1023 - n : n;
+        const KColumnBlob * blob;
+        rc_t rc = KColumnOpenBlobRead ( col, & blob, ( int64_t ) i * 5 + 1 );
+        if ( rc == 0 )
+        {
+            uint8_t b [ 4 ];
+            size_t num_read, remaining;
+            rc = KColumnBlobRead ( blob, 0, b, sizeof b, & num_read, & remaining );
+            if ( rc == 0 && ( num_read != 1 || remaining != 0 || b [ 0 ] != ( uint8_t ) i ) )
+                rc = RC ( rcDB, rcBlob, rcValidating, rcData, rcInvalid );
+            KColumnBlobRelease ( blob );
+        }
+        if ( rc != 0 )
+            return rc;
+    }
+    return 0;
+}
+
+static rc_t CC Idx2ColReadThread ( const KThread * self, void * data )
+{
+    const KColumn * col = ( const KColumn * ) data;
+    rc_t rc = 0;
+    for ( int round = 0; rc == 0 && round < 16; ++ round )
+        rc = Idx2ColReadBlobs ( col, round % 2 != 0 );
+    return rc;
+}
+
+TEST_CASE(ColumnDataMapping)
+{
+    // blobs read the same with and without mapping, in order,
+    // out of order, and from two threads sharing the column
+    const KDBManager * mgr;
+    REQUIRE_RC ( KDBManagerMakeRead ( & mgr, NULL ) );
+    REQUIRE_RC_FAIL ( KDBManagerSetColumnDataMapping ( NULL, true ) );
+
+    for ( int map = 0; map < 2; ++ map )
+    {
+        REQUIRE_RC ( KDBManagerSetColumnDataMapping ( mgr, map != 0 ) );
+        const KColumn * col;
+        REQUIRE_RC ( KDBManagerOpenColumnRead ( mgr, & col, "idx2col" ) );
+
+        REQUIRE_RC ( Idx2ColReadBlobs ( col, false ) );
+        REQUIRE_RC ( Idx2ColReadBlobs ( col, true ) );
+
+        KThread * t;
+        REQUIRE_RC ( KThreadMake ( & t, Idx2ColReadThread, ( void * ) col ) );
+        rc_t rc = 0;
+        for ( int round = 0; rc == 0 && round < 16; ++ round )
+            rc = Idx2ColReadBlobs ( col, round % 2 == 0 );
+        rc_t status;
+        REQUIRE_RC ( KThreadWait ( t, & status ) );
+        REQUIRE_RC ( KThreadRelease ( t ) );
+        REQUIRE_RC ( rc );
+        REQUIRE_RC ( status );
+
+        REQUIRE_RC ( KColumnRelease ( col ) );
+    }
+
+    REQUIRE_RC ( KDBManagerRelease ( mgr ) );
+}
+
 //////////////////////////////////////////// Main
 extern "C"
 {
@@ -36,6 +36,7 @@
 #include <klib/rc.h>
 
 #include <kproc/thread.h>
+#include <klib/time.h>
 
 #include <kfs/defs.h>
 #include <kfs/directory.h>
@@ -47,6 +48,8 @@ using namespace std;
 #define DATAFILE "org.dat"
 #define CACHEFILE "cache.dat"
 #define CACHEFILE1 "cache.dat.cache"
+#define OTHERFILE "other.dat"
+#define TRIMDIR "trim.dir"
 #define DATAFILESIZE ( ( 1024 * 1024 ) + 300 )
 
 TEST_SUITE( CacheTeeTests );
@@ -479,6 +482,258 @@ TEST_CASE( CacheTee_Multiple_Users_with_Promoting )
 }
 
 
+struct SharedTeeAccess
+{
+	const KFile * org;
+	const KFile * tee;
+	int id;
+};
+
+static rc_t CC shared_thread_func( const KThread *self, void *data )
+{
+	SharedTeeAccess * access = ( SharedTeeAccess * ) data;
+	rc_t rc = 0;
+	/* overlapping ranges, so that threads ask for the same blocks at the same time */
+	for ( int i = 0; i < 16 && rc == 0; ++i )
+	{
+		uint64_t pos = ( ( uint64_t )( i * 7 + access -> id ) * 1024 * 21 ) % DATAFILESIZE;
+		rc = compare_file_content( access -> org, access -> tee, pos, 1024 * 40 );
+	}
+	return rc;
+}
+
+
+TEST_CASE( CacheTee_Shared_By_Threads )
+{
+	KOutMsg( "Test: CacheTee_Shared_By_Threads\n" );
+	remove_file( CACHEFILE );	// to start with a clean slate on caching...
+	remove_file( CACHEFILE1 );
+
+    KDirectory * dir;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+
+	const KFile * org;
+    REQUIRE_RC( KDirectoryOpenFileRead( dir, &org, "%s", DATAFILE ) );
+	const KFile * tee;
+	REQUIRE_RC( KDirectoryMakeCacheTee ( dir, &tee, org, 0, "%s", CACHEFILE ) );
+
+	const int n = 8;
+	KThread *t [ n ];
+	SharedTeeAccess access[ n ];
+	for ( int i = 0; i < n; ++i )
+	{
+		access[ i ] . org = org;
+		access[ i ] . tee = tee;
+		access[ i ] . id = i;
+		REQUIRE_RC( KThreadMake ( &( t[ i ] ), shared_thread_func, &( access[ i ] ) ) );
+	}
+
+	for ( int i = 0; i < n; ++i )
+	{
+		rc_t rc_thread;
+		REQUIRE_RC( KThreadWait ( t[ i ], &rc_thread ) );
+		REQUIRE_RC( rc_thread );
+		REQUIRE_RC( KThreadRelease ( t[ i ] ) );
+	}
+
+	REQUIRE_RC( KFileRelease( tee ) );
+	REQUIRE_RC( KFileRelease( org ) );
+	REQUIRE_RC( KDirectoryRelease( dir ) );
+}
+
+
+TEST_CASE( CacheTee_Background_Fill )
+{
+	KOutMsg( "Test: CacheTee_Background_Fill\n" );
+	remove_file( CACHEFILE );	// to start with a clean slate on caching...
+	remove_file( CACHEFILE1 );
+
+    KDirectory * dir;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+
+	const KFile * org;
+    REQUIRE_RC( KDirectoryOpenFileRead( dir, &org, "%s", DATAFILE ) );
+	const KFile * tee;
+	REQUIRE_RC( KDirectoryMakeCacheTee ( dir, &tee, org, 0, "%s", CACHEFILE ) );
+
+	/* read a little bit, the fill-thread does the rest */
+	REQUIRE_RC( compare_file_content( org, tee, 1024 * 500, 100 ) );
+	REQUIRE_RC( StartCacheFill( tee ) );
+
+	const KFile * cache;
+	REQUIRE_RC( KDirectoryOpenFileRead( dir, &cache, "%s", CACHEFILE1 ) );
+	bool is_complete = false;
+	for ( int i = 0; i < 1000 && ! is_complete; ++i )
+	{
+		REQUIRE_RC( IsCacheFileComplete( cache, &is_complete ) );
+		if ( ! is_complete )
+			KSleepMs( 10 );
+	}
+	REQUIRE( is_complete );
+	REQUIRE_RC( KFileRelease( cache ) );
+
+	/* releasing the tee promotes the complete cache */
+	REQUIRE_RC( KFileRelease( tee ) );
+	REQUIRE( KDirectoryPathType ( dir, "%s", CACHEFILE1 ) == kptNotFound );
+
+	REQUIRE_RC( KDirectoryOpenFileRead( dir, &cache, "%s", CACHEFILE ) );
+	REQUIRE_RC( compare_file_content( org, cache, 0, DATAFILESIZE ) );
+	REQUIRE_RC( KFileRelease( cache ) );
+
+	REQUIRE_RC( KFileRelease( org ) );
+	REQUIRE_RC( KDirectoryRelease( dir ) );
+}
+
+
+TEST_CASE( CacheTee_ReadV )
+{
+	KOutMsg( "Test: CacheTee_ReadV\n" );
+	remove_file( CACHEFILE );	// to start with a clean slate on caching...
+	remove_file( CACHEFILE1 );
+
+    KDirectory * dir;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+
+	const KFile * org;
+    REQUIRE_RC( KDirectoryOpenFileRead( dir, &org, "%s", DATAFILE ) );
+	const KFile * tee;
+	REQUIRE_RC( KDirectoryMakeCacheTee ( dir, &tee, org, 0, "%s", CACHEFILE ) );
+
+	/* ranges spanning several blocks, one of them partially cached, one at the end */
+	REQUIRE_RC( compare_file_content( org, tee, 1024 * 300, 10 ) );
+	const size_t n = 3;
+	const uint64_t pos[ n ] = { 1024 * 200, 1024 * 700, DATAFILESIZE - 100 };
+	uint8_t * buf[ n ];
+	uint8_t * expected = ( uint8_t * )malloc( 1024 * 200 );
+	KFileReadVec vec[ n ];
+	for ( size_t i = 0; i < n; ++i )
+	{
+		buf[ i ] = ( uint8_t * )malloc( 1024 * 200 );
+		vec[ i ] . pos = pos[ i ];
+		vec[ i ] . buffer = buf[ i ];
+		vec[ i ] . bsize = 1024 * 200;
+	}
+	REQUIRE_RC( KFileReadV( tee, vec, n ) );
+	for ( size_t i = 0; i < n; ++i )
+	{
+		size_t num_read;
+		REQUIRE_RC( KFileReadAll( org, pos[ i ], expected, 1024 * 200, &num_read ) );
+		REQUIRE_EQ( vec[ i ] . num_read, num_read );
+		REQUIRE_EQ( memcmp( buf[ i ], expected, num_read ), 0 );
+		free( buf[ i ] );
+	}
+	free( expected );
+
+	REQUIRE_RC( KFileRelease( tee ) );
+	REQUIRE_RC( KFileRelease( org ) );
+	REQUIRE_RC( KDirectoryRelease( dir ) );
+}
+
+
+TEST_CASE( CacheTee_Shared_Cache_File )
+{
+	KOutMsg( "Test: CacheTee_Shared_Cache_File\n" );
+	remove_file( CACHEFILE );	// to start with a clean slate on caching...
+	remove_file( CACHEFILE1 );
+	REQUIRE_RC( create_random_file( OTHERFILE, DATAFILESIZE ) );
+
+    KDirectory * dir;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+
+	/* two cache-tees sharing one cache file, the 2nd one over different content of the same size:
+	   it returns the original content only if it takes the blocks the 1st one fetched from disk */
+	const KFile * org;
+    REQUIRE_RC( KDirectoryOpenFileRead( dir, &org, "%s", DATAFILE ) );
+	const KFile * other;
+    REQUIRE_RC( KDirectoryOpenFileRead( dir, &other, "%s", OTHERFILE ) );
+
+	const KFile * tee1;
+	REQUIRE_RC( KDirectoryMakeCacheTee ( dir, &tee1, org, 0, "%s", CACHEFILE ) );
+	const KFile * tee2;
+	REQUIRE_RC( KDirectoryMakeCacheTee ( dir, &tee2, other, 0, "%s", CACHEFILE ) );
+
+	REQUIRE_RC( read_all( tee1, 1024 * 32 ) );
+	REQUIRE_RC( compare_file_content( org, tee2, 0, DATAFILESIZE ) );
+
+	REQUIRE_RC( KFileRelease( tee2 ) );
+	REQUIRE_RC( KFileRelease( tee1 ) );
+	REQUIRE_RC( KFileRelease( other ) );
+	REQUIRE_RC( KFileRelease( org ) );
+
+	/* the cache was complete, and got promoted */
+	REQUIRE_EQ( KDirectoryPathType( dir, "%s", CACHEFILE ), ( uint32_t )kptFile );
+	const KFile * promoted;
+    REQUIRE_RC( KDirectoryOpenFileRead( dir, &promoted, "%s", CACHEFILE ) );
+    REQUIRE_RC( KDirectoryOpenFileRead( dir, &org, "%s", DATAFILE ) );
+	REQUIRE_RC( compare_file_content( org, promoted, 0, DATAFILESIZE ) );
+	REQUIRE_RC( KFileRelease( promoted ) );
+	REQUIRE_RC( KFileRelease( org ) );
+
+	remove_file( OTHERFILE );
+	REQUIRE_RC( KDirectoryRelease( dir ) );
+}
+
+TEST_CASE( CacheTee_Trim_Cache_Dir )
+{
+	KOutMsg( "Test: CacheTee_Trim_Cache_Dir\n" );
+
+    KDirectory * dir;
+    REQUIRE_RC( KDirectoryNativeDir( &dir ) );
+	KDirectoryRemove( dir, true, "%s", TRIMDIR );
+	REQUIRE_RC( KDirectoryCreateDir( dir, 0775, kcmCreate, "%s", TRIMDIR ) );
+
+	/* three files used one after another */
+	KTime_t now = KTimeStamp();
+	REQUIRE_RC( create_random_file( TRIMDIR "/a.dat", 64 * 1024 ) );
+	REQUIRE_RC( create_random_file( TRIMDIR "/b.dat", 64 * 1024 ) );
+	REQUIRE_RC( create_random_file( TRIMDIR "/c.dat", 64 * 1024 ) );
+	REQUIRE_RC( KDirectorySetDate( dir, false, now - 300, "%s/a.dat", TRIMDIR ) );
+	REQUIRE_RC( KDirectorySetDate( dir, false, now - 200, "%s/b.dat", TRIMDIR ) );
+	REQUIRE_RC( KDirectorySetDate( dir, false, now - 100, "%s/c.dat", TRIMDIR ) );
+
+	/* and a cache file older than all of them, but being filled right now */
+	const KFile * org;
+    REQUIRE_RC( KDirectoryOpenFileRead( dir, &org, "%s", DATAFILE ) );
+	const KFile * tee;
+	REQUIRE_RC( KDirectoryMakeCacheTee ( dir, &tee, org, 0, "%s/d.dat", TRIMDIR ) );
+	char buffer[ 1024 ];
+	size_t num_read;
+	REQUIRE_RC( KFileReadAll( tee, 0, buffer, sizeof buffer, &num_read ) );
+	REQUIRE_RC( KDirectorySetDate( dir, false, now - 400, "%s/d.dat.cache", TRIMDIR ) );
+
+	uint64_t a_size, b_size, c_size, d_size;
+	REQUIRE_RC( KDirectoryFileSize( dir, &a_size, "%s/a.dat", TRIMDIR ) );
+	REQUIRE_RC( KDirectoryFileSize( dir, &b_size, "%s/b.dat", TRIMDIR ) );
+	REQUIRE_RC( KDirectoryFileSize( dir, &c_size, "%s/c.dat", TRIMDIR ) );
+	REQUIRE_RC( KDirectoryFileSize( dir, &d_size, "%s/d.dat.cache", TRIMDIR ) );
+
+	/* within budget, nothing to do */
+	uint64_t evicted;
+	REQUIRE_RC( KDirectoryTrimCacheDir( dir, a_size + b_size + c_size + d_size, &evicted, "%s", TRIMDIR ) );
+	REQUIRE_EQ( evicted, ( uint64_t )0 );
+
+	/* the least recently used go first, the file in use stays */
+	REQUIRE_RC( KDirectoryTrimCacheDir( dir, c_size + d_size, &evicted, "%s", TRIMDIR ) );
+	REQUIRE_EQ( evicted, a_size + b_size );
+	REQUIRE_EQ( KDirectoryPathType( dir, "%s/a.dat", TRIMDIR ), ( uint32_t )kptNotFound );
+	REQUIRE_EQ( KDirectoryPathType( dir, "%s/b.dat", TRIMDIR ), ( uint32_t )kptNotFound );
+	REQUIRE_EQ( KDirectoryPathType( dir, "%s/c.dat", TRIMDIR ), ( uint32_t )kptFile );
+	REQUIRE_EQ( KDirectoryPathType( dir, "%s/d.dat.cache", TRIMDIR ), ( uint32_t )kptFile );
+
+	REQUIRE_RC( KDirectoryTrimCacheDir( dir, 0, &evicted, "%s", TRIMDIR ) );
+	REQUIRE_EQ( evicted, c_size );
+	REQUIRE_EQ( KDirectoryPathType( dir, "%s/d.dat.cache", TRIMDIR ), ( uint32_t )kptFile );
+
+	/* once released, it may go as well */
+	REQUIRE_RC( KFileRelease( tee ) );
+	REQUIRE_RC( KFileRelease( org ) );
+	REQUIRE_RC( KDirectoryTrimCacheDir( dir, 0, &evicted, "%s", TRIMDIR ) );
+	REQUIRE_EQ( KDirectoryPathType( dir, "%s/d.dat.cache", TRIMDIR ), ( uint32_t )kptNotFound );
+
+	REQUIRE_RC( KDirectoryRemove( dir, true, "%s", TRIMDIR ) );
+	REQUIRE_RC( KDirectoryRelease( dir ) );
+}
+
 //////////////////////////////////////////// Main
 extern "C"
 {
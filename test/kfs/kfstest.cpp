@@ -35,6 +35,13 @@
 #include <kfs/directory.h>
 #include <kfs/impl.h>
 #include <kfs/tar.h>
+#include <kfs/buffile.h>
+#include <kfs/ioqueue.h>
+#include <kfs/kfs-priv.h>
+#include <kfs/sra.h>
+#include <klib/vector.h>
+#include <klib/rc.h>
+#include <kproc/thread.h>
 
 #include <kfs/ffext.h>
 #include <kfs/ffmagic.h>
@@ -43,7 +50,9 @@
 #include <kfs/fileformat.h>
 #undef class
 
+extern "C" {
 #include "../../libs/kfs/toc-priv.h"
+}
 
 using namespace std;
 
@@ -84,6 +93,56 @@ TEST_CASE(KMMapMakeRead_and_KMMapRelease)
     REQUIRE_RC(KDirectoryRelease ( wd ));
 }
 
+TEST_CASE(KMMapAdvise_Region)
+{   // advice on unaligned ranges of a region, cropped to it, and the data still there after it
+
+    KDirectory *wd;
+    REQUIRE_RC(KDirectoryNativeDir ( & wd ));
+
+    const char* fileName="test.advise";
+    const size_t fileSize = 64 * 1024;
+    char * contents = new char [ fileSize ];
+    for ( size_t i = 0; i < fileSize; ++ i )
+        contents [ i ] = ( char ) ( i % 249 );
+    {
+        KFile* file;
+        REQUIRE_RC(KDirectoryCreateFile(wd, &file, true, 0664, kcmInit, fileName));
+        size_t num_writ=0;
+        REQUIRE_RC(KFileWriteAll(file, 0, contents, fileSize, &num_writ));
+        REQUIRE_RC(KFileRelease(file));
+    }
+
+    const KFile* file;
+    REQUIRE_RC(KDirectoryOpenFileRead(wd, &file, fileName));
+    const KMMap * mm;
+    const uint64_t rgnPos = 5000;
+    const size_t rgnSize = 30000;
+    REQUIRE_RC(KMMapMakeRgnRead(&mm, file, rgnPos, rgnSize));
+
+    REQUIRE_RC(KMMapAdvise(mm, 6001, 3000, kmmaWillNeed));
+    REQUIRE_RC(KMMapAdvise(mm, 0, fileSize, kmmaRandom));           // cropped to the region
+    REQUIRE_RC(KMMapAdvise(mm, 40000, 1000, kmmaWillNeed));         // beyond it: nothing to do
+    REQUIRE_RC(KMMapAdvise(mm, rgnPos, rgnSize, kmmaSequential));
+    REQUIRE_RC(KMMapAdvise(mm, rgnPos + 123, 20000, kmmaDontNeed));
+    REQUIRE_RC(KMMapAdvise(mm, rgnPos, rgnSize, kmmaNormal));
+    REQUIRE_RC_FAIL(KMMapAdvise(mm, rgnPos, rgnSize, kmmaDontNeed + 1));
+    REQUIRE_RC_FAIL(KMMapAdvise(NULL, rgnPos, rgnSize, kmmaNormal));
+
+    uint64_t pos;
+    REQUIRE_RC(KMMapPosition(mm, &pos));
+    size_t size;
+    REQUIRE_RC(KMMapSize(mm, &size));
+    const void * addr;
+    REQUIRE_RC(KMMapAddrRead(mm, &addr));
+    REQUIRE_EQ(memcmp(addr, contents + pos, size), 0);
+
+    REQUIRE_RC(KMMapRelease(mm));
+    REQUIRE_RC(KFileRelease(file));
+    delete [] contents;
+    REQUIRE_RC(KDirectoryRemove(wd, false, fileName));
+    REQUIRE_RC(KDirectoryRelease ( wd ));
+}
+
 #ifdef LINUX
 
 TEST_CASE(ExtFileFormat)
@@ -165,6 +224,369 @@ TEST_CASE(Tar_Parse)
     REQUIRE_RC(KDirectoryRelease(dir));
 }                                 
 
+TEST_CASE(BufFileReadAhead)
+{   // read a file sequentially, then at random, through a read-ahead buffer
+
+    KDirectory *wd;
+    REQUIRE_RC(KDirectoryNativeDir ( & wd ));
+
+    const char* fileName="test.readahead";
+    const size_t fileSize = 1000003;
+
+    {   // create temp file of known contents
+        KFile* file;
+        REQUIRE_RC(KDirectoryCreateFile(wd, &file, true, 0664, kcmInit, fileName));
+        char contents [ 4096 ];
+        for ( size_t pos = 0; pos < fileSize; pos += sizeof contents )
+        {
+            size_t size = fileSize - pos < sizeof contents ? fileSize - pos : sizeof contents;
+            for ( size_t i = 0; i < size; ++ i )
+                contents [ i ] = ( char ) ( ( pos + i ) % 251 );
+            size_t num_writ=0;
+            REQUIRE_RC(KFileWriteAll(file, pos, contents, size, &num_writ));
+        }
+        REQUIRE_RC(KFileRelease(file));
+    }
+
+    const KFile* orig;
+    REQUIRE_RC(KDirectoryOpenFileRead(wd, &orig, fileName));
+    const KFile* buf;
+    REQUIRE_RC(KBufFileMakeReadAhead(&buf, orig, 512 * 1024, 256 * 1024));
+
+    char data [ 10000 ];
+    size_t num_read;
+    uint64_t pos = 0;
+    for ( ; ; pos += num_read )
+    {   // sequential
+        REQUIRE_RC(KFileReadAll(buf, pos, data, sizeof data, &num_read));
+        if ( num_read == 0 )
+            break;
+        for ( size_t i = 0; i < num_read; ++ i )
+            REQUIRE_EQ((int)data[i], (int)(char)((pos + i) % 251));
+    }
+    REQUIRE_EQ(pos, (uint64_t)fileSize);
+
+    for ( uint64_t i = 0; i < 50; ++ i )
+    {   // random
+        pos = ( i * 7919 * 1031 ) % fileSize;
+        REQUIRE_RC(KFileReadAll(buf, pos, data, sizeof data, &num_read));
+        REQUIRE_EQ(num_read, (size_t)(fileSize - pos < sizeof data ? fileSize - pos : sizeof data));
+        REQUIRE_EQ((int)data[0], (int)(char)(pos % 251));
+        REQUIRE_EQ((int)data[num_read-1], (int)(char)((pos + num_read - 1) % 251));
+    }
+
+    REQUIRE_RC(KFileRelease(buf));
+    REQUIRE_RC(KFileRelease(orig));
+    REQUIRE_RC(KDirectoryRemove(wd, false, fileName));
+    REQUIRE_RC(KDirectoryRelease ( wd ));
+}
+
+TEST_CASE(KFileReadV_SysFile)
+{   // adjacent, separate and out of order ranges, and one past end of file
+
+    KDirectory *wd;
+    REQUIRE_RC(KDirectoryNativeDir ( & wd ));
+
+    const char* fileName="test.readv";
+    char contents [ 1000 ];
+    for ( size_t i = 0; i < sizeof contents; ++ i )
+        contents [ i ] = ( char ) ( i % 253 );
+    {
+        KFile* file;
+        REQUIRE_RC(KDirectoryCreateFile(wd, &file, true, 0664, kcmInit, fileName));
+        size_t num_writ=0;
+        REQUIRE_RC(KFileWriteAll(file, 0, contents, sizeof contents, &num_writ));
+        REQUIRE_RC(KFileRelease(file));
+    }
+
+    const KFile* file;
+    REQUIRE_RC(KDirectoryOpenFileRead(wd, &file, fileName));
+
+    char buf [ 5 ] [ 100 ];
+    const uint64_t pos [ 5 ] = { 0, 100, 500, 200, 950 };
+    KFileReadVec vec [ 5 ];
+    for ( int i = 0; i < 5; ++ i )
+    {
+        vec [ i ] . pos = pos [ i ];
+        vec [ i ] . buffer = buf [ i ];
+        vec [ i ] . bsize = sizeof buf [ i ];
+    }
+    REQUIRE_RC(KFileReadV(file, vec, 5));
+    for ( int i = 0; i < 5; ++ i )
+    {
+        size_t expected = pos [ i ] + 100 > sizeof contents ? sizeof contents - pos [ i ] : 100;
+        REQUIRE_EQ(vec [ i ] . num_read, expected);
+        REQUIRE_EQ(memcmp(buf [ i ], contents + pos [ i ], expected), 0);
+    }
+
+    REQUIRE_RC(KFileRelease(file));
+    REQUIRE_RC(KDirectoryRemove(wd, false, fileName));
+    REQUIRE_RC(KDirectoryRelease ( wd ));
+}
+
+TEST_CASE(KFileIOQueue_Reads)
+{   // more reads than the queue holds, into a registered buffer, one reaching end of file
+
+    KDirectory *wd;
+    REQUIRE_RC(KDirectoryNativeDir ( & wd ));
+
+    const char* fileName="test.ioqueue";
+    const size_t fileSize = 100000;
+    char * contents = new char [ fileSize ];
+    for ( size_t i = 0; i < fileSize; ++ i )
+        contents [ i ] = ( char ) ( i % 251 );
+    {
+        KFile* file;
+        REQUIRE_RC(KDirectoryCreateFile(wd, &file, true, 0664, kcmInit, fileName));
+        size_t num_writ=0;
+        REQUIRE_RC(KFileWriteAll(file, 0, contents, fileSize, &num_writ));
+        REQUIRE_RC(KFileRelease(file));
+    }
+
+    const KFile* sys;
+    REQUIRE_RC(KDirectoryOpenFileRead(wd, &sys, fileName));
+    const KFile* buf;
+    REQUIRE_RC(KBufFileMakeRead(&buf, sys, 4096));
+
+    KFileIOQueue *q;
+    REQUIRE_RC(KFileIOQueueMake(&q, 4));
+
+    const int reads = 20;
+    const size_t chunk = 1000;
+    char * block = new char [ reads * chunk ];
+    void * bufs [ 1 ] = { block };
+    size_t sizes [ 1 ] = { reads * chunk };
+    REQUIRE_RC(KFileIOQueueRegisterBuffers(q, bufs, sizes, 1));
+
+    // the sys file goes through the ring when there is one, the buffered file never does
+    for ( int pass = 0; pass < 2; ++ pass )
+    {
+        const KFile * f = pass == 0 ? sys : buf;
+        memset ( block, 0, reads * chunk );
+
+        int done = 0;
+        KFileIOCompletion c;
+        for ( int i = 0; i < reads; )
+        {
+            uint64_t pos = ( uint64_t ) ( reads - 1 - i ) * 5003 + 500;
+            rc_t rc = KFileIOQueueRead(q, f, pos, block + i * chunk, chunk, 0, (void*)(size_t)i);
+            if ( rc == 0 )
+            {
+                ++ i;
+                continue;
+            }
+            REQUIRE_EQ(GetRCState(rc), rcExhausted);
+            REQUIRE_EQ(KFileIOQueueOutstanding(q), 4u);
+            REQUIRE_RC(KFileIOQueueComplete(q, &c, true));
+            REQUIRE_RC(c.rc);
+            ++ done;
+        }
+        REQUIRE_RC(KFileIOQueueSubmit(q));
+        while ( KFileIOQueueOutstanding(q) != 0 )
+        {
+            REQUIRE_RC(KFileIOQueueComplete(q, &c, true));
+            REQUIRE_RC(c.rc);
+            ++ done;
+        }
+        REQUIRE_EQ(done, reads);
+        REQUIRE_EQ(GetRCState(KFileIOQueueComplete(q, &c, true)), rcDone);
+
+        for ( int i = 0; i < reads; ++ i )
+        {
+            uint64_t pos = ( uint64_t ) ( reads - 1 - i ) * 5003 + 500;
+            size_t expected = pos + chunk > fileSize ? fileSize - pos : chunk;
+            REQUIRE_EQ(memcmp(block + i * chunk, contents + pos, expected), 0);
+        }
+    }
+
+    // vectored, one range past end of file
+    char vbuf [ 3 ] [ 2000 ];
+    KFileReadVec vec [ 3 ];
+    const uint64_t pos [ 3 ] = { 70000, 10, fileSize - 500 };
+    for ( int i = 0; i < 3; ++ i )
+    {
+        vec [ i ] . pos = pos [ i ];
+        vec [ i ] . buffer = vbuf [ i ];
+        vec [ i ] . bsize = sizeof vbuf [ i ];
+    }
+    REQUIRE_RC(KFileIOQueueReadV(q, sys, vec, 3));
+    REQUIRE_EQ(vec [ 0 ] . num_read, sizeof vbuf [ 0 ]);
+    REQUIRE_EQ(vec [ 1 ] . num_read, sizeof vbuf [ 1 ]);
+    REQUIRE_EQ(vec [ 2 ] . num_read, (size_t)500);
+    for ( int i = 0; i < 3; ++ i )
+        REQUIRE_EQ(memcmp(vbuf [ i ], contents + pos [ i ], vec [ i ] . num_read), 0);
+
+    REQUIRE_RC(KFileIOQueueRelease(q));
+    delete [] block;
+    delete [] contents;
+
+    REQUIRE_RC(KFileRelease(buf));
+    REQUIRE_RC(KFileRelease(sys));
+    REQUIRE_RC(KDirectoryRemove(wd, false, fileName));
+    REQUIRE_RC(KDirectoryRelease ( wd ));
+}
+
+#if LINUX
+struct LockProbe
+{
+    KDirectory * wd;
+    const char * name;
+    rc_t rc;
+};
+
+static rc_t CC LockProbeThread ( const KThread *, void *data )
+{   // tries an exclusive lock through a file of its own
+    LockProbe * p = ( LockProbe * ) data;
+    KFile * f;
+    rc_t rc = KDirectoryOpenFileWrite ( p -> wd, & f, true, "%s", p -> name );
+    if ( rc == 0 )
+    {
+        p -> rc = KFileLockRange ( f, 0, 100, true, false );
+        if ( p -> rc == 0 )
+            rc = KFileUnlockRange ( f, 0, 100 );
+        KFileRelease ( f );
+    }
+    return rc;
+}
+
+static rc_t RunLockProbe ( LockProbe & p )
+{
+    KThread * t;
+    rc_t rc = KThreadMake ( & t, LockProbeThread, & p );
+    if ( rc == 0 )
+    {
+        rc_t status;
+        rc = KThreadWait ( t, & status );
+        if ( rc == 0 )
+            rc = status;
+        KThreadRelease ( t );
+    }
+    return rc;
+}
+
+TEST_CASE(KFileLockRange_Threads)
+{   // a lock excludes another thread, and survives closing another handle to the file
+
+    KDirectory *wd;
+    REQUIRE_RC(KDirectoryNativeDir ( & wd ));
+
+    const char* fileName="test.lock";
+    KFile* file;
+    REQUIRE_RC(KDirectoryCreateFile(wd, &file, true, 0664, kcmInit, fileName));
+    REQUIRE_RC(KFileLockRange(file, 0, 100, true, false));
+
+    const KFile* other;
+    REQUIRE_RC(KDirectoryOpenFileRead(wd, &other, fileName));
+    REQUIRE_RC(KFileRelease(other));
+
+    LockProbe p = { wd, fileName, 0 };
+    REQUIRE_RC(RunLockProbe(p));
+    REQUIRE_EQ(GetRCState(p.rc), rcBusy);
+
+    REQUIRE_RC(KFileUnlockRange(file, 0, 100));
+    REQUIRE_RC(RunLockProbe(p));
+    REQUIRE_RC(p.rc);
+
+    REQUIRE_RC(KFileRelease(file));
+    REQUIRE_RC(KDirectoryRemove(wd, false, fileName));
+    REQUIRE_RC(KDirectoryRelease ( wd ));
+}
+#endif
+
+static rc_t MakeToc ( KToc ** toc, const KFile * archive )
+{
+    String path;
+    CONST_STRING ( & path, "./toc.sra" );
+    return KTocInit ( toc, & path, tocKFile, archive, sraAlign4Byte );
+}
+
+static const KTocEntry * TocResolve ( const KToc * toc, const char * path, KTocEntryType * type )
+{
+    const KTocEntry * entry;
+    const char * unused;
+    if ( KTocResolvePathTocEntry ( toc, & entry, path, strlen ( path ), type, & unused ) != 0 )
+        return NULL;
+    return entry;
+}
+
+TEST_CASE(Toc_InflateOnDemand)
+{   // a persisted TOC inflated one directory at a time, hard links included, matches the full inflation
+
+    KDirectory *wd;
+    REQUIRE_RC(KDirectoryNativeDir ( & wd ));
+    const KFile* archive;
+    REQUIRE_RC(KDirectoryOpenFileRead(wd, &archive, "kfstest.cpp"));
+
+    KToc * src;
+    REQUIRE_RC(MakeToc(&src, archive));
+    REQUIRE_RC(KTocCreateDir(src, 0, 0775, kcmCreate, "d"));
+    REQUIRE_RC(KTocCreateFile(src, 0, 10, 0, 0664, kcmCreate, "d/x"));
+    REQUIRE_RC(KTocCreateFile(src, 10, 5, 0, 0664, kcmCreate, "r"));
+    REQUIRE_RC(KTocCreateDir(src, 0, 0775, kcmCreate | kcmParents, "z/b"));
+    REQUIRE_RC(KTocCreateFile(src, 100, 20, 0, 0664, kcmCreate, "z/b/f"));
+    REQUIRE_RC(KTocCreateHardLink(src, 0, 0775, kcmCreate, "d", "z/l"));
+    REQUIRE_RC(KTocCreateHardLink(src, 0, 0664, kcmCreate, "r", "z/rl"));
+
+    Vector files;
+    VectorInit(&files, 0, 1);
+    void * buffer;
+    size_t buffer_size;
+    uint64_t arcsize;
+    REQUIRE_RC(KTocPersist(src, &buffer, &buffer_size, &arcsize, &files));
+
+    const uint8_t * tree = (const uint8_t *) buffer + SraHeaderSize ( NULL );
+    uint64_t offset = SraHeaderGetFileOffset ( ( const KSraHeader * ) buffer );
+    uint32_t tree_size = ( uint32_t ) ( buffer_size - SraHeaderSize ( NULL ) );
+
+    KToc * full;
+    REQUIRE_RC(MakeToc(&full, archive));
+    REQUIRE_RC(KTocInflatePBSTree(full, arcsize, tree, tree_size, offset, false, ""));
+
+    KToc * lazy;
+    REQUIRE_RC(MakeToc(&lazy, archive));
+    void * copy = malloc ( tree_size );
+    REQUIRE_NOT_NULL(copy);
+    memcpy ( copy, tree, tree_size );
+    REQUIRE_RC(KTocSetPersisted(lazy, arcsize, copy, tree_size, offset, false));
+
+    KTocEntryType type;
+    const KTocEntry * z = TocResolve(lazy, "z", &type);
+    REQUIRE_NOT_NULL(z);
+    REQUIRE_EQ(type, ktocentrytype_dir);
+    REQUIRE_NOT_NULL(z->u.dir.pending);
+
+    const KTocEntry * f = TocResolve(lazy, "z/b/f", &type);
+    REQUIRE_NOT_NULL(f);
+    REQUIRE_NULL(z->u.dir.pending);
+    const KTocEntry * ff = TocResolve(full, "z/b/f", &type);
+    REQUIRE_NOT_NULL(ff);
+    REQUIRE_EQ(f->u.contiguous_file.file_size, ff->u.contiguous_file.file_size);
+    REQUIRE_EQ(f->u.contiguous_file.archive_offset, ff->u.contiguous_file.archive_offset);
+
+    // a link to a directory stays a hard link, the others become copies
+    REQUIRE_EQ(TocResolve(lazy, "z/l", &type), TocResolve(lazy, "d", &type));
+    const KTocEntry * x = TocResolve(lazy, "z/l/x", &type);
+    REQUIRE_NOT_NULL(x);
+    REQUIRE_EQ(x, TocResolve(lazy, "d/x", &type));
+
+    KTocEntryType ftype;
+    const KTocEntry * rl = TocResolve(lazy, "z/rl", &type);
+    REQUIRE_NOT_NULL(rl);
+    REQUIRE_NE(type, ktocentrytype_hardlink);
+    const KTocEntry * frl = TocResolve(full, "z/rl", &ftype);
+    REQUIRE_NOT_NULL(frl);
+    REQUIRE_EQ(type, ftype);
+    REQUIRE_EQ(rl->u.contiguous_file.file_size, frl->u.contiguous_file.file_size);
+    REQUIRE_EQ(rl->u.contiguous_file.archive_offset, frl->u.contiguous_file.archive_offset);
+
+    REQUIRE_RC(KTocRelease(lazy));
+    REQUIRE_RC(KTocRelease(full));
+    REQUIRE_RC(KTocRelease(src));
+    free ( buffer );
+    REQUIRE_RC(KFileRelease(archive));
+    REQUIRE_RC(KDirectoryRelease ( wd ));
+}
+
 //////////////////////////////////////////// Main
 extern "C"
 {
@@ -31,12 +31,18 @@
 #include <ktst/unit_test.hpp>
 
 #include <klib/log.h>
+#include <klib/rc.h>
 
 #include <kfg/config.h>
 
 #include <kns/manager.h>
 #include <kns/kns-mgr-priv.h>
 #include <kns/http.h>
+#include <kns/endpoint.h>
+#include <kns/socket.h>
+#include <kns/stream.h>
+#include <kproc/lock.h>
+#include <kproc/thread.h>
 
 #include <../libs/kns/mgr-priv.h>
 #include <../libs/kns/http-priv.h>
@@ -48,7 +54,9 @@
 #include <sysalloc.h>
 #include <stdexcept>
 #include <cstring>
+#include <cstdio>
 #include <list>
+#include <vector>
 
 TEST_SUITE(HttpTestSuite);
 
@@ -265,7 +273,7 @@ FIXTURE_TEST_CASE(Http_Read, HttpFixture)
     TestStream::AddResponse(    // response to GET
         "HTTP/1.1 206 Partial Content\n"
         "Transfer-Encoding: chunked\n"
-        /*"Content-Length: 7\n" */ /* bug fix in KClientHttpResultHandleContentRange: used to break if Content-Length was not there */
+        /*"Content-Length: 7\n" */ /* bug fix in Content-Range handling: used to break if Content-Length was not there */
         "Content-Range: bytes 0-6/7\n" 
         "\n"
         "7\n"
@@ -289,6 +297,43 @@ FIXTURE_TEST_CASE(HttpRequest_POST_NoParams, HttpFixture)
 }
 
 
+FIXTURE_TEST_CASE(HttpResult_Headers, HttpFixture)
+{   // CRLF line ends, a header longer than the line buffer increment
+    KClientHttpRequest *req;
+    REQUIRE_RC ( KNSManagerMakeClientRequest ( m_mgr, &req, 0x01010000, & m_stream, MakeURL(GetName()).c_str() ) );
+
+    KClientHttpResult *rslt;
+    TestStream::AddResponse(
+        "HTTP/1.1 206 Partial Content\r\n"
+        "X-Long: " + string ( 3000, 'x' ) + "\r\n"
+        "Content-Length: 5\r\n"
+        "Content-Range: bytes 2-6/7\r\n"
+        "Connection: Keep-Alive\r\n"
+        "\r\n"
+    );
+    REQUIRE_RC ( KClientHttpRequestGET ( req, & rslt ) );
+
+    uint64_t size;
+    REQUIRE ( KClientHttpResultSize ( rslt, & size ) );
+    REQUIRE_EQ ( (uint64_t)5, size );
+
+    uint64_t pos;
+    size_t bytes;
+    REQUIRE_RC ( KClientHttpResultRange ( rslt, & pos, & bytes ) );
+    REQUIRE_EQ ( (uint64_t)2, pos );
+    REQUIRE_EQ ( (size_t)5, bytes );
+
+    REQUIRE ( KClientHttpResultKeepAlive ( rslt ) );
+
+    char buf[4096];
+    size_t num_read;
+    REQUIRE_RC ( KClientHttpResultGetHeader ( rslt, "X-Long", buf, sizeof buf, & num_read ) );
+    REQUIRE_EQ ( string ( 3000, 'x' ), string ( buf, num_read ) );
+
+    REQUIRE_RC ( KClientHttpResultRelease ( rslt ) );
+    REQUIRE_RC ( KClientHttpRequestRelease ( req ) );
+}
+
 //////////////////////////
 // HttpRetrySpecs
 
@@ -633,6 +678,335 @@ FIXTURE_TEST_CASE(HttpReliableRequest_POST_5xx_retry, HttpFixture)
     REQUIRE_RC ( KClientHttpRequestRelease ( req ) );
 }
 
+//////////////////////////
+// Parallel range reads against a local stand-in server
+class HttpServerFixture
+{
+public:
+    HttpServerFixture()
+    : m_mgr(0), m_file(0), m_listener(0), m_acceptor(0), m_lock(0), m_stop(false), m_port(0), m_gets(0)
+    {
+        if ( KNSManagerMake ( & m_mgr ) != 0 )
+            throw logic_error ( "HttpServerFixture: KNSManagerMake failed" );
+        if ( KLockMake ( & m_lock ) != 0 )
+            throw logic_error ( "HttpServerFixture: KLockMake failed" );
+
+        for ( size_t i = 0; i < 100000; ++ i )
+            m_content += ( char ) ( ( i * 7 + i / 251 ) & 0xFF );
+
+        KEndPoint ep;
+        if ( KNSManagerInitIPv4Endpoint ( m_mgr, & ep, 0x7F000001, 0 ) != 0 ||
+             KNSManagerMakeListener ( m_mgr, & m_listener, & ep ) != 0 ||
+             KSocketGetLocalEndpoint ( ( const KSocket* ) m_listener, & ep ) != 0 )
+            throw logic_error ( "HttpServerFixture: cannot listen" );
+        m_port = ep . u . ipv4 . port;
+
+        if ( KThreadMake ( & m_acceptor, Accept, this ) != 0 )
+            throw logic_error ( "HttpServerFixture: KThreadMake failed" );
+    }
+
+    ~HttpServerFixture()
+    {
+        /* hang up the client side first */
+        KFileRelease ( m_file );
+
+        /* wake the acceptor with a connection of our own */
+        m_stop = true;
+        KEndPoint ep;
+        KSocket *sock;
+        if ( KNSManagerInitIPv4Endpoint ( m_mgr, & ep, 0x7F000001, m_port ) == 0 &&
+             KNSManagerMakeConnection ( m_mgr, & sock, NULL, & ep ) == 0 )
+            KSocketRelease ( sock );
+
+        /* closes the connections kept for reuse */
+        KNSManagerRelease ( m_mgr );
+
+        rc_t status;
+        KThreadWait ( m_acceptor, & status );
+        KThreadRelease ( m_acceptor );
+        for ( size_t i = 0; i < m_handlers . size (); ++ i )
+        {
+            KThreadWait ( m_handlers [ i ], & status );
+            KThreadRelease ( m_handlers [ i ] );
+        }
+
+        KListenerRelease ( m_listener );
+        KLockRelease ( m_lock );
+    }
+
+    string URL () const
+    {
+        char buf [ 64 ];
+        sprintf ( buf, "http://127.0.0.1:%u/file", ( unsigned ) m_port );
+        return buf;
+    }
+
+    size_t Connections ()
+    {
+        KLockAcquire ( m_lock );
+        size_t n = m_handlers . size ();
+        KLockUnlock ( m_lock );
+        return n;
+    }
+
+    size_t Gets ()
+    {
+        KLockAcquire ( m_lock );
+        size_t n = m_gets;
+        KLockUnlock ( m_lock );
+        return n;
+    }
+
+    KNSManager* m_mgr;
+    const KFile* m_file;
+    string m_content;
+
+private:
+    struct Conn
+    {
+        HttpServerFixture * server;
+        KStream * stream;
+    };
+
+    static rc_t CC Accept ( const KThread *, void *data )
+    {
+        HttpServerFixture * self = ( HttpServerFixture * ) data;
+        while ( true )
+        {
+            KSocket *sock;
+            rc_t rc = KListenerAccept ( self -> m_listener, & sock );
+            if ( rc != 0 )
+                return rc;
+            if ( self -> m_stop )
+            {
+                KSocketRelease ( sock );
+                return 0;
+            }
+
+            Conn * c = new Conn;
+            c -> server = self;
+            rc = KSocketGetStream ( sock, & c -> stream );
+            KSocketRelease ( sock );
+
+            KThread *t;
+            if ( rc == 0 && KThreadMake ( & t, Serve, c ) == 0 )
+            {
+                KLockAcquire ( self -> m_lock );
+                self -> m_handlers . push_back ( t );
+                KLockUnlock ( self -> m_lock );
+            }
+            else
+            {
+                KStreamRelease ( c -> stream );
+                delete c;
+            }
+        }
+    }
+
+    /* answers HEAD and ranged GET requests until the client hangs up,
+       or after the answer to a request asking to close */
+    static rc_t CC Serve ( const KThread *, void *data )
+    {
+        Conn * c = ( Conn * ) data;
+        HttpServerFixture * self = c -> server;
+        const string & content = self -> m_content;
+        string req;
+        while ( true )
+        {
+            size_t end = req . find ( "\r\n\r\n" );
+            if ( end == string :: npos )
+            {
+                char buf [ 4096 ];
+                size_t num_read;
+                if ( KStreamRead ( c -> stream, buf, sizeof buf, & num_read ) != 0 || num_read == 0 )
+                    break;
+                req . append ( buf, num_read );
+                continue;
+            }
+
+            string head = req . substr ( 0, end );
+            req . erase ( 0, end + 4 );
+            bool close = head . find ( "Connection: close" ) != string :: npos;
+
+            char hdr [ 256 ];
+            string rsp;
+            if ( head . compare ( 0, 5, "HEAD " ) == 0 )
+            {
+                sprintf ( hdr, "HTTP/1.1 200 OK\r\nContent-Length: %u\r\n\r\n", ( unsigned ) content . size () );
+                rsp = hdr;
+            }
+            else
+            {
+                unsigned long first, last;
+                size_t r = head . find ( "Range: bytes=" );
+                if ( r == string :: npos ||
+                     sscanf ( head . c_str () + r, "Range: bytes=%lu-%lu", & first, & last ) != 2 ||
+                     first >= content . size () )
+                    break;
+                if ( last >= content . size () )
+                    last = content . size () - 1;
+                sprintf ( hdr, "HTTP/1.1 206 Partial Content\r\nContent-Length: %lu\r\n"
+                    "Content-Range: bytes %lu-%lu/%u\r\n%s\r\n",
+                    last - first + 1, first, last, ( unsigned ) content . size (),
+                    close ? "Connection: close\r\n" : "" );
+                rsp = hdr + content . substr ( first, last - first + 1 );
+
+                KLockAcquire ( self -> m_lock );
+                ++ self -> m_gets;
+                KLockUnlock ( self -> m_lock );
+            }
+
+            size_t num_writ;
+            if ( KStreamWriteAll ( c -> stream, rsp . data (), rsp . size (), & num_writ ) != 0 || close )
+                break;
+        }
+        KStreamRelease ( c -> stream );
+        delete c;
+        return 0;
+    }
+
+    KListener * m_listener;
+    KThread * m_acceptor;
+    KLock * m_lock;
+    vector < KThread * > m_handlers;
+    volatile bool m_stop;
+    uint16_t m_port;
+    size_t m_gets;
+};
+
+FIXTURE_TEST_CASE(HttpParallelRead, HttpServerFixture)
+{
+    REQUIRE_RC ( KNSManagerSetHTTPParallelRead ( m_mgr, 4, 4096 ) );
+    REQUIRE_RC ( KNSManagerMakeHttpFile ( m_mgr, & m_file, NULL, 0x01010000, URL () . c_str () ) );
+
+    /* a read of many chunks comes back in order, over several connections */
+    vector < char > buf ( 60000 );
+    size_t num_read;
+    REQUIRE_RC ( KFileRead ( m_file, 1234, & buf [ 0 ], buf . size (), & num_read ) );
+    REQUIRE_EQ ( num_read, buf . size () );
+    REQUIRE ( memcmp ( & buf [ 0 ], m_content . data () + 1234, num_read ) == 0 );
+    REQUIRE_GT ( Connections (), ( size_t ) 1 );
+    REQUIRE_GE ( Gets (), ( size_t ) 15 );
+
+    /* stops at the end of the file */
+    REQUIRE_RC ( KFileRead ( m_file, m_content . size () - 20000, & buf [ 0 ], buf . size (), & num_read ) );
+    REQUIRE_EQ ( num_read, ( size_t ) 20000 );
+    REQUIRE ( memcmp ( & buf [ 0 ], m_content . data () + m_content . size () - 20000, num_read ) == 0 );
+
+    /* small reads keep to a single request */
+    size_t gets = Gets ();
+    REQUIRE_RC ( KFileRead ( m_file, 50, & buf [ 0 ], 5000, & num_read ) );
+    REQUIRE_EQ ( num_read, ( size_t ) 5000 );
+    REQUIRE ( memcmp ( & buf [ 0 ], m_content . data () + 50, num_read ) == 0 );
+    REQUIRE_EQ ( Gets (), gets + 1 );
+}
+
+FIXTURE_TEST_CASE(HttpReadV, HttpServerFixture)
+{
+    REQUIRE_RC ( KNSManagerMakeHttpFile ( m_mgr, & m_file, NULL, 0x01010000, URL () . c_str () ) );
+    size_t gets = Gets ();
+
+    /* nearby ranges share a request, the distant last one
+       takes another, and stops at end of file */
+    char buf [ 4 ] [ 3000 ];
+    KFileReadVec vec [ 4 ];
+    const uint64_t pos [ 4 ] = { 100, 3100, 10000, 99000 };
+    for ( int i = 0; i < 4; ++ i )
+    {
+        vec [ i ] . pos = pos [ i ];
+        vec [ i ] . buffer = buf [ i ];
+        vec [ i ] . bsize = sizeof buf [ i ];
+    }
+    REQUIRE_RC ( KFileReadV ( m_file, vec, 4 ) );
+    for ( int i = 0; i < 4; ++ i )
+    {
+        size_t expected = min ( sizeof buf [ i ], ( size_t ) ( m_content . size () - pos [ i ] ) );
+        REQUIRE_EQ ( vec [ i ] . num_read, expected );
+        REQUIRE ( memcmp ( buf [ i ], m_content . data () + pos [ i ], expected ) == 0 );
+    }
+    REQUIRE_EQ ( Gets (), gets + 2 );
+}
+
+FIXTURE_TEST_CASE(HttpConnectionPool, HttpServerFixture)
+{
+    char buf [ 1000 ];
+    size_t num_read;
+    REQUIRE_RC ( KNSManagerMakeHttpFile ( m_mgr, & m_file, NULL, 0x01010000, URL () . c_str () ) );
+    REQUIRE_RC ( KFileRead ( m_file, 0, buf, sizeof buf, & num_read ) );
+    REQUIRE_RC ( KFileRelease ( m_file ) );
+    m_file = NULL;
+
+    /* the next file to the same server continues on the same connection */
+    REQUIRE_RC ( KNSManagerMakeHttpFile ( m_mgr, & m_file, NULL, 0x01010000, URL () . c_str () ) );
+    REQUIRE_RC ( KFileRead ( m_file, 500, buf, sizeof buf, & num_read ) );
+    REQUIRE_EQ ( num_read, sizeof buf );
+    REQUIRE ( memcmp ( buf, m_content . data () + 500, num_read ) == 0 );
+    REQUIRE_EQ ( Connections (), ( size_t ) 1 );
+
+    /* unless reuse is disabled */
+    REQUIRE_RC ( KNSManagerSetHTTPConnectionPool ( m_mgr, 0, 0, 0 ) );
+    REQUIRE_RC ( KFileRelease ( m_file ) );
+    m_file = NULL;
+    REQUIRE_RC ( KNSManagerMakeHttpFile ( m_mgr, & m_file, NULL, 0x01010000, URL () . c_str () ) );
+    REQUIRE_EQ ( Connections (), ( size_t ) 2 );
+}
+
+/* sends a GET for 60000 bytes, reading "to_read" of them */
+static
+rc_t PoolGet ( KNSManager * mgr, const string & url, bool close, size_t to_read )
+{
+    KClientHttpRequest * req;
+    rc_t rc = KNSManagerMakeClientRequest ( mgr, & req, 0x01010000, NULL, "%s", url . c_str () );
+    if ( rc == 0 )
+    {
+        KClientHttpResult * rslt = NULL;
+        rc = KClientHttpRequestByteRange ( req, 0, 60000 );
+        if ( rc == 0 )
+            rc = KClientHttpRequestConnection ( req, close );
+        if ( rc == 0 )
+            rc = KClientHttpRequestGET ( req, & rslt );
+        if ( rc == 0 && to_read != 0 )
+        {
+            KStream * s;
+            rc = KClientHttpResultGetInputStream ( rslt, & s );
+            if ( rc == 0 )
+            {
+                char buf [ 1000 ];
+                size_t num_read;
+                for ( size_t total = 0; rc == 0 && total < to_read; total += num_read )
+                {
+                    rc = KStreamRead ( s, buf, min ( sizeof buf, to_read - total ), & num_read );
+                    if ( rc == 0 && num_read == 0 )
+                        rc = RC ( rcNS, rcNoTarg, rcReading, rcTransfer, rcIncomplete );
+                }
+                KStreamRelease ( s );
+            }
+        }
+        KClientHttpResultRelease ( rslt );
+        KClientHttpRequestRelease ( req );
+    }
+    return rc;
+}
+
+FIXTURE_TEST_CASE(HttpConnectionPool_ResponseRead, HttpServerFixture)
+{
+    /* a connection is kept once the whole body is read */
+    REQUIRE_RC ( PoolGet ( m_mgr, URL (), false, 60000 ) );
+    REQUIRE_RC ( PoolGet ( m_mgr, URL (), false, 60000 ) );
+    REQUIRE_EQ ( Connections (), ( size_t ) 1 );
+
+    /* but not with part of the body still to come */
+    REQUIRE_RC ( PoolGet ( m_mgr, URL (), false, 10 ) );
+    REQUIRE_RC ( PoolGet ( m_mgr, URL (), false, 60000 ) );
+    REQUIRE_EQ ( Connections (), ( size_t ) 2 );
+
+    /* nor when the server closes it after the response */
+    REQUIRE_RC ( PoolGet ( m_mgr, URL (), true, 60000 ) );
+    REQUIRE_RC ( PoolGet ( m_mgr, URL (), false, 60000 ) );
+    REQUIRE_EQ ( Connections (), ( size_t ) 3 );
+    REQUIRE_EQ ( Gets (), ( size_t ) 6 );
+}
+
 //////////////////////////////////////////// Main
 extern "C"
 {
@@ -0,0 +1,65 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "wb-nucstrstr-impl.h"
+
+#define NucStrstrMake test_NucStrstrMake
+#define NucStrstrWhack test_NucStrstrWhack
+#define NucStrstrSearch test_NucStrstrSearch
+
+#include "../libs/search/nucstrstr.c"
+
+int nssKernelAvailable(int kernel)
+{
+    switch (kernel) {
+    case nssKernelSSE2:
+        return INTEL_INTRINSICS;
+#if NSS_AVX2
+    case nssKernelAVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+    return 0;
+}
+
+int nssMake(void **nss, int positional, const char *query, unsigned int len)
+{
+    return NucStrstrMake((NucStrstr**)nss, positional, query, len);
+}
+
+void nssWhack(void *nss)
+{
+    NucStrstrWhack(nss);
+}
+
+int nssSearch(const void *nss, int kernel, const void *ncbi2na, unsigned int pos, unsigned int len)
+{
+#if NSS_AVX2
+    nss_avx2 = kernel == nssKernelAVX2;
+#endif
+    return NucStrstrSearch(nss, ncbi2na, pos, len, NULL);
+}
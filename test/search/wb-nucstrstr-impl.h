@@ -0,0 +1,50 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_nucstrstr_impl_
+#define _h_nucstrstr_impl_
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* evaluators */
+enum { nssKernelSSE2, nssKernelAVX2 };
+
+/* non-zero if the kernel was built and the processor runs it */
+int nssKernelAvailable(int kernel);
+
+int nssMake(void **nss, int positional, const char *query, unsigned int len);
+void nssWhack(void *nss);
+
+/* NucStrstrSearch with the given evaluators */
+int nssSearch(const void *nss, int kernel, const void *ncbi2na, unsigned int pos, unsigned int len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,286 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+/**
+* White box tests and benchmark for the nucstrstr evaluators
+*/
+
+#include <ktst/unit_test.hpp>
+#include <kapp/main.h> /* KMain */
+
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "wb-nucstrstr-impl.h"
+#include "PerfCounter.h"
+
+using namespace std;
+
+TEST_SUITE(NucStrstrTestSuite);
+
+static const char na2 [] = "ACGT";
+static const char na4 [] = "-ACMGRSVTWYHKDBN";
+
+class NucStrstrFixture
+{
+public:
+    NucStrstrFixture()
+    : nss(0)
+    {
+    }
+    ~NucStrstrFixture()
+    {
+        if (nss != 0)
+            nssWhack(nss);
+    }
+
+    // random 2na, with the slack NucStrstrSearch may read past the end
+    void MakeSequence(unsigned int bases)
+    {
+        seq.resize(bases);
+        for (unsigned int i = 0; i < bases; ++i)
+            seq[i] = rand() & 3;
+        packed.assign((bases + 3) / 4 + 32, 0);
+        for (unsigned int i = 0; i < bases; ++i)
+            packed[i / 4] |= seq[i] << (6 - 2 * (i & 3));
+    }
+
+    void Plant(const string &query, unsigned int at)
+    {
+        for (size_t i = 0; i < query.size(); ++i)
+        {
+            // any base allowed by the 4na code
+            int code = strchr(na4, query[i]) - na4;
+            int base;
+            do
+                base = rand() & 3;
+            while ((code & (1 << base)) == 0);
+
+            seq[at + i] = base;
+            packed[(at + i) / 4] &= ~(3 << (6 - 2 * ((at + i) & 3)));
+            packed[(at + i) / 4] |= base << (6 - 2 * ((at + i) & 3));
+        }
+    }
+
+    // first matching position relative to "pos", 1-based
+    int Reference(const string &query, unsigned int pos, unsigned int len) const
+    {
+        for (unsigned int i = pos; i + query.size() <= pos + len; ++i)
+        {
+            size_t j;
+            for (j = 0; j < query.size(); ++j)
+            {
+                int code = strchr(na4, query[j]) - na4;
+                if ((code & (1 << seq[i + j])) == 0)
+                    break;
+            }
+            if (j == query.size())
+                return (int)(i - pos + 1);
+        }
+        return 0;
+    }
+
+    bool Make(const string &query, int positional)
+    {
+        if (nss != 0)
+            nssWhack(nss);
+        nss = 0;
+        return nssMake(&nss, positional, query.data(), (unsigned int)query.size()) == 0;
+    }
+
+    // every available kernel agrees with the reference
+    bool Agrees(const string &query, int positional, unsigned int pos, unsigned int len)
+    {
+        int expected = Reference(query, pos, len);
+        for (int kernel = nssKernelSSE2; kernel <= nssKernelAVX2; ++kernel)
+        {
+            if (!nssKernelAvailable(kernel))
+                continue;
+            int found = nssSearch(nss, kernel, &packed[0], pos, len);
+            if (positional ? found != expected : (found != 0) != (expected != 0))
+            {
+                fprintf(stderr, "%s kernel %d pos %u len %u: %d, expected %d\n",
+                    query.c_str(), kernel, pos, len, found, expected);
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static string RandomQuery(size_t size, bool ambiguous)
+    {
+        string query;
+        for (size_t i = 0; i < size; ++i)
+            query += ambiguous && (rand() & 3) == 0 ? na4[1 + rand() % 15] : na2[rand() & 3];
+        return query;
+    }
+
+    void *nss;
+    vector<uint8_t> seq;
+    vector<uint8_t> packed;
+};
+
+// every 2na query size, from the 8-bit to the 128-bit evaluators
+FIXTURE_TEST_CASE(NucStrstr_2na, NucStrstrFixture)
+{
+    srand(1);
+    for (size_t size = 1; size <= 61; ++size)
+    {
+        for (int positional = 0; positional < 2; ++positional)
+        {
+            string query = RandomQuery(size, false);
+            REQUIRE(Make(query, positional));
+            for (int trial = 0; trial < 40; ++trial)
+            {
+                unsigned int pos = rand() % 8;
+                unsigned int len = size + rand() % 1200;
+                MakeSequence(pos + len);
+                if (trial & 1)
+                    Plant(query, pos + rand() % (len - size + 1));
+                REQUIRE(Agrees(query, positional, pos, len));
+            }
+        }
+    }
+}
+
+// ambiguous queries use the 4na evaluators
+FIXTURE_TEST_CASE(NucStrstr_4na, NucStrstrFixture)
+{
+    srand(2);
+    for (size_t size = 1; size <= 29; ++size)
+    {
+        for (int positional = 0; positional < 2; ++positional)
+        {
+            string query = RandomQuery(size, true);
+            query[0] = 'N';
+            REQUIRE(Make(query, positional));
+            for (int trial = 0; trial < 40; ++trial)
+            {
+                unsigned int pos = rand() % 8;
+                unsigned int len = size + rand() % 1200;
+                MakeSequence(pos + len);
+                if (trial & 1)
+                    Plant(query, pos + rand() % (len - size + 1));
+                REQUIRE(Agrees(query, positional, pos, len));
+            }
+        }
+    }
+}
+
+// matches at the very ends of the range and just outside of it
+FIXTURE_TEST_CASE(NucStrstr_bounds, NucStrstrFixture)
+{
+    srand(3);
+    const size_t sizes[] = { 1, 4, 9, 20, 40, 61 };
+    for (size_t s = 0; s < countof(sizes); ++s)
+    {
+        string query = RandomQuery(sizes[s], false);
+        REQUIRE(Make(query, 1));
+        for (unsigned int len = sizes[s]; len < sizes[s] + 300; len += 7)
+        {
+            MakeSequence(len + 16);
+            Plant(query, 5 + len - sizes[s]);
+            REQUIRE(Agrees(query, 1, 5, len));
+            REQUIRE(Agrees(query, 1, 6, len));
+            Plant(query, 5);
+            REQUIRE(Agrees(query, 1, 5, len));
+            REQUIRE(Agrees(query, 1, 6, len));
+        }
+    }
+}
+
+// throughput over short reads, as when filtering runs
+FIXTURE_TEST_CASE(NucStrstr_throughput, NucStrstrFixture)
+{
+    const char *queries[] = {
+        "ACGTACGTACGTA",
+        "ACGTACGTACGTACGTACGTACGTA",
+        "ACGTACGTACGTACGTACGTACGTACGTACGTACGTACGT",
+        "ACGTNNACGTRYACGT"
+    };
+    const unsigned int read_len = 150;
+    const unsigned int reads = 1 << 15;
+    const int passes = 4;
+
+    srand(4);
+    MakeSequence(read_len * reads);
+    for (size_t q = 0; q < countof(queries); ++q)
+    {
+        string query(queries[q]);
+        REQUIRE(Make(query, 0));
+        int hits[2] = { 0, 0 };
+        for (int kernel = nssKernelSSE2; kernel <= nssKernelAVX2; ++kernel)
+        {
+            if (!nssKernelAvailable(kernel))
+                continue;
+            CPerfCounter counter(kernel == nssKernelSSE2 ? "SSE2" : "AVX2");
+            {
+                CPCount count(counter);
+                for (int pass = 0; pass < passes; ++pass)
+                    for (unsigned int r = 0; r < reads; ++r)
+                        hits[kernel] += nssSearch(nss, kernel, &packed[0], r * read_len, read_len) != 0;
+            }
+            printf("%-40s %s: %.1f Mbases/s\n", queries[q], kernel == nssKernelSSE2 ? "SSE2" : "AVX2",
+                (double)read_len * reads * passes / counter.GetSeconds() / 1e6);
+        }
+        if (nssKernelAvailable(nssKernelAVX2))
+            REQUIRE_EQ(hits[nssKernelSSE2], hits[nssKernelAVX2]);
+    }
+}
+
+//////////////////////////////////////////// Main
+extern "C"
+{
+
+#include <kapp/args.h>
+#include <kfg/config.h>
+
+ver_t CC KAppVersion ( void )
+{
+    return 0x1000000;
+}
+rc_t CC UsageSummary (const char * progname)
+{
+    return 0;
+}
+
+rc_t CC Usage ( const Args * args )
+{
+    return 0;
+}
+
+const char UsageDefaultName[] = "wb-test-nucstrstr";
+
+rc_t CC KMain ( int argc, char *argv [] )
+{
+    KConfigDisableUserSettings();
+    rc_t rc = NucStrstrTestSuite(argc, argv);
+    return rc;
+}
+
+}
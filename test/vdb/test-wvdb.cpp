@@ -0,0 +1,1443 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include <vdb/manager.h> // VDBManager
+#include <vdb/table.h>
+#include <vdb/cursor.h>
+#include <vdb/schema.h>
+#include <vdb/database.h>
+#include <vdb/vdb-priv.h>
+#include <vdb/blob.h>
+#include <kdb/manager.h>
+#include <kdb/meta.h>
+#include <kfs/directory.h>
+#include <kfs/file.h>
+#include <kproc/thread.h>
+#include <klib/rc.h>
+#include <klib/namelist.h>
+#include <insdc/sra.h>
+
+#include <ktst/unit_test.hpp> // TEST_CASE
+#include <kfg/config.h>
+
+#include <sysalloc.h>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+TEST_SUITE( WVdbTestSuite )
+
+/* a table written locally, with one blob per ROWS_PER_BLOB rows */
+static const char * schema_text =
+    "version 1; table T #1 { column U32 VAL; };";
+
+static const int64_t ROWS_PER_BLOB = 1000;
+static const int64_t ROW_COUNT = 20 * ROWS_PER_BLOB;
+
+class WVdbFixture
+{
+public:
+    WVdbFixture()
+    : mgr(0), tbl(0), curs(0), col_idx(~0)
+    {
+        if ( VDBManagerMakeUpdate ( & mgr, NULL ) != 0 )
+            throw logic_error ( "WVdbFixture: VDBManagerMakeUpdate failed" );
+    }
+
+    ~WVdbFixture()
+    {
+        if ( curs && VCursorRelease ( curs ) != 0 )
+            throw logic_error ( "~WVdbFixture: VCursorRelease failed" );
+        if ( tbl && VTableRelease ( tbl ) != 0 )
+            throw logic_error ( "~WVdbFixture: VTableRelease failed" );
+        if ( mgr && VDBManagerRelease ( mgr ) != 0 )
+            throw logic_error ( "~WVdbFixture: VDBManagerRelease failed" );
+        if ( ! path . empty () )
+        {
+            KDirectory *wd;
+            if ( KDirectoryNativeDir ( & wd ) == 0 )
+            {
+                KDirectoryRemove ( wd, true, "%s", path . c_str () );
+                KDirectoryRelease ( wd );
+            }
+        }
+    }
+
+    /* VAL [ row ] == row * 3 */
+    rc_t Create ( const char * name )
+    {
+        path = string ( "test-wvdb-" ) + name;
+
+        VSchema *schema;
+        rc_t rc = VDBManagerMakeSchema ( mgr, & schema );
+        if ( rc == 0 )
+        {
+            rc = VSchemaParseText ( schema, NULL, schema_text, strlen ( schema_text ) );
+            if ( rc == 0 )
+            {
+                VTable *wtbl;
+                rc = VDBManagerCreateTable ( mgr, & wtbl, schema, "T", kcmInit + kcmMD5, "%s", path . c_str () );
+                if ( rc == 0 )
+                {
+                    VCursor *wcurs;
+                    rc = VTableCreateCursorWrite ( wtbl, & wcurs, kcmInsert );
+                    if ( rc == 0 )
+                    {
+                        uint32_t idx;
+                        rc = VCursorAddColumn ( wcurs, & idx, "VAL" );
+                        if ( rc == 0 )
+                            rc = VCursorOpen ( wcurs );
+                        for ( int64_t row = 1; rc == 0 && row <= ROW_COUNT; ++ row )
+                        {
+                            uint32_t val = ( uint32_t ) ( row * 3 );
+                            rc = VCursorOpenRow ( wcurs );
+                            if ( rc == 0 )
+                                rc = VCursorWrite ( wcurs, idx, 32, & val, 0, 1 );
+                            if ( rc == 0 )
+                                rc = VCursorCommitRow ( wcurs );
+                            if ( rc == 0 )
+                                rc = VCursorCloseRow ( wcurs );
+                            if ( rc == 0 && row % ROWS_PER_BLOB == 0 )
+                                rc = VCursorFlushPage ( wcurs );
+                        }
+                        if ( rc == 0 )
+                            rc = VCursorCommit ( wcurs );
+                        VCursorRelease ( wcurs );
+                    }
+                    VTableRelease ( wtbl );
+                }
+            }
+            VSchemaRelease ( schema );
+        }
+        if ( rc == 0 )
+            rc = VDBManagerOpenTableRead ( mgr, & tbl, NULL, "%s", path . c_str () );
+        return rc;
+    }
+
+    rc_t OpenCursor ( size_t capacity )
+    {
+        rc_t rc = VTableCreateCachedCursorRead ( tbl, & curs, capacity );
+        if ( rc == 0 )
+        {
+            rc = VCursorAddColumn ( curs, & col_idx, "VAL" );
+            if ( rc == 0 )
+                rc = VCursorOpen ( curs );
+        }
+        return rc;
+    }
+
+    uint32_t ReadVal ( int64_t row )
+    {
+        uint32_t elem_bits, boff, row_len;
+        const void *base;
+        if ( VCursorCellDataDirect ( curs, row, col_idx, & elem_bits, & base, & boff, & row_len ) != 0 )
+            throw logic_error ( "WVdbFixture: VCursorCellDataDirect failed" );
+        if ( elem_bits != 32 || row_len != 1 )
+            throw logic_error ( "WVdbFixture: unexpected cell shape" );
+        return * ( const uint32_t * ) base;
+    }
+
+    VDBManager * mgr;
+    const VTable * tbl;
+    const VCursor * curs;
+    uint32_t col_idx;
+    string path;
+};
+
+FIXTURE_TEST_CASE ( DataPrefetchAsync, WVdbFixture )
+{
+    REQUIRE_RC ( Create ( "prefetch-async" ) );
+    REQUIRE_RC ( OpenCursor ( 64 * 1024 * 1024 ) );
+
+    int64_t first, last;
+    REQUIRE_RC ( VCursorPageIdRange ( curs, col_idx, ROWS_PER_BLOB + 1, & first, & last ) );
+    REQUIRE_EQ ( first, ROWS_PER_BLOB + 1 );
+    REQUIRE_EQ ( last, 2 * ROWS_PER_BLOB );
+
+    int64_t rows [ 10 ];
+    for ( int i = 0; i < 10; ++ i )
+        rows [ i ] = ROW_COUNT - i * 2 * ROWS_PER_BLOB;
+
+    VCursorPrefetch *pf;
+    REQUIRE_RC ( VCursorDataPrefetchAsync ( curs, rows, col_idx, 10, 1, ROW_COUNT, false, 3, & pf ) );
+
+    /* reads may overlap with workers */
+    REQUIRE_EQ ( ReadVal ( 1 ), ( uint32_t ) 3 );
+
+    rc_t status = ~0;
+    REQUIRE_RC ( VCursorPrefetchWait ( pf, & status ) );
+    REQUIRE_RC ( status );
+    REQUIRE_RC ( VCursorPrefetchRelease ( pf ) );
+
+    for ( int i = 0; i < 10; ++ i )
+        REQUIRE_EQ ( ReadVal ( rows [ i ] ), ( uint32_t ) ( rows [ i ] * 3 ) );
+}
+
+FIXTURE_TEST_CASE ( DataPrefetchAsync_Detached, WVdbFixture )
+{
+    REQUIRE_RC ( Create ( "prefetch-detached" ) );
+    REQUIRE_RC ( OpenCursor ( 64 * 1024 * 1024 ) );
+
+    int64_t rows [ 3 ] = { 5, ROW_COUNT / 2, ROW_COUNT };
+    REQUIRE_RC ( VCursorDataPrefetchAsync ( curs, rows, col_idx, 3, 1, ROW_COUNT, true, 0, NULL ) );
+    REQUIRE_EQ ( ReadVal ( ROW_COUNT / 2 ), ( uint32_t ) ( ROW_COUNT / 2 * 3 ) );
+    /* the cursor collects the workers when released */
+}
+
+FIXTURE_TEST_CASE ( DataPrefetchAsync_ResumesFlush, WVdbFixture )
+{
+    REQUIRE_RC ( Create ( "prefetch-flush" ) );
+    /* holds a single blob */
+    REQUIRE_RC ( OpenCursor ( 1 ) );
+
+    int64_t rows [ 4 ];
+    for ( int i = 0; i < 4; ++ i )
+        rows [ i ] = i * ROWS_PER_BLOB + 1;
+
+    VCursorPrefetch *pf;
+    REQUIRE_RC ( VCursorDataPrefetchAsync ( curs, rows, col_idx, 4, 1, ROW_COUNT, false, 2, & pf ) );
+    REQUIRE_RC ( VCursorPrefetchWait ( pf, NULL ) );
+    REQUIRE_RC ( VCursorPrefetchRelease ( pf ) );
+
+    VCursorCacheStats stats;
+    REQUIRE_RC ( VCursorGetCacheStats ( curs, 0, & stats ) );
+    REQUIRE_EQ ( stats . evictions, ( uint64_t ) 0 );
+
+    /* the next regular save trims the prefetched blobs again */
+    REQUIRE_EQ ( ReadVal ( ROW_COUNT ), ( uint32_t ) ( ROW_COUNT * 3 ) );
+    REQUIRE_RC ( VCursorGetCacheStats ( curs, 0, & stats ) );
+    REQUIRE_GE ( stats . evictions, ( uint64_t ) 4 );
+}
+
+FIXTURE_TEST_CASE ( DataPrefetchAsync_BlobOnce, WVdbFixture )
+{
+    REQUIRE_RC ( Create ( "prefetch-once" ) );
+    REQUIRE_RC ( OpenCursor ( 64 * 1024 * 1024 ) );
+
+    /* many rows of the same blobs, each decoded by a single worker */
+    const uint32_t N = ( uint32_t ) ( ROW_COUNT / 7 );
+    int64_t *rows = new int64_t [ N ];
+    for ( uint32_t i = 0; i < N; ++ i )
+        rows [ i ] = ROW_COUNT - i * 7;
+
+    VCursorPrefetch *pf;
+    REQUIRE_RC ( VCursorDataPrefetchAsync ( curs, rows, col_idx, N, 1, ROW_COUNT, false, 8, & pf ) );
+    delete [] rows;
+    rc_t status = ~0;
+    REQUIRE_RC ( VCursorPrefetchWait ( pf, & status ) );
+    REQUIRE_RC ( status );
+    REQUIRE_RC ( VCursorPrefetchRelease ( pf ) );
+
+    VCursorCacheStats stats;
+    REQUIRE_RC ( VCursorGetCacheStats ( curs, 0, & stats ) );
+    REQUIRE_EQ ( stats . misses, ( uint64_t ) ( ROW_COUNT / ROWS_PER_BLOB ) );
+}
+
+FIXTURE_TEST_CASE ( DataPrefetchAsync_WaitsForPrevious, WVdbFixture )
+{
+    REQUIRE_RC ( Create ( "prefetch-previous" ) );
+    REQUIRE_RC ( OpenCursor ( 64 * 1024 * 1024 ) );
+
+    int64_t rows [ ROW_COUNT / ROWS_PER_BLOB ];
+    for ( int i = 0; i < ROW_COUNT / ROWS_PER_BLOB; ++ i )
+        rows [ i ] = i * ROWS_PER_BLOB + 1;
+
+    VCursorPrefetch *first;
+    REQUIRE_RC ( VCursorDataPrefetchAsync ( curs, rows, col_idx, ROW_COUNT / ROWS_PER_BLOB,
+        1, ROW_COUNT, false, 1, & first ) );
+    /* starting another one lets the first complete */
+    REQUIRE_RC ( VCursorDataPrefetchAsync ( curs, rows, col_idx, 1, 1, ROW_COUNT, false, 1, NULL ) );
+
+    rc_t status = ~0;
+    REQUIRE_RC ( VCursorPrefetchWait ( first, & status ) );
+    REQUIRE_RC ( status );
+    REQUIRE_RC ( VCursorPrefetchRelease ( first ) );
+
+    VCursorCacheStats stats;
+    REQUIRE_RC ( VCursorGetCacheStats ( curs, 0, & stats ) );
+    REQUIRE_EQ ( stats . misses, ( uint64_t ) ( ROW_COUNT / ROWS_PER_BLOB ) );
+}
+
+static
+rc_t CC PrefetchWaitThread ( const KThread *self, void *data )
+{
+    /* rows still unclaimed when the cursor goes away are canceled */
+    rc_t rc = VCursorPrefetchWait ( ( VCursorPrefetch* ) data, NULL );
+    if ( rc != 0 && GetRCState ( rc ) == rcCanceled )
+        rc = 0;
+    return rc;
+}
+
+FIXTURE_TEST_CASE ( DataPrefetchAsync_WaitWhileReleasing, WVdbFixture )
+{
+    REQUIRE_RC ( Create ( "prefetch-join" ) );
+    REQUIRE_RC ( OpenCursor ( 64 * 1024 * 1024 ) );
+
+    int64_t rows [ ROW_COUNT / ROWS_PER_BLOB ];
+    for ( int i = 0; i < ROW_COUNT / ROWS_PER_BLOB; ++ i )
+        rows [ i ] = i * ROWS_PER_BLOB + 1;
+
+    for ( int round = 0; round < 8; ++ round )
+    {
+        VCursorPrefetch *pf;
+        REQUIRE_RC ( VCursorDataPrefetchAsync ( curs, rows, col_idx, ROW_COUNT / ROWS_PER_BLOB,
+            1, ROW_COUNT, false, 4, & pf ) );
+
+        /* waiting on the handle races with the cursor collecting the workers */
+        KThread *t;
+        REQUIRE_RC ( KThreadMake ( & t, PrefetchWaitThread, pf ) );
+        REQUIRE_RC ( VCursorRelease ( curs ) );
+        curs = 0;
+        rc_t status;
+        REQUIRE_RC ( KThreadWait ( t, & status ) );
+        REQUIRE_RC ( status );
+        REQUIRE_RC ( KThreadRelease ( t ) );
+        REQUIRE_RC ( VCursorPrefetchRelease ( pf ) );
+
+        REQUIRE_RC ( OpenCursor ( 64 * 1024 * 1024 ) );
+    }
+}
+
+FIXTURE_TEST_CASE ( SharedBlobCache_SameBlob, WVdbFixture )
+{
+    REQUIRE_RC ( VDBManagerEnableSharedBlobCache ( mgr, 64 * 1024 * 1024 ) );
+    REQUIRE_RC ( Create ( "shared-same" ) );
+    REQUIRE_RC ( OpenCursor ( 0 ) );
+
+    const VCursor *curs2;
+    uint32_t idx2;
+    REQUIRE_RC ( VTableCreateCursorRead ( tbl, & curs2 ) );
+    REQUIRE_RC ( VCursorAddColumn ( curs2, & idx2, "VAL" ) );
+    REQUIRE_RC ( VCursorOpen ( curs2 ) );
+
+    /* the second cursor is handed the blob decoded by the first */
+    const VBlob *b1, *b2;
+    REQUIRE_RC ( VCursorGetBlobDirect ( curs, & b1, 1500, col_idx ) );
+    REQUIRE_RC ( VCursorGetBlobDirect ( curs2, & b2, 1700, idx2 ) );
+    REQUIRE_EQ ( ( void* ) b1, ( void* ) b2 );
+    REQUIRE_RC ( VBlobRelease ( b1 ) );
+    REQUIRE_RC ( VBlobRelease ( b2 ) );
+
+    REQUIRE_EQ ( ReadVal ( 1700 ), ( uint32_t ) 5100 );
+    REQUIRE_RC ( VCursorRelease ( curs2 ) );
+}
+
+FIXTURE_TEST_CASE ( SharedBlobCache_SeparateTables, WVdbFixture )
+{
+    REQUIRE_RC ( VDBManagerEnableSharedBlobCache ( mgr, 64 * 1024 * 1024 ) );
+    REQUIRE_RC ( Create ( "shared-tables" ) );
+    REQUIRE_RC ( OpenCursor ( 0 ) );
+
+    /* a table opened again on the same path, as another thread would */
+    const VTable *tbl2;
+    const VCursor *curs2;
+    uint32_t idx2;
+    REQUIRE_RC ( VDBManagerOpenTableRead ( mgr, & tbl2, NULL, "%s", path . c_str () ) );
+    REQUIRE_NE ( tbl, tbl2 );
+    REQUIRE_RC ( VTableCreateCursorRead ( tbl2, & curs2 ) );
+    REQUIRE_RC ( VCursorAddColumn ( curs2, & idx2, "VAL" ) );
+    REQUIRE_RC ( VCursorOpen ( curs2 ) );
+
+    const VBlob *b1, *b2;
+    REQUIRE_RC ( VCursorGetBlobDirect ( curs, & b1, 1500, col_idx ) );
+    REQUIRE_RC ( VCursorGetBlobDirect ( curs2, & b2, 1700, idx2 ) );
+    REQUIRE_EQ ( ( void* ) b1, ( void* ) b2 );
+    REQUIRE_RC ( VBlobRelease ( b1 ) );
+    REQUIRE_RC ( VBlobRelease ( b2 ) );
+    REQUIRE_RC ( VCursorRelease ( curs2 ) );
+    REQUIRE_RC ( VTableRelease ( tbl2 ) );
+
+    REQUIRE_EQ ( ReadVal ( 1800 ), ( uint32_t ) 5400 );
+}
+
+FIXTURE_TEST_CASE ( CacheStats, WVdbFixture )
+{
+    REQUIRE_RC ( Create ( "cache-stats" ) );
+    /* too small for any blob: capacity gets raised to hold one */
+    REQUIRE_RC ( OpenCursor ( 1 ) );
+
+    REQUIRE_EQ ( ReadVal ( 1 ), ( uint32_t ) 3 );
+    REQUIRE_EQ ( ReadVal ( 2 ), ( uint32_t ) 6 );
+    for ( int64_t i = 1; i < 4; ++ i )
+        REQUIRE_EQ ( ReadVal ( i * ROWS_PER_BLOB + 1 ), ( uint32_t ) ( ( i * ROWS_PER_BLOB + 1 ) * 3 ) );
+    /* evicted, and no longer among the last blobs read */
+    REQUIRE_EQ ( ReadVal ( 3 ), ( uint32_t ) 9 );
+
+    VCursorCacheStats total, col;
+    REQUIRE_RC ( VCursorGetCacheStats ( curs, 0, & total ) );
+    REQUIRE_EQ ( total . hits, ( uint64_t ) 1 );
+    REQUIRE_EQ ( total . misses, ( uint64_t ) 5 );
+    REQUIRE_GE ( total . evictions, ( uint64_t ) 4 );
+    REQUIRE_GE ( total . bytes_decoded, ( uint64_t ) ( 5 * ROWS_PER_BLOB * 4 ) );
+    REQUIRE_GE ( total . raises, ( uint64_t ) 1 );
+    REQUIRE_EQ ( total . capacity, ( uint64_t ) VCursorGetCacheCapacity ( curs ) );
+
+    REQUIRE_RC ( VCursorGetCacheStats ( curs, col_idx, & col ) );
+    REQUIRE_EQ ( col . hits, total . hits );
+    REQUIRE_EQ ( col . misses, total . misses );
+    REQUIRE_EQ ( col . decode_ns, total . decode_ns );
+
+    REQUIRE_RC_FAIL ( VCursorGetCacheStats ( curs, col_idx + 1, & col ) );
+}
+
+FIXTURE_TEST_CASE ( CacheStats_Adaptive, WVdbFixture )
+{
+    REQUIRE_RC ( Create ( "cache-adaptive" ) );
+    REQUIRE_RC ( OpenCursor ( 1 ) );
+    REQUIRE_RC ( VCursorSetCacheAdaptive ( curs, true ) );
+
+    /* cycle over more blobs than the cache holds at first */
+    VCursorCacheStats before, after;
+    for ( int pass = 0; pass < 6; ++ pass )
+    {
+        REQUIRE_RC ( VCursorGetCacheStats ( curs, 0, & before ) );
+        for ( int64_t i = 0; i < 6; ++ i )
+            REQUIRE_EQ ( ReadVal ( i * ROWS_PER_BLOB + 1 ), ( uint32_t ) ( ( i * ROWS_PER_BLOB + 1 ) * 3 ) );
+    }
+    REQUIRE_RC ( VCursorGetCacheStats ( curs, 0, & after ) );
+
+    /* grew to hold the whole cycle */
+    REQUIRE_EQ ( after . misses, before . misses );
+    REQUIRE_EQ ( after . raises, ( uint64_t ) 0 );
+    REQUIRE_GT ( after . capacity, ( uint64_t ) ( 6 * ROWS_PER_BLOB * 4 ) );
+
+    /* returns to the base capacity */
+    REQUIRE_RC ( VCursorSetCacheAdaptive ( curs, false ) );
+    REQUIRE_EQ ( VCursorGetCacheCapacity ( curs ), ( uint64_t ) 1 );
+}
+
+FIXTURE_TEST_CASE ( CacheStats_Budget, WVdbFixture )
+{
+    REQUIRE_RC ( Create ( "cache-budget" ) );
+    /* room for about two blobs */
+    REQUIRE_RC ( VDBManagerSetCacheBudget ( mgr, 24 * 1024 ) );
+    REQUIRE_RC ( OpenCursor ( 1 ) );
+    REQUIRE_RC ( VCursorSetCacheAdaptive ( curs, true ) );
+
+    for ( int pass = 0; pass < 4; ++ pass )
+        for ( int64_t i = 0; i < 6; ++ i )
+            REQUIRE_EQ ( ReadVal ( i * ROWS_PER_BLOB + 1 ), ( uint32_t ) ( ( i * ROWS_PER_BLOB + 1 ) * 3 ) );
+
+    VCursorCacheStats stats;
+    REQUIRE_RC ( VCursorGetCacheStats ( curs, 0, & stats ) );
+    REQUIRE_EQ ( stats . raises, ( uint64_t ) 0 );
+    REQUIRE_LE ( VCursorGetCacheCapacity ( curs ), ( uint64_t ) ( 24 * 1024 + 1 ) );
+}
+
+FIXTURE_TEST_CASE ( CacheStats_BudgetExhausted, WVdbFixture )
+{
+    REQUIRE_RC ( Create ( "cache-exhausted" ) );
+    /* nothing left to borrow for a blob */
+    REQUIRE_RC ( VDBManagerSetCacheBudget ( mgr, 1 ) );
+    REQUIRE_RC ( OpenCursor ( 1 ) );
+    REQUIRE_RC ( VCursorSetCacheAdaptive ( curs, true ) );
+
+    /* the blob still stays cached for the rows that follow */
+    for ( int64_t i = 0; i < 3; ++ i )
+        for ( int64_t row = 1; row <= 10; ++ row )
+            REQUIRE_EQ ( ReadVal ( i * ROWS_PER_BLOB + row ), ( uint32_t ) ( ( i * ROWS_PER_BLOB + row ) * 3 ) );
+
+    VCursorCacheStats stats;
+    REQUIRE_RC ( VCursorGetCacheStats ( curs, 0, & stats ) );
+    REQUIRE_EQ ( stats . misses, ( uint64_t ) 3 );
+    REQUIRE_EQ ( stats . hits, ( uint64_t ) 27 );
+    /* raised past the budget to hold one blob, instead of evicting it on every save */
+    REQUIRE_GE ( stats . raises, ( uint64_t ) 1 );
+    REQUIRE_GE ( stats . capacity, ( uint64_t ) ( ROWS_PER_BLOB * 4 ) );
+}
+
+FIXTURE_TEST_CASE ( CacheDepth, WVdbFixture )
+{
+    REQUIRE_RC ( Create ( "cache-depth" ) );
+    REQUIRE_RC ( VTableCreateCachedCursorRead ( tbl, & curs, 64 * 1024 * 1024 ) );
+    REQUIRE_RC ( VCursorAddColumn ( curs, & col_idx, "VAL" ) );
+    REQUIRE_RC_FAIL ( VCursorSetCacheDepth ( curs, 0 ) );
+    REQUIRE_RC ( VCursorSetCacheDepth ( curs, 4 ) );
+    REQUIRE_RC ( VCursorOpen ( curs ) );
+    REQUIRE_RC_FAIL ( VCursorSetCacheDepth ( curs, 2 ) );
+
+    /* interleaved reads of 4 blobs, all found among the last blobs read */
+    for ( int pass = 0; pass < 3; ++ pass )
+        for ( int64_t i = 0; i < 4; ++ i )
+            REQUIRE_EQ ( ReadVal ( i * ROWS_PER_BLOB + pass + 1 ), ( uint32_t ) ( ( i * ROWS_PER_BLOB + pass + 1 ) * 3 ) );
+
+    VCursorCacheStats stats;
+    REQUIRE_RC ( VCursorGetCacheStats ( curs, 0, & stats ) );
+    REQUIRE_EQ ( stats . misses, ( uint64_t ) 4 );
+    REQUIRE_EQ ( stats . hits, ( uint64_t ) 8 );
+}
+
+FIXTURE_TEST_CASE ( CacheDepth_RespectsCapacity, WVdbFixture )
+{
+    REQUIRE_RC ( Create ( "cache-depth-capacity" ) );
+    /* raised to hold a single blob */
+    REQUIRE_RC ( VTableCreateCachedCursorRead ( tbl, & curs, 1 ) );
+    REQUIRE_RC ( VCursorAddColumn ( curs, & col_idx, "VAL" ) );
+    REQUIRE_RC ( VCursorSetCacheDepth ( curs, 4 ) );
+    REQUIRE_RC ( VCursorOpen ( curs ) );
+
+    /* evicted blobs are not kept alive by the deeper slots */
+    for ( int pass = 0; pass < 3; ++ pass )
+        for ( int64_t i = 0; i < 4; ++ i )
+            REQUIRE_EQ ( ReadVal ( i * ROWS_PER_BLOB + pass + 1 ), ( uint32_t ) ( ( i * ROWS_PER_BLOB + pass + 1 ) * 3 ) );
+
+    VCursorCacheStats stats;
+    REQUIRE_RC ( VCursorGetCacheStats ( curs, 0, & stats ) );
+    REQUIRE_EQ ( stats . misses, ( uint64_t ) 12 );
+    REQUIRE_EQ ( stats . hits, ( uint64_t ) 0 );
+    REQUIRE_GE ( stats . evictions, ( uint64_t ) 11 );
+
+    /* while rows of the current blob are still served from it */
+    REQUIRE_EQ ( ReadVal ( 3 * ROWS_PER_BLOB + 10 ), ( uint32_t ) ( ( 3 * ROWS_PER_BLOB + 10 ) * 3 ) );
+    REQUIRE_RC ( VCursorGetCacheStats ( curs, 0, & stats ) );
+    REQUIRE_EQ ( stats . hits, ( uint64_t ) 1 );
+}
+
+FIXTURE_TEST_CASE ( CellDataPinned, WVdbFixture )
+{
+    REQUIRE_RC ( Create ( "cell-pinned" ) );
+    /* a capacity of one byte keeps no more than the most recent blobs */
+    REQUIRE_RC ( OpenCursor ( 1 ) );
+
+    const int N = ROW_COUNT / ROWS_PER_BLOB;
+    VCellRef refs [ N ];
+    for ( int i = 0; i < N; ++ i )
+    {
+        int64_t row = i * ROWS_PER_BLOB + 7;
+        REQUIRE_RC ( VCursorCellDataPinned ( curs, row, col_idx, & refs [ i ] ) );
+        REQUIRE_NOT_NULL ( refs [ i ] . blob );
+        REQUIRE_EQ ( refs [ i ] . elem_bits, ( uint32_t ) 32 );
+        REQUIRE_EQ ( refs [ i ] . row_len, ( uint32_t ) 1 );
+    }
+    VCellRef bad;
+    REQUIRE_RC_FAIL ( VCursorCellDataPinned ( curs, 1, col_idx + 1, & bad ) );
+    REQUIRE_NULL ( bad . blob );
+
+    /* cells outlive the cursor and its cache */
+    REQUIRE_RC ( VCursorRelease ( curs ) );
+    curs = NULL;
+    for ( int i = 0; i < N; ++ i )
+    {
+        REQUIRE_EQ ( * ( const uint32_t* ) refs [ i ] . base, ( uint32_t ) ( ( i * ROWS_PER_BLOB + 7 ) * 3 ) );
+        REQUIRE_RC ( VCellRefRelease ( & refs [ i ] ) );
+        REQUIRE_NULL ( refs [ i ] . blob );
+    }
+}
+
+static
+rc_t CC CheckBatchRow ( int64_t row_id, uint32_t elem_bits,
+    const void *base, uint32_t boff, uint32_t row_len, void *data )
+{
+    int64_t *expected = ( int64_t* ) data;
+    if ( row_id != * expected || elem_bits != 32 || boff != 0 || row_len != 1 ||
+         * ( const uint32_t* ) base != ( uint32_t ) ( row_id * 3 ) )
+        return RC ( rcVDB, rcCursor, rcReading, rcData, rcCorrupt );
+    ++ * expected;
+    return 0;
+}
+
+FIXTURE_TEST_CASE ( ReadBatch, WVdbFixture )
+{
+    REQUIRE_RC ( Create ( "read-batch" ) );
+    REQUIRE_RC ( OpenCursor ( 64 * 1024 * 1024 ) );
+
+    /* starts and ends in the middle of blobs */
+    int64_t next = 500;
+    REQUIRE_RC ( VCursorReadBatch ( curs, col_idx, 500, 3 * ROWS_PER_BLOB + 7, CheckBatchRow, & next ) );
+    REQUIRE_EQ ( next, ( int64_t ) ( 507 + 3 * ROWS_PER_BLOB ) );
+
+    next = 1;
+    REQUIRE_RC ( VCursorReadBatch ( curs, col_idx, 1, ROW_COUNT, CheckBatchRow, & next ) );
+    REQUIRE_EQ ( next, ROW_COUNT + 1 );
+
+    /* the callback can stop the batch */
+    next = 0;
+    REQUIRE_RC_FAIL ( VCursorReadBatch ( curs, col_idx, 10, 5, CheckBatchRow, & next ) );
+}
+
+FIXTURE_TEST_CASE ( CacheStats_ReadBatch, WVdbFixture )
+{
+    REQUIRE_RC ( Create ( "cache-batch" ) );
+    REQUIRE_RC ( OpenCursor ( 64 * 1024 * 1024 ) );
+
+    int64_t next = 1;
+    REQUIRE_RC ( VCursorReadBatch ( curs, col_idx, 1, ROW_COUNT, CheckBatchRow, & next ) );
+    next = 1;
+    REQUIRE_RC ( VCursorReadBatch ( curs, col_idx, 1, ROW_COUNT, CheckBatchRow, & next ) );
+
+    /* one lookup per blob and pass */
+    VCursorCacheStats stats;
+    REQUIRE_RC ( VCursorGetCacheStats ( curs, col_idx, & stats ) );
+    REQUIRE_EQ ( stats . misses, ( uint64_t ) ( ROW_COUNT / ROWS_PER_BLOB ) );
+    REQUIRE_EQ ( stats . hits, ( uint64_t ) ( ROW_COUNT / ROWS_PER_BLOB ) );
+    REQUIRE_GE ( stats . bytes_decoded, ( uint64_t ) ( ROW_COUNT * 4 ) );
+}
+
+static
+rc_t CC ReadAllThread ( const KThread *self, void *data )
+{
+    const VTable *tbl = ( const VTable* ) data;
+    const VCursor *c;
+    uint32_t idx;
+    rc_t rc = VTableCreateCursorRead ( tbl, & c );
+    if ( rc == 0 )
+    {
+        rc = VCursorAddColumn ( c, & idx, "VAL" );
+        if ( rc == 0 )
+            rc = VCursorOpen ( c );
+        for ( int64_t row = 1; rc == 0 && row <= ROW_COUNT; ++ row )
+        {
+            uint32_t val, row_len;
+            rc = VCursorReadDirect ( c, row, idx, 32, & val, 1, & row_len );
+            if ( rc == 0 && ( row_len != 1 || val != ( uint32_t ) ( row * 3 ) ) )
+                rc = RC ( rcVDB, rcCursor, rcReading, rcData, rcCorrupt );
+        }
+        VCursorRelease ( c );
+    }
+    return rc;
+}
+
+FIXTURE_TEST_CASE ( SharedBlobCache_Threads, WVdbFixture )
+{
+    /* a budget of a few blobs forces eviction while threads read */
+    REQUIRE_RC ( VDBManagerEnableSharedBlobCache ( mgr, 16 * 1024 ) );
+    REQUIRE_RC ( Create ( "shared-threads" ) );
+
+    const int THREADS = 4;
+    KThread *t [ THREADS ];
+    for ( int i = 0; i < THREADS; ++ i )
+        REQUIRE_RC ( KThreadMake ( & t [ i ], ReadAllThread, ( void* ) tbl ) );
+    for ( int i = 0; i < THREADS; ++ i )
+    {
+        rc_t status;
+        REQUIRE_RC ( KThreadWait ( t [ i ], & status ) );
+        REQUIRE_RC ( status );
+        REQUIRE_RC ( KThreadRelease ( t [ i ] ) );
+    }
+}
+
+/* several compressed columns, so a flush has independent encode chains */
+static const char * zip_schema_text =
+    "version 1;"
+    "fmtdef zlib_fmt;"
+    "function zlib_fmt zip #1.0 < * I32 strategy, I32 level > ( any in ) = vdb:zip;"
+    "function any unzip #1.0 ( zlib_fmt in ) = vdb:unzip;"
+    "physical < type T > T zip_encoding #1.0 < * I32 strategy, I32 level >"
+    "{ decode { return unzip ( @ ); } encode { return zip < strategy, level > ( @ ); } };"
+    "table Z #1 { column < U32 > zip_encoding A; column < U32 > zip_encoding B;"
+    " column < U64 > zip_encoding C; column < U8 > zip_encoding D; };";
+
+static const char * zip_columns [] = { "A", "B", "C", "D" };
+
+static
+rc_t WriteZipTable ( VDBManager * mgr, const string & path, uint32_t flush_threads, bool vary = false )
+{
+    VSchema *schema;
+    rc_t rc = VDBManagerMakeSchema ( mgr, & schema );
+    if ( rc == 0 )
+    {
+        rc = VSchemaParseText ( schema, NULL, zip_schema_text, strlen ( zip_schema_text ) );
+        if ( rc == 0 )
+        {
+            VTable *wtbl;
+            rc = VDBManagerCreateTable ( mgr, & wtbl, schema, "Z", kcmInit, "%s", path . c_str () );
+            if ( rc == 0 )
+            {
+                VCursor *wcurs;
+                rc = VTableCreateCursorWrite ( wtbl, & wcurs, kcmInsert );
+                if ( rc == 0 )
+                {
+                    uint32_t idx [ 4 ];
+                    for ( int i = 0; rc == 0 && i < 4; ++ i )
+                        rc = VCursorAddColumn ( wcurs, & idx [ i ], zip_columns [ i ] );
+                    if ( rc == 0 )
+                        rc = VCursorOpen ( wcurs );
+                    if ( rc == 0 )
+                        rc = VCursorSetFlushThreads ( wcurs, flush_threads );
+                    for ( int64_t row = 1; rc == 0 && row <= ROW_COUNT; ++ row )
+                    {
+                        uint32_t a = ( uint32_t ) ( row * 3 ), b = ( uint32_t ) ( row * row % 1009 );
+                        uint64_t c = ( uint64_t ) row << 20;
+                        uint8_t d = ( uint8_t ) ( row % 7 );
+                        rc = VCursorOpenRow ( wcurs );
+                        if ( rc == 0 )
+                            rc = VCursorWrite ( wcurs, idx [ 0 ], 32, & a, 0, 1 );
+                        if ( rc == 0 )
+                            rc = VCursorWrite ( wcurs, idx [ 1 ], 32, & b, 0, 1 );
+                        if ( rc == 0 )
+                            rc = VCursorWrite ( wcurs, idx [ 2 ], 64, & c, 0, 1 );
+                        if ( rc == 0 )
+                            rc = VCursorWrite ( wcurs, idx [ 3 ], 8, & d, 0, 1 );
+                        if ( rc == 0 )
+                            rc = VCursorCommitRow ( wcurs );
+                        if ( rc == 0 )
+                            rc = VCursorCloseRow ( wcurs );
+                        if ( rc == 0 && row % ROWS_PER_BLOB == 0 )
+                            rc = VCursorFlushPage ( wcurs );
+                        /* cycle through 1 .. flush_threads encoders */
+                        if ( rc == 0 && vary && row % ROWS_PER_BLOB == 0 )
+                            rc = VCursorSetFlushThreads ( wcurs, 1 + ( uint32_t ) ( row / ROWS_PER_BLOB ) % flush_threads );
+                    }
+                    if ( rc == 0 )
+                        rc = VCursorCommit ( wcurs );
+                    VCursorRelease ( wcurs );
+                }
+                VTableRelease ( wtbl );
+            }
+        }
+        VSchemaRelease ( schema );
+    }
+    return rc;
+}
+
+static
+string ReadColumnData ( const string & path, const char * col )
+{
+    string data;
+    KDirectory *wd;
+    if ( KDirectoryNativeDir ( & wd ) == 0 )
+    {
+        const KFile *f;
+        if ( KDirectoryOpenFileRead ( wd, & f, "%s/col/%s/data", path . c_str (), col ) == 0 )
+        {
+            uint64_t size;
+            if ( KFileSize ( f, & size ) == 0 )
+            {
+                size_t num_read;
+                data . resize ( ( size_t ) size );
+                if ( KFileReadAll ( f, 0, & data [ 0 ], data . size (), & num_read ) != 0 || num_read != data . size () )
+                    data . clear ();
+            }
+            KFileRelease ( f );
+        }
+        KDirectoryRelease ( wd );
+    }
+    return data;
+}
+
+FIXTURE_TEST_CASE ( FlushThreads, WVdbFixture )
+{
+    /* the parallel flush writes the same bytes as the serial one */
+    path = "test-wvdb-flush-threads";
+    string serial = path + "-serial";
+    REQUIRE_RC ( WriteZipTable ( mgr, serial, 1 ) );
+    REQUIRE_RC ( WriteZipTable ( mgr, path, 4 ) );
+
+    for ( int i = 0; i < 4; ++ i )
+    {
+        string expected = ReadColumnData ( serial, zip_columns [ i ] );
+        REQUIRE ( ! expected . empty () );
+        REQUIRE ( expected == ReadColumnData ( path, zip_columns [ i ] ) );
+    }
+
+    KDirectory *wd;
+    REQUIRE_RC ( KDirectoryNativeDir ( & wd ) );
+    REQUIRE_RC ( KDirectoryRemove ( wd, true, "%s", serial . c_str () ) );
+    REQUIRE_RC ( KDirectoryRelease ( wd ) );
+
+    REQUIRE_RC ( VDBManagerOpenTableRead ( mgr, & tbl, NULL, "%s", path . c_str () ) );
+    REQUIRE_RC ( VTableCreateCursorRead ( tbl, & curs ) );
+    REQUIRE_RC ( VCursorAddColumn ( curs, & col_idx, "A" ) );
+    REQUIRE_RC ( VCursorOpen ( curs ) );
+    for ( int64_t row = 1; row <= ROW_COUNT; row += 997 )
+        REQUIRE_EQ ( ReadVal ( row ), ( uint32_t ) ( row * 3 ) );
+}
+
+FIXTURE_TEST_CASE ( FlushThreads_Vary, WVdbFixture )
+{
+    /* workers are replaced between pages as the count changes */
+    path = "test-wvdb-flush-vary";
+    string serial = path + "-serial";
+    REQUIRE_RC ( WriteZipTable ( mgr, serial, 1 ) );
+    REQUIRE_RC ( WriteZipTable ( mgr, path, 3, true ) );
+
+    for ( int i = 0; i < 4; ++ i )
+    {
+        string expected = ReadColumnData ( serial, zip_columns [ i ] );
+        REQUIRE ( ! expected . empty () );
+        REQUIRE ( expected == ReadColumnData ( path, zip_columns [ i ] ) );
+    }
+
+    KDirectory *wd;
+    REQUIRE_RC ( KDirectoryNativeDir ( & wd ) );
+    REQUIRE_RC ( KDirectoryRemove ( wd, true, "%s", serial . c_str () ) );
+    REQUIRE_RC ( KDirectoryRelease ( wd ) );
+}
+
+FIXTURE_TEST_CASE ( ZipStreamReuse, WVdbFixture )
+{
+    /* each column deflates and inflates all of its blobs with one zlib stream */
+    path = "test-wvdb-zip-reuse";
+    REQUIRE_RC ( WriteZipTable ( mgr, path, 1 ) );
+    REQUIRE_RC ( VDBManagerOpenTableRead ( mgr, & tbl, NULL, "%s", path . c_str () ) );
+    REQUIRE_RC ( VTableCreateCursorRead ( tbl, & curs ) );
+
+    uint32_t idx [ 4 ];
+    for ( int i = 0; i < 4; ++ i )
+        REQUIRE_RC ( VCursorAddColumn ( curs, & idx [ i ], zip_columns [ i ] ) );
+    REQUIRE_RC ( VCursorOpen ( curs ) );
+
+    for ( int64_t row = 1; row <= ROW_COUNT; ++ row )
+    {
+        uint32_t elem_bits, boff, row_len;
+        const void *base;
+
+        REQUIRE_RC ( VCursorCellDataDirect ( curs, row, idx [ 0 ], & elem_bits, & base, & boff, & row_len ) );
+        REQUIRE_EQ ( * ( const uint32_t * ) base, ( uint32_t ) ( row * 3 ) );
+        REQUIRE_RC ( VCursorCellDataDirect ( curs, row, idx [ 1 ], & elem_bits, & base, & boff, & row_len ) );
+        REQUIRE_EQ ( * ( const uint32_t * ) base, ( uint32_t ) ( row * row % 1009 ) );
+        REQUIRE_RC ( VCursorCellDataDirect ( curs, row, idx [ 2 ], & elem_bits, & base, & boff, & row_len ) );
+        REQUIRE_EQ ( * ( const uint64_t * ) base, ( uint64_t ) row << 20 );
+        REQUIRE_RC ( VCursorCellDataDirect ( curs, row, idx [ 3 ], & elem_bits, & base, & boff, & row_len ) );
+        REQUIRE_EQ ( ( uint32_t ) * ( const uint8_t * ) base, ( uint32_t ) ( row % 7 ) );
+    }
+}
+
+FIXTURE_TEST_CASE ( ProjectedCursor, WVdbFixture )
+{
+    path = "test-wvdb-projected";
+    REQUIRE_RC ( WriteZipTable ( mgr, path, 1 ) );
+    REQUIRE_RC ( VDBManagerOpenTableRead ( mgr, & tbl, NULL, "%s", path . c_str () ) );
+
+    const char * columns [] = { "A", "C" };
+    REQUIRE_RC ( VTableCreateProjectedCursorRead ( tbl, & curs, 64 * 1024 * 1024, columns, 2 ) );
+    uint32_t c_idx, ignore;
+    REQUIRE_RC ( VCursorAddColumn ( curs, & col_idx, "A" ) );
+    REQUIRE_RC ( VCursorAddColumn ( curs, & c_idx, "C" ) );
+    /* columns outside the projection cannot be added */
+    REQUIRE_RC_FAIL ( VCursorAddColumn ( curs, & ignore, "B" ) );
+    REQUIRE_RC ( VCursorOpen ( curs ) );
+
+    /* reads the same cells as a cursor without projection */
+    const VCursor * plain;
+    uint32_t plain_idx [ 2 ];
+    REQUIRE_RC ( VTableCreateCachedCursorRead ( tbl, & plain, 64 * 1024 * 1024 ) );
+    REQUIRE_RC ( VCursorAddColumn ( plain, & plain_idx [ 0 ], "A" ) );
+    REQUIRE_RC ( VCursorAddColumn ( plain, & plain_idx [ 1 ], "C" ) );
+    REQUIRE_RC ( VCursorOpen ( plain ) );
+    for ( int64_t row = 1; row <= ROW_COUNT; row += 7 )
+    {
+        uint32_t idx [ 2 ] = { col_idx, c_idx };
+        for ( int i = 0; i < 2; ++ i )
+        {
+            uint32_t elem_bits, boff, row_len, plain_bits, plain_boff, plain_len;
+            const void *base, *plain_base;
+            REQUIRE_RC ( VCursorCellDataDirect ( curs, row, idx [ i ], & elem_bits, & base, & boff, & row_len ) );
+            REQUIRE_RC ( VCursorCellDataDirect ( plain, row, plain_idx [ i ], & plain_bits, & plain_base, & plain_boff, & plain_len ) );
+            REQUIRE_EQ ( elem_bits, plain_bits );
+            REQUIRE_EQ ( row_len, plain_len );
+            REQUIRE_EQ ( boff, ( uint32_t ) 0 );
+            REQUIRE_EQ ( plain_boff, ( uint32_t ) 0 );
+            REQUIRE ( memcmp ( base, plain_base, ( elem_bits * row_len + 7 ) / 8 ) == 0 );
+        }
+    }
+    REQUIRE_EQ ( ReadVal ( 1000 ), ( uint32_t ) 3000 );
+    REQUIRE_RC ( VCursorRelease ( plain ) );
+
+    /* only the physical columns behind A and C were opened */
+    KNamelist *names;
+    REQUIRE_RC ( VCursorListPhysicalColumns ( curs, & names ) );
+    uint32_t count;
+    REQUIRE_RC ( KNamelistCount ( names, & count ) );
+    REQUIRE_EQ ( count, ( uint32_t ) 2 );
+    for ( uint32_t i = 0; i < count; ++ i )
+    {
+        const char * name;
+        REQUIRE_RC ( KNamelistGet ( names, i, & name ) );
+        REQUIRE ( strcmp ( name, "A" ) == 0 || strcmp ( name, "C" ) == 0 );
+    }
+    REQUIRE_RC ( KNamelistRelease ( names ) );
+}
+
+/* text columns through zstd, B with a dictionary from table metadata */
+static const char * zstd_schema_text =
+    "version 1;"
+    "fmtdef zstd_fmt;"
+    "function zstd_fmt zstd #1.0 < * I32 level, ascii dict > ( any in ) = vdb:zstd;"
+    "function any unzstd #1.0 < * ascii dict > ( zstd_fmt in ) = vdb:unzstd;"
+    "physical < type T > T zstd_encoding #1.0 < * I32 level, ascii dict >"
+    "{ decode { return unzstd < dict > ( @ ); } encode { return zstd < level, dict > ( @ ); } };"
+    "table S #1 { column < ascii > zstd_encoding A;"
+    " column < ascii > zstd_encoding < 19, 'zstd/dict' > B; };";
+
+static
+string ZstdRowText ( int64_t row )
+{
+    char buf [ 64 ];
+    int n = snprintf ( buf, sizeof buf, "SRR000001.%d ACGT%dTTGCA", ( int ) row, ( int ) ( row * row % 97 ) );
+    return string ( buf, n );
+}
+
+static
+rc_t WriteZstdTable ( VDBManager * mgr, const string & path )
+{
+    VSchema *schema;
+    rc_t rc = VDBManagerMakeSchema ( mgr, & schema );
+    if ( rc == 0 )
+    {
+        rc = VSchemaParseText ( schema, NULL, zstd_schema_text, strlen ( zstd_schema_text ) );
+        if ( rc == 0 )
+        {
+            VTable *wtbl;
+            rc = VDBManagerCreateTable ( mgr, & wtbl, schema, "S", kcmInit, "%s", path . c_str () );
+            if ( rc == 0 )
+            {
+                /* the dictionary must be in place before the cursor opens */
+                KMetadata *meta;
+                rc = VTableOpenMetadataUpdate ( wtbl, & meta );
+                if ( rc == 0 )
+                {
+                    KMDataNode *node;
+                    rc = KMetadataOpenNodeUpdate ( meta, & node, "zstd/dict" );
+                    if ( rc == 0 )
+                    {
+                        string dict;
+                        for ( int64_t row = 1; row <= 64; ++ row )
+                            dict += ZstdRowText ( row * 131 );
+                        rc = KMDataNodeWrite ( node, dict . data (), dict . size () );
+                        KMDataNodeRelease ( node );
+                    }
+                    KMetadataRelease ( meta );
+                }
+
+                VCursor *wcurs;
+                if ( rc == 0 )
+                    rc = VTableCreateCursorWrite ( wtbl, & wcurs, kcmInsert );
+                if ( rc == 0 )
+                {
+                    uint32_t idx [ 2 ];
+                    rc = VCursorAddColumn ( wcurs, & idx [ 0 ], "A" );
+                    if ( rc == 0 )
+                        rc = VCursorAddColumn ( wcurs, & idx [ 1 ], "B" );
+                    if ( rc == 0 )
+                        rc = VCursorOpen ( wcurs );
+                    for ( int64_t row = 1; rc == 0 && row <= ROW_COUNT; ++ row )
+                    {
+                        string text = ZstdRowText ( row );
+                        rc = VCursorOpenRow ( wcurs );
+                        for ( int i = 0; rc == 0 && i < 2; ++ i )
+                            rc = VCursorWrite ( wcurs, idx [ i ], 8, text . data (), 0, text . size () );
+                        if ( rc == 0 )
+                            rc = VCursorCommitRow ( wcurs );
+                        if ( rc == 0 )
+                            rc = VCursorCloseRow ( wcurs );
+                        if ( rc == 0 && row % ROWS_PER_BLOB == 0 )
+                            rc = VCursorFlushPage ( wcurs );
+                    }
+                    if ( rc == 0 )
+                        rc = VCursorCommit ( wcurs );
+                    VCursorRelease ( wcurs );
+                }
+                VTableRelease ( wtbl );
+            }
+        }
+        VSchemaRelease ( schema );
+    }
+    return rc;
+}
+
+FIXTURE_TEST_CASE ( ZstdEncoding, WVdbFixture )
+{
+    path = "test-wvdb-zstd";
+    REQUIRE_RC ( WriteZstdTable ( mgr, path ) );
+    REQUIRE_RC ( VDBManagerOpenTableRead ( mgr, & tbl, NULL, "%s", path . c_str () ) );
+    REQUIRE_RC ( VTableCreateCursorRead ( tbl, & curs ) );
+    uint32_t idx [ 2 ];
+    REQUIRE_RC ( VCursorAddColumn ( curs, & idx [ 0 ], "A" ) );
+    REQUIRE_RC ( VCursorAddColumn ( curs, & idx [ 1 ], "B" ) );
+    REQUIRE_RC ( VCursorOpen ( curs ) );
+    for ( int64_t row = 1; row <= ROW_COUNT; row += 997 )
+    {
+        string expected = ZstdRowText ( row );
+        for ( int i = 0; i < 2; ++ i )
+        {
+            char buf [ 64 ];
+            uint32_t row_len;
+            REQUIRE_RC ( VCursorReadDirect ( curs, row, idx [ i ], 8, buf, sizeof buf, & row_len ) );
+            REQUIRE_EQ ( string ( buf, row_len ), expected );
+        }
+    }
+    REQUIRE_RC ( VCursorRelease ( curs ) );
+    curs = 0;
+    REQUIRE_RC ( VTableRelease ( tbl ) );
+    tbl = 0;
+
+    /* B cannot be decoded once its dictionary is gone */
+    VTable *wtbl;
+    REQUIRE_RC ( VDBManagerOpenTableUpdate ( mgr, & wtbl, NULL, "%s", path . c_str () ) );
+    KMetadata *meta;
+    REQUIRE_RC ( VTableOpenMetadataUpdate ( wtbl, & meta ) );
+    KMDataNode *node;
+    REQUIRE_RC ( KMetadataOpenNodeUpdate ( meta, & node, "zstd" ) );
+    REQUIRE_RC ( KMDataNodeDropChild ( node, "dict" ) );
+    REQUIRE_RC ( KMDataNodeRelease ( node ) );
+    REQUIRE_RC ( KMetadataRelease ( meta ) );
+    REQUIRE_RC ( VTableRelease ( wtbl ) );
+
+    REQUIRE_RC ( VDBManagerOpenTableRead ( mgr, & tbl, NULL, "%s", path . c_str () ) );
+    REQUIRE_RC ( VTableCreateCursorRead ( tbl, & curs ) );
+    REQUIRE_RC ( VCursorAddColumn ( curs, & idx [ 0 ], "A" ) );
+    REQUIRE_RC ( VCursorAddColumn ( curs, & idx [ 1 ], "B" ) );
+    REQUIRE_RC ( VCursorOpen ( curs ) );
+    char buf [ 64 ];
+    uint32_t row_len;
+    REQUIRE_RC ( VCursorReadDirect ( curs, 1, idx [ 0 ], 8, buf, sizeof buf, & row_len ) );
+    REQUIRE_RC_FAIL ( VCursorReadDirect ( curs, 1, idx [ 1 ], 8, buf, sizeof buf, & row_len ) );
+}
+
+/* VAL [ row ] == { row, row + 1, ... } with row % 5 + 1 elements, giving blobs real page maps */
+static
+rc_t WriteVarLenTable ( VDBManager * mgr, const string & path )
+{
+    VSchema *schema;
+    rc_t rc = VDBManagerMakeSchema ( mgr, & schema );
+    if ( rc == 0 )
+    {
+        rc = VSchemaParseText ( schema, NULL, schema_text, strlen ( schema_text ) );
+        if ( rc == 0 )
+        {
+            VTable *wtbl;
+            rc = VDBManagerCreateTable ( mgr, & wtbl, schema, "T", kcmInit, "%s", path . c_str () );
+            if ( rc == 0 )
+            {
+                VCursor *wcurs;
+                rc = VTableCreateCursorWrite ( wtbl, & wcurs, kcmInsert );
+                if ( rc == 0 )
+                {
+                    uint32_t idx;
+                    rc = VCursorAddColumn ( wcurs, & idx, "VAL" );
+                    if ( rc == 0 )
+                        rc = VCursorOpen ( wcurs );
+                    for ( int64_t row = 1; rc == 0 && row <= ROW_COUNT; ++ row )
+                    {
+                        uint32_t val [ 5 ];
+                        for ( uint32_t i = 0; i < 5; ++ i )
+                            val [ i ] = ( uint32_t ) row + i;
+                        rc = VCursorOpenRow ( wcurs );
+                        if ( rc == 0 )
+                            rc = VCursorWrite ( wcurs, idx, 32, val, 0, row % 5 + 1 );
+                        if ( rc == 0 )
+                            rc = VCursorCommitRow ( wcurs );
+                        if ( rc == 0 )
+                            rc = VCursorCloseRow ( wcurs );
+                        if ( rc == 0 && row % ROWS_PER_BLOB == 0 )
+                            rc = VCursorFlushPage ( wcurs );
+                    }
+                    if ( rc == 0 )
+                        rc = VCursorCommit ( wcurs );
+                    VCursorRelease ( wcurs );
+                }
+                VTableRelease ( wtbl );
+            }
+        }
+        VSchemaRelease ( schema );
+    }
+    return rc;
+}
+
+static
+rc_t CC ReadVarLenThread ( const KThread *self, void *data )
+{
+    const VTable *tbl = ( const VTable* ) data;
+    const VCursor *c;
+    uint32_t idx;
+    rc_t rc = VTableCreateCachedCursorRead ( tbl, & c, 1024 * 1024 );
+    if ( rc == 0 )
+    {
+        rc = VCursorAddColumn ( c, & idx, "VAL" );
+        if ( rc == 0 )
+            rc = VCursorOpen ( c );
+        /* read backwards to keep loading new blobs */
+        for ( int64_t row = ROW_COUNT; rc == 0 && row >= 1; -- row )
+        {
+            uint32_t val [ 5 ], row_len;
+            rc = VCursorReadDirect ( c, row, idx, 32, val, 5, & row_len );
+            if ( rc == 0 && ( row_len != row % 5 + 1 || val [ 0 ] != ( uint32_t ) row || val [ row_len - 1 ] != ( uint32_t ) row + row_len - 1 ) )
+                rc = RC ( rcVDB, rcCursor, rcReading, rcData, rcCorrupt );
+        }
+        VCursorRelease ( c );
+    }
+    return rc;
+}
+
+FIXTURE_TEST_CASE ( PagemapPool_Threads, WVdbFixture )
+{
+    /* cursors on several threads share the manager's pagemap workers */
+    path = "test-wvdb-pagemap-pool";
+    REQUIRE_RC ( WriteVarLenTable ( mgr, path ) );
+    REQUIRE_RC ( VDBManagerOpenTableRead ( mgr, & tbl, NULL, "%s", path . c_str () ) );
+
+    const int THREADS = 8;
+    KThread *t [ THREADS ];
+    for ( int i = 0; i < THREADS; ++ i )
+        REQUIRE_RC ( KThreadMake ( & t [ i ], ReadVarLenThread, ( void* ) tbl ) );
+    for ( int i = 0; i < THREADS; ++ i )
+    {
+        rc_t status;
+        REQUIRE_RC ( KThreadWait ( t [ i ], & status ) );
+        REQUIRE_RC ( status );
+        REQUIRE_RC ( KThreadRelease ( t [ i ] ) );
+    }
+}
+
+/* integer columns through ibpzip */
+static const char * ibp_schema_text =
+    "version 1;"
+    "fmtdef ibp_fmt;"
+    "function ibp_fmt ibpzip #1.0 ( any in ) = vdb:ibpzip;"
+    "function any ibpunzip #1.0 ( ibp_fmt in ) = vdb:ibpunzip;"
+    "physical < type T > T ibpzip_encoding #1.0"
+    "{ decode { return ( T ) ibpunzip ( @ ); } encode { return ibpzip ( @ ); } };"
+    "table I #1 { column < U32 > ibpzip_encoding POS; column < I16 > ibpzip_encoding Q;"
+    " column < U64 > ibpzip_encoding L; };";
+
+static
+rc_t WriteIbpTable ( VDBManager * mgr, const string & path )
+{
+    VSchema *schema;
+    rc_t rc = VDBManagerMakeSchema ( mgr, & schema );
+    if ( rc == 0 )
+    {
+        rc = VSchemaParseText ( schema, NULL, ibp_schema_text, strlen ( ibp_schema_text ) );
+        if ( rc == 0 )
+        {
+            VTable *wtbl;
+            rc = VDBManagerCreateTable ( mgr, & wtbl, schema, "I", kcmInit, "%s", path . c_str () );
+            if ( rc == 0 )
+            {
+                VCursor *wcurs;
+                rc = VTableCreateCursorWrite ( wtbl, & wcurs, kcmInsert );
+                if ( rc == 0 )
+                {
+                    uint32_t idx [ 3 ];
+                    rc = VCursorAddColumn ( wcurs, & idx [ 0 ], "POS" );
+                    if ( rc == 0 )
+                        rc = VCursorAddColumn ( wcurs, & idx [ 1 ], "Q" );
+                    if ( rc == 0 )
+                        rc = VCursorAddColumn ( wcurs, & idx [ 2 ], "L" );
+                    if ( rc == 0 )
+                        rc = VCursorOpen ( wcurs );
+                    for ( int64_t row = 1; rc == 0 && row <= ROW_COUNT; ++ row )
+                    {
+                        uint32_t pos = ( uint32_t ) ( row * 150 + row % 13 );
+                        int16_t q = ( int16_t ) ( row % 61 - 30 );
+                        uint64_t l = ( uint64_t ) row << 40;
+                        rc = VCursorOpenRow ( wcurs );
+                        if ( rc == 0 )
+                            rc = VCursorWrite ( wcurs, idx [ 0 ], 32, & pos, 0, 1 );
+                        if ( rc == 0 )
+                            rc = VCursorWrite ( wcurs, idx [ 1 ], 16, & q, 0, 1 );
+                        if ( rc == 0 )
+                            rc = VCursorWrite ( wcurs, idx [ 2 ], 64, & l, 0, 1 );
+                        if ( rc == 0 )
+                            rc = VCursorCommitRow ( wcurs );
+                        if ( rc == 0 )
+                            rc = VCursorCloseRow ( wcurs );
+                        if ( rc == 0 && row % ROWS_PER_BLOB == 0 )
+                            rc = VCursorFlushPage ( wcurs );
+                    }
+                    if ( rc == 0 )
+                        rc = VCursorCommit ( wcurs );
+                    VCursorRelease ( wcurs );
+                }
+                VTableRelease ( wtbl );
+            }
+        }
+        VSchemaRelease ( schema );
+    }
+    return rc;
+}
+
+FIXTURE_TEST_CASE ( IbpzipEncoding, WVdbFixture )
+{
+    path = "test-wvdb-ibpzip";
+    REQUIRE_RC ( WriteIbpTable ( mgr, path ) );
+    REQUIRE_RC ( VDBManagerOpenTableRead ( mgr, & tbl, NULL, "%s", path . c_str () ) );
+    REQUIRE_RC ( VTableCreateCursorRead ( tbl, & curs ) );
+
+    uint32_t idx [ 3 ];
+    REQUIRE_RC ( VCursorAddColumn ( curs, & idx [ 0 ], "POS" ) );
+    REQUIRE_RC ( VCursorAddColumn ( curs, & idx [ 1 ], "Q" ) );
+    REQUIRE_RC ( VCursorAddColumn ( curs, & idx [ 2 ], "L" ) );
+    REQUIRE_RC ( VCursorOpen ( curs ) );
+
+    for ( int64_t row = 1; row <= ROW_COUNT; ++ row )
+    {
+        uint32_t pos, row_len;
+        int16_t q;
+        uint64_t l;
+        REQUIRE_RC ( VCursorReadDirect ( curs, row, idx [ 0 ], 32, & pos, 1, & row_len ) );
+        REQUIRE_EQ ( pos, ( uint32_t ) ( row * 150 + row % 13 ) );
+        REQUIRE_RC ( VCursorReadDirect ( curs, row, idx [ 1 ], 16, & q, 1, & row_len ) );
+        REQUIRE_EQ ( q, ( int16_t ) ( row % 61 - 30 ) );
+        REQUIRE_RC ( VCursorReadDirect ( curs, row, idx [ 2 ], 64, & l, 1, & row_len ) );
+        REQUIRE_EQ ( l, ( uint64_t ) row << 40 );
+    }
+
+    /* sorted positions take a few bits each */
+    REQUIRE_LT ( ReadColumnData ( path, "POS" ) . size (), ( size_t ) ROW_COUNT * 2 );
+}
+
+/* a SEQUENCE table whose READ is restored from PRIMARY_ALIGNMENT */
+static const char * restore_schema_text =
+    "version 1;"
+    "typedef U8 INSDC:4na:bin;"
+    "function INSDC:4na:bin restore_read #1"
+    " ( INSDC:4na:bin rd, I64 align_id, U32 read_len, U8 read_type ) = ALIGN:seq_restore_read;"
+    "table PA #1 { column INSDC:4na:bin READ; };"
+    "table SEQ #1 { column INSDC:4na:bin CMP_READ; column I64 PRIMARY_ALIGNMENT_ID;"
+    " column U32 READ_LEN; column U8 READ_TYPE;"
+    " readonly column INSDC:4na:bin READ"
+    " = restore_read ( .CMP_READ, .PRIMARY_ALIGNMENT_ID, .READ_LEN, .READ_TYPE ); };"
+    "database D #1 { table PA #1 PRIMARY_ALIGNMENT; table SEQ #1 SEQUENCE; };";
+
+/* two reads per spot; some aligned, on either strand */
+static
+uint32_t RestoreReadLen ( int64_t row, int read )
+{
+    return read == 0 ? 20 + row % 13 : 30 + row % 7;
+}
+
+static
+bool RestoreReadAligned ( int64_t row, int read )
+{
+    return read == 0 ? row % 3 != 0 : row % 5 != 0;
+}
+
+static
+bool RestoreReadReverse ( int64_t row, int read )
+{
+    return ( row + read ) % 2 != 0;
+}
+
+static
+string RestoreReadBases ( int64_t row, int read )
+{
+    string bases ( RestoreReadLen ( row, read ), 0 );
+    for ( size_t j = 0; j < bases . size (); ++ j )
+        bases [ j ] = j % 17 == 0 ? 15 : 1 << ( ( row * 7 + read * 3 + j * j ) % 4 );
+    return bases;
+}
+
+static
+rc_t WriteRestoreDB ( VDBManager * mgr, const string & path, int64_t * align_id )
+{
+    /* alignments are stored out of spot order, as if sorted by position */
+    vector < int64_t > order;
+    for ( int64_t row = 1; row <= ROW_COUNT; ++ row )
+        for ( int read = 0; read < 2; ++ read )
+            if ( RestoreReadAligned ( row, read ) )
+                order . push_back ( row * 2 + read );
+    uint64_t state = 1;
+    for ( size_t i = order . size (); i > 1; -- i )
+    {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        swap ( order [ i - 1 ], order [ ( state >> 33 ) % i ] );
+    }
+
+    VSchema *schema;
+    rc_t rc = VDBManagerMakeSchema ( mgr, & schema );
+    if ( rc == 0 )
+    {
+        rc = VSchemaParseText ( schema, NULL, restore_schema_text, strlen ( restore_schema_text ) );
+        if ( rc == 0 )
+        {
+            VDatabase *db;
+            rc = VDBManagerCreateDB ( mgr, & db, schema, "D", kcmInit, "%s", path . c_str () );
+            if ( rc == 0 )
+            {
+                VTable *wtbl;
+                rc = VDatabaseCreateTable ( db, & wtbl, "PRIMARY_ALIGNMENT", kcmInit, "PRIMARY_ALIGNMENT" );
+                if ( rc == 0 )
+                {
+                    VCursor *wcurs;
+                    rc = VTableCreateCursorWrite ( wtbl, & wcurs, kcmInsert );
+                    if ( rc == 0 )
+                    {
+                        uint32_t idx;
+                        rc = VCursorAddColumn ( wcurs, & idx, "READ" );
+                        if ( rc == 0 )
+                            rc = VCursorOpen ( wcurs );
+                        for ( size_t i = 0; rc == 0 && i < order . size (); ++ i )
+                        {
+                            int64_t row = order [ i ] / 2;
+                            int read = ( int ) ( order [ i ] % 2 );
+                            string bases = RestoreReadBases ( row, read );
+                            if ( RestoreReadReverse ( row, read ) )
+                            {
+                                /* reverse complement: 4na complement reverses the bits */
+                                string rc_bases ( bases . rbegin (), bases . rend () );
+                                for ( size_t j = 0; j < rc_bases . size (); ++ j )
+                                {
+                                    uint8_t b = rc_bases [ j ];
+                                    rc_bases [ j ] = ( ( b & 1 ) << 3 ) | ( ( b & 2 ) << 1 ) | ( ( b & 4 ) >> 1 ) | ( ( b & 8 ) >> 3 );
+                                }
+                                bases = rc_bases;
+                            }
+                            align_id [ order [ i ] ] = ( int64_t ) i + 1;
+
+                            rc = VCursorOpenRow ( wcurs );
+                            if ( rc == 0 )
+                                rc = VCursorWrite ( wcurs, idx, 8, bases . data (), 0, bases . size () );
+                            if ( rc == 0 )
+                                rc = VCursorCommitRow ( wcurs );
+                            if ( rc == 0 )
+                                rc = VCursorCloseRow ( wcurs );
+                            if ( rc == 0 && ( i + 1 ) % ROWS_PER_BLOB == 0 )
+                                rc = VCursorFlushPage ( wcurs );
+                        }
+                        if ( rc == 0 )
+                            rc = VCursorCommit ( wcurs );
+                        VCursorRelease ( wcurs );
+                    }
+                    VTableRelease ( wtbl );
+                }
+
+                if ( rc == 0 )
+                    rc = VDatabaseCreateTable ( db, & wtbl, "SEQUENCE", kcmInit, "SEQUENCE" );
+                if ( rc == 0 )
+                {
+                    VCursor *wcurs;
+                    rc = VTableCreateCursorWrite ( wtbl, & wcurs, kcmInsert );
+                    if ( rc == 0 )
+                    {
+                        static const char * names [ 4 ] = { "CMP_READ", "PRIMARY_ALIGNMENT_ID", "READ_LEN", "READ_TYPE" };
+                        uint32_t idx [ 4 ];
+                        for ( int i = 0; rc == 0 && i < 4; ++ i )
+                            rc = VCursorAddColumn ( wcurs, & idx [ i ], names [ i ] );
+                        if ( rc == 0 )
+                            rc = VCursorOpen ( wcurs );
+                        for ( int64_t row = 1; rc == 0 && row <= ROW_COUNT; ++ row )
+                        {
+                            string cmp_read;
+                            int64_t ids [ 2 ];
+                            uint32_t len [ 2 ];
+                            uint8_t type [ 2 ];
+                            for ( int read = 0; read < 2; ++ read )
+                            {
+                                ids [ read ] = RestoreReadAligned ( row, read ) ? align_id [ row * 2 + read ] : 0;
+                                if ( ids [ read ] == 0 )
+                                    cmp_read += RestoreReadBases ( row, read );
+                                len [ read ] = RestoreReadLen ( row, read );
+                                type [ read ] = SRA_READ_TYPE_BIOLOGICAL |
+                                    ( RestoreReadReverse ( row, read ) ? SRA_READ_TYPE_REVERSE : SRA_READ_TYPE_FORWARD );
+                            }
+
+                            rc = VCursorOpenRow ( wcurs );
+                            if ( rc == 0 )
+                                rc = VCursorWrite ( wcurs, idx [ 0 ], 8, cmp_read . data (), 0, cmp_read . size () );
+                            if ( rc == 0 )
+                                rc = VCursorWrite ( wcurs, idx [ 1 ], 64, ids, 0, 2 );
+                            if ( rc == 0 )
+                                rc = VCursorWrite ( wcurs, idx [ 2 ], 32, len, 0, 2 );
+                            if ( rc == 0 )
+                                rc = VCursorWrite ( wcurs, idx [ 3 ], 8, type, 0, 2 );
+                            if ( rc == 0 )
+                                rc = VCursorCommitRow ( wcurs );
+                            if ( rc == 0 )
+                                rc = VCursorCloseRow ( wcurs );
+                            if ( rc == 0 && row % ROWS_PER_BLOB == 0 )
+                                rc = VCursorFlushPage ( wcurs );
+                        }
+                        if ( rc == 0 )
+                            rc = VCursorCommit ( wcurs );
+                        VCursorRelease ( wcurs );
+                    }
+                    VTableRelease ( wtbl );
+                }
+                VDatabaseRelease ( db );
+            }
+        }
+        VSchemaRelease ( schema );
+    }
+    return rc;
+}
+
+FIXTURE_TEST_CASE ( SeqRestoreRead, WVdbFixture )
+{
+    path = "test-wvdb-restore";
+    vector < int64_t > align_id ( ( ROW_COUNT + 1 ) * 2 );
+    REQUIRE_RC ( WriteRestoreDB ( mgr, path, & align_id [ 0 ] ) );
+
+    const VDatabase *db;
+    REQUIRE_RC ( VDBManagerOpenDBRead ( mgr, & db, NULL, "%s", path . c_str () ) );
+    REQUIRE_RC ( VDatabaseOpenTableRead ( db, & tbl, "SEQUENCE" ) );
+    REQUIRE_RC ( VDatabaseRelease ( db ) );
+
+    /* a full pass, then rows out of order */
+    for ( int pass = 0; pass < 2; ++ pass )
+    {
+        uint32_t idx;
+        REQUIRE_RC ( VTableCreateCursorRead ( tbl, & curs ) );
+        REQUIRE_RC ( VCursorAddColumn ( curs, & idx, "READ" ) );
+        REQUIRE_RC ( VCursorOpen ( curs ) );
+        for ( int64_t i = 1; i <= ROW_COUNT; i += pass == 0 ? 1 : 997 )
+        {
+            int64_t row = pass == 0 ? i : ROW_COUNT + 1 - i;
+            string expected = RestoreReadBases ( row, 0 ) + RestoreReadBases ( row, 1 );
+            char buf [ 128 ];
+            uint32_t row_len;
+            REQUIRE_RC ( VCursorReadDirect ( curs, row, idx, 8, buf, sizeof buf, & row_len ) );
+            REQUIRE_EQ ( string ( buf, row_len ), expected );
+        }
+        REQUIRE_RC ( VCursorRelease ( curs ) );
+        curs = 0;
+    }
+}
+
+//////////////////////////////////////////// Main
+extern "C"
+{
+
+#include <kapp/args.h>
+
+ver_t CC KAppVersion ( void )
+{
+    return 0x1000000;
+}
+rc_t CC UsageSummary (const char * progname)
+{
+    return 0;
+}
+
+rc_t CC Usage ( const Args * args )
+{
+    return 0;
+}
+
+const char UsageDefaultName[] = "test-wvdb";
+
+rc_t CC KMain ( int argc, char *argv [] )
+{
+    KConfigDisableUserSettings();
+    rc_t rc=WVdbTestSuite(argc, argv);
+    return rc;
+}
+
+}
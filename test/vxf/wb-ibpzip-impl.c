@@ -0,0 +1,76 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#include "wb-ibpzip-impl.h"
+
+#define vdb_ibpzip test_vdb_ibpzip
+#define vdb_ibpunzip test_vdb_ibpunzip
+
+#include "../libs/vxf/ibpzip.c"
+#include "../libs/vxf/ibpunzip.c"
+
+static ibp_unpack32_f get_kernel(int kernel)
+{
+    switch (kernel) {
+    case ibpKernelScalar:
+        return ibp_unpack32_scalar;
+#if IBP_X86_KERNELS
+    case ibpKernelSSE2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("sse2") ? ibp_unpack32_sse2 : NULL;
+    case ibpKernelAVX2:
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2") ? ibp_unpack32_avx2 : NULL;
+#endif
+    }
+    return NULL;
+}
+
+int ibpKernelAvailable(int kernel)
+{
+    return get_kernel(kernel) != NULL;
+}
+
+rc_t doEncode_ibp(uint8_t dst[], size_t dsize, size_t *used, const void *Y, uint64_t N, uint32_t elem_bits, int is_signed)
+{
+    return ibp_encode(dst, dsize, used, Y, N, elem_bits, is_signed != 0);
+}
+
+rc_t doDecode_ibp(void *Y, uint64_t N, uint32_t elem_bits, const uint8_t src[], size_t ssize, int kernel)
+{
+    ibp_unpack32_f f = get_kernel(kernel);
+    if (f == NULL)
+        return RC(rcXF, rcFunction, rcExecuting, rcFunction, rcUnsupported);
+    return ibp_decode(Y, N, elem_bits, src, ssize, f);
+}
+
+rc_t doDecodeRange_ibp(void *Y, uint64_t first, uint64_t n, uint64_t N, uint32_t elem_bits, const uint8_t src[], size_t ssize, int kernel)
+{
+    ibp_unpack32_f f = get_kernel(kernel);
+    if (f == NULL)
+        return RC(rcXF, rcFunction, rcExecuting, rcFunction, rcUnsupported);
+    return ibp_decode_range(Y, first, n, N, elem_bits, src, ssize, f);
+}
@@ -0,0 +1,50 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+#ifndef _h_ibpzip_impl_
+#define _h_ibpzip_impl_
+
+#include <klib/rc.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* unpacking kernels */
+enum { ibpKernelScalar, ibpKernelSSE2, ibpKernelAVX2 };
+
+/* non-zero if the kernel was built and the processor runs it */
+int ibpKernelAvailable(int kernel);
+
+rc_t doEncode_ibp(uint8_t dst[], size_t dsize, size_t *used, const void *Y, uint64_t N, uint32_t elem_bits, int is_signed);
+rc_t doDecode_ibp(void *Y, uint64_t N, uint32_t elem_bits, const uint8_t src[], size_t ssize, int kernel);
+rc_t doDecodeRange_ibp(void *Y, uint64_t first, uint64_t n, uint64_t N, uint32_t elem_bits, const uint8_t src[], size_t ssize, int kernel);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -29,6 +29,19 @@
 TEST_SUITE(VxfTestSuite);
 
 #include "wb-irzip-impl.h"
+#include "wb-ibpzip-impl.h"
+#include "wb-zip-impl.h"
+
+#include <vector>
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#include "../search/PerfCounter.h"
+
+using namespace std;
 
 ////////////////////////////////////////// IZIP encoding tests
 
@@ -235,6 +248,244 @@ FIXTURE_TEST_CASE(IRZIP_i32_assert1, EncoderFixture)
     REQUIRE_EQ_ARR(y, decoded, ARR_SIZE(y));
 }
 
+////////////////////////////////////////// IBPZIP encoding tests
+
+class IbpFixture
+{
+public:
+    IbpFixture()
+    : buf(1024 * 1024), used(0)
+    {
+    }
+
+    template < typename T >
+    rc_t Encode(const vector<T> &y, bool is_signed)
+    {
+        return doEncode_ibp(&buf[0], buf.size(), &used, &y[0], y.size(), sizeof(T) * 8, is_signed);
+    }
+
+    // every kernel this processor runs decodes the same values
+    template < typename T >
+    bool DecodesWithAllKernels(const vector<T> &y)
+    {
+        int kernels = 0;
+        for (int kernel = ibpKernelScalar; kernel <= ibpKernelAVX2; ++kernel)
+        {
+            if (!ibpKernelAvailable(kernel))
+                continue;
+            vector<T> decoded(y.size());
+            if (doDecode_ibp(&decoded[0], y.size(), sizeof(T) * 8, &buf[0], used, kernel) != 0 || decoded != y)
+                return false;
+            ++kernels;
+        }
+        return kernels != 0;
+    }
+
+    vector<uint8_t> buf;
+    size_t used;
+};
+
+// sorted positions are delta coded to a few bits each
+FIXTURE_TEST_CASE(IBPZIP_u32_positions, IbpFixture)
+{
+    vector<uint32_t> y(10000);
+    uint32_t pos = 1000000;
+    srand(1);
+    for (size_t i = 0; i < y.size(); ++i)
+        y[i] = pos += rand() % 300;
+    REQUIRE_RC(Encode(y, false));
+    REQUIRE_LT(used, y.size() * 2);
+    REQUIRE(DecodesWithAllKernels(y));
+}
+
+FIXTURE_TEST_CASE(IBPZIP_i16_signed, IbpFixture)
+{
+    vector<int16_t> y(777);
+    srand(2);
+    for (size_t i = 0; i < y.size(); ++i)
+        y[i] = (int16_t)(rand() % 41 - 20);
+    REQUIRE_RC(Encode(y, true));
+    REQUIRE_LT(used, y.size());
+    REQUIRE(DecodesWithAllKernels(y));
+}
+
+FIXTURE_TEST_CASE(IBPZIP_u8_constant, IbpFixture)
+{
+    vector<uint8_t> y(513, 42);
+    REQUIRE_RC(Encode(y, false));
+    REQUIRE_EQ(used, (size_t)(3 * 5));
+    REQUIRE(DecodesWithAllKernels(y));
+}
+
+// full width blocks in both coding domains
+FIXTURE_TEST_CASE(IBPZIP_i32_extremes, IbpFixture)
+{
+    vector<int32_t> y(300);
+    for (size_t i = 0; i < y.size(); ++i)
+        y[i] = (i & 1) ? INT32_MAX - (int32_t)i : INT32_MIN + (int32_t)i;
+    REQUIRE_RC(Encode(y, true));
+    REQUIRE(DecodesWithAllKernels(y));
+}
+
+FIXTURE_TEST_CASE(IBPZIP_u64_wide, IbpFixture)
+{
+    vector<uint64_t> y(1000);
+    srand(3);
+    for (size_t i = 0; i < y.size(); ++i)
+        y[i] = i < 256 ? ((uint64_t)rand() << 40) ^ (uint64_t)rand() ^ ((uint64_t)i << 63)
+                       : (UINT64_C(1) << 50) + i * 7;
+    REQUIRE_RC(Encode(y, false));
+    REQUIRE(DecodesWithAllKernels(y));
+}
+
+FIXTURE_TEST_CASE(IBPZIP_incompressible, IbpFixture)
+{
+    vector<uint32_t> y(256);
+    srand(4);
+    for (size_t i = 0; i < y.size(); ++i)
+        y[i] = ((uint32_t)rand() << 16) ^ (uint32_t)rand() ^ ((uint32_t)i << 31);
+    buf.resize(y.size() * sizeof(y[0]));
+    REQUIRE_RC_FAIL(Encode(y, false));
+}
+
+FIXTURE_TEST_CASE(IBPZIP_corrupt, IbpFixture)
+{
+    vector<uint32_t> y(1000);
+    for (size_t i = 0; i < y.size(); ++i)
+        y[i] = (uint32_t)(i * i);
+    REQUIRE_RC(Encode(y, false));
+
+    vector<uint32_t> decoded(y.size());
+    REQUIRE_RC_FAIL(doDecode_ibp(&decoded[0], y.size(), 32, &buf[0], used - 1, ibpKernelScalar));
+    buf[0] = 0x7F;
+    REQUIRE_RC_FAIL(doDecode_ibp(&decoded[0], y.size(), 32, &buf[0], used, ibpKernelScalar));
+}
+
+// ranges decode as the same elements of the whole blob
+FIXTURE_TEST_CASE(IBPZIP_range, IbpFixture)
+{
+    vector<uint16_t> y(5000);
+    for (size_t i = 0; i < y.size(); ++i)
+        y[i] = (uint16_t)(i * 7 + i % 13);
+    REQUIRE_RC(Encode(y, false));
+
+    const uint64_t ranges[][2] = { { 0, 1 }, { 300, 1 }, { 250, 20 }, { 256, 256 }, { 100, 4000 }, { 4999, 1 }, { 0, 5000 } };
+    for (int kernel = ibpKernelScalar; kernel <= ibpKernelAVX2; ++kernel)
+    {
+        if (!ibpKernelAvailable(kernel))
+            continue;
+        for (size_t r = 0; r < countof(ranges); ++r)
+        {
+            vector<uint16_t> decoded(ranges[r][1]);
+            REQUIRE_RC(doDecodeRange_ibp(&decoded[0], ranges[r][0], ranges[r][1], y.size(), 16, &buf[0], used, kernel));
+            REQUIRE(equal(decoded.begin(), decoded.end(), y.begin() + ranges[r][0]));
+        }
+    }
+
+    uint16_t one;
+    REQUIRE_RC_FAIL(doDecodeRange_ibp(&one, 5000, 1, y.size(), 16, &buf[0], used, ibpKernelScalar));
+    REQUIRE_RC_FAIL(doDecodeRange_ibp(&one, 4999, 2, y.size(), 16, &buf[0], used, ibpKernelScalar));
+}
+
+// a single row unpacks only the block holding it
+FIXTURE_TEST_CASE(IBPZIP_range_one_block, IbpFixture)
+{
+    vector<uint32_t> y(2000);
+    for (size_t i = 0; i < y.size(); ++i)
+        y[i] = (uint32_t)(i * i);
+    REQUIRE_RC(Encode(y, false));
+
+    // scribble over the packed data past the first block
+    const size_t blocks = (y.size() + 255) / 256;
+    const size_t dir = blocks * 5;
+    const size_t first_block = (buf[0] & 0x7F) * 32;
+    for (size_t i = dir + first_block; i < used; ++i)
+        buf[i] ^= 0x5A;
+
+    uint32_t v;
+    REQUIRE_RC(doDecodeRange_ibp(&v, 17, 1, y.size(), 32, &buf[0], used, ibpKernelScalar));
+    REQUIRE_EQ(v, y[17]);
+}
+
+////////////////////////////////////////// ZIP throughput
+
+class ZipFixture
+{
+public:
+    ZipFixture()
+    : codec(0)
+    {
+    }
+    ~ZipFixture()
+    {
+        if (codec != 0)
+            ZipCodecWhack(codec);
+    }
+
+    ZipCodec *codec;
+};
+
+// blobs zipped and unzipped by one function instance, with the zlib
+// streams kept across blobs and torn down after each. stream setup
+// weighs most on small blobs
+FIXTURE_TEST_CASE(ZIP_throughput, ZipFixture)
+{
+    const size_t sizes[] = { 4 * 1024, 64 * 1024 };
+    const size_t total = 16 * 1024 * 1024;
+    const int passes = 4;
+
+    // quality-like values: runs of a few symbols, compressible but not trivially
+    srand(22);
+    vector<uint8_t> data(total);
+    for (size_t i = 0; i < data.size(); )
+    {
+        uint8_t q = (uint8_t)(30 + rand() % 12);
+        for (size_t run = 1 + rand() % 8; run != 0 && i < data.size(); --run)
+            data[i++] = q;
+    }
+
+    REQUIRE_RC(ZipCodecMake(&codec, Z_RLE, Z_BEST_SPEED));
+
+    for (size_t s = 0; s < countof(sizes); ++s)
+    {
+        const size_t blob_bytes = sizes[s];
+        const size_t blobs = total / blob_bytes;
+        vector<uint8_t> zipped(blob_bytes + blob_bytes / 8 + 64);
+        vector< vector<uint8_t> > packed(blobs);
+        vector<uint8_t> unzipped(blob_bytes);
+
+        for (int reuse = 0; reuse <= 1; ++reuse)
+        {
+            CPerfCounter zip_counter(reuse ? "zip kept" : "zip fresh");
+            {
+                CPCount count(zip_counter);
+                for (int pass = 0; pass < passes; ++pass)
+                    for (size_t b = 0; b < blobs; ++b)
+                    {
+                        size_t used;
+                        REQUIRE_RC(doZip(codec, &zipped[0], zipped.size(), &used, &data[b * blob_bytes], blob_bytes, reuse));
+                        if (pass == 0)
+                            packed[b].assign(zipped.begin(), zipped.begin() + used);
+                    }
+            }
+
+            CPerfCounter unzip_counter(reuse ? "unzip kept" : "unzip fresh");
+            {
+                CPCount count(unzip_counter);
+                for (int pass = 0; pass < passes; ++pass)
+                    for (size_t b = 0; b < blobs; ++b)
+                        REQUIRE_RC(doUnzip(codec, &unzipped[0], blob_bytes, &packed[b][0], packed[b].size(), reuse));
+            }
+            REQUIRE(memcmp(&unzipped[0], &data[(blobs - 1) * blob_bytes], blob_bytes) == 0);
+
+            printf("%5u KB blobs, streams %-5s zip: %.1f MB/s unzip: %.1f MB/s\n",
+                (unsigned int)(blob_bytes / 1024), reuse ? "kept" : "fresh",
+                (double)total * passes / zip_counter.GetSeconds() / 1e6,
+                (double)total * passes / unzip_counter.GetSeconds() / 1e6);
+        }
+    }
+}
+
 //////////////////////////////////////////// Main
 extern "C"
 {
@@ -0,0 +1,94 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+
+#include "wb-zip-impl.h"
+
+#define vdb_zip test_vdb_zip
+#define prepare_zlib zip_prepare_zlib
+#define invoke_zlib zip_invoke_zlib
+#include "../libs/vxf/zip.c"
+#undef prepare_zlib
+#undef invoke_zlib
+
+#define vdb_unzip test_vdb_unzip
+#define NCBI_unzip test_NCBI_unzip
+#define prepare_zlib unzip_prepare_zlib
+#define invoke_zlib unzip_invoke_zlib
+#include "../libs/vxf/unzip.c"
+
+struct ZipCodec
+{
+    struct self_t zip;
+    unzip_t unzip;
+};
+
+rc_t ZipCodecMake(ZipCodec **codec, int strategy, int level)
+{
+    ZipCodec *self = calloc(1, sizeof *self);
+    if (self == NULL)
+        return RC(rcXF, rcFunction, rcConstructing, rcMemory, rcExhausted);
+    self->zip.strategy = strategy;
+    self->zip.level = level;
+    self->unzip.windowBits = -15;
+    *codec = self;
+    return 0;
+}
+
+void ZipCodecWhack(ZipCodec *self)
+{
+    if (self->zip.initialized)
+        deflateEnd(&self->zip.s);
+    if (self->unzip.initialized)
+        inflateEnd(&self->unzip.s);
+    free(self);
+}
+
+rc_t doZip(ZipCodec *self, uint8_t dst[], size_t dsize, size_t *used, const void *src, size_t ssize, int reuse)
+{
+    uint32_t size = (uint32_t)dsize;
+    rc_t rc = zip_invoke_zlib(&self->zip, dst, &size, src, (uint32_t)ssize);
+    if (rc == 0 && size == 0)
+        rc = RC(rcXF, rcFunction, rcExecuting, rcBuffer, rcInsufficient);
+    *used = size;
+    if (!reuse && self->zip.initialized)
+    {
+        deflateEnd(&self->zip.s);
+        self->zip.initialized = false;
+    }
+    return rc;
+}
+
+rc_t doUnzip(ZipCodec *self, void *dst, size_t dsize, const uint8_t src[], size_t ssize, int reuse)
+{
+    rc_t rc = unzip_invoke_zlib(&self->unzip, dst, dsize, src, ssize);
+    if (!reuse && self->unzip.initialized)
+    {
+        inflateEnd(&self->unzip.s);
+        self->unzip.initialized = false;
+    }
+    return rc;
+}
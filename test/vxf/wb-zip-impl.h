@@ -0,0 +1,52 @@
+/*===========================================================================
+*
+*                            PUBLIC DOMAIN NOTICE
+*               National Center for Biotechnology Information
+*
+*  This software/database is a "United States Government Work" under the
+*  terms of the United States Copyright Act.  It was written as part of
+*  the author's official duties as a United States Government employee and
+*  thus cannot be copyrighted.  This software/database is freely available
+*  to the public for use. The National Library of Medicine and the U.S.
+*  Government have not placed any restriction on its use or reproduction.
+*
+*  Although all reasonable efforts have been taken to ensure the accuracy
+*  and reliability of the software and data, the NLM and the U.S.
+*  Government do not and cannot warrant the performance or results that
+*  may be obtained by using this software or data. The NLM and the U.S.
+*  Government disclaim all warranties, express or implied, including
+*  warranties of performance, merchantability or fitness for any particular
+*  purpose.
+*
+*  Please cite the author in any work or product based on this material.
+*
+* ===========================================================================
+*
+*/
+
+
+#ifndef _h_zip_impl_
+#define _h_zip_impl_
+
+#include <klib/rc.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* a vdb:zip and a vdb:unzip function instance, as productions hold them */
+typedef struct ZipCodec ZipCodec;
+
+rc_t ZipCodecMake(ZipCodec **codec, int strategy, int level);
+void ZipCodecWhack(ZipCodec *codec);
+
+/* with "reuse" zero the zlib streams are torn down after every blob,
+   as they were before instances kept them */
+rc_t doZip(ZipCodec *codec, uint8_t dst[], size_t dsize, size_t *used, const void *src, size_t ssize, int reuse);
+rc_t doUnzip(ZipCodec *codec, void *dst, size_t dsize, const uint8_t src[], size_t ssize, int reuse);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif